@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace common {
+namespace base64 {
+
+    // ============================================================================
+    // Base64 - Table-driven codec (RFC 4648, standard alphabet)
+    // ============================================================================
+    // Encode and decode write into a buffer sized once up front: no per-byte
+    // push_back, and decoding is one table lookup per character instead of a
+    // search through the alphabet.
+    //
+    // Decoding stops at the first '=' or character outside the alphabet (the
+    // behaviour of the old text-upload decoder); whatever was decoded up to
+    // there is returned.
+    // ============================================================================
+
+    constexpr char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    constexpr uint8_t INVALID = 0xFF;
+
+    namespace detail {
+        constexpr std::array<uint8_t, 256> make_decode_table() {
+            std::array<uint8_t, 256> table{};
+            for (auto& v : table) v = INVALID;
+            for (uint8_t i = 0; i < 64; ++i) table[static_cast<uint8_t>(ALPHABET[i])] = i;
+            return table;
+        }
+        constexpr std::array<uint8_t, 256> DECODE_TABLE = make_decode_table();
+    }
+
+    inline size_t encoded_size(size_t len) { return (len + 2) / 3 * 4; }
+
+    // Upper bound for decode() output
+    inline size_t decoded_size_max(size_t len) { return len / 4 * 3 + 3; }
+
+    // Writes exactly encoded_size(len) characters to out
+    inline void encode(const uint8_t* data, size_t len, char* out) {
+        size_t i = 0;
+        for (; i + 2 < len; i += 3) {
+            uint32_t n = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+            *out++ = ALPHABET[(n >> 18) & 0x3F];
+            *out++ = ALPHABET[(n >> 12) & 0x3F];
+            *out++ = ALPHABET[(n >> 6) & 0x3F];
+            *out++ = ALPHABET[n & 0x3F];
+        }
+        if (i < len) {
+            uint32_t n = uint32_t(data[i]) << 16;
+            if (i + 1 < len) n |= uint32_t(data[i + 1]) << 8;
+            *out++ = ALPHABET[(n >> 18) & 0x3F];
+            *out++ = ALPHABET[(n >> 12) & 0x3F];
+            *out++ = (i + 1 < len) ? ALPHABET[(n >> 6) & 0x3F] : '=';
+            *out++ = '=';
+        }
+    }
+
+    inline std::string encode(const uint8_t* data, size_t len) {
+        std::string out(encoded_size(len), '\0');
+        encode(data, len, &out[0]);
+        return out;
+    }
+
+    // Returns the number of bytes written (at most decoded_size_max(len))
+    inline size_t decode(const char* in, size_t len, uint8_t* out) {
+        const auto& table = detail::DECODE_TABLE;
+        uint8_t* start = out;
+        size_t i = 0;
+
+        // Fast path: whole quads of valid characters
+        for (; i + 4 <= len; i += 4) {
+            uint8_t a = table[static_cast<uint8_t>(in[i])];
+            uint8_t b = table[static_cast<uint8_t>(in[i + 1])];
+            uint8_t c = table[static_cast<uint8_t>(in[i + 2])];
+            uint8_t d = table[static_cast<uint8_t>(in[i + 3])];
+            if ((a | b | c | d) & 0x80) break; // Padding, junk or end: finish below
+            uint32_t n = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | d;
+            *out++ = static_cast<uint8_t>(n >> 16);
+            *out++ = static_cast<uint8_t>(n >> 8);
+            *out++ = static_cast<uint8_t>(n);
+        }
+
+        // Tail: up to 3 valid characters before '=' / junk / end
+        uint32_t n = 0;
+        int have = 0;
+        for (; i < len && have < 4; ++i) {
+            uint8_t v = table[static_cast<uint8_t>(in[i])];
+            if (v == INVALID) break;
+            n = (n << 6) | v;
+            have++;
+        }
+        if (have >= 2) {
+            n <<= 6 * (4 - have);
+            *out++ = static_cast<uint8_t>(n >> 16);
+            if (have >= 3) *out++ = static_cast<uint8_t>(n >> 8);
+            if (have == 4) *out++ = static_cast<uint8_t>(n);
+        }
+        return static_cast<size_t>(out - start);
+    }
+
+    inline std::vector<uint8_t> decode(const char* in, size_t len) {
+        std::vector<uint8_t> out(decoded_size_max(len));
+        out.resize(decode(in, len, out.data()));
+        return out;
+    }
+
+    inline std::vector<uint8_t> decode(const std::string& in) {
+        return decode(in.data(), in.size());
+    }
+
+} // namespace base64
+} // namespace common
@@ -0,0 +1,411 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define COMMON_CRC32C_X86_GNU 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define COMMON_CRC32C_X86_MSVC 1
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define COMMON_CRC32C_ARM 1
+#endif
+
+namespace common {
+namespace checksum {
+
+    // ============================================================================
+    // CRC32C - Castagnoli CRC for per-chunk integrity
+    // ============================================================================
+    // Uses the SSE4.2 crc32 instruction when the CPU has it (checked once at
+    // runtime on x86, compile-time on ARM), otherwise slicing-by-8 tables.
+    // Incremental: crc32c(b, n2, crc32c(a, n1)) == crc32c(a + b, n1 + n2).
+    // ============================================================================
+
+    namespace detail {
+        constexpr uint32_t CRC32C_POLY = 0x82F63B78u;  // Reflected 0x1EDC6F41
+
+        constexpr std::array<std::array<uint32_t, 256>, 8> make_crc32c_tables() {
+            std::array<std::array<uint32_t, 256>, 8> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+                t[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (size_t s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+            return t;
+        }
+        constexpr auto CRC32C_TABLES = make_crc32c_tables();
+
+        inline uint32_t load_le32(const uint8_t* p) {
+            return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+        }
+
+        inline uint64_t load_le64(const uint8_t* p) {
+            return uint64_t(load_le32(p)) | (uint64_t(load_le32(p + 4)) << 32);
+        }
+
+#if defined(COMMON_CRC32C_X86_GNU)
+        __attribute__((target("sse4.2")))
+#endif
+#if defined(COMMON_CRC32C_X86_GNU) || defined(COMMON_CRC32C_X86_MSVC)
+        inline uint32_t crc32c_sse42(uint32_t crc, const uint8_t* data, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+            uint64_t c = crc;
+            for (; size >= 8; data += 8, size -= 8) {
+                uint64_t v;
+                memcpy(&v, data, 8);
+                c = _mm_crc32_u64(c, v);
+            }
+            crc = static_cast<uint32_t>(c);
+#endif
+            for (; size >= 4; data += 4, size -= 4) {
+                uint32_t v;
+                memcpy(&v, data, 4);
+                crc = _mm_crc32_u32(crc, v);
+            }
+            for (; size > 0; ++data, --size) crc = _mm_crc32_u8(crc, *data);
+            return crc;
+        }
+
+        inline bool cpu_has_sse42() {
+#if defined(COMMON_CRC32C_X86_GNU)
+            static const bool has = __builtin_cpu_supports("sse4.2");
+#else
+            static const bool has = []() {
+                int regs[4];
+                __cpuid(regs, 1);
+                return (regs[2] & (1 << 20)) != 0;
+            }();
+#endif
+            return has;
+        }
+#endif
+    }
+
+    // Table-driven CRC32C (also the reference for the hardware path)
+    inline uint32_t crc32c_portable(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        const auto& t = detail::CRC32C_TABLES;
+        crc = ~crc;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint32_t lo = detail::load_le32(data) ^ crc;
+            uint32_t hi = detail::load_le32(data + 4);
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                  t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        }
+        for (; size > 0; ++data, --size) crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+        return ~crc;
+    }
+
+    inline bool crc32c_hardware() {
+#if defined(COMMON_CRC32C_X86_GNU) || defined(COMMON_CRC32C_X86_MSVC)
+        return detail::cpu_has_sse42();
+#elif defined(COMMON_CRC32C_ARM)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    inline uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0) {
+#if defined(COMMON_CRC32C_X86_GNU) || defined(COMMON_CRC32C_X86_MSVC)
+        if (detail::cpu_has_sse42()) return ~detail::crc32c_sse42(~crc, data, size);
+#elif defined(COMMON_CRC32C_ARM)
+        crc = ~crc;
+        for (; size >= 8; data += 8, size -= 8) crc = __crc32cd(crc, detail::load_le64(data));
+        for (; size > 0; ++data, --size) crc = __crc32cb(crc, *data);
+        return ~crc;
+#endif
+        return crc32c_portable(data, size, crc);
+    }
+
+    namespace detail {
+        // GF(2) 32x32 matrix times vector / matrix squared (zlib's crc32_combine)
+        inline uint32_t gf2_times(const uint32_t* mat, uint32_t vec) {
+            uint32_t sum = 0;
+            for (; vec; vec >>= 1, ++mat) {
+                if (vec & 1) sum ^= *mat;
+            }
+            return sum;
+        }
+
+        inline void gf2_square(uint32_t* square, const uint32_t* mat) {
+            for (int n = 0; n < 32; ++n) square[n] = gf2_times(mat, mat[n]);
+        }
+    }
+
+    // CRC of a + b from crc(a), crc(b) and the length of b, in O(log len2):
+    // per-block CRCs computed in parallel give the whole-file CRC32C
+    inline uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+        if (len2 == 0) return crc1;
+
+        uint32_t even[32];  // Operator for 2^n zero bits
+        uint32_t odd[32];   // Operator for 2^(n+1) zero bits
+        odd[0] = detail::CRC32C_POLY;
+        for (uint32_t n = 1, row = 1; n < 32; ++n, row <<= 1) odd[n] = row;
+        detail::gf2_square(even, odd);  // 2 zero bits
+        detail::gf2_square(odd, even);  // 4 zero bits
+
+        // Append len2 zero bytes to crc1 (the first squaring makes one byte)
+        do {
+            detail::gf2_square(even, odd);
+            if (len2 & 1) crc1 = detail::gf2_times(even, crc1);
+            len2 >>= 1;
+            if (len2 == 0) break;
+            detail::gf2_square(odd, even);
+            if (len2 & 1) crc1 = detail::gf2_times(odd, crc1);
+            len2 >>= 1;
+        } while (len2 != 0);
+
+        return crc1 ^ crc2;
+    }
+
+    // ============================================================================
+    // Xxh64 - XXH64 hash (streaming)
+    // ============================================================================
+    // Fast 64-bit non-cryptographic hash: catches corruption, not tampering.
+    // update() may be called with any split of the input.
+    // ============================================================================
+
+    class Xxh64 {
+    public:
+        Xxh64() { reset(0); }
+        explicit Xxh64(uint64_t seed) { reset(seed); }
+
+        void reset(uint64_t seed = 0) {
+            v_[0] = seed + P1 + P2;
+            v_[1] = seed + P2;
+            v_[2] = seed;
+            v_[3] = seed - P1;
+            seed_ = seed;
+            total_ = 0;
+            buffered_ = 0;
+        }
+
+        void update(const uint8_t* data, size_t size) {
+            if (size == 0) return;
+            total_ += size;
+            if (buffered_ + size < STRIPE) {
+                memcpy(buffer_ + buffered_, data, size);
+                buffered_ += size;
+                return;
+            }
+            if (buffered_ > 0) {
+                size_t fill = STRIPE - buffered_;
+                memcpy(buffer_ + buffered_, data, fill);
+                consume(buffer_);
+                data += fill;
+                size -= fill;
+                buffered_ = 0;
+            }
+            for (; size >= STRIPE; data += STRIPE, size -= STRIPE) consume(data);
+            memcpy(buffer_, data, size);
+            buffered_ = size;
+        }
+
+        uint64_t digest() const {
+            uint64_t h;
+            if (total_ >= STRIPE) {
+                h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+                for (uint64_t v : v_) h = (h ^ round(0, v)) * P1 + P4;
+            } else {
+                h = seed_ + P5;
+            }
+            h += total_;
+
+            const uint8_t* p = buffer_;
+            size_t left = buffered_;
+            for (; left >= 8; p += 8, left -= 8) h = rotl(h ^ round(0, detail::load_le64(p)), 27) * P1 + P4;
+            if (left >= 4) {
+                h = rotl(h ^ (uint64_t(detail::load_le32(p)) * P1), 23) * P2 + P3;
+                p += 4;
+                left -= 4;
+            }
+            for (; left > 0; ++p, --left) h = rotl(h ^ (*p * P5), 11) * P1;
+
+            h ^= h >> 33;
+            h *= P2;
+            h ^= h >> 29;
+            h *= P3;
+            h ^= h >> 32;
+            return h;
+        }
+
+    private:
+        static constexpr uint64_t P1 = 11400714785074694791ULL;
+        static constexpr uint64_t P2 = 14029467366897019727ULL;
+        static constexpr uint64_t P3 = 1609587929392839161ULL;
+        static constexpr uint64_t P4 = 9650029242287828579ULL;
+        static constexpr uint64_t P5 = 2870177450012600261ULL;
+        static constexpr size_t STRIPE = 32;
+
+        static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+        static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; }
+
+        void consume(const uint8_t* p) {
+            for (int i = 0; i < 4; ++i) v_[i] = round(v_[i], detail::load_le64(p + 8 * i));
+        }
+
+        uint64_t v_[4];
+        uint64_t seed_ = 0;
+        uint64_t total_ = 0;
+        uint8_t buffer_[STRIPE];
+        size_t buffered_ = 0;
+    };
+
+    inline uint64_t xxh64(const uint8_t* data, size_t size, uint64_t seed = 0) {
+        Xxh64 h(seed);
+        h.update(data, size);
+        return h.digest();
+    }
+
+    inline std::string to_hex(uint64_t value) {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i, value >>= 4) out[i] = digits[value & 0xF];
+        return out;
+    }
+
+    // ============================================================================
+    // ChunkDigest - Whole-file digest fed in any order
+    // ============================================================================
+    // The file is cut into fixed blocks (the transfer chunk size); the digest
+    // is XXH64 over the little-endian XXH64 of every block. Parallel stripes
+    // and out-of-order uploads can feed it as data passes by, so the digest
+    // costs no second read of the file.
+    //
+    // A block must arrive front to back (in one piece or several); a block
+    // written out of order or twice is "incomplete" and its hash has to be
+    // supplied with set_block() (e.g. by re-reading that block) before
+    // finish(). Same file, same block size: same digest, however it was fed.
+    // ============================================================================
+
+    class ChunkDigest {
+    public:
+        explicit ChunkDigest(uint64_t block_size) : block_size_(block_size ? block_size : 1) {}
+
+        uint64_t block_size() const { return block_size_; }
+
+        void update(uint64_t offset, const uint8_t* data, size_t size) {
+            while (size > 0) {
+                uint64_t index = offset / block_size_;
+                uint64_t in_block = offset % block_size_;
+                size_t take = static_cast<size_t>((std::min)(uint64_t(size), block_size_ - in_block));
+                feed(index, in_block, data, take);
+                offset += take;
+                data += take;
+                size -= take;
+            }
+        }
+
+        // Blocks of a file_size-byte file whose hash is not known yet
+        std::vector<uint64_t> incomplete_blocks(uint64_t file_size) {
+            std::vector<uint64_t> out;
+            uint64_t count = block_count(file_size);
+            for (uint64_t i = 0; i < count; ++i) {
+                if (!settle(i, file_size)) out.push_back(i);
+            }
+            return out;
+        }
+
+        void set_block(uint64_t index, uint64_t hash) {
+            slot(index) = Block{hash, DONE};
+            open_.erase(index);
+        }
+
+        // Only meaningful once incomplete_blocks(file_size) is empty
+        uint64_t finish(uint64_t file_size) {
+            Xxh64 h;
+            uint8_t le[8];
+            for (uint64_t i = 0; i < block_count(file_size); ++i) {
+                uint64_t v = settle(i, file_size) ? blocks_[i].hash : 0;
+                for (int b = 0; b < 8; ++b) le[b] = static_cast<uint8_t>(v >> (8 * b));
+                h.update(le, 8);
+            }
+            return h.digest();
+        }
+
+    private:
+        enum State : uint8_t { EMPTY, DONE, BROKEN };
+        struct Block {
+            uint64_t hash = 0;
+            State state = EMPTY;
+        };
+        struct Open {
+            Xxh64 hash;
+            uint64_t next = 0;  // Bytes of the block hashed so far
+        };
+
+        uint64_t block_count(uint64_t file_size) const { return (file_size + block_size_ - 1) / block_size_; }
+
+        Block& slot(uint64_t index) {
+            if (index >= blocks_.size()) blocks_.resize(index + 1);
+            return blocks_[index];
+        }
+
+        void feed(uint64_t index, uint64_t in_block, const uint8_t* data, size_t size) {
+            Block& b = slot(index);
+            if (b.state == BROKEN) return;
+            if (b.state == DONE) {  // Rewritten
+                b.state = BROKEN;
+                return;
+            }
+            if (in_block == 0 && size == block_size_) {
+                b = Block{xxh64(data, size), DONE};
+                return;
+            }
+
+            auto it = open_.find(index);
+            if (it == open_.end()) {
+                if (in_block != 0) {
+                    b.state = BROKEN;
+                    return;
+                }
+                it = open_.emplace(index, Open{}).first;
+            }
+            Open& o = it->second;
+            if (o.next != in_block) {
+                b.state = BROKEN;
+                open_.erase(it);
+                return;
+            }
+            o.hash.update(data, size);
+            o.next += size;
+            if (o.next == block_size_) {
+                b = Block{o.hash.digest(), DONE};
+                open_.erase(it);
+            }
+        }
+
+        // A partial block is complete if it is the file's (short) last block
+        bool settle(uint64_t index, uint64_t file_size) {
+            Block& b = slot(index);
+            if (b.state == DONE) return true;
+            auto it = open_.find(index);
+            if (b.state == EMPTY && it != open_.end() &&
+                it->second.next == file_size - index * block_size_) {
+                b = Block{it->second.hash.digest(), DONE};
+                open_.erase(it);
+                return true;
+            }
+            return false;
+        }
+
+        uint64_t block_size_;
+        std::vector<Block> blocks_;
+        std::map<uint64_t, Open> open_;
+    };
+
+} // namespace checksum
+} // namespace common
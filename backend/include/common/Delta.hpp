@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "common/Checksum.hpp"
+
+namespace common {
+namespace delta {
+
+    // ============================================================================
+    // Delta - rsync-style block matching for overwriting uploads
+    // ============================================================================
+    // The receiver cuts its existing file (the basis) into fixed blocks and
+    // sends one signature per full block: a rolling weak checksum (rsync's
+    // Adler-style sum) and a strong CRC32C. The sender slides a window over
+    // the new file; where the weak sum hits and the CRC agrees, the window
+    // becomes a copy of that basis block, everything else is sent literally.
+    // Weak and strong sum make 64 bits per block; the whole result is then
+    // checked against the sender's CRC32C of the new file before it replaces
+    // the basis, so a false match fails the upload instead of corrupting it.
+    //
+    // compute_delta() is the sender side (the frontend implements the same
+    // algorithm); the backend uses it in tests and benchmarks.
+    // ============================================================================
+
+    constexpr uint32_t MIN_BLOCK_SIZE = 2048;
+    constexpr uint32_t MAX_BLOCK_SIZE = 64 * 1024;
+    constexpr size_t SIGNATURE_BYTES = 8;  // Per block on the wire: weak, strong (big-endian)
+
+    // ~sqrt(file size), in whole KB, within [MIN_BLOCK_SIZE, MAX_BLOCK_SIZE]
+    inline uint32_t block_size_for(uint64_t file_size) {
+        uint64_t root = static_cast<uint64_t>(std::sqrt(static_cast<double>(file_size)));
+        root = (root + 1023) / 1024 * 1024;
+        root = (std::max)(root, uint64_t(MIN_BLOCK_SIZE));
+        return static_cast<uint32_t>((std::min)(root, uint64_t(MAX_BLOCK_SIZE)));
+    }
+
+    // a = sum of bytes, b = sum of (n - i) * byte_i, both mod 2^16
+    class RollingSum {
+    public:
+        void reset(const uint8_t* data, size_t size) {
+            a_ = b_ = 0;
+            size_ = size;
+            for (size_t i = 0; i < size; ++i) {
+                a_ += data[i];
+                b_ += a_;
+            }
+        }
+
+        // Slide the window one byte: `out` leaves at the front, `in` enters at the back
+        void roll(uint8_t out, uint8_t in) {
+            a_ += static_cast<uint32_t>(in) - out;
+            b_ += a_ - static_cast<uint32_t>(size_) * out;
+        }
+
+        uint32_t value() const { return (a_ & 0xFFFF) | ((b_ & 0xFFFF) << 16); }
+
+    private:
+        uint32_t a_ = 0;
+        uint32_t b_ = 0;
+        size_t size_ = 0;
+    };
+
+    inline uint32_t weak_sum(const uint8_t* data, size_t size) {
+        RollingSum r;
+        r.reset(data, size);
+        return r.value();
+    }
+
+    struct BlockSignature {
+        uint32_t weak = 0;
+        uint32_t strong = 0;  // CRC32C
+    };
+
+    // Signatures of a basis file fed front to back in pieces of any size;
+    // the short tail block gets none (it can only be sent literally)
+    class SignatureBuilder {
+    public:
+        explicit SignatureBuilder(uint32_t block_size) : block_size_(block_size) {
+            pending_.reserve(block_size);
+        }
+
+        uint32_t block_size() const { return block_size_; }
+
+        void update(const uint8_t* data, size_t size) {
+            while (size > 0) {
+                if (pending_.empty() && size >= block_size_) {
+                    add(data);
+                    data += block_size_;
+                    size -= block_size_;
+                    continue;
+                }
+                size_t take = (std::min)(size, size_t(block_size_) - pending_.size());
+                pending_.insert(pending_.end(), data, data + take);
+                data += take;
+                size -= take;
+                if (pending_.size() == block_size_) {
+                    add(pending_.data());
+                    pending_.clear();
+                }
+            }
+        }
+
+        const std::vector<BlockSignature>& blocks() const { return blocks_; }
+
+    private:
+        void add(const uint8_t* block) {
+            blocks_.push_back({weak_sum(block, block_size_), checksum::crc32c(block, block_size_)});
+        }
+
+        uint32_t block_size_;
+        std::vector<uint8_t> pending_;
+        std::vector<BlockSignature> blocks_;
+    };
+
+    // One step of the new file: bytes sent as-is, or a run of the basis
+    struct Op {
+        bool copy = false;
+        uint64_t dst = 0;     // Offset in the new file
+        uint64_t src = 0;     // Offset in the basis (copy only)
+        uint64_t length = 0;
+    };
+
+    // Adjacent copies of adjacent basis blocks are merged into one op
+    inline std::vector<Op> compute_delta(const std::vector<BlockSignature>& basis, uint32_t block_size,
+                                         const uint8_t* data, size_t size) {
+        std::vector<Op> ops;
+        auto emit = [&ops](bool copy, uint64_t dst, uint64_t src, uint64_t length) {
+            if (length == 0) return;
+            if (!ops.empty()) {
+                Op& last = ops.back();
+                if (last.copy == copy && last.dst + last.length == dst &&
+                    (!copy || last.src + last.length == src)) {
+                    last.length += length;
+                    return;
+                }
+            }
+            ops.push_back(Op{copy, dst, src, length});
+        };
+
+        std::unordered_map<uint32_t, std::vector<uint32_t>> by_weak;
+        by_weak.reserve(basis.size());
+        for (uint32_t i = 0; i < basis.size(); ++i) by_weak[basis[i].weak].push_back(i);
+
+        size_t literal_start = 0;
+        size_t pos = 0;
+        uint64_t next_block = UINT64_MAX;  // Block after the last match: tried first
+        RollingSum rolling;
+        bool fresh = true;
+
+        while (!basis.empty() && pos + block_size <= size) {
+            if (fresh) {
+                rolling.reset(data + pos, block_size);
+                fresh = false;
+            }
+            auto hit = by_weak.find(rolling.value());
+            if (hit != by_weak.end()) {
+                uint32_t strong = checksum::crc32c(data + pos, block_size);
+                int64_t match = -1;
+                for (uint32_t index : hit->second) {
+                    if (basis[index].strong != strong) continue;
+                    if (match < 0 || index == next_block) match = index;
+                    if (index == next_block) break;
+                }
+                if (match >= 0) {
+                    emit(false, literal_start, 0, pos - literal_start);
+                    emit(true, pos, uint64_t(match) * block_size, block_size);
+                    pos += block_size;
+                    literal_start = pos;
+                    next_block = uint64_t(match) + 1;
+                    fresh = true;
+                    continue;
+                }
+            }
+            if (pos + block_size < size) rolling.roll(data[pos], data[pos + block_size]);
+            pos++;
+        }
+        emit(false, literal_start, 0, size - literal_start);
+        return ops;
+    }
+
+} // namespace delta
+} // namespace common
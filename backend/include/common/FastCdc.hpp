@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace common {
+namespace cdc {
+
+    // ============================================================================
+    // FastCDC - Content-defined chunk boundaries
+    // ============================================================================
+    // A gear hash (fp = (fp << 1) + GEAR[byte]) runs over the data; a chunk
+    // ends where the hash's top bits are all zero. Cut points depend only on
+    // the bytes before them (the last 32, for a 32-bit hash), so an edit moves
+    // the boundaries near it and the chunks after it are the same as before:
+    // a patched installer shares most chunks with the previous version.
+    //
+    // Normalized chunking (FastCDC level 2): a stricter mask before AVG_SIZE
+    // and a looser one after it pull chunk sizes towards the average;
+    // no chunk is smaller than MIN_SIZE (but the last) or larger than MAX_SIZE.
+    //
+    // The hash is 32-bit and the gear table comes from splitmix64 with a
+    // fixed seed, so the frontend (protocol.ts) cuts at exactly these points.
+    // ============================================================================
+
+    constexpr size_t MIN_SIZE = 16 * 1024;
+    constexpr size_t AVG_SIZE = 64 * 1024;
+    constexpr size_t MAX_SIZE = 256 * 1024;
+
+    constexpr uint32_t MASK_STRICT = 0xFFFFC000u;  // 18 bits: before AVG_SIZE
+    constexpr uint32_t MASK_LOOSE  = 0xFFFC0000u;  // 14 bits: after it
+
+    namespace detail {
+        constexpr std::array<uint32_t, 256> make_gear() {
+            std::array<uint32_t, 256> gear{};
+            uint64_t x = 0x43414645434443ull;  // Fixed seed, shared with the frontend
+            for (auto& g : gear) {
+                x += 0x9E3779B97F4A7C15ull;
+                uint64_t z = x;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                g = static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+            }
+            return gear;
+        }
+        constexpr auto GEAR = make_gear();
+    }
+
+    // Length of the chunk at the start of data. size: bytes available; pass
+    // at least MAX_SIZE unless this is the end of the input.
+    inline size_t cut(const uint8_t* data, size_t size) {
+        if (size <= MIN_SIZE) return size;
+        if (size > MAX_SIZE) size = MAX_SIZE;
+        const size_t normal = size < AVG_SIZE ? size : AVG_SIZE;
+
+        uint32_t fp = 0;
+        size_t i = MIN_SIZE;
+        for (; i < normal; ++i) {
+            fp = (fp << 1) + detail::GEAR[data[i]];
+            if ((fp & MASK_STRICT) == 0) return i + 1;
+        }
+        for (; i < size; ++i) {
+            fp = (fp << 1) + detail::GEAR[data[i]];
+            if ((fp & MASK_LOOSE) == 0) return i + 1;
+        }
+        return size;
+    }
+
+    // Chunk lengths of a whole buffer, in order
+    inline std::vector<size_t> chunk_lengths(const uint8_t* data, size_t size) {
+        std::vector<size_t> lengths;
+        size_t pos = 0;
+        while (pos < size) {
+            size_t n = cut(data + pos, size - pos);
+            lengths.push_back(n);
+            pos += n;
+        }
+        return lengths;
+    }
+
+} // namespace cdc
+} // namespace common
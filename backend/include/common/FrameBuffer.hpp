@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace common {
+
+    // ============================================================================
+    // FrameBuffer / FrameBufferPool - Recycled video frame storage with headroom
+    // ============================================================================
+    // A captured frame is written into a pooled block exactly once and then
+    // travels by reference: Streamer -> VideoPacket -> BroadcastBus -> writer.
+    //
+    // Block layout:
+    //   [ HEADROOM (16B) ][ payload (JPEG / NAL units) ][ spare capacity ]
+    //                  ^ data()
+    //
+    // The headroom is scratch space for the wire prefix the writer thread puts
+    // in front of the payload ([12B gateway header][traffic class][channel]),
+    // so header + payload leave in a single send() without building a new
+    // packet vector. The payload itself is immutable once published.
+    //
+    // With several gateway sessions the same frame reaches several writer
+    // threads. Only the writer that claims the headroom first may stamp it
+    // (claim_headroom); the others send their prefix as a separate slice.
+    //
+    // Pooling: blocks are returned to the pool when the last shared_ptr drops
+    // and handed out again for the next frame of similar size. The pool keeps
+    // at most `max_free` idle blocks; extra blocks are freed.
+    // ============================================================================
+
+    class FrameBufferPool;
+
+    class FrameBuffer {
+    public:
+        // [4B len][4B cid][4B bid][1B traffic class][1B channel] + 2B alignment
+        static constexpr size_t HEADROOM = 16;
+
+        FrameBuffer(const FrameBuffer&) = delete;
+        FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+        const uint8_t* data() const { return mem_.get() + HEADROOM; }
+        uint8_t* data() { return mem_.get() + HEADROOM; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        size_t capacity() const { return capacity_ - HEADROOM; }
+
+        const uint8_t* begin() const { return data(); }
+        const uint8_t* end() const { return data() + size_; }
+
+        // Set the payload length (must fit in capacity()).
+        void resize(size_t size) { size_ = size < capacity() ? size : capacity(); }
+
+        // Write `len` prefix bytes directly in front of the payload and return
+        // the start of the contiguous wire image (prefix + payload).
+        // The headroom belongs to the writer that claimed it; the payload bytes
+        // are never touched, so this is allowed on a frame that is shared
+        // read-only with other consumers.
+        const uint8_t* stamp_prefix(const uint8_t* prefix, size_t len) const {
+            if (len > HEADROOM) return nullptr;
+            uint8_t* dst = mem_.get() + HEADROOM - len;
+            std::memcpy(dst, prefix, len);
+            return dst;
+        }
+
+        // True if `owner` may use the headroom: the first caller wins and
+        // keeps it for the lifetime of the frame. Lock-free.
+        bool claim_headroom(const void* owner) const {
+            const void* expected = nullptr;
+            return headroom_owner_.compare_exchange_strong(expected, owner) || expected == owner;
+        }
+
+    private:
+        friend class FrameBufferPool;
+
+        FrameBuffer(std::unique_ptr<uint8_t[]> mem, size_t capacity)
+            : mem_(std::move(mem)), capacity_(capacity) {}
+
+        std::unique_ptr<uint8_t[]> mem_;
+        size_t capacity_ = 0; // Including headroom
+        size_t size_ = 0;
+        mutable std::atomic<const void*> headroom_owner_{nullptr};
+    };
+
+    class FrameBufferPool {
+    public:
+        struct Stats {
+            uint64_t allocations = 0; // New blocks from the heap
+            uint64_t reuses = 0;      // Acquisitions served from the free list
+            uint64_t releases = 0;    // Blocks returned to the free list
+            uint64_t discards = 0;    // Blocks freed because the free list was full
+            uint64_t in_flight = 0;   // Blocks currently referenced by packets
+        };
+
+        explicit FrameBufferPool(size_t max_free = 32)
+            : state_(std::make_shared<State>()) {
+            state_->max_free = max_free;
+        }
+
+        // Process-wide pool shared by all streamers.
+        static FrameBufferPool& global() {
+            static FrameBufferPool pool;
+            return pool;
+        }
+
+        // Get a buffer with room for at least `size` payload bytes.
+        // size() of the returned buffer is `size`; content is uninitialized.
+        std::shared_ptr<FrameBuffer> acquire(size_t size) {
+            FrameBuffer* fb = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                auto& free_list = state_->free_list;
+                // Most recently released first (warm in cache)
+                for (size_t i = free_list.size(); i-- > 0;) {
+                    if (free_list[i]->capacity() >= size) {
+                        fb = free_list[i];
+                        free_list[i] = free_list.back();
+                        free_list.pop_back();
+                        break;
+                    }
+                }
+                if (fb) state_->stats.reuses++;
+                else state_->stats.allocations++;
+                state_->stats.in_flight++;
+            }
+
+            if (!fb) {
+                size_t capacity = FrameBuffer::HEADROOM + round_up(size);
+                fb = new FrameBuffer(std::unique_ptr<uint8_t[]>(new uint8_t[capacity]), capacity);
+            }
+            fb->size_ = size;
+            fb->headroom_owner_.store(nullptr, std::memory_order_relaxed);
+
+            std::weak_ptr<State> weak_state = state_;
+            return std::shared_ptr<FrameBuffer>(fb, [weak_state](FrameBuffer* p) {
+                if (auto state = weak_state.lock()) {
+                    state->release(p);
+                } else {
+                    delete p;
+                }
+            });
+        }
+
+        // Acquire and fill in one step (the single copy out of a capture buffer).
+        std::shared_ptr<FrameBuffer> acquire_copy(const uint8_t* src, size_t size) {
+            auto fb = acquire(size);
+            if (size > 0) std::memcpy(fb->data(), src, size);
+            return fb;
+        }
+
+        Stats stats() const {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->stats;
+        }
+
+        size_t free_blocks() const {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->free_list.size();
+        }
+
+    private:
+        // Blocks are sized in 64KB steps so frames of a stream with slowly
+        // varying JPEG size keep hitting the same blocks.
+        static size_t round_up(size_t size) {
+            const size_t granule = 64 * 1024;
+            size_t n = (size + granule - 1) / granule;
+            return (n == 0 ? 1 : n) * granule;
+        }
+
+        // Shared with the deleters so buffers may outlive the pool object.
+        struct State {
+            mutable std::mutex mutex;
+            std::vector<FrameBuffer*> free_list;
+            size_t max_free = 32;
+            Stats stats;
+
+            void release(FrameBuffer* fb) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stats.in_flight--;
+                    if (free_list.size() < max_free) {
+                        fb->size_ = 0;
+                        free_list.push_back(fb);
+                        stats.releases++;
+                        return;
+                    }
+                    stats.discards++;
+                }
+                delete fb;
+            }
+
+            ~State() {
+                for (auto* fb : free_list) delete fb;
+            }
+        };
+
+        std::shared_ptr<State> state_;
+    };
+
+} // namespace common
@@ -0,0 +1,247 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <functional>
+
+namespace common {
+
+    // ============================================================================
+    // JpegFrameSplitter - Incremental MJPEG stream -> JPEG frame splitter
+    // ============================================================================
+    // Splits the byte stream produced by `ffmpeg -f mjpeg -` (and similar tools)
+    // into complete SOI..EOI frames in a single linear pass.
+    //
+    // Design Decisions:
+    // - Resumable: the scan position and parser state survive between reads, so
+    //   every byte is inspected once (the legacy splitters re-ran std::search
+    //   from the start of the buffer on every 64KB read).
+    // - Compacting buffer: completed frames are released by advancing head_;
+    //   the remaining partial frame is moved to the front only when the caller
+    //   needs more write space (no erase() of the front per frame).
+    // - Marker aware: segments with a length field (APPn, DQT, SOF, ...) are
+    //   skipped by length, so EOI-looking bytes inside EXIF thumbnails do not
+    //   split frames. Inside entropy-coded data, 0xFF00 stuffing and RSTn
+    //   markers are skipped; memchr() drives the search for 0xFF.
+    //
+    // Usage (zero-copy read path):
+    //   uint8_t* dst = splitter.prepare(64 * 1024);
+    //   size_t n = fread(dst, 1, 64 * 1024, pipe);
+    //   splitter.commit(n, [](const uint8_t* jpeg, size_t size) { ... });
+    //
+    // The frame pointer handed to the callback is only valid during the call.
+    // Not thread-safe: owned by a single streamer thread.
+    // ============================================================================
+
+    class JpegFrameSplitter {
+    public:
+        using FrameCallback = std::function<void(const uint8_t* data, size_t size)>;
+
+        struct Stats {
+            uint64_t bytes_in = 0;
+            uint64_t frames = 0;
+            uint64_t resyncs = 0;    // Corrupt marker structure, frame discarded
+            uint64_t overflows = 0;  // Frame exceeded max_frame_size, discarded
+            uint64_t compactions = 0;
+        };
+
+        // max_frame_size: Safety limit for a single frame (legacy limit was 1MB
+        // of buffered data; 4MB leaves room for high quality 4K frames).
+        explicit JpegFrameSplitter(size_t max_frame_size = 4 * 1024 * 1024)
+            : max_frame_size_(max_frame_size) {
+            buf_.resize(256 * 1024); // Typical 1080p JPEG is 100-250KB
+        }
+
+        // Returns a pointer with at least `size` writable bytes at the tail.
+        // Must be followed by commit() with the number of bytes actually written.
+        uint8_t* prepare(size_t size) {
+            if (buf_.size() - tail_ < size) {
+                compact();
+                if (buf_.size() - tail_ < size) {
+                    size_t new_size = buf_.size() * 2;
+                    while (new_size - tail_ < size) new_size *= 2;
+                    buf_.resize(new_size);
+                }
+            }
+            return buf_.data() + tail_;
+        }
+
+        // Account `size` bytes written into the region returned by prepare()
+        // and emit every frame completed by them.
+        void commit(size_t size, const FrameCallback& on_frame) {
+            tail_ += size;
+            stats_.bytes_in += size;
+            scan(on_frame);
+        }
+
+        // Copying convenience wrapper for callers that already own a buffer.
+        void feed(const uint8_t* data, size_t size, const FrameCallback& on_frame) {
+            std::memcpy(prepare(size), data, size);
+            commit(size, on_frame);
+        }
+
+        // Drop any partial frame and return to the initial state.
+        void reset() {
+            head_ = pos_ = tail_ = frame_start_ = skip_to_ = 0;
+            state_ = State::SeekSoi;
+        }
+
+        size_t buffered() const { return tail_ - head_; }
+        const Stats& stats() const { return stats_; }
+
+    private:
+        enum class State {
+            SeekSoi,   // Looking for FF D8
+            Marker,    // At a marker inside a frame
+            Skip,      // Skipping a length-prefixed segment
+            Entropy    // Inside scan data after SOS
+        };
+
+        void scan(const FrameCallback& on_frame) {
+            while (pos_ < tail_ && step(on_frame)) {}
+            check_frame_size();
+        }
+
+        // Advance the parser by one token. Returns false when more input is
+        // needed to make progress.
+        bool step(const FrameCallback& on_frame) {
+            const uint8_t* b = buf_.data();
+
+            switch (state_) {
+            case State::SeekSoi: {
+                const void* hit = std::memchr(b + pos_, 0xFF, tail_ - pos_);
+                if (!hit) {
+                    head_ = pos_ = tail_; // Garbage only, discard
+                    return false;
+                }
+                size_t i = static_cast<const uint8_t*>(hit) - b;
+                if (i + 1 >= tail_) {
+                    head_ = pos_ = i;     // Keep the lone 0xFF for the next read
+                    return false;
+                }
+                if (b[i + 1] == 0xD8) {
+                    head_ = frame_start_ = i;
+                    pos_ = i + 2;
+                    state_ = State::Marker;
+                } else {
+                    head_ = pos_ = i + 1;
+                }
+                return true;
+            }
+
+            case State::Marker: {
+                if (tail_ - pos_ < 2) return false;
+                if (b[pos_] != 0xFF) {
+                    resync();
+                    return true;
+                }
+                uint8_t m = b[pos_ + 1];
+                if (m == 0xFF) {              // Fill byte
+                    pos_ += 1;
+                } else if (m == 0xD9) {       // EOI - frame complete
+                    size_t end = pos_ + 2;
+                    stats_.frames++;
+                    on_frame(b + frame_start_, end - frame_start_);
+                    head_ = pos_ = end;
+                    state_ = State::SeekSoi;
+                } else if (m == 0xD8) {       // SOI without EOI: restart frame
+                    stats_.resyncs++;
+                    head_ = frame_start_ = pos_;
+                    pos_ += 2;
+                } else if ((m >= 0xD0 && m <= 0xD7) || m == 0x01) {
+                    pos_ += 2;                // Standalone markers (RSTn, TEM)
+                } else {
+                    if (tail_ - pos_ < 4) return false;
+                    size_t len = (static_cast<size_t>(b[pos_ + 2]) << 8) | b[pos_ + 3];
+                    if (len < 2) {
+                        resync();
+                        return true;
+                    }
+                    skip_to_ = pos_ + 2 + len;
+                    after_skip_ = (m == 0xDA) ? State::Entropy : State::Marker;
+                    state_ = State::Skip;
+                }
+                return true;
+            }
+
+            case State::Skip:
+                if (skip_to_ > tail_) {
+                    pos_ = tail_;
+                    return false;
+                }
+                pos_ = skip_to_;
+                state_ = after_skip_;
+                return true;
+
+            case State::Entropy: {
+                const void* hit = std::memchr(b + pos_, 0xFF, tail_ - pos_);
+                if (!hit) {
+                    pos_ = tail_;
+                    return false;
+                }
+                size_t i = static_cast<const uint8_t*>(hit) - b;
+                if (i + 1 >= tail_) {
+                    pos_ = i;
+                    return false;
+                }
+                uint8_t m = b[i + 1];
+                if (m == 0x00 || (m >= 0xD0 && m <= 0xD7)) {
+                    pos_ = i + 2;             // Stuffed byte or restart marker
+                } else if (m == 0xFF) {
+                    pos_ = i + 1;             // Fill byte before a marker
+                } else {
+                    pos_ = i;                 // Real marker: EOI, DHT, next SOS...
+                    state_ = State::Marker;
+                }
+                return true;
+            }
+            }
+            return false;
+        }
+
+        // Corrupt structure: drop the current frame and look for the next SOI.
+        void resync() {
+            stats_.resyncs++;
+            head_ = pos_ = frame_start_ + 1;
+            state_ = State::SeekSoi;
+        }
+
+        // Discard the frame in progress if it grew past max_frame_size_.
+        void check_frame_size() {
+            if (state_ == State::SeekSoi || tail_ - frame_start_ <= max_frame_size_) return;
+            stats_.overflows++;
+            head_ = pos_ = tail_;
+            state_ = State::SeekSoi;
+        }
+
+        // Move the unconsumed bytes [head_, tail_) to the front of the buffer.
+        void compact() {
+            if (head_ == 0) return;
+            size_t live = tail_ - head_;
+            if (live > 0) std::memmove(buf_.data(), buf_.data() + head_, live);
+            pos_ -= head_;
+            if (state_ != State::SeekSoi) {
+                frame_start_ -= head_;
+                if (state_ == State::Skip) skip_to_ -= head_;
+            }
+            tail_ = live;
+            head_ = 0;
+            stats_.compactions++;
+        }
+
+        std::vector<uint8_t> buf_;
+        size_t max_frame_size_;
+
+        size_t head_ = 0;         // First byte still needed
+        size_t pos_ = 0;          // Resumable scan position
+        size_t tail_ = 0;         // End of valid data
+        size_t frame_start_ = 0;  // SOI of the frame in progress
+        size_t skip_to_ = 0;      // End of the segment being skipped
+
+        State state_ = State::SeekSoi;
+        State after_skip_ = State::Marker;
+        Stats stats_;
+    };
+
+} // namespace common
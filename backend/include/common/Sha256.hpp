@@ -0,0 +1,209 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define COMMON_SHA256_X86_GNU 1
+#endif
+
+namespace common {
+namespace checksum {
+
+    // ============================================================================
+    // SHA-256 (FIPS 180-4) - Content addresses for the chunk store
+    // ============================================================================
+    // Collision resistant, unlike CRC32C/XXH64: chunks are shared by every
+    // upload to this machine, so their key must not be forgeable. Browsers
+    // compute the same digest natively (crypto.subtle.digest('SHA-256')).
+    // Uses the SHA extensions (sha256rnds2/msg1/msg2) when the CPU has them,
+    // checked once at runtime like CRC32C's SSE4.2 path; portable otherwise.
+    // Incremental: update() any number of times, then finish().
+    // ============================================================================
+
+    namespace detail {
+        constexpr uint32_t SHA256_K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+        inline void sha256_blocks_portable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+            for (; blocks > 0; --blocks, data += 64) {
+                uint32_t w[64];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+                           (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+                }
+                for (int i = 16; i < 64; ++i) {
+                    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+                uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+                for (int i = 0; i < 64; ++i) {
+                    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                                  SHA256_K[i] + w[i];
+                    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g; g = f; f = e; e = d + t1;
+                    d = c; c = b; b = a; a = t1 + t2;
+                }
+                state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+                state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+            }
+        }
+
+#if defined(COMMON_SHA256_X86_GNU)
+        // Four rounds per step; the state is kept as ABEF/CDGH, the layout
+        // sha256rnds2 works on
+        __attribute__((target("sha,sse4.1,ssse3")))
+        inline void sha256_blocks_shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+            const __m128i BSWAP = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+            __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+            __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+            __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+            state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+
+            for (; blocks > 0; --blocks, data += 64) {
+                const __m128i abef = state0, cdgh = state1;
+                __m128i w[4];
+                for (int g = 0; g < 16; ++g) {
+                    __m128i& cur = w[g & 3];
+                    if (g < 4) {
+                        cur = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), BSWAP);
+                    } else {
+                        // W[i..i+3] from W[i-16..i-1]: cur holds W[i-16..i-13] until overwritten
+                        __m128i t = _mm_sha256msg1_epu32(cur, w[(g + 1) & 3]);
+                        t = _mm_add_epi32(t, _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+                        cur = _mm_sha256msg2_epu32(t, w[(g + 3) & 3]);
+                    }
+                    __m128i msg = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(SHA256_K + 4 * g)));
+                    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+                }
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            tmp = _mm_shuffle_epi32(state0, 0x1B);                                 // FEBA
+            state1 = _mm_shuffle_epi32(state1, 0xB1);                              // DCHG
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, state1, 0xF0));  // DCBA
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+        }
+
+        inline bool cpu_has_sha() {
+            static const bool has = []() {
+                unsigned a, b, c, d;
+                if (!__get_cpuid_count(7, 0, &a, &b, &c, &d) || !(b & (1u << 29))) return false;  // SHA
+                return __get_cpuid(1, &a, &b, &c, &d) && (c & (1u << 19)) && (c & (1u << 9));   // SSE4.1, SSSE3
+            }();
+            return has;
+        }
+#endif
+
+        inline bool sha256_hardware() {
+#if defined(COMMON_SHA256_X86_GNU)
+            return cpu_has_sha();
+#else
+            return false;
+#endif
+        }
+
+        inline void sha256_blocks(uint32_t state[8], const uint8_t* data, size_t blocks) {
+#if defined(COMMON_SHA256_X86_GNU)
+            if (cpu_has_sha()) return sha256_blocks_shani(state, data, blocks);
+#endif
+            sha256_blocks_portable(state, data, blocks);
+        }
+    }
+
+    class Sha256 {
+    public:
+        using Digest = std::array<uint8_t, 32>;
+
+        Sha256() { reset(); }
+
+        void reset() {
+            static constexpr uint32_t INIT[8] = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            std::memcpy(state_, INIT, sizeof(state_));
+            length_ = 0;
+            buffered_ = 0;
+        }
+
+        void update(const uint8_t* data, size_t size) {
+            length_ += size;
+            if (buffered_ > 0) {
+                size_t take = (size < 64 - buffered_) ? size : 64 - buffered_;
+                std::memcpy(buffer_ + buffered_, data, take);
+                buffered_ += take;
+                data += take;
+                size -= take;
+                if (buffered_ < 64) return;
+                detail::sha256_blocks(state_, buffer_, 1);
+                buffered_ = 0;
+            }
+            detail::sha256_blocks(state_, data, size / 64);
+            data += size / 64 * 64;
+            size %= 64;
+            if (size > 0) std::memcpy(buffer_, data, size);
+            buffered_ = size;
+        }
+
+        Digest finish() {
+            const uint64_t bits = length_ * 8;
+            const uint8_t pad = 0x80;
+            update(&pad, 1);
+            const uint8_t zero = 0;
+            while (buffered_ != 56) update(&zero, 1);
+            uint8_t tail[8];
+            for (int i = 0; i < 8; ++i) tail[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            update(tail, 8);
+
+            Digest out;
+            for (int i = 0; i < 8; ++i) {
+                out[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+                out[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+                out[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+                out[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+            }
+            reset();
+            return out;
+        }
+
+    private:
+        uint32_t state_[8];
+        uint64_t length_;
+        uint8_t buffer_[64];
+        size_t buffered_;
+    };
+
+    // Lowercase hex of the digest (64 characters)
+    inline std::string sha256_hex(const uint8_t* data, size_t size) {
+        Sha256 h;
+        h.update(data, size);
+        auto digest = h.finish();
+        static const char* HEX = "0123456789abcdef";
+        std::string out(64, '0');
+        for (size_t i = 0; i < digest.size(); ++i) {
+            out[2 * i] = HEX[digest[i] >> 4];
+            out[2 * i + 1] = HEX[digest[i] & 0xF];
+        }
+        return out;
+    }
+
+} // namespace checksum
+} // namespace common
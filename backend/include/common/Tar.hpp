@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace common {
+namespace tar {
+
+    // ============================================================================
+    // Tar - POSIX (pax) archive headers for streamed archives
+    // ============================================================================
+    // An archive is, per entry: header blocks, the file bytes, zero padding to
+    // the next 512-byte block; then END_SIZE zero bytes. Every size is known
+    // from the entry alone, so the archive's length is known before any file
+    // is read (the download START message announces it).
+    //
+    // Names longer than the ustar fields allow and sizes from 8 GiB up go in
+    // a pax extended header ('x') ahead of the ustar header, as GNU tar,
+    // bsdtar and 7-Zip read them. Owner is always 0/0 (root), modes are
+    // 0755 for directories and 0644 (0444 read-only) for files.
+    // ============================================================================
+
+    constexpr size_t BLOCK_SIZE = 512;
+    constexpr size_t END_SIZE = 2 * BLOCK_SIZE;
+
+    struct Entry {
+        std::string name;       // Relative, '/'-separated; directories end with '/'
+        uint64_t size = 0;      // 0 for directories
+        uint64_t mtime = 0;     // Unix seconds
+        bool is_directory = false;
+        bool is_readonly = false;
+    };
+
+    inline uint64_t padding(uint64_t size) {
+        return (BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE;
+    }
+
+    namespace detail {
+        constexpr uint64_t USTAR_MAX_SIZE = 077777777777ULL;  // 11 octal digits
+
+        // Octal, zero-padded to width - 1 digits, NUL-terminated
+        inline void put_octal(uint8_t* field, size_t width, uint64_t value) {
+            field[width - 1] = 0;
+            for (size_t i = width - 1; i-- > 0; value >>= 3) field[i] = static_cast<uint8_t>('0' + (value & 7));
+        }
+
+        inline void put_string(uint8_t* field, size_t width, const std::string& value) {
+            memcpy(field, value.data(), (std::min)(width, value.size()));
+        }
+
+        // "len key=value\n", where len counts the whole record including itself
+        inline std::string pax_record(const std::string& key, const std::string& value) {
+            size_t body = key.size() + value.size() + 3;  // ' ', '=', '\n'
+            size_t len = body + 1;
+            while (std::to_string(len).size() + body != len) len = std::to_string(len).size() + body;
+            return std::to_string(len) + " " + key + "=" + value + "\n";
+        }
+
+        // ustar splits names at a '/' into prefix (155) and name (100)
+        inline bool split_name(const std::string& name, std::string& prefix, std::string& base) {
+            if (name.size() <= 100) {
+                prefix.clear();
+                base = name;
+                return true;
+            }
+            // Leave the trailing '/' of a directory in the name part
+            size_t search_end = name.size() > 1 ? name.size() - 2 : 0;
+            for (size_t slash = name.rfind('/', search_end); slash != std::string::npos && slash > 0;
+                 slash = name.rfind('/', slash - 1)) {
+                if (slash > 155) continue;
+                if (name.size() - slash - 1 > 100) break;
+                prefix = name.substr(0, slash);
+                base = name.substr(slash + 1);
+                return true;
+            }
+            return false;
+        }
+
+        inline void ustar_header(uint8_t* h, const std::string& prefix, const std::string& name,
+                                 uint64_t size, uint64_t mtime, uint32_t mode, char type) {
+            memset(h, 0, BLOCK_SIZE);
+            put_string(h, 100, name);
+            put_octal(h + 100, 8, mode);
+            put_octal(h + 108, 8, 0);
+            put_octal(h + 116, 8, 0);
+            put_octal(h + 124, 12, size > USTAR_MAX_SIZE ? 0 : size);
+            put_octal(h + 136, 12, mtime > USTAR_MAX_SIZE ? USTAR_MAX_SIZE : mtime);
+            h[156] = static_cast<uint8_t>(type);
+            memcpy(h + 257, "ustar", 6);
+            memcpy(h + 263, "00", 2);
+            put_string(h + 265, 32, "root");
+            put_string(h + 297, 32, "root");
+            put_string(h + 345, 155, prefix);
+
+            // Checksum: byte sum with the checksum field read as spaces
+            memset(h + 148, ' ', 8);
+            uint32_t sum = 0;
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) sum += h[i];
+            put_octal(h + 148, 7, sum);
+            h[155] = ' ';
+        }
+    }
+
+    // Header blocks for one entry (a multiple of BLOCK_SIZE)
+    inline std::vector<uint8_t> header(const Entry& e) {
+        std::string prefix, base;
+        std::string pax;
+        if (!detail::split_name(e.name, prefix, base)) {
+            pax += detail::pax_record("path", e.name);
+            prefix.clear();
+            base = e.name.substr(0, 100);
+        }
+        if (e.size > detail::USTAR_MAX_SIZE) pax += detail::pax_record("size", std::to_string(e.size));
+
+        std::vector<uint8_t> out;
+        if (!pax.empty()) {
+            out.resize(BLOCK_SIZE + pax.size() + padding(pax.size()));
+            detail::ustar_header(out.data(), "", "PaxHeaders/" + base.substr(0, 89), pax.size(), e.mtime, 0644, 'x');
+            memcpy(out.data() + BLOCK_SIZE, pax.data(), pax.size());
+        }
+
+        size_t at = out.size();
+        out.resize(at + BLOCK_SIZE);
+        uint32_t mode = e.is_directory ? 0755 : (e.is_readonly ? 0444 : 0644);
+        detail::ustar_header(out.data() + at, prefix, base, e.is_directory ? 0 : e.size, e.mtime, mode,
+                             e.is_directory ? '5' : '0');
+        return out;
+    }
+
+    // Bytes the entry takes in the archive: headers, data and padding
+    inline uint64_t entry_size(const Entry& e) {
+        uint64_t data = e.is_directory ? 0 : e.size;
+        return header(e).size() + data + padding(data);
+    }
+
+} // namespace tar
+} // namespace common
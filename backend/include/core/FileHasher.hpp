@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/Cancellation.hpp"
+#include "common/Result.hpp"
+#include "core/ParallelTransfer.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    enum class HashAlgorithm : uint8_t {
+        Xxh64Tree,  // "xxh64": ChunkDigest layout, the digest downloads and uploads report
+        Crc32c      // "crc32c": plain CRC32C of the whole file
+    };
+
+    const char* hash_algorithm_name(HashAlgorithm algo);
+    bool parse_hash_algorithm(const std::string& name, HashAlgorithm& out);
+
+    // Digest as sent to clients: 16 hex digits (xxh64) or 8 (crc32c)
+    std::string format_digest(HashAlgorithm algo, uint64_t digest);
+
+    // ============================================================================
+    // FileHasher - Parallel whole-file hashing with a persistent result cache
+    // ============================================================================
+    // Files are read as striped parallel reads (ParallelTransfer) and hashed per
+    // FILE_TRANSFER_CHUNK_SIZE block on the reading threads; the block results
+    // are then folded in file order (tree layout), so the digest is the same
+    // however many stripes read the file:
+    // - xxh64:  XXH64 over the block XXH64s (common::checksum::ChunkDigest)
+    // - crc32c: block CRCs joined with crc32c_combine (= CRC32C of the file)
+    //
+    // Results are cached by (algorithm, device, inode, size, mtime), or by path
+    // where the platform reports no inode, and kept in a text file across
+    // restarts, so re-scanning an unchanged tree costs one stat per file.
+    // A file modified within RACY_SECONDS of hashing is not cached: mtime has
+    // one-second resolution and a later write in the same second would keep
+    // the key. Beyond MAX_CACHE_ENTRIES, the least recently used entries are
+    // dropped when the cache is saved.
+    //
+    // Thread-safe: several hashes may run at once (they share the read pool).
+    // ============================================================================
+
+    class FileHasher {
+    public:
+        // Bytes hashed so far / file size; called from read threads, one call at a time
+        using ProgressFn = std::function<void(uint64_t done, uint64_t total)>;
+
+        static constexpr size_t MAX_CACHE_ENTRIES = 200000;
+        static constexpr uint64_t RACY_SECONDS = 2;
+        static constexpr std::chrono::seconds SAVE_INTERVAL{30};
+
+        struct FileHash {
+            uint64_t digest = 0;
+            uint64_t size = 0;
+            bool cached = false;  // Served from the cache, file not read
+        };
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            size_t entries = 0;
+        };
+
+        // cache_path empty: results are cached in memory only
+        FileHasher(interfaces::IFileTransfer& transfer, ParallelTransfer& parallel, std::string cache_path);
+        ~FileHasher();  // Saves the cache
+
+        FileHasher(const FileHasher&) = delete;
+        FileHasher& operator=(const FileHasher&) = delete;
+
+        common::Result<FileHash> hash(const std::string& path, HashAlgorithm algo,
+                                      ProgressFn on_progress = nullptr, common::CancellationToken cancel = {});
+
+        // Same with the file's info already at hand (directory scans)
+        common::Result<FileHash> hash(const interfaces::FileInfo& info, HashAlgorithm algo,
+                                      ProgressFn on_progress = nullptr, common::CancellationToken cancel = {});
+
+        // Writes the cache file if it changed and SAVE_INTERVAL passed since
+        // the last write (force: whenever it changed)
+        common::EmptyResult save(bool force = false);
+
+        Stats stats() const;
+
+        // $XDG_CACHE_HOME or ~/.cache (Windows: %LOCALAPPDATA%) /CafeAgent/file_hash.cache
+        static std::string default_cache_path();
+
+    private:
+        struct Entry {
+            uint64_t digest = 0;
+            uint64_t used = 0;  // LRU stamp
+        };
+
+        static std::string cache_key(const interfaces::FileInfo& info, HashAlgorithm algo);
+
+        common::Result<uint64_t> compute(const interfaces::FileInfo& info, HashAlgorithm algo,
+                                         ProgressFn& on_progress, common::CancellationToken& cancel);
+        common::Result<uint64_t> compute_sequential(const interfaces::FileInfo& info, HashAlgorithm algo);
+
+        void load_locked();
+        common::EmptyResult write_locked();
+
+        interfaces::IFileTransfer& transfer_;
+        ParallelTransfer& parallel_;
+        std::string cache_path_;
+
+        mutable std::mutex cache_mutex_;
+        std::unordered_map<std::string, Entry> cache_;
+        bool loaded_ = false;
+        bool dirty_ = false;
+        uint64_t clock_ = 0;  // Next LRU stamp
+        std::chrono::steady_clock::time_point last_save_{};
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+    };
+
+} // namespace core
@@ -6,6 +6,7 @@
 #include <memory>
 #include <iostream>
 #include "common/Result.hpp"
+#include "interfaces/IFileTransfer.hpp"
 
 namespace core {
 namespace command {
@@ -18,8 +19,10 @@ namespace command {
 // ============================================================================
 
 struct CommandContext {
-    // Client/routing info
-    uint32_t client_id;
+    // Client/routing info. client_id is qualified by the gateway session
+    // (BroadcastBus::make_id(session, cid)): each gateway numbers its own
+    // clients, so a bare cid names different clients on different sessions
+    uint64_t client_id;
     uint32_t backend_id;
 
     // Response callback (captured by command for async responses)
@@ -27,6 +30,13 @@ struct CommandContext {
     using ResponseFn = std::function<void(std::vector<uint8_t>&&, bool is_critical, uint8_t traffic_class)>;
     ResponseFn respond;
 
+    // Ordered bulk lane on the data channel (optional; may be null).
+    // Takes: head bytes, traffic_class, file region appended after head.
+    // Packets leave in call order, so a transfer's markers and chunks cannot
+    // overtake each other; region bytes are copied by the kernel (sendfile).
+    using BulkFn = std::function<void(std::vector<uint8_t>&&, uint8_t traffic_class, interfaces::FileRegion)>;
+    BulkFn send_bulk;
+
     // Convenience methods
     void send_text(const std::string& text, bool is_critical = true, const std::string& prefix = "") const {
         std::string full_text = prefix + text;
@@ -119,6 +129,10 @@ public:
 
     // Handler category name (for logging/debugging)
     virtual const char* category() const noexcept = 0;
+
+    // The client's session ended: stop work done on its behalf (its replies
+    // have nowhere to go)
+    virtual void on_client_disconnected(uint64_t client_id) { (void)client_id; }
 };
 
 } // namespace command
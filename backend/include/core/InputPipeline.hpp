@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "interfaces/IInputInjector.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // InputPipeline - Coalescing stage between the command parser and the injector
+    // ============================================================================
+    // The session pushes every input command it decodes from one read burst,
+    // then flushes at most once per display refresh (REFRESH_INTERVAL):
+    // - A Move directly following a Move replaces it (latest position wins),
+    //   so a backlog of stale moves costs one injection, not one per message.
+    // - Everything else (buttons, keys, scroll, text) is kept and stays in
+    //   order relative to the moves around it.
+    //
+    // Not thread-safe: owned by one session's reactor thread.
+    // ============================================================================
+
+    class InputPipeline {
+    public:
+        static constexpr std::chrono::milliseconds REFRESH_INTERVAL{16}; // ~60 Hz
+
+        struct Stats {
+            uint64_t received = 0;  // Ops pushed
+            uint64_t coalesced = 0; // Moves replaced by a newer Move before injection
+            uint64_t injected = 0;  // Ops handed to the injector
+            uint64_t flushes = 0;
+        };
+
+        explicit InputPipeline(std::shared_ptr<interfaces::IInputInjector> injector);
+
+        void push(interfaces::InputOp op);
+
+        // Time until the next flush is allowed (zero: flush now)
+        std::chrono::milliseconds flush_delay(std::chrono::steady_clock::time_point now) const;
+
+        // Inject everything pending. Returns the number of ops injected.
+        size_t flush(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+        size_t pending() const { return pending_.size(); }
+        const Stats& stats() const { return stats_; }
+
+    private:
+        std::shared_ptr<interfaces::IInputInjector> injector_;
+        std::vector<interfaces::InputOp> pending_;
+        std::chrono::steady_clock::time_point last_flush_{};
+        Stats stats_;
+    };
+
+} // namespace core
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "interfaces/IInputInjector.hpp"
+
+namespace core {
+namespace input {
+
+    // ============================================================================
+    // Binary input protocol (Frontend -> Backend, TRAFFIC_INPUT)
+    // ============================================================================
+    // Payload: [TRAFFIC_INPUT][record][record]...  (one or more records)
+    //
+    // Record (12 bytes, integers big-endian like the gateway header):
+    //   op(1) | flags(1) | code(2) | x(2, int16) | y(2, int16) | timestamp_ms(4)
+    //
+    // - x/y: normalized position, 0..COORD_MAX maps to 0.0..1.0 (Move only)
+    // - code: MouseButton / KeyCode value, or signed wheel delta for Scroll
+    // - flags: reserved, must be 0
+    // - timestamp_ms: client clock, wraps; diagnostics only
+    //
+    // Text input has no record form and stays a text command.
+    // ============================================================================
+
+    constexpr uint8_t TRAFFIC_INPUT = 0x05;
+    constexpr size_t RECORD_SIZE = 12;
+    constexpr int16_t COORD_MAX = 32767;
+
+    enum class Op : uint8_t {
+        Move = 1,
+        ButtonDown = 2,
+        ButtonUp = 3,
+        Click = 4,
+        Scroll = 5,
+        KeyDown = 6,
+        KeyUp = 7
+    };
+
+    struct Record {
+        Op op = Op::Move;
+        uint8_t flags = 0;
+        uint16_t code = 0;
+        int16_t x = 0;
+        int16_t y = 0;
+        uint32_t timestamp_ms = 0;
+    };
+
+    // Read one record from exactly RECORD_SIZE bytes
+    Record decode_record(const uint8_t* p);
+
+    // Write one record into exactly RECORD_SIZE bytes
+    void encode_record(const Record& rec, uint8_t* p);
+
+    // Map a record onto the injector's op. False for unknown ops.
+    bool to_input_op(const Record& rec, interfaces::InputOp& op);
+
+    // Number of records in a payload body (after the traffic byte);
+    // 0 if the body is empty or not a whole number of records.
+    inline size_t record_count(size_t body_len) {
+        return body_len % RECORD_SIZE == 0 ? body_len / RECORD_SIZE : 0;
+    }
+
+} // namespace input
+} // namespace core
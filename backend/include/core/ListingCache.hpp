@@ -0,0 +1,159 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common/Result.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // ListingCache - Directory listings kept in memory, patched by change events
+    // ============================================================================
+    // A listed directory is watched (IFileTransfer::watch_directory) and its
+    // listing kept; a change event marks one entry, which is looked at again
+    // (get_file_info) the next time the listing is used, so repeat listings
+    // cost no directory read. Events that do not name an entry (overflow,
+    // directory deleted or moved) and more than MAX_PENDING marked entries
+    // make the listing stale: it is read again in full.
+    //
+    // Subscribers follow one directory each: changes are applied within
+    // PUSH_DELAY of the event and reported to them as a Delta (added or
+    // modified entries, removed names; or a reset after a full re-read).
+    // Listings and deltas carry a version, increasing with every change:
+    // a delta no newer than a listing is already part of it.
+    //
+    // Bounded by max_bytes (estimated memory of the listings) and
+    // max_directories (one watch each); least recently used listings are
+    // dropped first, subscribed ones never. Directories the platform cannot
+    // watch are listed every time. Thread-safe.
+    //
+    // Not seen by the watch: a subdirectory's own mtime when its contents
+    // change, and changes on remote filesystems made by other machines.
+    // ============================================================================
+
+    class ListingCache {
+    public:
+        static constexpr uint64_t DEFAULT_MAX_BYTES = 64ull * 1024 * 1024;
+        static constexpr size_t DEFAULT_MAX_DIRECTORIES = 256;
+        static constexpr size_t MAX_PENDING = 4096;    // Marked entries before a full re-read
+        static constexpr size_t MAX_SUBSCRIBERS = 64;  // Oldest dropped beyond
+        static constexpr std::chrono::milliseconds PUSH_DELAY{100};
+
+        using Listing = std::shared_ptr<const std::vector<interfaces::FileInfo>>;
+
+        struct Delta {
+            std::string directory;
+            uint64_t version = 0;
+            bool reset = false;                         // Read again (or gone): list() anew
+            std::vector<interfaces::FileInfo> changed;  // Added or modified
+            std::vector<std::string> removed;           // Names
+        };
+        using DeltaCallback = std::function<void(const Delta&)>;
+
+        struct Stats {
+            uint64_t directories = 0;
+            uint64_t entries = 0;
+            uint64_t bytes = 0;
+            uint64_t hits = 0;       // Listings served from memory
+            uint64_t misses = 0;     // Read from the filesystem
+            uint64_t uncached = 0;   // Not watchable (or too large): read every time
+            uint64_t patched = 0;    // Entries looked at again after an event
+            uint64_t relisted = 0;   // Stale listings read again
+            uint64_t evicted = 0;
+            uint64_t pushed = 0;     // Deltas reported to subscribers
+        };
+
+        explicit ListingCache(interfaces::IFileTransfer& transfer,
+                              uint64_t max_bytes = DEFAULT_MAX_BYTES,
+                              size_t max_directories = DEFAULT_MAX_DIRECTORIES);
+        ~ListingCache();
+
+        ListingCache(const ListingCache&) = delete;
+        ListingCache& operator=(const ListingCache&) = delete;
+
+        // Same result as IFileTransfer::list_directory (order unspecified).
+        // version: set to the listing's (0 if it is not cached)
+        common::Result<Listing> list(const std::string& path, uint64_t* version = nullptr);
+
+        // Report changes of `path` to on_delta (replaces the subscriber's
+        // earlier subscription). Called in version order with the cache
+        // locked, from its thread or from list(): must not call back into
+        // the cache, nor block. Subscribers are CommandContext::client_id
+        // values, unique across gateway sessions.
+        void subscribe(uint64_t subscriber, const std::string& path, DeltaCallback on_delta);
+        void unsubscribe(uint64_t subscriber);
+
+        Stats stats() const;
+
+    private:
+        // Changed entries reported by the watch, per directory; shared with
+        // the watch callbacks (which may outlive the cache)
+        struct Pending {
+            std::unordered_map<std::string, std::string> entries;  // Name -> path
+            bool stale = false;
+        };
+        struct Inbox {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::unordered_map<std::string, Pending> pending;
+            std::unordered_map<std::string, size_t> subscribed;  // Directory -> subscribers
+            bool wake = false;  // A subscribed directory changed
+            bool stop = false;
+        };
+
+        struct Directory {
+            Listing listing;  // Null: stale, read again on next use
+            uint64_t version = 0;
+            std::unordered_map<std::string, size_t> index;  // Name -> position in listing
+            uint64_t bytes = 0;
+            uint32_t loading = 0;  // Reads under way (not evicted meanwhile)
+            std::list<std::string>::iterator lru;
+        };
+
+        struct Subscriber {
+            std::string path;
+            DeltaCallback on_delta;
+            uint64_t sequence;
+        };
+
+        // Cached listing or a read
+        common::Result<Listing> fetch(const std::string& path, uint64_t* version, bool count);
+        common::Result<Listing> load(const std::string& path, uint64_t* version);
+        // Applies the directory's pending changes; false if it is (now) stale
+        bool update_locked(const std::string& path, Directory& dir);
+        void notify_locked(const Delta& delta);
+        void drop_listing_locked(Directory& dir);
+        void erase_locked(const std::string& path);
+        void evict_locked();
+        void push_loop();
+
+        static uint64_t entry_bytes(const interfaces::FileInfo& info);
+        static bool same_entry(const interfaces::FileInfo& a, const interfaces::FileInfo& b);
+
+        interfaces::IFileTransfer& transfer_;
+        uint64_t max_bytes_;
+        size_t max_directories_;
+        std::shared_ptr<Inbox> inbox_;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, Directory> dirs_;
+        std::list<std::string> lru_;  // Most recently used first
+        std::unordered_map<uint64_t, Subscriber> subscribers_;
+        uint64_t subscriber_sequence_ = 0;
+        uint64_t version_ = 0;
+        uint64_t bytes_ = 0;
+        Stats stats_;
+
+        std::thread push_thread_;
+    };
+
+} // namespace core
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // ListingOrder - Sort order and page cursors for directory listings
+    // ============================================================================
+    // Directories come first, by name; files by the key (name, size or
+    // modification time), equal keys by name. Names compare ASCII
+    // case-insensitively, then bytewise, so no two entries are equal.
+    //
+    // A cursor names the last entry of a page by its sort position
+    // ("<d|f>/<key>/<name>", Base64 so it is one token in a command), not
+    // by an offset: the next page starts after that position even if
+    // entries were added or removed meanwhile.
+    //
+    // Entries are put in order as they are needed (select, then arrange the
+    // first page, then the rest): the first page of a large directory does
+    // not wait for the whole listing to be sorted.
+    // ============================================================================
+
+    class ListingOrder {
+    public:
+        enum class Key { Name, Size, Modified };
+
+        Key key = Key::Name;
+        bool descending = false;
+
+        // "name", "size" or "mtime", "-" prefixed for descending
+        static bool parse(const std::string& text, ListingOrder& order);
+        std::string to_string() const;
+
+        bool before(const interfaces::FileInfo& a, const interfaces::FileInfo& b) const;
+        std::vector<const interfaces::FileInfo*> sort(const std::vector<interfaces::FileInfo>& entries) const;
+
+        std::string cursor(const interfaces::FileInfo& last) const;
+        // The entries after cursor ("" = all of them), unordered; false if
+        // the cursor is malformed
+        bool select(const std::vector<interfaces::FileInfo>& entries, const std::string& cursor,
+                    std::vector<const interfaces::FileInfo*>& selected) const;
+        // Puts the smallest of selected[from, end) in order at [from, to)
+        void arrange(std::vector<const interfaces::FileInfo*>& selected, size_t from, size_t to) const;
+
+    private:
+        uint64_t key_of(const interfaces::FileInfo& info) const;
+        bool parse_cursor(const std::string& cursor, interfaces::FileInfo& probe) const;
+    };
+
+} // namespace core
@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "common/Cancellation.hpp"
+#include "common/Result.hpp"
+#include "core/ThreadPool.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // ParallelTransfer - Multi-stream reads of one large file
+    // ============================================================================
+    // Splits a byte range into N stripes on FILE_TRANSFER_CHUNK_SIZE boundaries
+    // and reads them concurrently through IFileTransfer::download_file (pread
+    // per stripe) on a worker pool shared by all downloads, so the number of
+    // reads in flight stays bounded however many clients download at once.
+    //
+    // Chunks are reported with their file offset; offset / chunk size is the
+    // wire sequence number, which the receiver sorts by, so arrival order does
+    // not matter. Exactly one chunk (the one ending the range) has is_last set,
+    // but it is not necessarily delivered last.
+    //
+    // Stream count auto-tuning: throughput is measured per count (powers of
+    // two up to max_streams). The tuner doubles N while that gains at least
+    // MIN_GAIN, then stays on the best count, re-probing the next one up every
+    // REPROBE_EVERY transfers in case conditions changed. Ranges smaller than
+    // min_parallel_bytes are read on one stream and not measured.
+    // ============================================================================
+
+    class ParallelTransfer {
+    public:
+        // Called concurrently from pool threads; must be thread-safe
+        using ChunkFn = std::function<void(uint64_t offset, const uint8_t* data, size_t size, bool is_last)>;
+
+        static constexpr size_t MAX_STREAMS = 16;
+        static constexpr double MIN_GAIN = 0.10;
+        static constexpr uint32_t REPROBE_EVERY = 16;
+
+        struct Config {
+            size_t max_streams = 4;
+            uint64_t min_parallel_bytes = 8 * interfaces::FILE_TRANSFER_CHUNK_SIZE;  // 2 MB
+        };
+
+        explicit ParallelTransfer(interfaces::IFileTransfer& transfer);
+        ParallelTransfer(interfaces::IFileTransfer& transfer, Config config);
+
+        ParallelTransfer(const ParallelTransfer&) = delete;
+        ParallelTransfer& operator=(const ParallelTransfer&) = delete;
+
+        // Read a range already resolved against the file size (resolve_range)
+        // with the tuned stream count. Returns once every chunk was delivered.
+        // Once cancel is requested no further chunks are delivered and the
+        // result is ErrorCode::Cancelled.
+        common::EmptyResult read(const std::string& path, interfaces::ByteRange range, ChunkFn on_chunk,
+                                 common::CancellationToken cancel = {});
+
+        // Same with a fixed stream count; not recorded by the tuner
+        common::EmptyResult read_with(size_t streams, const std::string& path,
+                                      interfaces::ByteRange range, ChunkFn on_chunk,
+                                      common::CancellationToken cancel = {});
+
+        // Stream count the next large read would use
+        size_t next_streams() const;
+
+        // Smoothed MB/s measured for a stream count; 0 if never measured
+        double measured_mbps(size_t streams) const;
+
+    private:
+        size_t pick_streams_locked() const;
+        void record(size_t streams, uint64_t bytes, double seconds);
+
+        interfaces::IFileTransfer& transfer_;
+        Config config_;
+        ThreadPool pool_;
+
+        mutable std::mutex tune_mutex_;
+        std::array<double, MAX_STREAMS + 1> mbps_{};  // EWMA, indexed by stream count
+        uint32_t measured_transfers_ = 0;
+    };
+
+} // namespace core
@@ -8,6 +8,9 @@
 #include <functional>
 #include <atomic>
 #include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 namespace core {
 
@@ -151,4 +154,109 @@ private:
     std::atomic<bool> stop_;
 };
 
+/**
+ * @brief Runs tasks on a ThreadPool one at a time, in submission order.
+ *
+ * For work that must not be reordered (e.g. the start, chunks and end of
+ * one upload) while still staying off the caller's thread. At most one
+ * task of a strand is queued in the pool at any time.
+ */
+class TaskStrand : public std::enable_shared_from_this<TaskStrand> {
+public:
+    explicit TaskStrand(ThreadPool& pool) : pool_(pool) {}
+
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push(std::move(task));
+            if (running_) return;
+            running_ = true;
+        }
+        schedule();
+    }
+
+private:
+    void schedule() {
+        pool_.submit_detached([self = shared_from_this()]() { self->run_next(); });
+    }
+
+    void run_next() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (tasks_.empty()) {
+                running_ = false;
+                return;
+            }
+        }
+        schedule();
+    }
+
+    ThreadPool& pool_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    bool running_ = false;
+};
+
+/**
+ * @brief One TaskStrand per key, kept only while the key has tasks.
+ *
+ * Tasks posted under the same key (e.g. one upload's path) run in order,
+ * one at a time; tasks under different keys run in parallel on the pool.
+ * A key's strand is dropped once its last queued task has run, so a key
+ * posted again later simply starts a new strand.
+ */
+class KeyedStrands : public std::enable_shared_from_this<KeyedStrands> {
+public:
+    explicit KeyedStrands(ThreadPool& pool) : pool_(pool) {}
+
+    void post(const std::string& key, std::function<void()> task) {
+        std::shared_ptr<TaskStrand> strand;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Entry& entry = strands_[key];
+            if (!entry.strand) entry.strand = std::make_shared<TaskStrand>(pool_);
+            entry.pending++;
+            strand = entry.strand;
+        }
+        strand->post([self = shared_from_this(), key, task = std::move(task)]() {
+            try {
+                task();
+            } catch (...) {
+                self->finished(key);
+                throw;
+            }
+            self->finished(key);
+        });
+    }
+
+    // Keys with tasks queued or running
+    size_t active() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return strands_.size();
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<TaskStrand> strand;
+        size_t pending = 0;
+    };
+
+    void finished(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = strands_.find(key);
+        if (it != strands_.end() && --it->second.pending == 0) strands_.erase(it);
+    }
+
+    ThreadPool& pool_;
+    std::unordered_map<std::string, Entry> strands_;
+    mutable std::mutex mutex_;
+};
+
 } // namespace core
@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/Cancellation.hpp"
+#include "interfaces/IFileTransfer.hpp"
+
+namespace core {
+
+    // ============================================================================
+    // TransferScheduler - Bounded, fair, cancellable background file work
+    // ============================================================================
+    // Runs downloads and listing prefetch on a fixed set of workers instead of
+    // a detached thread each:
+    // - At most max_active jobs run at once; Bulk jobs get max_active - 1 of
+    //   the slots so an Interactive job (listing) never waits behind downloads
+    // - Interactive jobs are started before Bulk ones
+    // - Within a priority, clients take turns (round-robin): a client queueing
+    //   ten downloads does not delay another client's first one. Clients are
+    //   CommandContext::client_id values, unique across gateway sessions
+    // - cancel() drops queued jobs and signals running ones through their
+    //   CancellationToken; a job stops at its next check
+    //
+    // Zero-copy downloads queue file regions much faster than a socket drains
+    // them, so jobs pace themselves with acquire_lease(): it blocks while
+    // FLOW_WINDOW of the transfer's packets are still in the writer. A job
+    // counts as active until its last leased packet has left the writer.
+    // ============================================================================
+
+    class TransferScheduler {
+    public:
+        enum class Priority { Interactive = 0, Bulk = 1 };
+
+        static constexpr size_t FLOW_WINDOW = 8;  // Chunks queued per transfer (2 MB)
+
+        // One scheduled job, as seen by the job itself
+        class Transfer {
+        public:
+            uint64_t id() const { return id_; }
+            uint64_t client_id() const { return client_id_; }
+            const std::string& label() const { return label_; }
+
+            const common::CancellationToken& token() const { return token_; }
+            bool cancelled() const { return token_.is_cancellation_requested(); }
+
+            // Blocks until the flow window has room. Null once cancelled.
+            std::shared_ptr<const interfaces::TransferLease> acquire_lease();
+
+        private:
+            friend class TransferScheduler;
+            class Lease;
+
+            Transfer(uint64_t id, uint64_t client_id, Priority priority, std::string label);
+
+            void cancel();
+            void release_slot();
+            void wait_drained();
+
+            uint64_t id_;
+            uint64_t client_id_;
+            Priority priority_;
+            std::string label_;
+            common::CancellationSource source_;
+            common::CancellationToken token_;
+
+            std::mutex flow_mutex_;
+            std::condition_variable flow_cv_;
+            size_t in_flight_ = 0;
+        };
+
+        using Job = std::function<void(Transfer&)>;
+
+        struct Stats {
+            size_t queued = 0;
+            size_t active = 0;
+            uint64_t completed = 0;
+            uint64_t cancelled = 0;
+        };
+
+        explicit TransferScheduler(size_t max_active = 4);
+        ~TransferScheduler();
+
+        TransferScheduler(const TransferScheduler&) = delete;
+        TransferScheduler& operator=(const TransferScheduler&) = delete;
+
+        // Queue a job; returns its transfer id
+        uint64_t submit(uint64_t client_id, Priority priority, std::string label, Job job);
+
+        // Cancel a client's queued and running jobs of one priority whose
+        // label matches (empty label: all of them). Returns how many.
+        size_t cancel(uint64_t client_id, Priority priority, const std::string& label = "");
+
+        Stats stats() const;
+
+    private:
+        struct Pending {
+            std::shared_ptr<Transfer> transfer;
+            Job job;
+        };
+
+        // Per-priority queue: FIFO per client, clients served in rotation
+        struct Lane {
+            std::map<uint64_t, std::deque<Pending>> by_client;
+            std::deque<uint64_t> rotation;
+            size_t size = 0;
+        };
+
+        bool can_start_locked(Priority priority) const;
+        bool take_locked(Pending& out);
+        void worker_loop();
+
+        size_t max_active_;
+        std::vector<std::thread> workers_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::array<Lane, 2> lanes_;
+        std::map<uint64_t, std::shared_ptr<Transfer>> running_;
+        size_t running_bulk_ = 0;
+        uint64_t next_id_ = 1;
+        uint64_t completed_ = 0;
+        uint64_t cancelled_ = 0;
+        bool stop_ = false;
+    };
+
+} // namespace core
@@ -1,5 +1,12 @@
 #pragma once
+#include "common/Delta.hpp"
+#include "core/ChunkStore.hpp"
+#include "core/FileHasher.hpp"
 #include "core/ICommand.hpp"
+#include "core/ListingCache.hpp"
+#include "core/ListingOrder.hpp"
+#include "core/ParallelTransfer.hpp"
+#include "core/TransferScheduler.hpp"
 #include "interfaces/IFileTransfer.hpp"
 #include <memory>
 #include <sstream>
@@ -14,29 +21,83 @@ using core::command::ICommandHandler;
 // FileCommandHandler - Handles file transfer commands
 // ============================================================================
 // Commands:
-//   file_list <path>              - List directory contents
+//   file_list <path>              - List directory contents (FILES_PAGE, by name)
+//   file_list_page <sort> <limit> <cursor> <path>
+//                                 - Sorted listing (name, size, mtime; "-" descending)
+//                                   in FILES_PAGE messages: up to limit entries (0: all)
+//                                   after cursor (from the previous reply's last page;
+//                                   "-": from the start)
+//   file_watch [path]             - Follow path: its listing now (FILES_PAGE, by name),
+//                                   then its changes as FILES_DELTA (none: stop)
 //   file_info <path>              - Get file/directory info
-//   file_download <path>          - Start file download (sends chunks)
+//   file_download <path>[|offset[|length[|mtime]]]
+//                                 - Start file download (sends chunks); a range
+//                                   resumes or splits it, mtime guards a resume
+//   file_download_dir <path>      - Download a directory as one tar archive (<path>.tar)
+//   file_download_cancel [path]   - Cancel this client's download(s) of path (all if omitted)
+//   file_transfers                - Scheduler queue depth and active transfers
+//   file_hash <path> [algo]       - Hash a file (xxh64 tree digest or crc32c)
+//   file_hash_dir <path> [algo]   - Hash every file under a directory
 //   file_upload_start <path> <size> - Start file upload
+//   file_delta_sig <path>         - Block signatures of a file, for a delta upload over it
+//   file_delta_start <size> <id> <basis_size> <basis_mtime> <path>
+//                                 - Start a delta upload (literals as upload chunks)
+//   file_delta_copy <dst:src:len,...> <path> - Reuse ranges of the current file
+//   file_delta_end <crc32c> <path> - Verify and atomically replace the file
+//   file_cas_start <size> <id> <path> - Start an upload deduplicated against the chunk store
+//   file_cas_have <offset> <sha256:len,...> <path>
+//                                 - The upload's next chunks; replies with those to send
+//   file_cas_end <path>           - Fill in the stored chunks and finish the upload
 //   file_mkdir <path>             - Create directory
 //   file_delete <path>            - Delete file/directory
 //   file_rename <old> <new>       - Rename/move file
 //   file_space <path>             - Get free disk space
 // ============================================================================
 
+// Listings come from the cache; both commands prefetch the subdirectories
 class FileListCommand : public ICommand {
 public:
-    FileListCommand(interfaces::IFileTransfer& transfer,
+    FileListCommand(core::ListingCache& listings,
+                   core::TransferScheduler& scheduler,
                    std::string path,
+                   bool watch,
                    CommandContext ctx)
-        : transfer_(transfer), path_(std::move(path)), ctx_(std::move(ctx)) {}
+        : listings_(listings), scheduler_(scheduler), path_(std::move(path)), watch_(watch),
+          ctx_(std::move(ctx)) {}
 
     common::EmptyResult execute() override;
-    const char* type() const noexcept override { return "file_list"; }
+    const char* type() const noexcept override { return watch_ ? "file_watch" : "file_list"; }
 
 private:
-    interfaces::IFileTransfer& transfer_;
+    core::ListingCache& listings_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    bool watch_;  // file_watch: subscribe, the pages then deltas
+    CommandContext ctx_;
+};
+
+class FileListPageCommand : public ICommand {
+public:
+    FileListPageCommand(core::ListingCache& listings,
+                       core::TransferScheduler& scheduler,
+                       std::string path,
+                       core::ListingOrder order,
+                       size_t limit,
+                       std::string cursor,
+                       CommandContext ctx)
+        : listings_(listings), scheduler_(scheduler), path_(std::move(path)), order_(order), limit_(limit),
+          cursor_(std::move(cursor)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_list_page"; }
+
+private:
+    core::ListingCache& listings_;
+    core::TransferScheduler& scheduler_;
     std::string path_;
+    core::ListingOrder order_;
+    size_t limit_;        // 0: to the end
+    std::string cursor_;  // Empty: from the start
     CommandContext ctx_;
 };
 
@@ -59,16 +120,117 @@ private:
 class FileDownloadCommand : public ICommand {
 public:
     FileDownloadCommand(interfaces::IFileTransfer& transfer,
+                       core::ParallelTransfer& parallel,
+                       core::TransferScheduler& scheduler,
                        std::string path,
+                       interfaces::ByteRange range,
+                       uint64_t expected_mtime,
+                       bool checksums,
                        CommandContext ctx)
-        : transfer_(transfer), path_(std::move(path)), ctx_(std::move(ctx)) {}
+        : transfer_(transfer), parallel_(parallel), scheduler_(scheduler), path_(std::move(path)),
+          range_(range), expected_mtime_(expected_mtime), checksums_(checksums), ctx_(std::move(ctx)) {}
 
     common::EmptyResult execute() override;
     const char* type() const noexcept override { return "file_download"; }
 
 private:
     interfaces::IFileTransfer& transfer_;
+    core::ParallelTransfer& parallel_;
+    core::TransferScheduler& scheduler_;
     std::string path_;
+    interfaces::ByteRange range_;
+    uint64_t expected_mtime_;  // 0: no check
+    bool checksums_;           // CRC32C per chunk, digest in the END message
+    CommandContext ctx_;
+};
+
+class FileDownloadDirCommand : public ICommand {
+public:
+    FileDownloadDirCommand(interfaces::IFileTransfer& transfer,
+                          core::TransferScheduler& scheduler,
+                          std::string path,
+                          CommandContext ctx)
+        : transfer_(transfer), scheduler_(scheduler), path_(std::move(path)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_download_dir"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    CommandContext ctx_;
+};
+
+class FileDownloadCancelCommand : public ICommand {
+public:
+    FileDownloadCancelCommand(core::TransferScheduler& scheduler,
+                             std::string path,
+                             CommandContext ctx)
+        : scheduler_(scheduler), path_(std::move(path)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_download_cancel"; }
+
+private:
+    core::TransferScheduler& scheduler_;
+    std::string path_;  // Empty: all of the client's downloads
+    CommandContext ctx_;
+};
+
+class FileTransfersCommand : public ICommand {
+public:
+    FileTransfersCommand(core::TransferScheduler& scheduler, CommandContext ctx)
+        : scheduler_(scheduler), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_transfers"; }
+
+private:
+    core::TransferScheduler& scheduler_;
+    CommandContext ctx_;
+};
+
+class FileHashCommand : public ICommand {
+public:
+    FileHashCommand(core::FileHasher& hasher,
+                   core::TransferScheduler& scheduler,
+                   std::string path,
+                   core::HashAlgorithm algo,
+                   CommandContext ctx)
+        : hasher_(hasher), scheduler_(scheduler), path_(std::move(path)), algo_(algo), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_hash"; }
+
+private:
+    core::FileHasher& hasher_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    core::HashAlgorithm algo_;
+    CommandContext ctx_;
+};
+
+class FileHashDirCommand : public ICommand {
+public:
+    FileHashDirCommand(interfaces::IFileTransfer& transfer,
+                      core::FileHasher& hasher,
+                      core::TransferScheduler& scheduler,
+                      std::string path,
+                      core::HashAlgorithm algo,
+                      CommandContext ctx)
+        : transfer_(transfer), hasher_(hasher), scheduler_(scheduler), path_(std::move(path)),
+          algo_(algo), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_hash_dir"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    core::FileHasher& hasher_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    core::HashAlgorithm algo_;
     CommandContext ctx_;
 };
 
@@ -129,15 +291,160 @@ private:
 class FileUploadCancelCommand : public ICommand {
 public:
     FileUploadCancelCommand(interfaces::IFileTransfer& transfer,
+                           core::ChunkStore& chunks,
                            std::string path,
                            CommandContext ctx)
-        : transfer_(transfer), path_(std::move(path)), ctx_(std::move(ctx)) {}
+        : transfer_(transfer), chunks_(chunks), path_(std::move(path)), ctx_(std::move(ctx)) {}
 
     common::EmptyResult execute() override;
     const char* type() const noexcept override { return "file_upload_cancel"; }
 
 private:
     interfaces::IFileTransfer& transfer_;
+    core::ChunkStore& chunks_;
+    std::string path_;
+    CommandContext ctx_;
+};
+
+class FileDeltaSigCommand : public ICommand {
+public:
+    FileDeltaSigCommand(interfaces::IFileTransfer& transfer,
+                       core::TransferScheduler& scheduler,
+                       std::string path,
+                       CommandContext ctx)
+        : transfer_(transfer), scheduler_(scheduler), path_(std::move(path)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_delta_sig"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    CommandContext ctx_;
+};
+
+class FileDeltaStartCommand : public ICommand {
+public:
+    FileDeltaStartCommand(interfaces::IFileTransfer& transfer,
+                         std::string path,
+                         uint64_t size,
+                         uint64_t basis_size,
+                         uint64_t basis_mtime,
+                         CommandContext ctx)
+        : transfer_(transfer), path_(std::move(path)), size_(size),
+          basis_size_(basis_size), basis_mtime_(basis_mtime), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_delta_start"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    std::string path_;
+    uint64_t size_;
+    uint64_t basis_size_;   // The file the signatures were made from:
+    uint64_t basis_mtime_;  // the upload fails if it has changed since
+    CommandContext ctx_;
+};
+
+class FileDeltaCopyCommand : public ICommand {
+public:
+    FileDeltaCopyCommand(interfaces::IFileTransfer& transfer,
+                        std::string path,
+                        std::vector<common::delta::Op> copies,
+                        CommandContext ctx)
+        : transfer_(transfer), path_(std::move(path)),
+          copies_(std::move(copies)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_delta_copy"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    std::string path_;
+    std::vector<common::delta::Op> copies_;
+    CommandContext ctx_;
+};
+
+class FileDeltaEndCommand : public ICommand {
+public:
+    FileDeltaEndCommand(interfaces::IFileTransfer& transfer,
+                       std::string path,
+                       uint32_t crc32c,
+                       CommandContext ctx)
+        : transfer_(transfer), path_(std::move(path)), crc32c_(crc32c), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_delta_end"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    std::string path_;
+    uint32_t crc32c_;  // Of the whole new file
+    CommandContext ctx_;
+};
+
+class FileCasStartCommand : public ICommand {
+public:
+    FileCasStartCommand(interfaces::IFileTransfer& transfer,
+                       core::ChunkStore& chunks,
+                       std::string path,
+                       uint64_t size,
+                       CommandContext ctx)
+        : transfer_(transfer), chunks_(chunks), path_(std::move(path)),
+          size_(size), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_cas_start"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    core::ChunkStore& chunks_;
+    std::string path_;
+    uint64_t size_;
+    CommandContext ctx_;
+};
+
+class FileCasHaveCommand : public ICommand {
+public:
+    struct Chunk {
+        std::string key;  // SHA-256, lowercase hex
+        uint64_t length;
+    };
+
+    FileCasHaveCommand(core::ChunkStore& chunks,
+                      std::string path,
+                      uint64_t offset,
+                      std::vector<Chunk> list,
+                      CommandContext ctx)
+        : chunks_(chunks), path_(std::move(path)), offset_(offset),
+          list_(std::move(list)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_cas_have"; }
+
+private:
+    core::ChunkStore& chunks_;
+    std::string path_;
+    uint64_t offset_;  // Of the first chunk; the rest follow back to back
+    std::vector<Chunk> list_;
+    CommandContext ctx_;
+};
+
+class FileCasEndCommand : public ICommand {
+public:
+    FileCasEndCommand(interfaces::IFileTransfer& transfer,
+                     core::ChunkStore& chunks,
+                     std::string path,
+                     CommandContext ctx)
+        : transfer_(transfer), chunks_(chunks), path_(std::move(path)), ctx_(std::move(ctx)) {}
+
+    common::EmptyResult execute() override;
+    const char* type() const noexcept override { return "file_cas_end"; }
+
+private:
+    interfaces::IFileTransfer& transfer_;
+    core::ChunkStore& chunks_;
     std::string path_;
     CommandContext ctx_;
 };
@@ -216,7 +523,9 @@ private:
 class FileCommandHandler : public ICommandHandler {
 public:
     explicit FileCommandHandler(interfaces::IFileTransfer& transfer)
-        : transfer_(transfer) {}
+        : transfer_(transfer), parallel_(transfer),
+          hasher_(transfer, parallel_, core::FileHasher::default_cache_path()),
+          chunks_(transfer, core::ChunkStore::default_root()), listings_(transfer) {}
 
     bool can_handle(const std::string& command) const override;
 
@@ -229,9 +538,28 @@ public:
         return "FileCommandHandler";
     }
 
+    // Cancels the client's transfers and listing jobs, ends its file_watch
+    void on_client_disconnected(uint64_t client_id) override;
+
 private:
     interfaces::IFileTransfer& transfer_;
 
+    // Striped reads for the copying download path, shared by all downloads
+    core::ParallelTransfer parallel_;
+
+    // file_hash results, cached on disk across restarts; reads through parallel_
+    core::FileHasher hasher_;
+
+    // Chunks of past uploads, reused by file_cas_* uploads across sessions
+    core::ChunkStore chunks_;
+
+    // file_list / file_watch listings, kept current by directory watches
+    core::ListingCache listings_;
+
+    // Runs downloads and listing prefetch (declared after parallel_, hasher_ and listings_:
+    // destroyed first, joining jobs that still use them)
+    core::TransferScheduler scheduler_;
+
     // Track current upload for chunk handling
     std::string current_upload_path_;
 };
@@ -86,7 +86,7 @@ public:
     StopMonitorStreamCommand(
         std::shared_ptr<core::BroadcastBus> bus,
         std::shared_ptr<core::StreamSession> session,
-        uint32_t client_id,
+        core::SubscriberId client_id,
         core::command::CommandContext ctx
     ) : bus_(std::move(bus))
       , session_(std::move(session))
@@ -99,7 +99,7 @@ public:
 private:
     std::shared_ptr<core::BroadcastBus> bus_;
     std::shared_ptr<core::StreamSession> session_;
-    uint32_t client_id_;
+    core::SubscriberId client_id_;
     core::command::CommandContext ctx_;
 };
 
@@ -127,7 +127,7 @@ public:
     StopWebcamStreamCommand(
         std::shared_ptr<core::BroadcastBus> bus,
         std::shared_ptr<core::StreamSession> session,
-        uint32_t client_id,
+        core::SubscriberId client_id,
         core::command::CommandContext ctx
     ) : bus_(std::move(bus))
       , session_(std::move(session))
@@ -140,7 +140,7 @@ public:
 private:
     std::shared_ptr<core::BroadcastBus> bus_;
     std::shared_ptr<core::StreamSession> session_;
-    uint32_t client_id_;
+    core::SubscriberId client_id_;
     core::command::CommandContext ctx_;
 };
 
@@ -4,6 +4,8 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <algorithm>
+#include "common/Checksum.hpp"
 #include "common/Result.hpp"
 
 namespace interfaces {
@@ -30,6 +32,29 @@ constexpr size_t FILE_TRANSFER_CHUNK_SIZE = 250 * 1024;  // 250 KB - Fits in Gat
 // Data Structures
 // ============================================================================
 
+// Byte range of a download. length 0 means "to end of file".
+struct ByteRange {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+// Clamp a range to the file size. False if it starts past the end.
+inline bool resolve_range(ByteRange& range, uint64_t file_size) {
+    if (range.offset > file_size) return false;
+    uint64_t avail = file_size - range.offset;
+    if (range.length == 0 || range.length > avail) range.length = avail;
+    return true;
+}
+
+// Download chunks are cut at multiples of FILE_TRANSFER_CHUNK_SIZE in file
+// coordinates: chunk N covers the same bytes whichever range fetched it, so
+// N (the wire sequence number) locates the chunk for resumes and multi-range
+// fetches. Returns the size of the chunk starting at pos.
+inline size_t chunk_span(uint64_t pos, uint64_t end) {
+    uint64_t boundary = (pos / FILE_TRANSFER_CHUNK_SIZE + 1) * FILE_TRANSFER_CHUNK_SIZE;
+    return static_cast<size_t>((std::min)(boundary, end) - pos); // Parenthesized: windows.h min macro
+}
+
 struct FileInfo {
     std::string name;           // File/directory name only
     std::string path;           // Full absolute path
@@ -38,6 +63,8 @@ struct FileInfo {
     bool is_directory;
     bool is_hidden;
     bool is_readonly;
+    uint64_t device = 0;        // Identity for caches: st_dev / st_ino
+    uint64_t inode = 0;         // (0 where the platform does not report it)
 
     // Helper for serialization
     std::string to_string() const {
@@ -64,9 +91,58 @@ struct TransferProgress {
     }
 };
 
+// ============================================================================
+// Zero-copy download source
+// ============================================================================
+// An open file whose bytes the connection writer hands to the socket with
+// sendfile() (the kernel copies page cache -> socket, nothing passes through
+// userspace). The descriptor stays open while any FileRegion references it.
+
+class IFileSource {
+public:
+    virtual ~IFileSource() = default;
+    virtual int native_handle() const = 0;  // POSIX file descriptor
+    virtual uint64_t size() const = 0;      // Size when opened
+};
+
+// Held by each queued packet of a scheduled transfer (core::TransferScheduler).
+// The writer drops its packet once it is sent or discarded, which releases
+// the lease and frees a slot in the transfer's flow window; packets of a
+// cancelled transfer that have not started are discarded unsent.
+class TransferLease {
+public:
+    virtual ~TransferLease() = default;
+    virtual bool cancelled() const = 0;
+};
+
+// A byte range of a file source, queued as the body of one packet
+struct FileRegion {
+    std::shared_ptr<const IFileSource> source;  // Null: no file body
+    uint64_t offset = 0;
+    size_t length = 0;
+    std::shared_ptr<const TransferLease> lease;  // Optional
+};
+
+// ============================================================================
+// Directory change notification
+// ============================================================================
+// One change to the entries of a watched directory. Changes are reported,
+// not their result: the receiver looks at the entry again (it may be gone
+// by then, or have changed further). An empty name means the directory as a
+// whole: it was deleted or moved, or the platform dropped events - anything
+// known about its entries is stale.
+
+struct DirectoryChange {
+    std::string directory;      // As passed to watch_directory
+    std::string name;           // Entry name; empty: the whole directory
+    std::string path;           // Full path of the entry (list_directory's FileInfo::path)
+    bool removed = false;       // Deleted or moved away (otherwise: created, modified)
+};
+
 // Callbacks
 using ProgressCallback = std::function<void(const TransferProgress&)>;
 using DataChunkCallback = std::function<void(const uint8_t* data, size_t size, bool is_last)>;
+using DirectoryChangeCallback = std::function<void(const DirectoryChange&)>;
 
 // ============================================================================
 // IFileTransfer Interface
@@ -95,16 +171,51 @@ public:
     virtual common::EmptyResult delete_path(
         const std::string& path) = 0;
 
+    // Report changes to the entries of `path` (not recursive) to on_change,
+    // replacing an earlier watch of the same path. Called from a platform
+    // thread, or from flush_directory_changes; must not call back into the
+    // watch functions. Platforms without change notification return
+    // NotImplemented: listings of such directories cannot be cached.
+    virtual common::EmptyResult watch_directory(
+        const std::string& path,
+        DirectoryChangeCallback on_change) {
+        (void)on_change;
+        return common::EmptyResult::err(
+            common::ErrorCode::NotImplemented, "Directory watch not supported: " + path);
+    }
+
+    // Stop watching `path` (no-op if it is not watched). A callback already
+    // under way may still complete.
+    virtual void unwatch_directory(const std::string& path) {
+        (void)path;
+    }
+
+    // Deliver every change caused by operations that completed before this
+    // call, on the calling thread, before returning
+    virtual void flush_directory_changes() {}
+
     // ========== Download (Server → Client) ==========
 
     // Read file and call callback with chunks
     // Optimized for streaming large files
-    // on_chunk: Called for each chunk (data pointer valid only during callback)
+    // on_chunk: Called for each chunk (data pointer valid only during callback),
+    //           cut at chunk_span() boundaries; is_last marks the end of the range
     // on_progress: Called periodically with transfer progress
+    // range: Bytes to read (default: whole file); error if it starts past the end
     virtual common::EmptyResult download_file(
         const std::string& path,
         DataChunkCallback on_chunk,
-        ProgressCallback on_progress = nullptr) = 0;
+        ProgressCallback on_progress = nullptr,
+        ByteRange range = {}) = 0;
+
+    // Open a file for zero-copy sending (see IFileSource).
+    // Platforms without a kernel send path return NotImplemented and
+    // downloads fall back to download_file().
+    virtual common::Result<std::shared_ptr<const IFileSource>> open_for_send(
+        const std::string& path) {
+        return common::Result<std::shared_ptr<const IFileSource>>::err(
+            common::ErrorCode::NotImplemented, "Zero-copy send not supported: " + path);
+    }
 
     // ========== Upload (Client → Server) ==========
 
@@ -121,14 +232,97 @@ public:
         const uint8_t* data,
         size_t size) = 0;
 
+    // Write chunk at an absolute file offset (binary upload frames).
+    // Default: append via upload_chunk, correct when chunks arrive in order.
+    virtual common::EmptyResult upload_write_at(
+        const std::string& path,
+        uint64_t offset,
+        const uint8_t* data,
+        size_t size) {
+        (void)offset;
+        return upload_chunk(path, data, size);
+    }
+
+    // Fill `length` bytes of an ongoing upload at `offset` from another file
+    // on this machine (counted like written chunks).
+    // Default: read the range and write it; platforms copy in the kernel.
+    virtual common::EmptyResult upload_copy_from(
+        const std::string& path,
+        uint64_t offset,
+        const std::string& source,
+        uint64_t source_offset,
+        uint64_t length) {
+        if (length == 0) return common::EmptyResult::success();  // (A zero range length means "to the end")
+        uint64_t got = 0;
+        common::EmptyResult written = common::EmptyResult::success();
+        auto result = download_file(source, [&](const uint8_t* data, size_t size, bool) {
+            size = static_cast<size_t>((std::min)(uint64_t(size), length - got));
+            if (written.is_ok() && size > 0) written = upload_write_at(path, offset + got, data, size);
+            got += size;
+        }, nullptr, ByteRange{source_offset, length});
+        if (result.is_err()) return result;
+        if (written.is_err()) return written;
+        if (got != length) {
+            return common::EmptyResult::err(
+                common::ErrorCode::Unknown, "Short copy from " + source + ": " + path);
+        }
+        return common::EmptyResult::success();
+    }
+
     // Finalize upload (flush buffers, verify size)
     virtual common::EmptyResult upload_finish(
         const std::string& path) = 0;
 
+    // Finalize upload and return the file's digest (see file_digest).
+    // Default: finish, then hash the written file in a second read pass;
+    // platforms that hash chunks as they are written override this.
+    virtual common::Result<uint64_t> upload_finish_digest(
+        const std::string& path) {
+        auto result = upload_finish(path);
+        if (result.is_err()) return result.error();
+        return file_digest(path);
+    }
+
     // Cancel ongoing upload (delete partial file)
     virtual common::EmptyResult upload_cancel(
         const std::string& path) = 0;
 
+    // ========== Delta Upload (overwrite an existing file) ==========
+    // The new content of `path` is built in a temporary file next to it
+    // from literal bytes (upload_write_at) and ranges of the current file
+    // (delta_copy); delta_finish verifies it and renames it over `path`,
+    // so readers see the old or the new file, never a mix.
+    // upload_cancel drops the temporary file and leaves `path` untouched.
+
+    virtual common::EmptyResult delta_start(
+        const std::string& path,
+        uint64_t new_size) {
+        (void)new_size;
+        return common::EmptyResult::err(
+            common::ErrorCode::NotImplemented, "Delta upload not supported: " + path);
+    }
+
+    // Copy `length` bytes at `src` in the current file to `dst` in the new one
+    virtual common::EmptyResult delta_copy(
+        const std::string& path,
+        uint64_t dst,
+        uint64_t src,
+        uint64_t length) {
+        (void)dst; (void)src; (void)length;
+        return common::EmptyResult::err(
+            common::ErrorCode::NotImplemented, "Delta upload not supported: " + path);
+    }
+
+    // Verify the new file against the sender's CRC32C, replace `path`
+    // and return the digest (see file_digest). On error `path` is unchanged.
+    virtual common::Result<uint64_t> delta_finish(
+        const std::string& path,
+        uint32_t expected_crc32c) {
+        (void)expected_crc32c;
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::NotImplemented, "Delta upload not supported: " + path);
+    }
+
     // ========== Utility ==========
 
     // Get available disk space at path
@@ -139,6 +333,19 @@ public:
     virtual common::EmptyResult rename(
         const std::string& old_path,
         const std::string& new_path) = 0;
+
+    // Whole-file digest: common::checksum::ChunkDigest over
+    // FILE_TRANSFER_CHUNK_SIZE blocks, the same value downloads report
+    common::Result<uint64_t> file_digest(const std::string& path) {
+        common::checksum::ChunkDigest digest(FILE_TRANSFER_CHUNK_SIZE);
+        uint64_t pos = 0;
+        auto result = download_file(path, [&](const uint8_t* data, size_t size, bool) {
+            digest.update(pos, data, size);
+            pos += size;
+        });
+        if (result.is_err()) return result.error();
+        return digest.finish(pos);
+    }
 };
 
 } // namespace interfaces
@@ -1,5 +1,10 @@
 #pragma once
 #include "common/Result.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <chrono>
 
 namespace interfaces {
 
@@ -30,6 +35,25 @@ namespace interfaces {
         Backslash, Minus, Equal, Tilde
     };
 
+    // One input action as queued by core::InputPipeline
+    struct InputOp {
+        enum class Type : uint8_t {
+            Move,   // x, y: absolute position (0.0 to 1.0)
+            Button, // code: MouseButton, down
+            Click,  // code: MouseButton (down + up)
+            Scroll, // code: wheel delta
+            Key,    // code: KeyCode, down
+            Text    // text
+        };
+
+        Type type = Type::Move;
+        float x = 0.0f;
+        float y = 0.0f;
+        int code = 0;
+        bool down = false;
+        std::string text;
+    };
+
     class IInputInjector {
     public:
         virtual ~IInputInjector() = default;
@@ -48,6 +72,41 @@ namespace interfaces {
 
         // Send Text (Unicode)
         virtual common::EmptyResult send_text(const std::string& text) = 0;
+
+        // Inject a sequence of ops in order. Implementations override this to
+        // submit the whole batch at once (one write() / one XFlush); the
+        // default makes one call per op. Returns the first error, if any,
+        // after attempting every op.
+        virtual common::EmptyResult inject_batch(const InputOp* ops, size_t count) {
+            common::EmptyResult result = common::EmptyResult::success();
+            for (size_t i = 0; i < count; ++i) {
+                common::EmptyResult r = inject_one(ops[i]);
+                if (r.is_err() && result.is_ok()) result = std::move(r);
+            }
+            return result;
+        }
+
+    protected:
+        common::EmptyResult inject_one(const InputOp& op) {
+            auto button = static_cast<MouseButton>(op.code);
+            switch (op.type) {
+                case InputOp::Type::Move:   return move_mouse(op.x, op.y);
+                case InputOp::Type::Button: return click_mouse(button, op.down);
+                case InputOp::Type::Click: {
+                    auto r = click_mouse(button, true);
+                    if (r.is_err()) return r;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(CLICK_HOLD_MS));
+                    return click_mouse(button, false);
+                }
+                case InputOp::Type::Scroll: return scroll_mouse(op.code);
+                case InputOp::Type::Key:    return press_key(static_cast<KeyCode>(op.code), op.down);
+                case InputOp::Type::Text:   return send_text(op.text);
+            }
+            return common::EmptyResult::success();
+        }
+
+        // How long a Click holds the button down
+        static constexpr int CLICK_HOLD_MS = 20;
     };
 
 }
@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <cstddef>
 #include "core/Protocol.hpp"
 
 namespace core {
@@ -14,6 +16,15 @@ namespace network {
         Fatal
     };
 
+    // One contiguous region of a scatter-gather write (maps to iovec / WSABUF)
+    struct IoSlice {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // Slices submitted per send_vectored() call (well below IOV_MAX)
+    constexpr size_t MAX_IO_SLICES = 64;
+
     class INetworkSocket {
     public:
         virtual ~INetworkSocket() = default;
@@ -22,11 +33,21 @@ namespace network {
         virtual bool set_non_blocking(bool enable) = 0;
         virtual bool set_no_delay(bool enable) = 0;
         virtual void set_send_buffer_size(int size) = 0;
+        // TCP keepalive probes: first after idle_s, then every interval_s, drop after count misses
+        virtual bool set_keep_alive(int idle_s, int interval_s, int count) = 0;
 
         // IO Operations
         // Returns number of bytes sent or error
         virtual std::pair<size_t, SocketError> send(const uint8_t* data, size_t size) = 0;
 
+        // Gather-write up to MAX_IO_SLICES slices in one syscall (writev/sendmsg).
+        // Returns total bytes sent, which may end in the middle of any slice.
+        virtual std::pair<size_t, SocketError> send_vectored(const IoSlice* slices, size_t count) = 0;
+
+        // Send `count` bytes of an open file starting at `offset` without a
+        // userspace copy where the OS allows it (sendfile). May send less.
+        virtual std::pair<size_t, SocketError> send_file(int file_fd, uint64_t offset, size_t count) = 0;
+
         // Returns number of bytes received
         virtual std::pair<size_t, SocketError> recv(uint8_t* buffer, size_t max_size) = 0;
 
@@ -18,7 +18,8 @@ namespace testing {
 
             // Generate dummy Config
             {
-                auto cfg_data = std::make_shared<std::vector<uint8_t>>(10, 0xCC); // Fake SPS/PPS
+                auto cfg_data = common::FrameBufferPool::global().acquire(10); // Fake SPS/PPS
+                memset(cfg_data->data(), 0xCC, cfg_data->size());
                 common::VideoPacket pkt{cfg_data, pts++, gen, common::PacketKind::CodecConfig};
                 on_packet(pkt);
             }
@@ -27,7 +28,8 @@ namespace testing {
             while (!token.is_cancellation_requested()) {
                 // Fake IDR every 30 frames
                 bool is_key = (pts % 30 == 0);
-                auto data = std::make_shared<std::vector<uint8_t>>(1024, is_key ? 0xFF : 0x00);
+                auto data = common::FrameBufferPool::global().acquire(1024);
+                memset(data->data(), is_key ? 0xFF : 0x00, data->size());
 
                 common::VideoPacket pkt{
                     data,
@@ -0,0 +1,119 @@
+#include "core/ArchiveStream.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace core {
+
+    ArchiveStream::ArchiveStream(interfaces::IFileTransfer& transfer, std::vector<Member> members, size_t chunk_size)
+        : transfer_(transfer), members_(std::move(members)), chunk_size_((std::max)(size_t(1), chunk_size)) {
+        for (const auto& m : members_) size_ += common::tar::entry_size(m.entry);
+        size_ += common::tar::END_SIZE;
+        reader_ = std::thread([this]() { produce(); });
+    }
+
+    ArchiveStream::~ArchiveStream() {
+        close();
+        if (reader_.joinable()) reader_.join();
+    }
+
+    bool ArchiveStream::next(std::vector<uint8_t>& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return closed_ || !ready_.empty() || done_; });
+        if (closed_ || ready_.empty()) return false;
+        out = std::move(ready_.front());
+        ready_.pop_front();
+        cv_.notify_all();  // A slot for the reader
+        return true;
+    }
+
+    void ArchiveStream::close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        ready_.clear();
+        cv_.notify_all();
+    }
+
+    bool ArchiveStream::flush() {
+        if (current_.empty()) return true;
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return closed_ || ready_.size() < READ_AHEAD_CHUNKS; });
+        if (closed_) {
+            stopped_ = true;
+            return false;
+        }
+        ready_.push_back(std::move(current_));
+        current_.clear();
+        current_.reserve(chunk_size_);
+        cv_.notify_all();
+        return true;
+    }
+
+    void ArchiveStream::append(const uint8_t* data, size_t size) {
+        while (size > 0 && !stopped_) {
+            size_t take = (std::min)(size, chunk_size_ - current_.size());
+            current_.insert(current_.end(), data, data + take);
+            data += take;
+            size -= take;
+            if (current_.size() == chunk_size_ && !flush()) return;
+        }
+    }
+
+    void ArchiveStream::append_zeros(uint64_t count) {
+        static const uint8_t zeros[common::tar::BLOCK_SIZE] = {};
+        while (count > 0 && !stopped_) {
+            size_t take = static_cast<size_t>((std::min)(count, uint64_t(sizeof(zeros))));
+            append(zeros, take);
+            count -= take;
+        }
+    }
+
+    void ArchiveStream::archive_file(const Member& m) {
+        const uint64_t size = m.entry.size;
+        uint64_t pos = 0;
+
+        // In spans, so a close() is noticed between reads (download_file runs to the end of its range)
+        while (pos < size && !stopped_) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_) return;
+            }
+            uint64_t span = (std::min)(READ_SPAN, size - pos);
+            uint64_t got = 0;
+            auto result = transfer_.download_file(m.path, [&](const uint8_t* data, size_t n, bool) {
+                n = static_cast<size_t>((std::min)(uint64_t(n), span - got));
+                append(data, n);
+                got += n;
+            }, nullptr, interfaces::ByteRange{pos, span});
+            pos += got;
+
+            if (stopped_) return;
+            if (result.is_err() || got < span) {
+                std::cerr << "[ArchiveStream] " << m.path << " changed or failed at " << pos << " of "
+                          << size << " bytes" << (result.is_err() ? ": " + result.error().message : "") << std::endl;
+                changed_++;
+                break;
+            }
+        }
+        append_zeros(size - pos);
+    }
+
+    void ArchiveStream::produce() {
+        current_.reserve(chunk_size_);
+        for (const auto& m : members_) {
+            auto header = common::tar::header(m.entry);
+            append(header.data(), header.size());
+            if (!m.entry.is_directory) {
+                archive_file(m);
+                append_zeros(common::tar::padding(m.entry.size));
+            }
+            if (stopped_) return;
+        }
+        append_zeros(common::tar::END_SIZE);
+        flush();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+        cv_.notify_all();
+    }
+
+} // namespace core
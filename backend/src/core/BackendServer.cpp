@@ -6,13 +6,22 @@
 #include "interfaces/IAppManager.hpp"
 #include "interfaces/IInputInjector.hpp"
 #include "core/network/TcpSocket.hpp"
+#include "core/network/Reactor.hpp"
+#include "core/InputPipeline.hpp"
+#include "core/InputProtocol.hpp"
 #include "core/network/PacketDispatcher.hpp"
+#include "core/network/TrafficShaper.hpp"
 #include "handlers/FileCommandHandler.hpp"
+#include "common/Checksum.hpp"
 #include <cstring>
 #include <iostream>
 #include <algorithm>
 #include <deque>
+#include <map>
+#include <set>
+#include <array>
 #include <sstream>
+#include <iomanip>
 #include <thread>
 #include <chrono>
 #include <ctime>
@@ -32,7 +41,18 @@
 constexpr uint8_t TRAFFIC_CONTROL = 0x01;  // Commands, Status, Info - Never drop
 constexpr uint8_t TRAFFIC_VIDEO   = 0x02;  // Video frames - Drop if busy
 constexpr uint8_t TRAFFIC_FILE    = 0x04;  // File chunks - Never drop
+// Frontend -> Backend TRAFFIC_FILE: binary upload chunk [upload_id(4)][offset(8)][bytes],
+// with [crc32c(4)] before the bytes for uploads started with checksums
+constexpr size_t UPLOAD_FRAME_HEAD = 12;
+constexpr size_t UPLOAD_CRC_SIZE = 4;
 // Note: TRAFFIC_ACK (0x03) is Frontend -> Gateway only
+// Note: TRAFFIC_INPUT (0x05) is Frontend -> Backend binary input (core/InputProtocol.hpp)
+
+// Video wire prefix stamped into FrameBuffer headroom: [12B Header][Traffic][ChannelID]
+constexpr size_t VIDEO_PREFIX_SIZE = 14;
+// Max frames of one GOP waiting per video mailbox (inter-frame codecs only)
+constexpr size_t VIDEO_GOP_BUDGET = 8;
+static_assert(VIDEO_PREFIX_SIZE <= common::FrameBuffer::HEADROOM, "video prefix must fit in frame headroom");
 
 namespace core {
 
@@ -57,6 +77,9 @@ namespace core {
         command_pool_ = std::make_unique<ThreadPool>(4);
         std::cout << "[BackendServer] ThreadPool initialized with 4 workers" << std::endl;
 
+        // Bandwidth limits shared by all sessions (unlimited until set_bandwidth)
+        shaper_ = std::make_shared<network::TrafficShaper>();
+
         if (file_transfer_) {
             dispatcher_->register_handler(std::make_shared<handlers::FileCommandHandler>(*file_transfer_));
         }
@@ -135,82 +158,294 @@ namespace core {
         // Start Discovery Broadcaster in background thread
         discovery_thread_ = std::thread(&BackendServer::broadcast_discovery, this);
 
-        // Accept loop - wait for BOTH connections before proceeding
-        while (running_) {
-            struct sockaddr_in client_addr;
-            socklen_t addr_len = sizeof(client_addr);
+        auto reactor = std::make_shared<network::Reactor>();
+        if (!reactor->is_valid()) {
+            std::cerr << "[BackendServer] Failed to create accept reactor" << std::endl;
+            CLOSE_SOCKET(listen_fd_);
+            CLOSE_SOCKET(listen_fd_data_);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            accept_reactor_ = reactor;
+        }
 
-            // 1. Accept Control connection
-            std::cout << "[BackendServer] Waiting for Gateway Control connection..." << std::endl;
-            socket_t control_fd = accept(listen_fd_, (struct sockaddr*)&client_addr, &addr_len);
+        // Accepted sockets waiting for their partner channel
+        struct PendingChannel {
+            socket_t fd = INVALID_SOCKET;
+            bool is_data = false;
+            std::string ip;
+            std::vector<uint8_t> inbuf;  // Bytes after the handshake go to the session
+            std::string token;           // Set once the HELLO frame arrived
+            bool legacy = false;         // No handshake: pair in accept order
+            std::chrono::steady_clock::time_point accepted = std::chrono::steady_clock::now();
+        };
+        std::map<socket_t, PendingChannel> pending;
 
-            if (!IS_VALID_SOCKET(control_fd)) continue;
+        auto drop_pending = [&](socket_t fd) {
+            reactor->remove(fd);
+            CLOSE_SOCKET(fd);
+            pending.erase(fd);
+        };
 
-            char ip_str[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &client_addr.sin_addr, ip_str, sizeof(ip_str));
-            std::cout << "[BackendServer] Control connected from " << ip_str << std::endl;
+        // Hand a control/data pair to a session thread
+        auto pair_up = [&](socket_t control_fd, socket_t data_fd) {
+            std::vector<uint8_t> initial_input = std::move(pending[control_fd].inbuf);
+            reactor->remove(control_fd);
+            reactor->remove(data_fd);
+            pending.erase(control_fd);
+            pending.erase(data_fd);
+            start_session(control_fd, data_fd, std::move(initial_input));
+        };
 
-            // Set Non-Blocking Mode for Control Socket
-            #ifdef _WIN32
-            u_long mode_ctrl = 1;
-            ioctlsocket(control_fd, FIONBIO, &mode_ctrl);
-            // ENABLE TCP_NODELAY (Disable Nagle)
-            int flag_ctrl = 1;
-            setsockopt(control_fd, IPPROTO_TCP, TCP_NODELAY, (char*)&flag_ctrl, sizeof(flag_ctrl));
-            #else
-            int flags_ctrl = fcntl(control_fd, F_GETFL, 0);
-            fcntl(control_fd, F_SETFL, flags_ctrl | O_NONBLOCK);
-            // ENABLE TCP_NODELAY (Disable Nagle)
-            int flag_ctrl = 1;
-            setsockopt(control_fd, IPPROTO_TCP, TCP_NODELAY, &flag_ctrl, sizeof(flag_ctrl));
-            #endif
+        auto try_pair = [&]() {
+            // Token pairs first
+            for (auto& c : pending) {
+                if (c.second.is_data || c.second.token.empty()) continue;
+                for (auto& d : pending) {
+                    if (d.second.is_data && d.second.token == c.second.token) {
+                        pair_up(c.first, d.first);
+                        return true;
+                    }
+                }
+            }
+            // Then legacy sockets, oldest control with oldest data
+            const PendingChannel* oldest[2] = {nullptr, nullptr};
+            for (const auto& p : pending) {
+                const PendingChannel& ch = p.second;
+                if (!ch.legacy) continue;
+                const PendingChannel*& slot = oldest[ch.is_data ? 1 : 0];
+                if (!slot || ch.accepted < slot->accepted) slot = &ch;
+            }
+            if (oldest[0] && oldest[1]) {
+                pair_up(oldest[0]->fd, oldest[1]->fd);
+                return true;
+            }
+            return false;
+        };
 
-            // 2. Accept Data connection (with 5 second timeout)
-            std::cout << "[BackendServer] Waiting for Gateway Data connection..." << std::endl;
+        // Look for the HELLO frame at the start of a pending socket's input
+        auto parse_handshake = [](PendingChannel& ch) {
+            static const char HELLO[] = "HELLO ";
+            const size_t hello_len = sizeof(HELLO) - 1;
+            const size_t header_size = 12;
+            if (!ch.token.empty() || ch.legacy || ch.inbuf.size() < header_size) return;
 
-            // Set timeout on data listen socket
-            #ifdef _WIN32
-            DWORD timeout = 5000;
-            setsockopt(listen_fd_data_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-            #else
-            struct timeval tv;
-            tv.tv_sec = 5;
-            tv.tv_usec = 0;
-            setsockopt(listen_fd_data_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-            #endif
+            uint32_t net_len; memcpy(&net_len, ch.inbuf.data(), 4);
+            uint32_t len = ntohl(net_len);
+            size_t avail = ch.inbuf.size() - header_size;
+            size_t check = (std::min<size_t>)({len, hello_len, avail});
+            if (len < hello_len + 1 || len > hello_len + 64 ||
+                memcmp(ch.inbuf.data() + header_size, HELLO, check) != 0) {
+                ch.legacy = true; // First frame is a command: older gateway
+                return;
+            }
+            if (avail < len) return; // Wait for the rest of the handshake
+
+            ch.token.assign(ch.inbuf.begin() + header_size + hello_len, ch.inbuf.begin() + header_size + len);
+            ch.token.erase(std::remove_if(ch.token.begin(), ch.token.end(), [](unsigned char c) {
+                return c <= 32 || c == 127;
+            }), ch.token.end());
+            ch.inbuf.erase(ch.inbuf.begin(), ch.inbuf.begin() + header_size + len);
+            if (ch.token.empty()) ch.legacy = true;
+        };
 
-            socket_t data_fd = accept(listen_fd_data_, (struct sockaddr*)&client_addr, &addr_len);
+        auto on_pending = [&](socket_t fd) {
+            auto it = pending.find(fd);
+            if (it == pending.end()) return;
+            PendingChannel& ch = it->second;
+
+            uint8_t chunk[4096];
+            bool overfull = false;
+            while (true) {
+                int n = recv(fd, (char*)chunk, sizeof(chunk), 0);
+                if (n > 0) {
+                    ch.inbuf.insert(ch.inbuf.end(), chunk, chunk + n);
+                    if (ch.inbuf.size() > 1024 * 1024) { overfull = true; break; }
+                    continue;
+                }
+                #ifdef _WIN32
+                bool would_block = n < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+                #else
+                bool would_block = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+                #endif
+                if (would_block) break;
+                std::cout << "[BackendServer] " << (ch.is_data ? "Data" : "Control")
+                          << " socket from " << ch.ip << " closed before pairing" << std::endl;
+                drop_pending(fd);
+                return;
+            }
+
+            parse_handshake(ch);
+            while (try_pair()) {}
 
-            if (!IS_VALID_SOCKET(data_fd)) {
-                std::cerr << "[BackendServer] Data connection timeout/failed. Closing control." << std::endl;
-                CLOSE_SOCKET(control_fd);
-                continue;
+            // A paired session reads the rest of the socket; an unpaired one
+            // would not be woken again (edge-triggered) with input left unread
+            if (overfull && pending.count(fd)) {
+                std::cout << "[BackendServer] " << (ch.is_data ? "Data" : "Control")
+                          << " socket from " << ch.ip << " sent too much before pairing" << std::endl;
+                drop_pending(fd);
             }
+        };
 
-            std::cout << "[BackendServer] Data connected. Dual channel established!" << std::endl;
+        // Accept everything queued on a listen socket
+        auto on_listen = [&](socket_t listen_fd, bool is_data) {
+            while (true) {
+                struct sockaddr_in client_addr;
+                socklen_t addr_len = sizeof(client_addr);
+                socket_t fd = accept(listen_fd, (struct sockaddr*)&client_addr, &addr_len);
+                if (!IS_VALID_SOCKET(fd)) break;
+
+                char ip_str[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &client_addr.sin_addr, ip_str, sizeof(ip_str));
+                std::cout << "[BackendServer] " << (is_data ? "Data" : "Control")
+                          << " connected from " << ip_str << std::endl;
+
+                // Set Non-Blocking Mode, ENABLE TCP_NODELAY (Disable Nagle)
+                #ifdef _WIN32
+                u_long mode = 1;
+                ioctlsocket(fd, FIONBIO, &mode);
+                int flag = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(flag));
+                #else
+                int flags = fcntl(fd, F_GETFL, 0);
+                fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+                int flag = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+                #endif
 
-            // Set Non-Blocking Mode for Data Socket
-            #ifdef _WIN32
-            u_long mode_data = 1;
-            ioctlsocket(data_fd, FIONBIO, &mode_data);
-            // ENABLE TCP_NODELAY (Disable Nagle)
-            int flag_data = 1;
-            setsockopt(data_fd, IPPROTO_TCP, TCP_NODELAY, (char*)&flag_data, sizeof(flag_data));
-            #else
-            int flags_data = fcntl(data_fd, F_GETFL, 0);
-            fcntl(data_fd, F_SETFL, flags_data | O_NONBLOCK);
-            // ENABLE TCP_NODELAY (Disable Nagle)
-            int flag_data = 1;
-            setsockopt(data_fd, IPPROTO_TCP, TCP_NODELAY, &flag_data, sizeof(flag_data));
-            #endif
+                PendingChannel ch;
+                ch.fd = fd;
+                ch.is_data = is_data;
+                ch.ip = ip_str;
+                pending[fd] = std::move(ch);
+                reactor->add(fd, network::IO_READ, [&, fd](uint32_t) { on_pending(fd); });
+                on_pending(fd); // Handshake may already be here
+            }
+        };
 
-            handle_connection(control_fd, data_fd);
+        #ifdef _WIN32
+        u_long listen_mode = 1;
+        ioctlsocket(listen_fd_, FIONBIO, &listen_mode);
+        ioctlsocket(listen_fd_data_, FIONBIO, &listen_mode);
+        #else
+        fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(listen_fd_data_, F_SETFL, fcntl(listen_fd_data_, F_GETFL, 0) | O_NONBLOCK);
+        #endif
+        reactor->add(listen_fd_, network::IO_READ, [&](uint32_t) { on_listen(listen_fd_, false); });
+        reactor->add(listen_fd_data_, network::IO_READ, [&](uint32_t) { on_listen(listen_fd_data_, true); });
+
+        // Handshake grace / pairing timeout, and joining finished sessions
+        reactor->add_timer(std::chrono::milliseconds(250), [&]() {
+            auto now = std::chrono::steady_clock::now();
+            std::vector<socket_t> expired;
+            for (auto& p : pending) {
+                PendingChannel& ch = p.second;
+                auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - ch.accepted).count();
+                if (age > PAIRING_TIMEOUT_MS) expired.push_back(p.first);
+                else if (ch.token.empty() && !ch.legacy && age > HANDSHAKE_GRACE_MS) ch.legacy = true;
+            }
+            for (socket_t fd : expired) {
+                std::cerr << "[BackendServer] " << (pending[fd].is_data ? "Data" : "Control")
+                          << " socket from " << pending[fd].ip << " never paired. Closing." << std::endl;
+                drop_pending(fd);
+            }
+            while (try_pair()) {}
+            reap_sessions(false);
+        });
 
-            std::cout << "[BackendServer] Gateway disconnected. Waiting for reconnection..." << std::endl;
+        std::cout << "[BackendServer] Waiting for Gateway connections (up to "
+                  << MAX_GATEWAY_SESSIONS << " sessions)..." << std::endl;
+        if (running_) reactor->run();
+
+        // Shutdown: unpaired sockets, then every session
+        for (auto& p : pending) CLOSE_SOCKET(p.first);
+        pending.clear();
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            accept_reactor_.reset();
+            for (auto& s : sessions_) s.reactor->stop();
         }
+        reap_sessions(true);
 
         CLOSE_SOCKET(listen_fd_);
         CLOSE_SOCKET(listen_fd_data_);
+        listen_fd_ = INVALID_SOCKET;
+        listen_fd_data_ = INVALID_SOCKET;
+    }
+
+    void BackendServer::start_session(socket_t fd_control, socket_t fd_data, std::vector<uint8_t> initial_input) {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (sessions_.size() >= MAX_GATEWAY_SESSIONS) {
+            std::cerr << "[BackendServer] Session limit (" << MAX_GATEWAY_SESSIONS << ") reached. Rejecting gateway." << std::endl;
+            CLOSE_SOCKET(fd_control);
+            CLOSE_SOCKET(fd_data);
+            return;
+        }
+
+        auto reactor = std::make_shared<network::Reactor>();
+        if (!reactor->is_valid()) {
+            std::cerr << "[BackendServer] Failed to create session reactor" << std::endl;
+            CLOSE_SOCKET(fd_control);
+            CLOSE_SOCKET(fd_data);
+            return;
+        }
+
+        sessions_.emplace_back();
+        GatewaySession& s = sessions_.back();
+        s.id = next_session_id_++;
+        s.reactor = reactor;
+        s.done = std::make_shared<std::atomic<bool>>(false);
+
+        std::cout << "[BackendServer] Dual channel established. Session " << s.id
+                  << " started (" << sessions_.size() << " active)" << std::endl;
+
+        uint32_t id = s.id;
+        auto done = s.done;
+        s.thread = std::thread([this, fd_control, fd_data, id, reactor, done, input = std::move(initial_input)]() mutable {
+            handle_connection(fd_control, fd_data, id, reactor, std::move(input));
+            std::cout << "[BackendServer] Gateway session " << id << " disconnected." << std::endl;
+            done->store(true);
+        });
+    }
+
+    void BackendServer::reap_sessions(bool all) {
+        std::list<GatewaySession> finished;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            for (auto it = sessions_.begin(); it != sessions_.end();) {
+                auto next = std::next(it);
+                if (all || it->done->load()) finished.splice(finished.end(), sessions_, it);
+                it = next;
+            }
+        }
+        // Join outside the lock: a stopping session may still call into the server
+        for (auto& s : finished) {
+            if (s.thread.joinable()) s.thread.join();
+        }
+    }
+
+    common::Result<common::Ok> BackendServer::attach_viewer(BroadcastBus& bus, StreamSession& session,
+                                                            SubscriberId id, PacketCallback send_fn) {
+        std::lock_guard<std::mutex> lock(capture_mutex_);
+        bus.subscribe(id, std::move(send_fn));
+        return session.start(); // Busy: already capturing for another viewer
+    }
+
+    void BackendServer::detach_viewer(BroadcastBus& bus, StreamSession& session, SubscriberId id) {
+        std::lock_guard<std::mutex> lock(capture_mutex_);
+        bus.unsubscribe(id);
+        if (bus.subscriber_count() == 0) session.stop();
+    }
+
+    void BackendServer::detach_session(uint32_t session_id) {
+        std::lock_guard<std::mutex> lock(capture_mutex_);
+        if (bus_monitor_->unsubscribe_group(session_id) > 0 && bus_monitor_->subscriber_count() == 0) {
+            session_->stop();
+        }
+        if (bus_webcam_->unsubscribe_group(session_id) > 0 && bus_webcam_->subscriber_count() == 0) {
+            webcam_session_->stop();
+        }
     }
 
     void BackendServer::broadcast_discovery() {
@@ -306,9 +541,10 @@ namespace core {
     void BackendServer::stop() {
         running_ = false;
 
-        // Close listen socket to break accept()
-        if (IS_VALID_SOCKET(listen_fd_)) {
-            CLOSE_SOCKET(listen_fd_);
+        // Break the accept loop; run() then stops and joins every session
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            if (accept_reactor_) accept_reactor_->stop();
         }
 
         // Wait for discovery thread
@@ -317,7 +553,9 @@ namespace core {
         }
     }
 
-    void BackendServer::handle_connection(socket_t fd_control, socket_t fd_data) {
+    void BackendServer::handle_connection(socket_t fd_control, socket_t fd_data, uint32_t session_id,
+                                          std::shared_ptr<network::Reactor> reactor,
+                                          std::vector<uint8_t> initial_input) {
         // === CONTROL CHANNEL SOCKET ===
         auto socket_control = std::make_shared<network::TcpSocket>(fd_control);
         socket_control->set_non_blocking(true);
@@ -334,25 +572,18 @@ namespace core {
         // A mutex to protect writes to the client socket
         auto client_mutex = std::make_shared<std::mutex>();
 
-        // Helper for cross-platform poll/select
-        auto wait_for_write = [](socket_t fd, int timeout_ms) -> bool {
-            #ifdef _WIN32
-                WSAPOLLFD pfd;
-                pfd.fd = fd;
-                pfd.events = POLLOUT;
-                pfd.revents = 0;
-                int ret = WSAPoll(&pfd, 1, timeout_ms);
-            #else
-                struct pollfd pfd;
-                pfd.fd = fd;
-                pfd.events = POLLOUT;
-                pfd.revents = 0;
-                int ret = poll(&pfd, 1, timeout_ms);
-            #endif
+        // Both channels are driven by one reactor on this session thread:
+        // reads, writes and timers wake it, nothing polls on a timeout.
+        // The server keeps a reference so stop() can end the session.
+        if (!reactor->is_valid()) {
+            std::cerr << "[Session " << session_id << "] Invalid reactor, dropping connection" << std::endl;
+            return;
+        }
 
-            if (ret > 0 && (pfd.revents & POLLOUT)) return true;
-            return false;
-        };
+        // TCP keepalive: the gateway protocol has no ping, so a silently dead
+        // peer is detected by the kernel (60s idle, 3 probes 10s apart).
+        socket_control->set_keep_alive(60, 10, 3);
+        socket_data->set_keep_alive(60, 10, 3);
 
         static const int HEADER_SIZE = 12; // 4 bytes for len, 4 for cid, 4 for bid
 
@@ -361,296 +592,722 @@ namespace core {
         // before writing to the Kernel TCP Buffer.
 
         struct QueuedPacket {
-             std::vector<uint8_t> data; // Full packet with headers pre-built
-             bool is_critical;
+             // Wire prefix: [12B Header][Traffic] (+ [ChannelID] for video frames)
+             uint8_t header[VIDEO_PREFIX_SIZE] = {};
+             size_t header_len = 0;
+             std::vector<uint8_t> body; // Payload moved in from the caller (text, file chunks)
+             // Zero-copy video: pooled frame sent by reference. The writer stamps
+             // header into the frame headroom right before sending, so
+             // header + payload go out as one slice.
+             std::shared_ptr<const common::FrameBuffer> frame;
+             // Zero-copy file body: follows header + body, sent with sendfile()
+             interfaces::FileRegion file;
+             bool is_critical = false;
+             uint8_t traffic = 0;
+             common::PacketKind kind = common::PacketKind::KeyFrame; // Video only
+             std::chrono::steady_clock::time_point enqueued;         // Video only (latency stats)
+
+             // Control and file packets are never dropped on a full socket
+             bool must_deliver() const { return is_critical || traffic == TRAFFIC_FILE; }
         };
 
+        // Writer counters: syscalls per MB tells whether batching keeps up with
+        // 30 fps x N viewers (logged every 10s and on disconnect)
+        struct WriterStats {
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<uint64_t> syscalls{0};
+            std::atomic<uint64_t> packets{0};
+            std::atomic<uint64_t> would_block{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<uint64_t> superseded{0};   // Replaced in the mailbox by a newer frame before send
+            std::atomic<uint64_t> gop_dropped{0};  // InterFrames dropped until the next KeyFrame
+            std::atomic<uint64_t> video_sent{0};
+            std::atomic<uint64_t> video_latency_us{0}; // Sum of mailbox enqueue -> fully written
+            std::atomic<uint64_t> file_bytes{0};       // Of bytes: file bodies copied by the kernel
+            std::atomic<uint64_t> file_padded{0};      // Zeros sent for files that shrank mid-download
+            std::atomic<uint64_t> file_cancelled{0};   // Packets of cancelled transfers discarded unsent
+            uint32_t session_id = 0;
+
+            void log(const char* tag) const {
+                // Formatted off to the side: sessions log concurrently and
+                // std::fixed on std::cout would leak between them
+                double mb = bytes.load() / (1024.0 * 1024.0);
+                uint64_t frames = video_sent.load();
+                std::ostringstream line;
+                line << "[WRITER " << session_id << "] " << tag << ": " << std::fixed << std::setprecision(1) << mb << " MB, "
+                     << packets.load() << " packets, " << syscalls.load() << " syscalls ("
+                     << std::setprecision(2) << (mb > 0 ? syscalls.load() / mb : 0.0) << "/MB), "
+                     << would_block.load() << " EAGAIN, " << dropped.load() << " video dropped, "
+                     << superseded.load() << " superseded, " << gop_dropped.load() << " GOP dropped, "
+                     << std::setprecision(1) << file_bytes.load() / (1024.0 * 1024.0) << " MB sendfile, "
+                     << file_cancelled.load() << " cancelled, "
+                     << "avg video queue " << std::setprecision(1)
+                     << (frames > 0 ? video_latency_us.load() / 1000.0 / frames : 0.0) << " ms";
+                std::cout << line.str() << std::endl;
+            }
+        };
+        auto writer_stats = std::make_shared<WriterStats>();
+        writer_stats->session_id = session_id;
+
         // Using shared_ptr to share queues with the flush logic
-        auto high_prio_q = std::make_shared<std::deque<QueuedPacket>>();
-        auto low_prio_q = std::make_shared<std::deque<QueuedPacket>>();
+        auto control_q = std::make_shared<std::deque<QueuedPacket>>(); // Control channel, never dropped
+        auto file_q = std::make_shared<std::deque<QueuedPacket>>();    // Data channel, never dropped
+        auto low_prio_q = std::make_shared<std::deque<QueuedPacket>>(); // Data channel, droppable
         auto queue_mutex = std::make_shared<std::mutex>();
+        // Set when the session ends: jobs still running (and holding the senders)
+        // have their packets dropped, which releases any flow-window lease
+        auto queues_closed = std::make_shared<bool>(false);
+
+        // Latest-frame-wins video mailboxes, one per (client, channel), guarded by queue_mutex.
+        // MJPEG (every frame a KeyFrame): a single slot; a newer frame replaces the
+        // pending one, so a congested link costs frames instead of latency.
+        // Inter-frame codecs: the current GOP queues up to VIDEO_GOP_BUDGET frames;
+        // past that the rest of the GOP is dropped, and the next KeyFrame
+        // supersedes everything still pending.
+        struct VideoMailbox {
+            std::deque<QueuedPacket> pending;
+            bool skip_to_keyframe = false;
+        };
+        struct VideoMailboxes {
+            std::map<uint64_t, VideoMailbox> boxes; // Key: (cid << 8) | channel
+            size_t pending = 0;
+        };
+        auto video_mailboxes = std::make_shared<VideoMailboxes>();
+
+        // Producers (any thread) only queue; the reactor thread does all socket
+        // writes. One pump task is in flight at a time.
+        auto flush_scheduled = std::make_shared<std::atomic<bool>>(false);
+        auto pump_task = std::make_shared<std::function<void()>>();
+        auto request_flush = [reactor, flush_scheduled, pump_task]() {
+            if (flush_scheduled->exchange(true)) return;
+            reactor->post([pump_task]() { if (*pump_task) (*pump_task)(); });
+        };
 
-        // Writer Thread Control
-        auto stop_writer = std::make_shared<std::atomic<bool>>(false);
-        auto cv_writer = std::make_shared<std::condition_variable>();
-
-        // --- DEDICATED WRITER THREAD (DUAL CHANNEL) ---
-        // Routes Critical packets to fd_control, Data packets to fd_data
-        std::thread writer_thread([fd_control, fd_data, high_prio_q, low_prio_q, queue_mutex, wait_for_write, stop_writer, cv_writer]() {
-            while (!*stop_writer) {
-                std::vector<QueuedPacket> batch;
-
-                // 1. POP BATCH UNDER LOCK (Fast)
-                {
-                    std::unique_lock<std::mutex> lock(*queue_mutex);
+        // Per-channel output buffer, owned by the reactor thread.
+        // Write interest (IO_WRITE) is registered only while `blocked`.
+        struct Outbox {
+            Outbox(network::INetworkSocket* s, socket_t f) : sock(s), fd(f) {}
+            network::INetworkSocket* sock;
+            socket_t fd;
+            std::deque<QueuedPacket> packets;
+            size_t front_sent = 0; // Bytes of packets.front() already written
+            bool blocked = false;
+            std::chrono::steady_clock::time_point last_progress = std::chrono::steady_clock::now();
+        };
+        Outbox out_control{socket_control.get(), fd_control};
+        Outbox out_data{socket_data.get(), fd_data};
 
-                    // Wait for data or stop signal
-                    cv_writer->wait(lock, [&]() {
-                        return !high_prio_q->empty() || !low_prio_q->empty() || *stop_writer;
-                    });
+        auto wire_size = [](const QueuedPacket& pkt) -> size_t {
+            return pkt.header_len + (pkt.frame ? pkt.frame->size() : pkt.body.size() + pkt.file.length);
+        };
 
-                    if (*stop_writer && high_prio_q->empty() && low_prio_q->empty()) break;
+        // Bytes of a file packet that precede its file region
+        auto file_head_size = [](const QueuedPacket& pkt) -> size_t {
+            return pkt.header_len + pkt.body.size();
+        };
 
-                    // FAIR INTERLEAVING:
-                    // Take a batch of High priority (Control/Files)
-                    int high_to_take = 20;
-                    while (!high_prio_q->empty() && high_to_take-- > 0) {
-                        batch.push_back(std::move(high_prio_q->front()));
-                        high_prio_q->pop_front();
+        // Gather-write an outbox: queued packets become IoSlices (one per
+        // video frame, header + body otherwise) and go out in as few
+        // sendmsg/WSASend calls as the socket accepts. Partial writes resume
+        // at the exact byte; on EAGAIN the reactor waits for IO_WRITE instead
+        // of a blocking retry loop.
+        // A file packet ends the gather list after its head; once the head is
+        // out, its region goes socket-side with sendfile(), so nothing else
+        // can land between a chunk's header and its bytes.
+        // Packets of a cancelled transfer are discarded when they reach the
+        // front unsent (dropping them releases their flow-window lease).
+        std::vector<network::IoSlice> slices;
+        std::vector<const common::FrameBuffer*> stamped;
+        auto transfer_cancelled = [](const QueuedPacket& pkt) {
+            return pkt.file.lease && pkt.file.lease->cancelled();
+        };
+        auto write_outbox = [&](Outbox& ob) {
+            while (!ob.packets.empty()) {
+                QueuedPacket& head = ob.packets.front();
+                if (ob.front_sent == 0 && transfer_cancelled(head)) {
+                    writer_stats->file_cancelled++;
+                    ob.packets.pop_front();
+                    continue;
+                }
+                if (head.file.source && ob.front_sent >= file_head_size(head)) {
+                    size_t done = ob.front_sent - file_head_size(head);
+                    size_t left = head.file.length - done;
+                    std::pair<size_t, network::SocketError> res{0, network::SocketError::Ok};
+                    if (left > 0) {
+                        res = ob.sock->send_file(head.file.source->native_handle(), head.file.offset + done, left);
+                        writer_stats->syscalls++;
+                        if (res.second == network::SocketError::Ok && res.first == 0) {
+                            // File shrank after it was queued: the frame length is
+                            // already on the wire, so pad with zeros to keep framing
+                            static const uint8_t zeros[4096] = {};
+                            if (writer_stats->file_padded == 0) {
+                                std::cerr << "[Session " << session_id << "] File shrank during download, zero-padding "
+                                          << left << " bytes" << std::endl;
+                            }
+                            res = ob.sock->send(zeros, (std::min)(left, sizeof(zeros)));
+                            writer_stats->file_padded += res.first;
+                        }
+                    }
+                    if (res.second == network::SocketError::Ok) {
+                        ob.front_sent += res.first;
+                        writer_stats->bytes += res.first;
+                        writer_stats->file_bytes += res.first;
+                        ob.last_progress = std::chrono::steady_clock::now();
+                        if (res.first == left) {
+                            writer_stats->packets++;
+                            ob.packets.pop_front();
+                            ob.front_sent = 0;
+                        }
+                        continue;
+                    }
+                    if (res.second != network::SocketError::WouldBlock) {
+                        reactor->stop();
+                        return;
                     }
+                    writer_stats->would_block++;
+                    if (!ob.blocked) {
+                        ob.blocked = true;
+                        reactor->modify(ob.fd, network::IO_READ | network::IO_WRITE);
+                    }
+                    return;
+                }
 
-                    // Also take a batch of Low priority (Video) to maintain stream
-                    // if High wasn't too overwhelming
-                    int low_to_take = 5;
-                    while (!low_prio_q->empty() && low_to_take-- > 0) {
-                        batch.push_back(std::move(low_prio_q->front()));
-                        low_prio_q->pop_front();
+                slices.clear();
+                stamped.clear();
+                for (const auto& pkt : ob.packets) {
+                    if (slices.size() + 2 > network::MAX_IO_SLICES) break;
+                    if (pkt.frame) {
+                        // The same frame queued for two viewers can only use the
+                        // headroom once; later copies send the header separately.
+                        // Other sessions may be sending the same frame: only the
+                        // session that claimed the headroom stamps it.
+                        const common::FrameBuffer* fb = pkt.frame.get();
+                        if (fb->claim_headroom(reactor.get()) &&
+                            std::find(stamped.begin(), stamped.end(), fb) == stamped.end()) {
+                            stamped.push_back(fb);
+                            slices.push_back({fb->stamp_prefix(pkt.header, pkt.header_len), pkt.header_len + fb->size()});
+                        } else {
+                            slices.push_back({pkt.header, pkt.header_len});
+                            if (fb->size() > 0) slices.push_back({fb->data(), fb->size()});
+                        }
+                    } else {
+                        if (!slices.empty() && transfer_cancelled(pkt)) break; // Discarded at the front
+                        slices.push_back({pkt.header, pkt.header_len});
+                        if (!pkt.body.empty()) slices.push_back({pkt.body.data(), pkt.body.size()});
+                        if (pkt.file.source) break; // Region follows via sendfile
                     }
-                } // Unlock here!
+                }
 
-                // 2. SEND BATCH WITHOUT LOCK (Blocking I/O allowed here)
-                for (auto& pkt : batch) {
-                    // === DUAL CHANNEL ROUTING ===
-                    // Critical packets (commands/status) → Control channel (fd_control)
-                    // Data packets (video/keylog) → Data channel (fd_data)
-                    socket_t target_fd = pkt.is_critical ? fd_control : fd_data;
-
-                    // DEBUG: Check for specific traffic types
-                    bool is_keylog_pkt = false;
-                    bool is_file_pkt = false;
-                    uint32_t seq = 0;
-                    if (pkt.data.size() > 13) {
-                        uint8_t traffic_type = pkt.data[12];
-                        if (traffic_type == 0x01) { // TRAFFIC_CONTROL
-                             const char* payload = (const char*)pkt.data.data() + 13;
-                             is_keylog_pkt = (strncmp(payload, "KEYLOG:", 7) == 0);
-                        } else if (traffic_type == 0x04) { // TRAFFIC_FILE
-                             is_file_pkt = true;
-                             // Extract sequence from [12B Header][1B Traffic][4B Seq]
-                             if (pkt.data.size() >= 17) {
-                                 uint32_t net_seq;
-                                 memcpy(&net_seq, pkt.data.data() + 13, 4);
-                                 seq = ntohl(net_seq);
-                             }
+                // Resume the front packet where the last partial write stopped
+                size_t skip = ob.front_sent;
+                size_t first = 0;
+                while (skip > 0 && skip >= slices[first].size) skip -= slices[first++].size;
+                slices[first].data += skip;
+                slices[first].size -= skip;
+
+                auto [n, err] = ob.sock->send_vectored(&slices[first], slices.size() - first);
+                writer_stats->syscalls++;
+
+                if (err == network::SocketError::Ok) {
+                    writer_stats->bytes += n;
+                    ob.last_progress = std::chrono::steady_clock::now();
+                    while (n > 0) {
+                        QueuedPacket& front = ob.packets.front();
+                        size_t left = wire_size(front) - ob.front_sent;
+                        if (n < left) {
+                            ob.front_sent += n;
+                            break;
                         }
+                        n -= left;
+                        writer_stats->packets++;
+                        if (front.frame) {
+                            writer_stats->video_sent++;
+                            writer_stats->video_latency_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                                ob.last_progress - front.enqueued).count();
+                        }
+                        ob.packets.pop_front();
+                        ob.front_sent = 0;
                     }
+                    continue;
+                }
 
-                    if (is_keylog_pkt) {
-                        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::system_clock::now().time_since_epoch()).count();
-                        std::string preview((char*)pkt.data.data() + 13, std::min((size_t)30, pkt.data.size() - 13));
-                        std::cout << "[WRITER] Sending KEYLOG: '" << preview << "' at " << now << "ms (critical=" << pkt.is_critical << ")" << std::endl;
-                        std::cout.flush();
+                if (err != network::SocketError::WouldBlock) {
+                    reactor->stop(); // Disconnected: end the session
+                    return;
+                }
+
+                writer_stats->would_block++;
+
+                // Unsent video is stale by the time the socket drains (the
+                // mailbox will hold a newer frame): drop it. A half-written
+                // front packet and control/file packets must complete.
+                for (auto it = ob.packets.begin(); it != ob.packets.end();) {
+                    bool started = (it == ob.packets.begin() && ob.front_sent > 0);
+                    if (it->frame && !it->must_deliver() && !started) {
+                        writer_stats->dropped++;
+                        it = ob.packets.erase(it);
+                    } else {
+                        ++it;
                     }
+                }
 
-                    if (is_file_pkt) {
-                        std::cout << "[WRITER] Sending FILE chunk #" << seq << " size=" << pkt.data.size() << std::endl;
-                        std::cout.flush();
+                if (!ob.blocked) {
+                    ob.blocked = true;
+                    reactor->modify(ob.fd, network::IO_READ | network::IO_WRITE);
+                }
+                return;
+            }
+
+            if (ob.blocked) {
+                ob.blocked = false;
+                reactor->modify(ob.fd, network::IO_READ);
+            }
+        };
+
+        // Writer shaping (reactor thread only). Control goes first on its own
+        // socket. The data channel is refilled only up to DATA_OUTBOX_TARGET,
+        // so the choice of what goes next is made here, by deficit round-robin
+        // between Video and File, rather than by a deep FIFO outbox. Every
+        // packet must pass the shared TrafficShaper (rate limits); a throttled
+        // class is retried from a one-shot timer when its tokens are back.
+        static constexpr size_t DATA_OUTBOX_TARGET = 512 * 1024;
+        using network::TrafficClass;
+        const TrafficClass drr_classes[] = {TrafficClass::Video, TrafficClass::File};
+        struct ShapingState {
+            std::array<size_t, network::TRAFFIC_CLASS_COUNT> deficit{};
+            size_t turn = 0;        // Index into drr_classes
+            bool in_turn = false;   // Quantum of the current turn already granted
+            bool retry_scheduled = false;
+        };
+        ShapingState shaping;
+
+        auto outbox_bytes = [&](const Outbox& ob) {
+            size_t total = 0;
+            for (const auto& pkt : ob.packets) total += wire_size(pkt);
+            return total - ob.front_sent;
+        };
+
+        // Legacy copied file chunks ride the control queue (in order with
+        // their START/END text) but are still shaped as File
+        auto shaping_class = [](const QueuedPacket& pkt) {
+            if (pkt.traffic == TRAFFIC_FILE) return TrafficClass::File;
+            if (pkt.traffic == TRAFFIC_VIDEO) return TrafficClass::Video;
+            return TrafficClass::Control;
+        };
+
+        // Queue holding the next packet of a data-channel class (queue_mutex
+        // held); null if the class has nothing to send. Video waits while the
+        // data channel is blocked: the mailboxes keep replacing frames.
+        auto class_queue = [&](TrafficClass c) -> std::deque<QueuedPacket>* {
+            if (c == TrafficClass::File) return file_q->empty() ? nullptr : file_q.get();
+            if (out_data.blocked) return nullptr;
+            if (!low_prio_q->empty()) return low_prio_q.get();
+            if (video_mailboxes->pending > 0) {
+                for (auto& entry : video_mailboxes->boxes) {
+                    if (!entry.second.pending.empty()) return &entry.second.pending;
+                }
+            }
+            return nullptr;
+        };
+
+        // Move queued packets into the channel outboxes and write them.
+        // Runs on the reactor thread only.
+        *pump_task = [&]() {
+            flush_scheduled->store(false);
+
+            bool more = true;
+            for (int round = 0; round < 8 && more && !reactor->is_stopped(); ++round) {
+                auto now = std::chrono::steady_clock::now();
+                bool moved = false;
+                bool throttled = false;
+                std::chrono::microseconds retry_in{0};
+                auto note_throttled = [&](TrafficClass c) {
+                    auto wait = shaper_->wait_time(c, now);
+                    if (!throttled || wait < retry_in) retry_in = wait;
+                    throttled = true;
+                };
+
+                {
+                    std::lock_guard<std::mutex> lock(*queue_mutex);
+
+                    // === DUAL CHANNEL ROUTING ===
+                    // Critical packets (commands/status) → Control channel (fd_control)
+                    // Data packets (video/files/keylog) → Data channel (fd_data)
+
+                    // Control: strict priority, FIFO
+                    while (!control_q->empty()) {
+                        auto& pkt = control_q->front();
+                        TrafficClass c = shaping_class(pkt);
+                        if (!shaper_->admit(c, wire_size(pkt), now)) {
+                            note_throttled(c);
+                            break;
+                        }
+                        out_control.packets.push_back(std::move(pkt));
+                        control_q->pop_front();
+                        moved = true;
                     }
 
-                    size_t total = pkt.data.size();
-                    size_t total_sent = 0;
-
-                    while (total_sent < total) {
-                        ssize_t n = send(target_fd, (const char*)pkt.data.data() + total_sent, total - total_sent, 0);
-
-                        if (n < 0) {
-                            #ifdef _WIN32
-                            int err = WSAGetLastError();
-                            if (err == WSAEWOULDBLOCK) {
-                            #else
-                            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                            #endif
-                                // If critical OR File packet, we MUST wait and retry
-                                if (pkt.is_critical || is_file_pkt) {
-                                    int retries = 0;
-                                    while (retries < 100) { // Increased to 100 * 50ms = 5s
-                                        if (wait_for_write(target_fd, 50)) break;
-                                        retries++;
-                                        if (is_file_pkt && retries % 10 == 0) {
-                                            std::cout << "[WRITER] FILE chunk #" << seq << " blocked, retry " << retries << std::endl;
-                                            std::cout.flush();
-                                        }
-                                    }
-                                    if (retries < 100) continue;
-                                    std::cerr << "[WRITER] FATAL: File/Critical packet timed out after retries!" << std::endl;
-                                    break;
-                                } else {
+                    // Data: DRR between Video and File up to the outbox target
+                    std::array<bool, network::TRAFFIC_CLASS_COUNT> held{};
+                    size_t queued = outbox_bytes(out_data);
+                    while (queued < DATA_OUTBOX_TARGET) {
+                        TrafficClass c = drr_classes[shaping.turn];
+                        size_t ci = static_cast<size_t>(c);
+                        auto* q = held[ci] ? nullptr : class_queue(c);
+
+                        if (q) {
+                            if (!shaping.in_turn) {
+                                shaping.deficit[ci] += shaper_->weight(c) * network::TrafficShaper::DRR_QUANTUM;
+                                shaping.in_turn = true;
+                            }
+                            while (q && queued < DATA_OUTBOX_TARGET) {
+                                size_t size = wire_size(q->front());
+                                if (size > shaping.deficit[ci]) break;
+                                if (!shaper_->admit(c, size, now)) {
+                                    held[ci] = true;
+                                    note_throttled(c);
                                     break;
                                 }
+                                shaping.deficit[ci] -= size;
+                                queued += size;
+                                out_data.packets.push_back(std::move(q->front()));
+                                q->pop_front();
+                                if (c == TrafficClass::Video && q != low_prio_q.get()) video_mailboxes->pending--;
+                                moved = true;
+                                q = class_queue(c);
                             }
-                            break;
+                            if (queued >= DATA_OUTBOX_TARGET && q && !held[ci]) break; // Resume this turn
                         }
+                        if (!class_queue(c)) shaping.deficit[ci] = 0; // Idle classes bank no credit
 
-                        if (n > 0) total_sent += n;
-                    }
+                        shaping.in_turn = false;
+                        shaping.turn = (shaping.turn + 1) % (sizeof(drr_classes) / sizeof(drr_classes[0]));
 
-                    if (is_file_pkt && total_sent == total) {
-                         std::cout << "[WRITER] FILE chunk #" << seq << " sent successfully" << std::endl;
-                         std::cout.flush();
+                        bool sendable = false;
+                        for (TrafficClass d : drr_classes) {
+                            if (!held[static_cast<size_t>(d)] && class_queue(d)) sendable = true;
+                        }
+                        if (!sendable) break;
                     }
+                }
 
-                    // DEBUG: Log after sending KEYLOG
-                    if (is_keylog_pkt && total_sent == total) {
-                        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::system_clock::now().time_since_epoch()).count();
-                        std::cout << "[WRITER] KEYLOG sent successfully at " << now << "ms" << std::endl;
-                        std::cout.flush();
-                    }
+                write_outbox(out_control);
+                write_outbox(out_data);
+
+                // Tokens run out: come back when the first throttled class may send
+                if (throttled && !shaping.retry_scheduled && !reactor->is_stopped()) {
+                    shaping.retry_scheduled = true;
+                    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(retry_in) + std::chrono::milliseconds(1);
+                    reactor->add_oneshot(delay, [&]() {
+                        shaping.retry_scheduled = false;
+                        (*pump_task)();
+                    });
                 }
+
+                std::lock_guard<std::mutex> lock(*queue_mutex);
+                more = moved && (!control_q->empty() || class_queue(TrafficClass::File) || class_queue(TrafficClass::Video));
             }
-        });
 
-        // Sender Lambda: Queues packets for writer_thread to process
-        auto sender = [this, high_prio_q, low_prio_q, queue_mutex, cv_writer](const std::vector<uint8_t>& data, uint8_t prefix, bool is_critical, uint32_t target_cid, uint32_t target_bid) {
+            // Still backlogged: yield to socket events, then continue
+            if (more && !reactor->is_stopped()) request_flush();
+        };
+
+        // Sender Lambda: Queues packets for the reactor to write
+        // The payload vector is moved into the queue; the 12-byte header and
+        // traffic byte live inline in QueuedPacket (no header + payload copy)
+        auto sender = [control_q, file_q, low_prio_q, queue_mutex, queues_closed, request_flush](std::vector<uint8_t> data, uint8_t prefix, bool is_critical, uint32_t target_cid, uint32_t target_bid) {
 
-            // 1. Build Full Packet Buffer
+            // 1. Build Header
+            QueuedPacket qp;
             uint32_t len = data.size() + (prefix != 0 ? 1 : 0);
             uint32_t net_len = htonl(len);
             uint32_t net_cid = htonl(target_cid);
             uint32_t net_bid = htonl(target_bid);
-
-            std::vector<uint8_t> packet;
-            packet.reserve(12 + len); // Header size known as 12 locally if constant removed
-
-            uint8_t header[12];
-            memcpy(header, &net_len, 4);
-            memcpy(header+4, &net_cid, 4);
-            memcpy(header+8, &net_bid, 4);
-
-            packet.insert(packet.end(), header, header + 12);
-            if (prefix != 0) packet.push_back(prefix);
-            packet.insert(packet.end(), data.begin(), data.end());
-
-            // DEBUG: Check if this is a KEYLOG packet
-            bool is_keylog = (data.size() > 7 && strncmp((const char*)data.data(), "KEYLOG:", 7) == 0);
+            memcpy(qp.header, &net_len, 4);
+            memcpy(qp.header + 4, &net_cid, 4);
+            memcpy(qp.header + 8, &net_bid, 4);
+            qp.header_len = HEADER_SIZE;
+            if (prefix != 0) qp.header[qp.header_len++] = prefix;
+            qp.body = std::move(data);
+            qp.traffic = prefix;
 
             // 2. Queue It (Fast)
             {
                 std::lock_guard<std::mutex> lock(*queue_mutex);
-
-                // DEBUG: Log queue depths before adding
-                if (is_keylog) {
-                    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()).count();
-                    std::cout << "[SENDER] KEYLOG packet queued at " << now_ms << "ms, high_q=" << high_prio_q->size() << ", low_q=" << low_prio_q->size() << std::endl;
-                    std::cout.flush();
-                }
+                if (*queues_closed) return;
 
                 if (is_critical || prefix == TRAFFIC_CONTROL) {
                     // Critical or Control: Mandatory High Prio, uses fd_control
-                    high_prio_q->push_back({packet, true});
+                    qp.is_critical = true;
+                    control_q->push_back(std::move(qp));
                 } else if (prefix == TRAFFIC_FILE) {
                     // Files: Never drop, High Prio in writer, but uses fd_data (is_critical=false)
                     // unless caller explicitly asked for critical (rare)
-                    high_prio_q->push_back({packet, is_critical});
+                    qp.is_critical = is_critical;
+                    file_q->push_back(std::move(qp));
                 } else if (prefix == TRAFFIC_VIDEO) {
                     // Video: Drop if busy, uses fd_data
                     if (low_prio_q->size() < 5) {
-                        low_prio_q->push_back({packet, false});
+                        low_prio_q->push_back(std::move(qp));
                     }
                 } else {
                     // Fallback
-                    if (is_critical) high_prio_q->push_back({packet, true});
-                    else low_prio_q->push_back({packet, false});
+                    qp.is_critical = is_critical;
+                    if (is_critical) control_q->push_back(std::move(qp));
+                    else low_prio_q->push_back(std::move(qp));
                 }
             }
 
-            // 3. Wake Writer
-            cv_writer->notify_one();
+            // 3. Wake Reactor
+            request_flush();
+        };
+
+        // Bulk Sender: ordered lane on the data channel for file transfers.
+        // Protocol: [12B Header][Traffic][head][file region bytes]
+        // Unlike sender(), text is not rerouted to the control channel, so a
+        // transfer's markers stay in order with its chunks. The region is
+        // never copied here: the writer sendfile()s it after the head.
+        auto send_bulk = [file_q, queue_mutex, queues_closed, request_flush](std::vector<uint8_t> head, uint8_t prefix, interfaces::FileRegion region, uint32_t target_cid, uint32_t target_bid) {
+            QueuedPacket qp;
+            if (!region.source) region.length = 0;
+            uint32_t net_len = htonl(static_cast<uint32_t>(1 + head.size() + region.length));
+            uint32_t net_cid = htonl(target_cid);
+            uint32_t net_bid = htonl(target_bid);
+            memcpy(qp.header, &net_len, 4);
+            memcpy(qp.header + 4, &net_cid, 4);
+            memcpy(qp.header + 8, &net_bid, 4);
+            qp.header[12] = prefix;
+            qp.header_len = HEADER_SIZE + 1;
+            qp.body = std::move(head);
+            qp.file = std::move(region);
+            qp.traffic = prefix;
+            qp.is_critical = false;
+
+            {
+                std::lock_guard<std::mutex> lock(*queue_mutex);
+                if (*queues_closed) return;
+                file_q->push_back(std::move(qp)); // Never dropped
+            }
+            request_flush();
+        };
+
+        // Frame Sender: Queues a pooled video frame by reference (no packet copy)
+        // Protocol: [12B Header][TRAFFIC_VIDEO][ChannelID][VideoData]
+        // ChannelID: 0x01 = Monitor, 0x02 = Webcam
+        auto send_frame = [video_mailboxes, queue_mutex, request_flush, writer_stats](const common::VideoPacket& vp, uint8_t channel, uint32_t target_cid, uint32_t target_bid) {
+            if (!vp.data) return;
+
+            QueuedPacket qp;
+            qp.is_critical = false;
+            qp.traffic = TRAFFIC_VIDEO;
+            qp.frame = vp.data;
+            qp.kind = vp.kind;
+            qp.enqueued = std::chrono::steady_clock::now();
+
+            uint32_t net_len = htonl(static_cast<uint32_t>(vp.data->size() + 2)); // + Traffic + ChannelID
+            uint32_t net_cid = htonl(target_cid);
+            uint32_t net_bid = htonl(target_bid);
+            memcpy(qp.header, &net_len, 4);
+            memcpy(qp.header + 4, &net_cid, 4);
+            memcpy(qp.header + 8, &net_bid, 4);
+            qp.header[12] = TRAFFIC_VIDEO;
+            qp.header[13] = channel;
+            qp.header_len = VIDEO_PREFIX_SIZE;
+
+            {
+                std::lock_guard<std::mutex> lock(*queue_mutex);
+                auto& box = video_mailboxes->boxes[(static_cast<uint64_t>(target_cid) << 8) | channel];
+                auto& pending = box.pending;
+
+                if (qp.kind == common::PacketKind::InterFrame) {
+                    // GOP-aware: never send an InterFrame whose predecessor was dropped
+                    if (box.skip_to_keyframe || pending.size() >= VIDEO_GOP_BUDGET) {
+                        box.skip_to_keyframe = true;
+                        writer_stats->gop_dropped++;
+                        return;
+                    }
+                } else {
+                    // KeyFrame: everything older except codec config is obsolete.
+                    // CodecConfig: starts a new generation, nothing older is needed.
+                    size_t before = pending.size();
+                    bool is_config = qp.kind == common::PacketKind::CodecConfig;
+                    pending.erase(std::remove_if(pending.begin(), pending.end(), [&](const QueuedPacket& old) {
+                        return is_config || old.kind != common::PacketKind::CodecConfig;
+                    }), pending.end());
+                    size_t removed = before - pending.size();
+                    writer_stats->superseded += removed;
+                    video_mailboxes->pending -= removed;
+                    box.skip_to_keyframe = false;
+                }
+
+                pending.push_back(std::move(qp));
+                video_mailboxes->pending++;
+            }
+            request_flush();
         };
 
         // send_text: Used for STATUS, ERROR, and control messages → Control Channel
-        auto send_text = [&](const std::string& msg, uint32_t t_cid, uint32_t t_bid, bool is_critical = true) {
+        auto send_text = [sender](const std::string& msg, uint32_t t_cid, uint32_t t_bid, bool is_critical = true) {
             std::vector<uint8_t> b(msg.begin(), msg.end());
             // Control channel for status/control messages (never drop)
-            sender(b, TRAFFIC_CONTROL, is_critical, t_cid, t_bid);
+            sender(std::move(b), TRAFFIC_CONTROL, is_critical, t_cid, t_bid);
         };
 
         // send_data: Used for DATA payloads (APPS, PROCS, KEYLOG, FILES) → Data Channel
-        auto send_data = [&](const std::string& msg, uint32_t t_cid, uint32_t t_bid, bool is_critical = false) {
+        auto send_data = [sender](const std::string& msg, uint32_t t_cid, uint32_t t_bid, bool is_critical = false) {
             std::vector<uint8_t> b(msg.begin(), msg.end());
             // Data channel for actual data payloads (faster, parallel)
             // Use TRAFFIC_CONTROL (0x01) for text data but ensure it goes through the data fd
-            sender(b, TRAFFIC_CONTROL, is_critical, t_cid, t_bid);
+            sender(std::move(b), TRAFFIC_CONTROL, is_critical, t_cid, t_bid);
         };
 
-        // Helper for cross-platform poll/select READ
-        auto wait_for_read = [](socket_t fd, int timeout_ms) -> bool {
-            #ifdef _WIN32
-                WSAPOLLFD pfd;
-                pfd.fd = fd;
-                pfd.events = POLLIN;
-                pfd.revents = 0;
-                int ret = WSAPoll(&pfd, 1, timeout_ms);
-            #else
-                struct pollfd pfd;
-                pfd.fd = fd;
-                pfd.events = POLLIN;
-                pfd.revents = 0;
-                int ret = poll(&pfd, 1, timeout_ms);
-            #endif
+        uint32_t cid = 0;
+        uint32_t bid = 0; // Capture BID for echo
+        std::set<uint32_t> session_clients; // Every cid seen: their work is stopped at disconnect
+        std::vector<uint8_t> payload;
 
-            if (ret > 0 && (pfd.revents & POLLIN)) return true;
-            return false;
+        uint32_t my_backend_id = 1; // Default to 1
+
+        // --- INPUT PIPELINE ---
+        // Moves decoded from one read burst collapse to the latest position;
+        // the pipeline is flushed at most once per display refresh.
+        auto input = std::make_shared<InputPipeline>(input_injector_);
+        bool input_flush_armed = false;
+        auto schedule_input_flush = [&]() {
+            if (input->pending() == 0 || input_flush_armed) return;
+            auto delay = input->flush_delay(std::chrono::steady_clock::now());
+            if (delay.count() == 0) {
+                input->flush();
+                return;
+            }
+            input_flush_armed = true;
+            reactor->add_oneshot(delay, [&]() {
+                input_flush_armed = false;
+                input->flush();
+            });
         };
 
-        // --- READ HANDLER (READS FROM CONTROL CHANNEL) ---
-        // Commands come in via control channel only
-        auto read_frame_lambda = [&](socket_t sock_fd, std::vector<uint8_t>& out_payload, uint32_t& out_cid, uint32_t& out_bid) -> bool {
-            uint8_t header[HEADER_SIZE];
-            size_t got = 0;
-            while(got < HEADER_SIZE) {
-                auto [n, err] = socket_control->recv(header + got, HEADER_SIZE - got);
-                if (n > 0) got += n;
-                else if (err == network::SocketError::WouldBlock) {
-                    // OPTIMIZATION: Wait for data instead of sleep
-                    if (wait_for_read(sock_fd, 10)) { // Wait up to 10ms for data
-                        continue;
-                    }
-                    // If timeout, just loop back (outer loop handles keepalive check implicitly or eventually)
-                    // For responsiveness, we yield briefly if truly idle, but poll handles the wait.
-                    continue;
+        // Binary input frame: [record][record]... (see core/InputProtocol.hpp)
+        uint64_t input_binary_frames = 0;
+        uint64_t input_rejected_frames = 0;
+        auto process_input_records = [&](const uint8_t* data, size_t len) {
+            size_t count = input::record_count(len);
+            if (count == 0) {
+                if (input_rejected_frames++ == 0) {
+                    std::cerr << "[Session " << session_id << "] Malformed input frame ("
+                              << len << " bytes), dropping" << std::endl;
                 }
-                else return false; // Error or connection closed
+                return;
             }
-
-            uint32_t net_len; memcpy(&net_len, header, 4);
-            uint32_t len = ntohl(net_len);
-            uint32_t net_cid; memcpy(&net_cid, header+4, 4);
-            out_cid = ntohl(net_cid);
-            uint32_t net_bid; memcpy(&net_bid, header+8, 4);
-            out_bid = ntohl(net_bid);
-
-            if (len > 10 * 1024 * 1024) return false; // Prevent huge allocations
-
-            out_payload.resize(len);
-            if(len > 0) {
-                got = 0;
-                while(got < len) {
-                    auto [n, err] = socket_control->recv(out_payload.data() + got, len - got);
-                    if (n > 0) got += n;
-                    else if (err == network::SocketError::WouldBlock) {
-                         // OPTIMIZATION: Wait for data instead of sleep
-                        if (wait_for_read(sock_fd, 10)) {
-                            continue;
-                        }
-                        continue;
-                    }
-                    else return false; // Error or connection closed
+            input_binary_frames++;
+            for (size_t i = 0; i < count; ++i) {
+                interfaces::InputOp op;
+                if (input::to_input_op(input::decode_record(data + i * input::RECORD_SIZE), op)) {
+                    input->push(std::move(op));
                 }
             }
-            return true;
         };
 
-        uint32_t cid = 0;
-        uint32_t bid = 0; // Capture BID for echo
-        std::vector<uint8_t> payload;
+        // --- FILE UPLOADS ---
+        // Each upload's commands and chunks run on a strand of their own,
+        // keyed by its path: off the reactor thread and never reordered
+        // (start opens the file before any chunk lands), while different
+        // uploads write in parallel. Binary chunks name their upload by the id the client
+        // passed to `file_upload_start <path> <size> <upload_id> [checksums]`.
+        // With checksums, a chunk failing its CRC32C is dropped and noted;
+        // file_upload_end then asks for just those chunks again
+        // (DATA:FILE_UPLOAD_RETRY:path|offset:length,...) instead of finishing.
+        // Delta uploads (file_delta_start/copy/end) share the route: their
+        // literal runs arrive as upload chunks, always checksummed. So do
+        // deduplicated uploads (file_cas_start/have/end): the chunks the
+        // store lacks are sent as ordinary upload chunks.
+        struct UploadRoute {
+            std::string path;
+            uint64_t size = 0;                 // Announced at start: frames must fit in it
+            bool checksums = false;
+            std::map<uint64_t, uint64_t> bad;  // offset -> length
+        };
+        auto upload_strands = std::make_shared<KeyedStrands>(*command_pool_); // Key: upload path
+        std::unordered_map<uint64_t, UploadRoute> upload_paths; // Key: (cid << 32) | upload_id
+        auto upload_key = [](uint32_t c, uint32_t id) { return (static_cast<uint64_t>(c) << 32) | id; };
+        // The path an ordered upload command names: after its other fields
+        // (it comes last, so it may contain spaces), or first for
+        // file_upload_start and before the data for file_upload_chunk
+        auto upload_path_of = [](const std::string& cmd, const std::string& msg) {
+            std::string field, path;
+            if (cmd == "file_upload_chunk") {
+                // Sliced out of msg: the base64 data can be large
+                size_t first = msg.find_first_not_of(" \t", cmd.size());
+                size_t last = msg.find_last_of(' ');
+                if (first == std::string::npos || last == std::string::npos || last < first) return path;
+                path = msg.substr(first, last - first);
+                path.erase(path.find_last_not_of(" \t") + 1);
+                return path;
+            }
+            std::istringstream in(msg.substr(cmd.size()));
+            if (cmd == "file_upload_start") {
+                in >> path;
+                return path;
+            }
+            int skip = 0;
+            if (cmd == "file_delta_start") skip = 4;                                // size id basis_size basis_mtime
+            else if (cmd == "file_cas_start" || cmd == "file_cas_have") skip = 2;    // size id | offset list
+            else if (cmd == "file_delta_copy" || cmd == "file_delta_end") skip = 1;  // list | crc
+            while (skip-- > 0) in >> field;
+            std::getline(in >> std::ws, path);
+            return path;
+        };
 
-        uint32_t my_backend_id = 1; // Default to 1
+        auto process_upload_frame = [&](const uint8_t* data, size_t len) {
+            if (len < UPLOAD_FRAME_HEAD) return;
+            uint32_t net_id; memcpy(&net_id, data, 4);
+            uint32_t net_hi, net_lo; memcpy(&net_hi, data + 4, 4); memcpy(&net_lo, data + 8, 4);
+            uint32_t upload_id = ntohl(net_id);
+            uint64_t offset = (static_cast<uint64_t>(ntohl(net_hi)) << 32) | ntohl(net_lo);
+
+            uint32_t t_cid = cid, t_bid = my_backend_id;
+            auto it = upload_paths.find(upload_key(cid, upload_id));
+            if (it == upload_paths.end() || !file_transfer_) {
+                send_text("ERROR:FILE_UPLOAD_ERROR:Unknown upload id " + std::to_string(upload_id), t_cid, t_bid);
+                return;
+            }
+
+            UploadRoute& route = it->second;
+            size_t head = route.checksums ? UPLOAD_FRAME_HEAD + UPLOAD_CRC_SIZE : UPLOAD_FRAME_HEAD;
+            if (len < head) return;
+
+            // The offset is the client's: nothing past the announced size
+            // reaches the file (a sparse multi-terabyte write otherwise)
+            uint64_t count = len - head;
+            if (offset > route.size || count > route.size - offset) {
+                send_text("ERROR:FILE_UPLOAD_ERROR:Chunk at " + std::to_string(offset) + " (" + std::to_string(count) +
+                          " bytes) outside the " + std::to_string(route.size) + " byte upload: " + route.path,
+                          t_cid, t_bid);
+                return;
+            }
+
+            if (route.checksums) {
+                uint32_t net_crc; memcpy(&net_crc, data + UPLOAD_FRAME_HEAD, 4);
+                if (common::checksum::crc32c(data + head, len - head) != ntohl(net_crc)) {
+                    std::cerr << "[Upload] CRC mismatch at offset " << offset << " (" << (len - head)
+                              << " bytes): " << route.path << std::endl;
+                    route.bad[offset] = len - head;
+                    return;
+                }
+                route.bad.erase(offset);
+            }
+
+            // The only copy: out of the receive buffer for the strand
+            std::vector<uint8_t> bytes(data + head, data + len);
+            upload_strands->post(route.path, [this, send_text, path = route.path, offset, bytes = std::move(bytes), t_cid, t_bid]() {
+                auto res = file_transfer_->upload_write_at(path, offset, bytes.data(), bytes.size());
+                if (res.is_err()) send_text("ERROR:FILE_UPLOAD_ERROR:" + res.error().message, t_cid, t_bid);
+            });
+        };
 
-        while (true) {
-            if (!read_frame_lambda(fd_control, payload, cid, bid)) break;
+        // --- COMMAND HANDLER ---
+        // Runs once per complete control frame (cid/bid/payload set by on_control)
+        auto process_command = [&]() {
 
             // Log Command Receipt (Latency Debugging)
             if (payload.size() < 100) {
@@ -693,20 +1350,72 @@ namespace core {
             if (cmd.rfind("file_", 0) == 0) {
                 if (dispatcher_) {
                     core::command::CommandContext ctx;
-                    ctx.client_id = cid;
+                    ctx.client_id = BroadcastBus::make_id(session_id, cid);
                     ctx.backend_id = my_backend_id;
                     // Create a responder that routes FILE data through DATA channel for speed
                     // is_critical=false means it goes to fd_data (faster, parallel to control)
                     ctx.respond = [sender, cid, my_backend_id](std::vector<uint8_t>&& d, bool is_critical, uint8_t traffic_class) {
-                        sender(d, traffic_class, is_critical, cid, my_backend_id);
+                        sender(std::move(d), traffic_class, is_critical, cid, my_backend_id);
                     };
+                    // Downloads: markers + sendfile regions, in order on fd_data
+                    ctx.send_bulk = [send_bulk, cid, my_backend_id](std::vector<uint8_t>&& head, uint8_t traffic_class, interfaces::FileRegion region) {
+                        send_bulk(std::move(head), traffic_class, std::move(region), cid, my_backend_id);
+                    };
+
+                    // Binary chunks need the id -> path mapping before the next frame
+                    if (cmd == "file_upload_start") {
+                        std::string path; uint64_t size; uint32_t upload_id; int checksums = 0;
+                        if (ss >> path >> size >> upload_id) {
+                            ss >> checksums;
+                            upload_paths[upload_key(cid, upload_id)] = UploadRoute{path, size, checksums != 0, {}};
+                        }
+                    } else if (cmd == "file_delta_start") {
+                        // The path comes last and may contain spaces
+                        std::string path; uint64_t size, basis_size, basis_mtime; uint32_t upload_id;
+                        if (ss >> size >> upload_id >> basis_size >> basis_mtime && std::getline(ss >> std::ws, path)) {
+                            upload_paths[upload_key(cid, upload_id)] = UploadRoute{path, size, true, {}};
+                        }
+                    } else if (cmd == "file_cas_start") {
+                        std::string path; uint64_t size; uint32_t upload_id;
+                        if (ss >> size >> upload_id && std::getline(ss >> std::ws, path)) {
+                            upload_paths[upload_key(cid, upload_id)] = UploadRoute{path, size, true, {}};
+                        }
+                    } else if (cmd == "file_upload_end" || cmd == "file_delta_end" || cmd == "file_cas_end" ||
+                               cmd == "file_upload_cancel") {
+                        std::string path, crc;
+                        if (cmd == "file_delta_end") ss >> crc;
+                        std::getline(ss >> std::ws, path);
+                        bool retry = false;
+                        for (auto it = upload_paths.begin(); it != upload_paths.end();) {
+                            if ((it->first >> 32) != cid || it->second.path != path) { ++it; continue; }
+                            if (cmd != "file_upload_cancel" && !it->second.bad.empty()) {
+                                // Keep the upload open until the bad chunks arrive intact
+                                std::string ranges;
+                                for (const auto& [offset, length] : it->second.bad) {
+                                    if (!ranges.empty()) ranges += ",";
+                                    ranges += std::to_string(offset) + ":" + std::to_string(length);
+                                }
+                                send_text("DATA:FILE_UPLOAD_RETRY:" + path + "|" + ranges, cid, my_backend_id);
+                                retry = true;
+                                ++it;
+                                continue;
+                            }
+                            it = upload_paths.erase(it);
+                        }
+                        if (retry) return;
+                    }
 
                     // ASYNC: File operations can be slow (disk I/O)
-                    command_pool_->submit_detached([this, msg, ctx]() mutable {
+                    auto task = [this, msg, ctx]() mutable {
                         dispatcher_->dispatch(msg, ctx);
-                    });
+                    };
+                    bool ordered = cmd.rfind("file_upload_", 0) == 0 ||
+                                   cmd.rfind("file_cas_", 0) == 0 ||
+                                   (cmd.rfind("file_delta_", 0) == 0 && cmd != "file_delta_sig");
+                    if (ordered) upload_strands->post(upload_path_of(cmd, msg), std::move(task)); // Keep upload order
+                    else command_pool_->submit_detached(std::move(task));
                 }
-                continue; // Skip legacy handling
+                return; // Skip legacy handling
             }
 
             if (cmd == "ping") {
@@ -729,28 +1438,20 @@ namespace core {
                  uint32_t sub_bid = my_backend_id;
 
                  // ASYNC: Streaming startup
-                 command_pool_->submit_detached([this, cid, my_backend_id, send_text, sub_cid, sub_bid, sender]() {
-                     bus_monitor_->subscribe(sub_cid, [sender, sub_cid, sub_bid](const std::vector<uint8_t>& d){
-                         // Protocol: [TRAFFIC_VIDEO][ChannelID][VideoData]
-                         // ChannelID: 0x01 = Monitor, 0x02 = Webcam
-                         std::vector<uint8_t> payload;
-                         payload.reserve(1 + d.size());
-                         payload.push_back(0x01); // Channel: Monitor
-                         payload.insert(payload.end(), d.begin(), d.end());
-
-                         sender(payload, TRAFFIC_VIDEO, false, sub_cid, sub_bid);
-                     });
-
-                     auto res = session_->start();
+                 command_pool_->submit_detached([this, cid, my_backend_id, send_text, sub_cid, sub_bid, send_frame, session_id]() {
+                     auto res = attach_viewer(*bus_monitor_, *session_, BroadcastBus::make_id(session_id, sub_cid),
+                         [send_frame, sub_cid, sub_bid](const common::VideoPacket& pkt){
+                             send_frame(pkt, 0x01, sub_cid, sub_bid); // Channel: Monitor
+                         });
                      if(res.is_err() && res.error().code != common::ErrorCode::Busy) send_text("ERROR:StartStream:" + res.error().message, cid, my_backend_id);
                      else send_text("STATUS:MONITOR_STREAM:STARTED", cid, my_backend_id);
                  });
             }
             else if (cmd == "stop_monitor_stream") {
                  // ASYNC: Streaming cleanup
-                 command_pool_->submit_detached([this, cid, my_backend_id, send_text]() {
-                     bus_monitor_->unsubscribe(cid);
-                     session_->stop();
+                 command_pool_->submit_detached([this, cid, my_backend_id, send_text, session_id]() {
+                     // Capture keeps running while other viewers/gateways watch
+                     detach_viewer(*bus_monitor_, *session_, BroadcastBus::make_id(session_id, cid));
                      send_text("STATUS:MONITOR_STREAM:STOPPED", cid, my_backend_id);
                  });
             }
@@ -847,29 +1548,40 @@ namespace core {
                uint32_t sub_bid = my_backend_id;
 
                // ASYNC: Webcam startup
-               command_pool_->submit_detached([this, cid, my_backend_id, send_text, sub_cid, sub_bid, sender]() {
-                   bus_webcam_->subscribe(sub_cid, [sender, sub_cid, sub_bid](const std::vector<uint8_t>& d){
-                       // Protocol: [TRAFFIC_VIDEO][ChannelID][VideoData]
-                       std::vector<uint8_t> payload;
-                       payload.reserve(1 + d.size());
-                       payload.push_back(0x02); // Channel: Webcam
-                       payload.insert(payload.end(), d.begin(), d.end());
-
-                       sender(payload, TRAFFIC_VIDEO, false, sub_cid, sub_bid);
-                   });
-                   auto res = webcam_session_->start();
+               command_pool_->submit_detached([this, cid, my_backend_id, send_text, sub_cid, sub_bid, send_frame, session_id]() {
+                   auto res = attach_viewer(*bus_webcam_, *webcam_session_, BroadcastBus::make_id(session_id, sub_cid),
+                       [send_frame, sub_cid, sub_bid](const common::VideoPacket& pkt){
+                           send_frame(pkt, 0x02, sub_cid, sub_bid); // Channel: Webcam
+                       });
                    if(res.is_err() && res.error().code != common::ErrorCode::Busy) send_text("ERROR:StartWebcam:" + res.error().message, cid, my_backend_id);
                    else send_text("STATUS:WEBCAM_STREAM:STARTED", cid, my_backend_id);
                });
             }
             else if (cmd == "stop_webcam_stream") {
                  // ASYNC: Webcam cleanup
-                 command_pool_->submit_detached([this, cid, my_backend_id, send_text]() {
-                     bus_webcam_->unsubscribe(cid);
-                     webcam_session_->stop();
+                 command_pool_->submit_detached([this, cid, my_backend_id, send_text, session_id]() {
+                     detach_viewer(*bus_webcam_, *webcam_session_, BroadcastBus::make_id(session_id, cid));
                      send_text("STATUS:WEBCAM_STREAM:STOPPED", cid, my_backend_id);
                  });
             }
+            else if (cmd == "get_stream_stats") {
+                 // Per-viewer bus queue stats: STATUS:STREAM_STATS:<channel>:dropped=..,force_clears=..,delivered=..,queued=..
+                 auto report = [&](const char* channel, const std::shared_ptr<BroadcastBus>& bus) {
+                     auto res = bus->get_stats(BroadcastBus::make_id(session_id, cid));
+                     if (res.is_err()) {
+                         send_text(std::string("STATUS:STREAM_STATS:") + channel + ":inactive", cid, my_backend_id);
+                         return;
+                     }
+                     const auto& st = res.unwrap();
+                     send_text(std::string("STATUS:STREAM_STATS:") + channel +
+                               ":dropped=" + std::to_string(st.dropped_frames) +
+                               ",force_clears=" + std::to_string(st.force_clears) +
+                               ",delivered=" + std::to_string(st.delivered_frames) +
+                               ",queued=" + std::to_string(st.queue_depth), cid, my_backend_id);
+                 };
+                 report("monitor", bus_monitor_);
+                 report("webcam", bus_webcam_);
+            }
             else if (cmd == "start_keylog") {
                 uint32_t sub_cid = cid;
                 uint32_t sub_bid = my_backend_id;
@@ -985,7 +1697,7 @@ namespace core {
 
                 if (args.empty()) {
                     std::cout << "[Backend] " << cmd << " called with no arguments, ignoring." << std::endl;
-                    continue;
+                    return;
                 }
 
                 std::cout << "[Backend] Executing " << cmd << " with args: [" << args << "]" << std::endl;
@@ -1002,43 +1714,71 @@ namespace core {
                     }
                 });
             }
+            // Input commands go through the coalescing pipeline (injected per refresh)
             else if (cmd == "mouse_move") {
-                float x, y; ss >> x >> y;
-                if(input_injector_) input_injector_->move_mouse(x, y);
-            }
-            else if (cmd == "mouse_down") {
-                 int btn; ss >> btn;
-                 if(input_injector_) input_injector_->click_mouse((interfaces::MouseButton)btn, true);
-            }
-            else if (cmd == "mouse_up") {
-                 int btn; ss >> btn;
-                 if(input_injector_) input_injector_->click_mouse((interfaces::MouseButton)btn, false);
-            }
-            else if (cmd == "mouse_click") {
-                 int btn; ss >> btn;
-                  if(input_injector_) {
-                     input_injector_->click_mouse((interfaces::MouseButton)btn, true);
-                     std::this_thread::sleep_for(std::chrono::milliseconds(20));
-                     input_injector_->click_mouse((interfaces::MouseButton)btn, false);
-                 }
+                interfaces::InputOp op;
+                op.type = interfaces::InputOp::Type::Move;
+                if (ss >> op.x >> op.y) input->push(std::move(op));
             }
-            else if (cmd == "mouse_scroll") {
-                int delta; ss >> delta;
-                if(input_injector_) input_injector_->scroll_mouse(delta);
+            else if (cmd == "mouse_down" || cmd == "mouse_up" || cmd == "mouse_click") {
+                 interfaces::InputOp op;
+                 op.type = cmd == "mouse_click" ? interfaces::InputOp::Type::Click : interfaces::InputOp::Type::Button;
+                 op.down = cmd == "mouse_down";
+                 if (ss >> op.code) input->push(std::move(op));
             }
-            else if (cmd == "key_down") {
-                int code; ss >> code;
-                if(input_injector_) input_injector_->press_key(static_cast<interfaces::KeyCode>(code), true);
+            else if (cmd == "mouse_scroll") {
+                interfaces::InputOp op;
+                op.type = interfaces::InputOp::Type::Scroll;
+                if (ss >> op.code) input->push(std::move(op));
             }
-            else if (cmd == "key_up") {
-                int code; ss >> code;
-                if(input_injector_) input_injector_->press_key(static_cast<interfaces::KeyCode>(code), false);
+            else if (cmd == "key_down" || cmd == "key_up") {
+                interfaces::InputOp op;
+                op.type = interfaces::InputOp::Type::Key;
+                op.down = cmd == "key_down";
+                if (ss >> op.code) input->push(std::move(op));
             }
             else if (cmd == "text_input") {
-                std::string text;
+                interfaces::InputOp op;
+                op.type = interfaces::InputOp::Type::Text;
                 if(ss.peek() == ' ') ss.ignore();
-                std::getline(ss, text);
-                if(input_injector_) input_injector_->send_text(text);
+                std::getline(ss, op.text);
+                input->push(std::move(op));
+            }
+            else if (cmd == "get_traffic_stats") {
+                 send_text("STATUS:TRAFFIC_STATS:" + shaper_->format_stats(), cid, my_backend_id);
+            }
+            else if (cmd == "set_bandwidth") {
+                 // set_bandwidth <control|video|file|global> <KB/s> [burst KB]; 0 = unlimited
+                 std::string name; uint64_t kbps = 0, burst_kb = 0;
+                 network::TrafficClass c;
+                 if (!(ss >> name >> kbps) || (name != "global" && !network::parse_traffic_class(name, c))) {
+                     send_text("ERROR:BANDWIDTH:Usage: set_bandwidth <control|video|file|global> <KB/s> [burst KB]", cid, my_backend_id);
+                 } else {
+                     ss >> burst_kb;
+                     if (name == "global") shaper_->set_global_rate(kbps * 1024, burst_kb * 1024);
+                     else shaper_->set_rate(c, kbps * 1024, burst_kb * 1024);
+                     send_text("STATUS:BANDWIDTH:" + name + "=" + std::to_string(kbps), cid, my_backend_id);
+                 }
+            }
+            else if (cmd == "set_traffic_weight") {
+                 // set_traffic_weight <video|file> <weight>: DRR share of the data channel
+                 std::string name; uint32_t weight = 0;
+                 network::TrafficClass c;
+                 if (!(ss >> name >> weight) || !network::parse_traffic_class(name, c) || c == network::TrafficClass::Control) {
+                     send_text("ERROR:BANDWIDTH:Usage: set_traffic_weight <video|file> <weight>", cid, my_backend_id);
+                 } else {
+                     shaper_->set_weight(c, weight);
+                     send_text("STATUS:TRAFFIC_WEIGHT:" + name + "=" + std::to_string(shaper_->weight(c)), cid, my_backend_id);
+                 }
+            }
+            else if (cmd == "get_input_stats") {
+                 const auto& st = input->stats();
+                 send_text("STATUS:INPUT_STATS:received=" + std::to_string(st.received) +
+                           ",coalesced=" + std::to_string(st.coalesced) +
+                           ",injected=" + std::to_string(st.injected) +
+                           ",flushes=" + std::to_string(st.flushes) +
+                           ",binary_frames=" + std::to_string(input_binary_frames) +
+                           ",rejected_frames=" + std::to_string(input_rejected_frames), cid, my_backend_id);
             }
             else if (cmd == "kill_process") {
                  uint32_t pid; ss >> pid;
@@ -1092,15 +1832,180 @@ namespace core {
             else {
                 // if(cmd.length() > 0) std::cout << "[CMD] " << cmd << std::endl;
             }
+        };
+
+        // --- CONTROL CHANNEL READS ---
+        // Edge-triggered: drain the socket, then cut complete frames out of
+        // the buffer. Commands are handled inline on the reactor thread; slow
+        // ones are already handed to command_pool_.
+        std::vector<uint8_t> inbuf = std::move(initial_input); // Bytes read during pairing
+        size_t in_off = 0;
+        auto on_control = [&](uint32_t events) {
+            if (events & network::IO_WRITE) write_outbox(out_control);
+            if (!(events & (network::IO_READ | network::IO_ERROR))) return;
+
+            uint8_t chunk[16 * 1024];
+            while (true) {
+                auto [n, err] = socket_control->recv(chunk, sizeof(chunk));
+                if (n > 0) {
+                    inbuf.insert(inbuf.end(), chunk, chunk + n);
+                    continue;
+                }
+                if (err == network::SocketError::WouldBlock) break;
+                reactor->stop(); // Error or connection closed
+                return;
+            }
+
+            while (inbuf.size() - in_off >= HEADER_SIZE && !reactor->is_stopped()) {
+                const uint8_t* header = inbuf.data() + in_off;
+                uint32_t net_len; memcpy(&net_len, header, 4);
+                uint32_t len = ntohl(net_len);
+                if (len > 10 * 1024 * 1024) { // Prevent huge allocations
+                    reactor->stop();
+                    return;
+                }
+                if (inbuf.size() - in_off < HEADER_SIZE + len) break;
+
+                uint32_t net_cid; memcpy(&net_cid, header + 4, 4);
+                cid = ntohl(net_cid);
+                session_clients.insert(cid);
+                uint32_t net_bid; memcpy(&net_bid, header + 8, 4);
+                bid = ntohl(net_bid);
+                const uint8_t* body = header + HEADER_SIZE;
+                in_off += HEADER_SIZE + len;
+
+                // Binary input records are decoded in place and skip the text parser
+                if (len > 0 && body[0] == input::TRAFFIC_INPUT) {
+                    process_input_records(body + 1, len - 1);
+                    continue;
+                }
+                // Binary upload chunks: no text parsing, no base64
+                if (len > 0 && body[0] == TRAFFIC_FILE) {
+                    if (bid != 0) my_backend_id = bid;
+                    process_upload_frame(body + 1, len - 1);
+                    continue;
+                }
+
+                payload.assign(body, body + len);
+                process_command();
+            }
+
+            // Compact once the parsed prefix is no longer needed
+            if (in_off == inbuf.size()) {
+                inbuf.clear();
+                in_off = 0;
+            } else if (in_off > 64 * 1024) {
+                inbuf.erase(inbuf.begin(), inbuf.begin() + in_off);
+                in_off = 0;
+            }
+
+            schedule_input_flush(); // After the whole burst, so stale moves coalesce
+            (*pump_task)(); // Flush replies queued by the commands
+        };
+
+        // --- DATA CHANNEL ---
+        // The gateway never sends on it; reads only detect the peer closing.
+        auto on_data = [&](uint32_t events) {
+            if (events & network::IO_WRITE) {
+                write_outbox(out_data);
+                (*pump_task)(); // Room again: pull the next frames
+            }
+            if (!(events & (network::IO_READ | network::IO_ERROR))) return;
+
+            uint8_t sink[4096];
+            while (true) {
+                auto [n, err] = socket_data->recv(sink, sizeof(sink));
+                if (n > 0) continue;
+                if (err == network::SocketError::WouldBlock) break;
+                reactor->stop();
+                return;
+            }
+        };
+
+        if (!reactor->add(fd_control, network::IO_READ, on_control) ||
+            !reactor->add(fd_data, network::IO_READ, on_data)) {
+            std::cerr << "[Session " << session_id << "] Failed to register sockets with reactor" << std::endl;
+            reactor->stop();
         }
 
+        // Commands that arrived together with the handshake
+        if (!inbuf.empty()) reactor->post([&]() { on_control(network::IO_READ); });
+
+        // Write-stall watchdog: a peer that stops reading keeps TCP alive
+        // but never drains. Give up after 10s without progress.
+        reactor->add_timer(std::chrono::seconds(1), [&]() {
+            auto now = std::chrono::steady_clock::now();
+            for (Outbox* ob : {&out_control, &out_data}) {
+                if (ob->blocked && now - ob->last_progress > std::chrono::seconds(10)) {
+                    std::cerr << "[Session " << session_id << "] Write stalled for 10s on fd " << ob->fd << ", closing" << std::endl;
+                    reactor->stop();
+                    return;
+                }
+            }
+        });
+
+        uint64_t last_report_bytes = 0;
+        reactor->add_timer(std::chrono::seconds(10), [&]() {
+            if (writer_stats->bytes.load() == last_report_bytes) return; // Idle: stay quiet
+            last_report_bytes = writer_stats->bytes.load();
+            writer_stats->log("stats");
+        });
+
+        reactor->run();
+
         // Cleanup
-        *stop_writer = true;
-        cv_writer->notify_all();
-        if (writer_thread.joinable()) writer_thread.join();
+        // Tasks still posted by command_pool_/drainers must not touch this frame
+        *pump_task = nullptr;
+        writer_stats->log("session total");
+        std::cout << "[Session " << session_id << "] Reactor wakeups: " << reactor->wakeups() << std::endl;
+
+        // Drop every viewer of this gateway; capture stops if no other session watches
+        detach_session(session_id);
+
+        // Stop the clients' transfers and watches, then drop what is still
+        // queued: a cancelled download waits for its queued chunks' leases
+        if (dispatcher_) {
+            for (uint32_t client : session_clients) {
+                dispatcher_->client_disconnected(BroadcastBus::make_id(session_id, client));
+            }
+            // Uploads left open are cancelled by their handler, after the
+            // chunks already queued on their strand: the partial file or
+            // delta temp file goes, its descriptor is closed and a
+            // deduplicated upload's chunk store plan (and pins) is released
+            for (const auto& [key, route] : upload_paths) {
+                core::command::CommandContext ctx;
+                ctx.client_id = BroadcastBus::make_id(session_id, static_cast<uint32_t>(key >> 32));
+                ctx.backend_id = my_backend_id;
+                ctx.respond = [](std::vector<uint8_t>&&, bool, uint8_t) {}; // Nobody left to tell
+                upload_strands->post(route.path, [this, msg = "file_upload_cancel " + route.path, ctx]() {
+                    dispatcher_->dispatch(msg, ctx);
+                });
+            }
+            upload_paths.clear();
+        }
+        {
+            std::deque<QueuedPacket> control, file, low_prio;
+            {
+                std::lock_guard<std::mutex> lock(*queue_mutex);
+                *queues_closed = true;
+                control.swap(*control_q);
+                file.swap(*file_q);
+                low_prio.swap(*low_prio_q);
+            }
+        }
+
+        const auto& in_stats = input->stats();
+        if (in_stats.received > 0) {
+            std::cout << "[Session " << session_id << "] Input: " << in_stats.received << " received, "
+                      << in_stats.coalesced << " coalesced, " << in_stats.injected << " injected in "
+                      << in_stats.flushes << " flushes (" << input_binary_frames << " binary frames, "
+                      << input_rejected_frames << " rejected)" << std::endl;
+        }
 
-        bus_monitor_->unsubscribe(cid);
-        bus_webcam_->unsubscribe(cid);
+        auto pool_stats = common::FrameBufferPool::global().stats();
+        std::cout << "[BackendServer] Frame pool: allocations=" << pool_stats.allocations
+                  << ", reuses=" << pool_stats.reuses
+                  << ", discards=" << pool_stats.discards << std::endl;
     }
 
     // Deprecated methods removed
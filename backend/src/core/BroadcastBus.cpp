@@ -1,121 +1,214 @@
 #include "core/BroadcastBus.hpp"
 #include <iostream>
+#include <algorithm>
+#include <string>
 
 namespace core {
 
-    BroadcastBus::BroadcastBus() {}
-    BroadcastBus::~BroadcastBus() {}
+    namespace {
+        // "group:client" for logs
+        std::string describe(SubscriberId id) {
+            return std::to_string(id >> 32) + ":" + std::to_string(id & 0xFFFFFFFFu);
+        }
+    }
 
-    void BroadcastBus::push(const common::VideoPacket& packet) {
-        std::lock_guard<std::mutex> lock(mutex_);
+    BroadcastBus::BroadcastBus()
+        : subscribers_(std::make_shared<const SubscriberList>()) {}
+
+    BroadcastBus::~BroadcastBus() {
+        std::shared_ptr<const SubscriberList> subs;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            subs = subscribers_;
+            std::atomic_store(&subscribers_, std::make_shared<const SubscriberList>());
+        }
+        for (const auto& sub : *subs) stop_subscriber(sub);
+    }
+
+    std::shared_ptr<const BroadcastBus::SubscriberList> BroadcastBus::snapshot() const {
+        return std::atomic_load(&subscribers_);
+    }
 
+    void BroadcastBus::push(const common::VideoPacket& packet) {
         // 1. Update Global Caches
         if (packet.kind == common::PacketKind::CodecConfig) {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
             cached_configs_[packet.generation] = packet;
         } else if (packet.kind == common::PacketKind::KeyFrame) {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
             cached_idrs_[packet.generation] = packet;
         }
 
-        // 2. Fan-Out to Subscribers
-        for (auto& sub : subscribers_) {
-            dispatch_to_subscriber(sub, packet);
+        // 2. Fan-Out to Subscribers (queue only, drainers do the sending)
+        auto subs = snapshot();
+        for (const auto& sub : *subs) {
+            enqueue(*sub, packet);
         }
     }
 
-    void BroadcastBus::subscribe(uint32_t client_id, PacketCallback send_fn) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        // Remove existing if any (prevent duplicates)
-        auto it = std::remove_if(subscribers_.begin(), subscribers_.end(),
-            [client_id](const std::shared_ptr<Subscriber>& s){ return s->id == client_id; });
-        subscribers_.erase(it, subscribers_.end());
-
+    void BroadcastBus::subscribe(SubscriberId client_id, PacketCallback send_fn) {
         auto new_sub = std::make_shared<Subscriber>();
         new_sub->id = client_id;
-        new_sub->send_fn = send_fn;
+        new_sub->send_fn = std::move(send_fn);
 
-        // 3. Smart Join: Send Cached Header if available
+        // 3. Smart Join: Queue Cached Header if available
         // Find latest generation (max key)
-        if (!cached_configs_.empty()) {
-            auto latest_gen = cached_configs_.rbegin()->first;
-
-            // Send Config
-            const auto& config_pkt = cached_configs_.rbegin()->second;
-            // Check if we have IDR for this gen
-            auto idr_it = cached_idrs_.find(latest_gen);
-
-            // Dispatch logic:
-            // We can directly call send_fn here since we are inside subscribe
-            // and assume it's thread-safe to call from here (blocking the bus lock briefly).
-            // In high-perf, queue these. For Phase 1: Direct Send.
-
-            // Re-enforce VideoPacket const-correctness by copying content or passing packet
-            // BUT: send_fn takes vector<uint8_t>.
-            // We need to Serialize Packet -> Bytes?
-            // Architecture Note: The Bus manages VideoPackets. The Callback usually adapter to Bytes.
-            // Let's assume the HAL/Streamer produces VideoPacket where 'data' IS the payload to send.
-
-            if (config_pkt.data) new_sub->send_fn(*config_pkt.data);
-            if (idr_it != cached_idrs_.end() && idr_it->second.data) {
-                new_sub->send_fn(*idr_it->second.data);
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            if (!cached_configs_.empty()) {
+                auto latest_gen = cached_configs_.rbegin()->first;
+                const auto& config_pkt = cached_configs_.rbegin()->second;
+                // Check if we have IDR for this gen
+                auto idr_it = cached_idrs_.find(latest_gen);
+
+                if (config_pkt.data) new_sub->queue.push_back(config_pkt);
+                if (idr_it != cached_idrs_.end() && idr_it->second.data) {
+                    new_sub->queue.push_back(idr_it->second);
+                }
+            }
+        }
+        new_sub->stats.queue_depth = new_sub->queue.size();
+        new_sub->drainer = std::thread(&BroadcastBus::drain, new_sub);
+
+        std::shared_ptr<Subscriber> replaced;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto next = std::make_shared<SubscriberList>();
+            next->reserve(subscribers_->size() + 1);
+
+            // Remove existing if any (prevent duplicates)
+            for (const auto& s : *subscribers_) {
+                if (s->id == client_id) replaced = s;
+                else next->push_back(s);
             }
+            next->push_back(new_sub);
+            std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberList>(std::move(next)));
         }
+        if (replaced) stop_subscriber(replaced);
 
-        subscribers_.push_back(new_sub);
-        std::cout << "[BroadcastBus] Client " << client_id << " subscribed." << std::endl;
+        std::cout << "[BroadcastBus] Client " << describe(client_id) << " subscribed." << std::endl;
     }
 
-    void BroadcastBus::unsubscribe(uint32_t client_id) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = std::remove_if(subscribers_.begin(), subscribers_.end(),
-            [client_id](const std::shared_ptr<Subscriber>& s){ return s->id == client_id; });
-        if (it != subscribers_.end()) {
-             subscribers_.erase(it, subscribers_.end());
-             std::cout << "[BroadcastBus] Client " << client_id << " unsubscribed." << std::endl;
+    void BroadcastBus::unsubscribe(SubscriberId client_id) {
+        std::shared_ptr<Subscriber> removed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto next = std::make_shared<SubscriberList>();
+            for (const auto& s : *subscribers_) {
+                if (s->id == client_id) removed = s;
+                else next->push_back(s);
+            }
+            if (!removed) return;
+            std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberList>(std::move(next)));
         }
+
+        // Outside the bus lock: the drainer may be inside send_fn
+        stop_subscriber(removed);
+        std::cout << "[BroadcastBus] Client " << describe(client_id) << " unsubscribed. Dropped: "
+                  << removed->stats.dropped_frames << ", force clears: " << removed->stats.force_clears << std::endl;
     }
 
-    void BroadcastBus::dispatch_to_subscriber(const std::shared_ptr<Subscriber>& sub, const common::VideoPacket& pkt) {
-        // Backpressure Logic
-        // For Phase 1: We simulate "Bound" by checking if previous send is done?
-        // Actually, 'send_fn' in current legacy backend is BLOCKING (socket send).
-        // This is dangerous.
-        // CORRECT FIX: The Subscriber struct has a 'queue'.
-        // We push to queue.
-        // AND we need a Worker/Thread to drain it.
-        // But since we don't have an async IoContext set up yet in this Phase 1 skeleton,
-        // we will implement the "Drop Policy" but then call send_fn directly (Blocking).
-        // REAL FIX LATER: 'send_fn' should be async / non-blocking.
-
-        // Simulation of Drop Policy:
-        if (sub->queue.size() >= sub->max_queue_size) {
-            bool drop = true;
-
-            if (pkt.kind == common::PacketKind::KeyFrame) {
-                // Priority: Drop others, keep KeyFrame
-                sub->queue.clear();
-                sub->stats.force_clears++;
-                drop = false;
-            } else if (pkt.kind == common::PacketKind::CodecConfig) {
-                sub->queue.clear();
-                drop = false;
+    size_t BroadcastBus::unsubscribe_group(uint32_t group) {
+        std::vector<std::shared_ptr<Subscriber>> removed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto next = std::make_shared<SubscriberList>();
+            for (const auto& s : *subscribers_) {
+                if ((s->id >> 32) == group) removed.push_back(s);
+                else next->push_back(s);
             }
+            if (removed.empty()) return 0;
+            std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberList>(std::move(next)));
+        }
+
+        for (const auto& sub : removed) stop_subscriber(sub);
+        std::cout << "[BroadcastBus] Group " << group << " unsubscribed (" << removed.size() << " clients)." << std::endl;
+        return removed.size();
+    }
 
-            if (drop) {
-                sub->stats.dropped_frames++;
-                // If drop threshold exceeded -> unsubscribe (not implemented here safely inside loop)
+    common::Result<SubscriberStats> BroadcastBus::get_stats(SubscriberId client_id) const {
+        auto subs = snapshot();
+        for (const auto& sub : *subs) {
+            if (sub->id == client_id) {
+                std::lock_guard<std::mutex> lock(sub->mutex);
+                SubscriberStats stats = sub->stats;
+                stats.queue_depth = sub->queue.size();
+                return common::Result<SubscriberStats>::ok(stats);
+            }
+        }
+        return common::Result<SubscriberStats>::err(
+            common::ErrorCode::DeviceNotFound, "Client " + describe(client_id) + " is not subscribed");
+    }
+
+    size_t BroadcastBus::subscriber_count() const {
+        return snapshot()->size();
+    }
+
+    void BroadcastBus::enqueue(Subscriber& sub, const common::VideoPacket& pkt) {
+        if (!pkt.data) return;
+
+        {
+            std::lock_guard<std::mutex> lock(sub.mutex);
+            if (sub.stopping) return;
+
+            bool is_sync_point = pkt.kind == common::PacketKind::KeyFrame ||
+                                 pkt.kind == common::PacketKind::CodecConfig;
+
+            // InterFrames after a drop reference a missing frame: skip to next KeyFrame
+            if (sub.awaiting_keyframe && !is_sync_point) {
+                sub.stats.dropped_frames++;
                 return;
             }
+
+            if (sub.queue.size() >= sub.max_queue_size) {
+                if (!is_sync_point) {
+                    sub.stats.dropped_frames++;
+                    sub.awaiting_keyframe = true;
+                    return;
+                }
+                // Priority: Drop others, keep KeyFrame/Config
+                sub.stats.dropped_frames += sub.queue.size();
+                sub.queue.clear();
+                sub.stats.force_clears++;
+            }
+
+            if (pkt.kind == common::PacketKind::KeyFrame) sub.awaiting_keyframe = false;
+            sub.queue.push_back(pkt);
         }
+        sub.cv.notify_one();
+    }
+
+    void BroadcastBus::drain(std::shared_ptr<Subscriber> sub) {
+        std::unique_lock<std::mutex> lock(sub->mutex);
+        while (true) {
+            sub->cv.wait(lock, [&]() { return sub->stopping || !sub->queue.empty(); });
+            if (sub->stopping) break;
+
+            common::VideoPacket pkt = std::move(sub->queue.front());
+            sub->queue.pop_front();
 
-        // Just push to queue (conceptually)
-        // sub->queue.push_back(pkt);
+            lock.unlock();
+            sub->send_fn(pkt);
+            lock.lock();
 
-        // Immediate Send (Legacy Mode Compatibility):
-        // If we really want to support blocking socket send without killing encoder,
-        // we MUST have a thread per subscriber or async IO.
-        // For this Skeleton, we assume 'send_fn' is fast enough or client is fast.
-        if (pkt.data) sub->send_fn(*pkt.data);
+            sub->stats.delivered_frames++;
+        }
+    }
+
+    void BroadcastBus::stop_subscriber(const std::shared_ptr<Subscriber>& sub) {
+        {
+            std::lock_guard<std::mutex> lock(sub->mutex);
+            sub->stopping = true;
+            sub->queue.clear();
+        }
+        sub->cv.notify_all();
+
+        if (!sub->drainer.joinable()) return;
+        if (sub->drainer.get_id() == std::this_thread::get_id()) {
+            sub->drainer.detach(); // Unsubscribed from inside send_fn
+        } else {
+            sub->drainer.join();
+        }
     }
 
 } // namespace core
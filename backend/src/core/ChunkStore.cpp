@@ -0,0 +1,338 @@
+#include "core/ChunkStore.hpp"
+#include "common/Sha256.hpp"
+#include <cstdlib>
+#include <iostream>
+
+namespace core {
+
+#ifdef _WIN32
+    static constexpr char SEP = '\\';
+#else
+    static constexpr char SEP = '/';
+#endif
+
+    ChunkStore::ChunkStore(interfaces::IFileTransfer& transfer, std::string root, uint64_t max_bytes)
+        : transfer_(transfer), root_(std::move(root)), max_bytes_(max_bytes) {}
+
+    ChunkStore::~ChunkStore() {
+        auto result = save(true);
+        if (result.is_err()) {
+            std::cerr << "[ChunkStore] " << result.error().message << std::endl;
+        }
+    }
+
+    std::string ChunkStore::default_root() {
+#ifdef _WIN32
+        const char* base = std::getenv("LOCALAPPDATA");
+        if (!base || !*base) return "chunks";
+        return std::string(base) + "\\CafeAgent\\chunks";
+#else
+        const char* xdg = std::getenv("XDG_CACHE_HOME");
+        if (xdg && *xdg) return std::string(xdg) + "/CafeAgent/chunks";
+        const char* home = std::getenv("HOME");
+        if (!home || !*home) return "chunks";
+        return std::string(home) + "/.cache/CafeAgent/chunks";
+#endif
+    }
+
+    bool ChunkStore::valid_key(const std::string& key) {
+        if (key.size() != 64) return false;
+        for (char c : key) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+        }
+        return true;
+    }
+
+    std::string ChunkStore::chunk_dir(const std::string& key) const {
+        return root_ + SEP + key.substr(0, 2);
+    }
+
+    std::string ChunkStore::chunk_path(const std::string& key) const {
+        return chunk_dir(key) + SEP + key;
+    }
+
+    std::string ChunkStore::index_path() const {
+        return root_ + SEP + "index";
+    }
+
+    // ============================================================================
+    // Uploads
+    // ============================================================================
+
+    bool ChunkStore::plan(const std::string& upload, uint64_t offset, const std::string& key, uint64_t length) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        load_locked();
+
+        bool present = false;
+        auto it = index_.find(key);
+        if (it != index_.end() && it->second->size == length) {
+            it->second->pins++;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            present = true;
+            stats_.hits++;
+            dirty_ = true;
+        } else {
+            stats_.misses++;
+        }
+        plans_[upload].chunks.push_back(Planned{offset, key, length, present});
+        return present;
+    }
+
+    common::Result<uint64_t> ChunkStore::assemble(const std::string& upload) {
+        std::vector<Planned> present;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = plans_.find(upload);
+            if (it == plans_.end() || it->second.assembled) return uint64_t(0);
+            for (const auto& c : it->second.chunks) {
+                if (c.present) present.push_back(c);
+            }
+        }
+
+        // Pinned: no eviction can delete these files meanwhile
+        uint64_t copied = 0;
+        for (const auto& c : present) {
+            auto result = transfer_.upload_copy_from(upload, c.offset, chunk_path(c.key), 0, c.length);
+            if (result.is_err()) {
+                return common::Result<uint64_t>::err(result.error().code,
+                                                     "Chunk " + c.key + " unusable: " + result.error().message);
+            }
+            copied += c.length;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = plans_.find(upload);
+        if (it != plans_.end() && !it->second.assembled) {
+            unpin_locked(it->second);
+            it->second.assembled = true;
+        }
+        stats_.reused_bytes += copied;
+        return copied;
+    }
+
+    uint64_t ChunkStore::absorb(const std::string& upload) {
+        std::vector<Planned> missing;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = plans_.find(upload);
+            if (it == plans_.end()) return 0;
+            if (!it->second.assembled) unpin_locked(it->second);
+            for (const auto& c : it->second.chunks) {
+                if (!c.present) missing.push_back(c);
+            }
+            plans_.erase(it);
+        }
+        if (root_.empty()) return 0;
+
+        uint64_t stored = 0;
+        std::vector<uint8_t> data;
+        for (const auto& c : missing) {
+            if (contains(c.key)) continue;  // Repeated within the file
+            data.clear();
+            data.reserve(static_cast<size_t>(c.length));
+            auto read = transfer_.download_file(upload, [&](const uint8_t* bytes, size_t n, bool) {
+                data.insert(data.end(), bytes, bytes + n);
+            }, nullptr, interfaces::ByteRange{c.offset, c.length});
+            if (read.is_err() || data.size() != c.length) continue;
+            auto result = put(c.key, data.data(), data.size());
+            if (result.is_ok()) {
+                stored++;
+            } else {
+                std::cerr << "[ChunkStore] " << result.error().message << std::endl;
+            }
+        }
+        return stored;
+    }
+
+    void ChunkStore::release(const std::string& upload) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = plans_.find(upload);
+        if (it == plans_.end()) return;
+        if (!it->second.assembled) unpin_locked(it->second);
+        plans_.erase(it);
+    }
+
+    void ChunkStore::unpin_locked(const UploadPlan& plan) {
+        for (const auto& c : plan.chunks) {
+            if (!c.present) continue;
+            auto it = index_.find(c.key);
+            if (it != index_.end() && it->second->pins > 0) it->second->pins--;
+        }
+    }
+
+    // ============================================================================
+    // Chunks
+    // ============================================================================
+
+    bool ChunkStore::contains(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        load_locked();
+        return index_.count(key) != 0;
+    }
+
+    common::EmptyResult ChunkStore::put(const std::string& key, const uint8_t* data, size_t size) {
+        if (root_.empty()) return common::EmptyResult::success();
+        if (common::checksum::sha256_hex(data, size) != key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.rejected++;
+            return common::EmptyResult::err(common::ErrorCode::Unknown, "Chunk content does not match " + key);
+        }
+
+        std::string temp;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            load_locked();
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return common::EmptyResult::success();
+            }
+            temp = chunk_path(key) + ".tmp." + std::to_string(temp_sequence_++);
+        }
+
+        // Written under a temporary name: a chunk file is always complete
+        transfer_.create_directory(chunk_dir(key));
+        auto written = write_file(temp, data, size);
+        if (written.is_ok()) written = transfer_.rename(temp, chunk_path(key));
+        if (written.is_err()) {
+            transfer_.delete_path(temp);
+            return written;
+        }
+
+        std::vector<std::string> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (index_.count(key) == 0) {  // Unless a concurrent put won
+                lru_.push_front(Entry{key, size, 0});
+                index_[key] = lru_.begin();
+                bytes_ += size;
+                stats_.stored++;
+                dirty_ = true;
+                victims = evict_locked();
+            }
+        }
+        remove_files(victims);
+        return common::EmptyResult::success();
+    }
+
+    std::vector<std::string> ChunkStore::evict_locked() {
+        std::vector<std::string> victims;
+        auto it = lru_.end();
+        while (bytes_ > max_bytes_ && it != lru_.begin()) {
+            --it;
+            if (it->pins > 0) continue;
+            victims.push_back(it->key);
+            bytes_ -= it->size;
+            index_.erase(it->key);
+            it = lru_.erase(it);
+            stats_.evicted++;
+            dirty_ = true;
+        }
+        return victims;
+    }
+
+    void ChunkStore::remove_files(const std::vector<std::string>& keys) {
+        for (const auto& key : keys) transfer_.delete_path(chunk_path(key));
+    }
+
+    common::EmptyResult ChunkStore::write_file(const std::string& path, const uint8_t* data, size_t size) {
+        auto result = transfer_.upload_start(path, size);
+        if (result.is_ok() && size > 0) result = transfer_.upload_write_at(path, 0, data, size);
+        if (result.is_ok()) return transfer_.upload_finish(path);
+        transfer_.upload_cancel(path);
+        return result;
+    }
+
+    // ============================================================================
+    // Index: one key per line, most recently used first
+    // ============================================================================
+
+    void ChunkStore::load_locked() {
+        if (loaded_) return;
+        loaded_ = true;
+        last_save_ = std::chrono::steady_clock::now();
+        if (root_.empty()) return;
+
+        auto top = transfer_.list_directory(root_);
+        if (top.is_err()) return;  // Nothing stored yet
+
+        std::unordered_map<std::string, uint64_t> found;
+        for (const auto& dir : top.unwrap()) {
+            if (!dir.is_directory || dir.name.size() != 2) continue;
+            auto files = transfer_.list_directory(dir.path);
+            if (files.is_err()) continue;
+            for (const auto& f : files.unwrap()) {
+                if (f.is_directory) continue;
+                if (valid_key(f.name) && f.name.compare(0, 2, dir.name) == 0) {
+                    found[f.name] = f.size;
+                } else if (f.name.find(".tmp.") != std::string::npos) {
+                    transfer_.delete_path(f.path);  // Interrupted write
+                }
+            }
+        }
+
+        std::string text;
+        transfer_.download_file(index_path(), [&](const uint8_t* data, size_t n, bool) {
+            text.append(reinterpret_cast<const char*>(data), n);
+        });
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos) end = text.size();
+            std::string key = text.substr(pos, end - pos);
+            pos = end + 1;
+            auto it = found.find(key);
+            if (it == found.end()) continue;  // Deleted meanwhile, or malformed
+            lru_.push_back(Entry{key, it->second, 0});
+            found.erase(it);
+        }
+        // Files the index does not know (written after its last save): oldest
+        for (const auto& [key, size] : found) lru_.push_back(Entry{key, size, 0});
+
+        for (auto it = lru_.begin(); it != lru_.end(); ++it) {
+            index_[it->key] = it;
+            bytes_ += it->size;
+        }
+        remove_files(evict_locked());  // The limit may have shrunk
+    }
+
+    common::EmptyResult ChunkStore::save(bool force) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dirty_ || root_.empty()) return common::EmptyResult::success();
+        if (!force && std::chrono::steady_clock::now() - last_save_ < SAVE_INTERVAL) {
+            return common::EmptyResult::success();
+        }
+
+        std::string text;
+        text.reserve(lru_.size() * 65);
+        for (const auto& e : lru_) {
+            text += e.key;
+            text += '\n';
+        }
+
+        // Temporary file renamed over the index: a crash leaves the old one
+        std::string temp = index_path() + ".tmp";
+        auto result = write_file(temp, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+        if (result.is_ok() && transfer_.rename(temp, index_path()).is_err()) {
+            transfer_.delete_path(index_path());  // Platforms whose rename does not replace
+            result = transfer_.rename(temp, index_path());
+        }
+        if (result.is_err()) {
+            transfer_.delete_path(temp);
+            return common::EmptyResult::err(common::ErrorCode::Unknown,
+                                            "Cannot write chunk index: " + result.error().message);
+        }
+        dirty_ = false;
+        last_save_ = std::chrono::steady_clock::now();
+        return common::EmptyResult::success();
+    }
+
+    ChunkStore::Stats ChunkStore::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s = stats_;
+        s.chunks = lru_.size();
+        s.bytes = bytes_;
+        return s;
+    }
+
+} // namespace core
@@ -117,6 +117,10 @@ common::EmptyResult CommandDispatcher::dispatch(
     return common::EmptyResult::success();
 }
 
+void CommandDispatcher::client_disconnected(uint64_t client_id) {
+    for (auto& handler : handlers_) handler->on_client_disconnected(client_id);
+}
+
 // ============================================================================
 // Statistics
 // ============================================================================
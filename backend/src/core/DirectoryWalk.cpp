@@ -0,0 +1,62 @@
+#include "core/DirectoryWalk.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace core {
+
+    static std::string identity(const interfaces::FileInfo& dir) {
+        return dir.inode ? std::to_string(dir.device) + ":" + std::to_string(dir.inode) : dir.path;
+    }
+
+    common::Result<TreeListing> walk_tree(interfaces::IFileTransfer& transfer, const std::string& root,
+                                          common::CancellationToken cancel) {
+        auto root_info = transfer.get_file_info(root);
+        if (root_info.is_err()) return root_info.error();
+        if (!root_info.unwrap().is_directory) {
+            return common::Result<TreeListing>::err(common::ErrorCode::Unknown, "Not a directory: " + root);
+        }
+
+        TreeListing out;
+        std::unordered_set<std::string> seen{identity(root_info.unwrap())};
+        std::vector<std::string> pending{root};
+
+        while (!pending.empty()) {
+            if (cancel.is_cancellation_requested()) {
+                return common::Result<TreeListing>::err(common::ErrorCode::Cancelled, "Walk cancelled: " + root);
+            }
+            std::string dir = std::move(pending.back());
+            pending.pop_back();
+
+            auto listing = transfer.list_directory(dir);
+            if (listing.is_err()) {
+                if (dir == root) return listing.error();
+                out.errors++;
+                continue;
+            }
+
+            // Subdirectories go on the stack in reverse, so they are walked in listing order
+            size_t first_subdir = pending.size();
+            for (const auto& f : listing.unwrap()) {
+                if (f.name == "." || f.name == "..") continue;
+                if (f.is_directory) {
+                    if (!seen.insert(identity(f)).second) continue;
+                    pending.push_back(f.path);
+                } else {
+                    out.files++;
+                    out.bytes += f.size;
+                }
+                out.entries.push_back(f);
+            }
+            std::reverse(pending.begin() + first_subdir, pending.end());
+        }
+        return out;
+    }
+
+    std::string relative_path(const std::string& root, const std::string& path) {
+        std::string rel = path.compare(0, root.size(), root) == 0 ? path.substr(root.size()) : path;
+        std::replace(rel.begin(), rel.end(), '\\', '/');
+        rel.erase(0, rel.find_first_not_of('/'));
+        return rel;
+    }
+
+} // namespace core
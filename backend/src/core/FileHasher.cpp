@@ -0,0 +1,281 @@
+#include "core/FileHasher.hpp"
+#include "common/Checksum.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace core {
+
+    using interfaces::FILE_TRANSFER_CHUNK_SIZE;
+
+    const char* hash_algorithm_name(HashAlgorithm algo) {
+        switch (algo) {
+            case HashAlgorithm::Xxh64Tree: return "xxh64";
+            case HashAlgorithm::Crc32c: return "crc32c";
+        }
+        return "unknown";
+    }
+
+    bool parse_hash_algorithm(const std::string& name, HashAlgorithm& out) {
+        for (auto algo : {HashAlgorithm::Xxh64Tree, HashAlgorithm::Crc32c}) {
+            if (name == hash_algorithm_name(algo)) {
+                out = algo;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string format_digest(HashAlgorithm algo, uint64_t digest) {
+        std::string hex = common::checksum::to_hex(digest);
+        return algo == HashAlgorithm::Crc32c ? hex.substr(8) : hex;
+    }
+
+    FileHasher::FileHasher(interfaces::IFileTransfer& transfer, ParallelTransfer& parallel, std::string cache_path)
+        : transfer_(transfer), parallel_(parallel), cache_path_(std::move(cache_path)) {}
+
+    FileHasher::~FileHasher() {
+        auto result = save(true);
+        if (result.is_err()) {
+            std::cerr << "[FileHasher] " << result.error().message << std::endl;
+        }
+    }
+
+    std::string FileHasher::default_cache_path() {
+#ifdef _WIN32
+        const char* base = std::getenv("LOCALAPPDATA");
+        if (!base || !*base) return "file_hash.cache";
+        return std::string(base) + "\\CafeAgent\\file_hash.cache";
+#else
+        const char* xdg = std::getenv("XDG_CACHE_HOME");
+        if (xdg && *xdg) return std::string(xdg) + "/CafeAgent/file_hash.cache";
+        const char* home = std::getenv("HOME");
+        if (!home || !*home) return "file_hash.cache";
+        return std::string(home) + "/.cache/CafeAgent/file_hash.cache";
+#endif
+    }
+
+    std::string FileHasher::cache_key(const interfaces::FileInfo& info, HashAlgorithm algo) {
+        std::string key = hash_algorithm_name(algo);
+        if (info.inode != 0) {
+            key += "|" + std::to_string(info.device) + "|" + std::to_string(info.inode);
+        } else {
+            key += "|" + info.path;
+        }
+        return key + "|" + std::to_string(info.size) + "|" + std::to_string(info.modified_time);
+    }
+
+    common::Result<FileHasher::FileHash> FileHasher::hash(const std::string& path, HashAlgorithm algo,
+                                                          ProgressFn on_progress, common::CancellationToken cancel) {
+        auto info = transfer_.get_file_info(path);
+        if (info.is_err()) return info.error();
+        return hash(info.unwrap(), algo, std::move(on_progress), std::move(cancel));
+    }
+
+    common::Result<FileHasher::FileHash> FileHasher::hash(const interfaces::FileInfo& info, HashAlgorithm algo,
+                                                          ProgressFn on_progress, common::CancellationToken cancel) {
+        if (info.is_directory) {
+            return common::Result<FileHash>::err(common::ErrorCode::Unknown, "Is a directory: " + info.path);
+        }
+
+        // Newlines would break the cache file's line format
+        std::string key = cache_key(info, algo);
+        bool cacheable = key.find('\n') == std::string::npos;
+
+        if (cacheable) {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            load_locked();
+            auto it = cache_.find(key);
+            if (it != cache_.end()) {
+                it->second.used = clock_++;
+                hits_++;
+                return FileHash{it->second.digest, info.size, true};
+            }
+            misses_++;
+        }
+
+        auto digest = compute(info, algo, on_progress, cancel);
+        if (digest.is_err()) return digest.error();
+
+        // The file must not have changed while it was read
+        auto after = transfer_.get_file_info(info.path);
+        if (after.is_err()) return after.error();
+        if (after.unwrap().size != info.size || after.unwrap().modified_time != info.modified_time) {
+            return common::Result<FileHash>::err(common::ErrorCode::Busy, "File changed while hashing: " + info.path);
+        }
+
+        uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+        if (cacheable && info.modified_time + RACY_SECONDS <= now) {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            cache_[key] = Entry{digest.unwrap(), clock_++};
+            dirty_ = true;
+        }
+        return FileHash{digest.unwrap(), info.size, false};
+    }
+
+    common::Result<uint64_t> FileHasher::compute(const interfaces::FileInfo& info, HashAlgorithm algo,
+                                                 ProgressFn& on_progress, common::CancellationToken& cancel) {
+        const uint64_t size = info.size;
+        const uint64_t block_count = (size + FILE_TRANSFER_CHUNK_SIZE - 1) / FILE_TRANSFER_CHUNK_SIZE;
+
+        // Stripes deliver whole blocks (the last one may be short), so each
+        // read thread hashes its own blocks into a distinct slot, lock-free
+        std::vector<uint64_t> blocks(block_count);
+        std::atomic<uint64_t> hashed{0};
+        std::atomic<bool> irregular{false};
+        std::mutex progress_mutex;
+
+        if (size > 0) {
+            auto result = parallel_.read(info.path, interfaces::ByteRange{0, size},
+                [&](uint64_t offset, const uint8_t* data, size_t len, bool) {
+                    bool whole_block = offset % FILE_TRANSFER_CHUNK_SIZE == 0 &&
+                                       (len == FILE_TRANSFER_CHUNK_SIZE || offset + len == size);
+                    if (!whole_block) {
+                        irregular.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    blocks[offset / FILE_TRANSFER_CHUNK_SIZE] = algo == HashAlgorithm::Crc32c
+                        ? common::checksum::crc32c(data, len)
+                        : common::checksum::xxh64(data, len);
+
+                    uint64_t done = hashed.fetch_add(len) + len;
+                    if (on_progress) {
+                        std::lock_guard<std::mutex> lock(progress_mutex);
+                        on_progress(done, size);
+                    }
+                },
+                cancel);
+            if (result.is_err()) return result.error();
+        }
+
+        // A short read split a block: hash the file again on one stream
+        if (irregular.load() || hashed.load() != size) {
+            if (hashed.load() < size && !irregular.load()) {
+                return common::Result<uint64_t>::err(common::ErrorCode::Busy, "File changed while hashing: " + info.path);
+            }
+            return compute_sequential(info, algo);
+        }
+
+        if (algo == HashAlgorithm::Crc32c) {
+            uint32_t crc = 0;
+            for (uint64_t i = 0; i < block_count; ++i) {
+                uint64_t len = (std::min)(uint64_t(FILE_TRANSFER_CHUNK_SIZE), size - i * FILE_TRANSFER_CHUNK_SIZE);
+                crc = common::checksum::crc32c_combine(crc, static_cast<uint32_t>(blocks[i]), len);
+            }
+            return uint64_t(crc);
+        }
+
+        common::checksum::ChunkDigest digest(FILE_TRANSFER_CHUNK_SIZE);
+        for (uint64_t i = 0; i < block_count; ++i) digest.set_block(i, blocks[i]);
+        return digest.finish(size);
+    }
+
+    common::Result<uint64_t> FileHasher::compute_sequential(const interfaces::FileInfo& info, HashAlgorithm algo) {
+        if (algo == HashAlgorithm::Crc32c) {
+            uint32_t crc = 0;
+            auto result = transfer_.download_file(info.path, [&](const uint8_t* data, size_t size, bool) {
+                crc = common::checksum::crc32c(data, size, crc);
+            });
+            if (result.is_err()) return result.error();
+            return uint64_t(crc);
+        }
+        return transfer_.file_digest(info.path);
+    }
+
+    FileHasher::Stats FileHasher::stats() const {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        Stats st;
+        st.hits = hits_;
+        st.misses = misses_;
+        st.entries = cache_.size();
+        return st;
+    }
+
+    // ============================================================================
+    // Cache file: one "digest-hex key" line per entry, least recently used first
+    // ============================================================================
+
+    void FileHasher::load_locked() {
+        if (loaded_) return;
+        loaded_ = true;
+        last_save_ = std::chrono::steady_clock::now();
+        if (cache_path_.empty()) return;
+
+        std::ifstream in(cache_path_);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t space = line.find(' ');
+            if (space != 16 || line.size() <= space + 1) continue;  // Malformed: skip
+            try {
+                uint64_t digest = std::stoull(line.substr(0, space), nullptr, 16);
+                cache_[line.substr(space + 1)] = Entry{digest, clock_++};
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+    }
+
+    common::EmptyResult FileHasher::save(bool force) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (!dirty_ || cache_path_.empty()) return common::EmptyResult::success();
+        if (!force && std::chrono::steady_clock::now() - last_save_ < SAVE_INTERVAL) {
+            return common::EmptyResult::success();
+        }
+        return write_locked();
+    }
+
+    common::EmptyResult FileHasher::write_locked() {
+        std::vector<std::pair<uint64_t, const std::pair<const std::string, Entry>*>> order;
+        order.reserve(cache_.size());
+        for (const auto& entry : cache_) order.emplace_back(entry.second.used, &entry);
+        std::sort(order.begin(), order.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        size_t skip = order.size() > MAX_CACHE_ENTRIES ? order.size() - MAX_CACHE_ENTRIES : 0;
+
+        // Write a temporary file and rename it over the cache, so a crash
+        // mid-write leaves the previous cache intact
+        std::error_code ec;
+        fs::path target(cache_path_);
+        if (target.has_parent_path()) fs::create_directories(target.parent_path(), ec);
+
+        std::string temp = cache_path_ + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            if (!out) {
+                return common::EmptyResult::err(common::ErrorCode::PermissionDenied,
+                                                "Cannot write hash cache: " + temp);
+            }
+            for (size_t i = skip; i < order.size(); ++i) {
+                out << common::checksum::to_hex(order[i].second->second.digest) << ' '
+                    << order[i].second->first << '\n';
+            }
+            if (!out.flush()) {
+                return common::EmptyResult::err(common::ErrorCode::Unknown, "Hash cache write failed: " + temp);
+            }
+        }
+
+        fs::rename(temp, target, ec);
+        if (ec) {
+            fs::remove(temp, ec);
+            return common::EmptyResult::err(common::ErrorCode::Unknown, "Cannot replace hash cache: " + cache_path_);
+        }
+
+        // Keep memory in line with the file
+        for (size_t i = 0; i < skip; ++i) {
+            std::string key = order[i].second->first;
+            cache_.erase(key);
+        }
+        dirty_ = false;
+        last_save_ = std::chrono::steady_clock::now();
+        return common::EmptyResult::success();
+    }
+
+} // namespace core
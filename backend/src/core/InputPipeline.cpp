@@ -0,0 +1,44 @@
+#include "core/InputPipeline.hpp"
+
+namespace core {
+
+    using interfaces::InputOp;
+
+    InputPipeline::InputPipeline(std::shared_ptr<interfaces::IInputInjector> injector)
+        : injector_(std::move(injector)) {
+        pending_.reserve(64); // Keeps steady-state pushes allocation-free
+    }
+
+    void InputPipeline::push(InputOp op) {
+        stats_.received++;
+        if (op.type == InputOp::Type::Move && !pending_.empty() &&
+            pending_.back().type == InputOp::Type::Move) {
+            pending_.back().x = op.x;
+            pending_.back().y = op.y;
+            stats_.coalesced++;
+            return;
+        }
+        pending_.push_back(std::move(op));
+    }
+
+    std::chrono::milliseconds InputPipeline::flush_delay(std::chrono::steady_clock::time_point now) const {
+        auto since = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_flush_);
+        if (since >= REFRESH_INTERVAL) return std::chrono::milliseconds(0);
+        return REFRESH_INTERVAL - since;
+    }
+
+    size_t InputPipeline::flush(std::chrono::steady_clock::time_point now) {
+        if (pending_.empty()) return 0;
+        last_flush_ = now;
+        stats_.flushes++;
+
+        size_t count = pending_.size();
+        if (injector_) {
+            injector_->inject_batch(pending_.data(), count); // One submission per refresh
+            stats_.injected += count;
+        }
+        pending_.clear();
+        return count;
+    }
+
+} // namespace core
@@ -0,0 +1,86 @@
+#include "core/InputProtocol.hpp"
+
+namespace core {
+namespace input {
+
+    using interfaces::InputOp;
+
+    static uint16_t read_u16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t read_u32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    static void write_u16(uint8_t* p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v >> 8);
+        p[1] = static_cast<uint8_t>(v);
+    }
+
+    static void write_u32(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    static float to_unit(int16_t v) {
+        if (v <= 0) return 0.0f;
+        return static_cast<float>(v) / COORD_MAX;
+    }
+
+    Record decode_record(const uint8_t* p) {
+        Record rec;
+        rec.op = static_cast<Op>(p[0]);
+        rec.flags = p[1];
+        rec.code = read_u16(p + 2);
+        rec.x = static_cast<int16_t>(read_u16(p + 4));
+        rec.y = static_cast<int16_t>(read_u16(p + 6));
+        rec.timestamp_ms = read_u32(p + 8);
+        return rec;
+    }
+
+    void encode_record(const Record& rec, uint8_t* p) {
+        p[0] = static_cast<uint8_t>(rec.op);
+        p[1] = rec.flags;
+        write_u16(p + 2, rec.code);
+        write_u16(p + 4, static_cast<uint16_t>(rec.x));
+        write_u16(p + 6, static_cast<uint16_t>(rec.y));
+        write_u32(p + 8, rec.timestamp_ms);
+    }
+
+    bool to_input_op(const Record& rec, InputOp& op) {
+        switch (rec.op) {
+            case Op::Move:
+                op.type = InputOp::Type::Move;
+                op.x = to_unit(rec.x);
+                op.y = to_unit(rec.y);
+                return true;
+            case Op::ButtonDown:
+            case Op::ButtonUp:
+                op.type = InputOp::Type::Button;
+                op.code = rec.code;
+                op.down = rec.op == Op::ButtonDown;
+                return true;
+            case Op::Click:
+                op.type = InputOp::Type::Click;
+                op.code = rec.code;
+                return true;
+            case Op::Scroll:
+                op.type = InputOp::Type::Scroll;
+                op.code = static_cast<int16_t>(rec.code);
+                return true;
+            case Op::KeyDown:
+            case Op::KeyUp:
+                op.type = InputOp::Type::Key;
+                op.code = rec.code;
+                op.down = rec.op == Op::KeyDown;
+                return true;
+        }
+        return false;
+    }
+
+} // namespace input
+} // namespace core
@@ -0,0 +1,352 @@
+#include "core/ListingCache.hpp"
+#include <algorithm>
+
+namespace core {
+
+    ListingCache::ListingCache(interfaces::IFileTransfer& transfer, uint64_t max_bytes, size_t max_directories)
+        : transfer_(transfer), max_bytes_(max_bytes), max_directories_(max_directories),
+          inbox_(std::make_shared<Inbox>()),
+          push_thread_([this]() { push_loop(); }) {}
+
+    ListingCache::~ListingCache() {
+        {
+            std::lock_guard<std::mutex> lock(inbox_->mutex);
+            inbox_->stop = true;
+        }
+        inbox_->cv.notify_all();
+        if (push_thread_.joinable()) push_thread_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [path, dir] : dirs_) transfer_.unwatch_directory(path);
+    }
+
+    // ============================================================================
+    // Listings
+    // ============================================================================
+
+    common::Result<ListingCache::Listing> ListingCache::list(const std::string& path, uint64_t* version) {
+        // Events of operations that already returned (an upload just
+        // finished, a file just deleted) are in the listing
+        transfer_.flush_directory_changes();
+        return fetch(path, version, true);
+    }
+
+    common::Result<ListingCache::Listing> ListingCache::fetch(const std::string& path, uint64_t* version, bool count) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = dirs_.find(path);
+            if (it != dirs_.end() && update_locked(path, it->second)) {
+                lru_.splice(lru_.begin(), lru_, it->second.lru);
+                if (count) stats_.hits++;
+                if (version) *version = it->second.version;
+                return it->second.listing;
+            }
+        }
+        return load(path, version);
+    }
+
+    common::Result<ListingCache::Listing> ListingCache::load(const std::string& path, uint64_t* version) {
+        if (version) *version = 0;
+        bool existed = false;
+        bool watched = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            existed = (dirs_.count(path) != 0);
+
+            // Watched before it is read: changes made meanwhile are applied on next use
+            std::weak_ptr<Inbox> weak = inbox_;
+            auto result = transfer_.watch_directory(path, [weak, path](const interfaces::DirectoryChange& change) {
+                auto inbox = weak.lock();
+                if (!inbox) return;
+                std::lock_guard<std::mutex> lock(inbox->mutex);
+                Pending& pending = inbox->pending[path];
+                if (!pending.stale) {
+                    if (change.name.empty() || pending.entries.size() >= MAX_PENDING) {
+                        pending.stale = true;
+                        pending.entries.clear();
+                    } else {
+                        pending.entries[change.name] = change.path;
+                    }
+                }
+                if (!inbox->wake && inbox->subscribed.count(path) != 0) {
+                    inbox->wake = true;
+                    inbox->cv.notify_all();
+                }
+            });
+
+            if (result.is_ok()) {
+                watched = true;
+                if (!existed) {
+                    lru_.push_front(path);
+                    dirs_[path].lru = lru_.begin();
+                }
+                dirs_[path].loading++;
+                std::lock_guard<std::mutex> inbox_lock(inbox_->mutex);
+                inbox_->pending.erase(path);  // Older than the read below
+            } else {
+                if (existed) erase_locked(path);
+                stats_.uncached++;
+            }
+        }
+
+        auto result = transfer_.list_directory(path);
+
+        // Subscribers of a listing that was cached: read again (or gone)
+        auto reset = [&]() {
+            if (!existed) return;
+            Delta delta;
+            delta.directory = path;
+            delta.version = ++version_;
+            delta.reset = true;
+            notify_locked(delta);
+        };
+
+        if (!watched) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reset();
+            if (result.is_err()) return result.error();
+            return Listing(std::make_shared<const std::vector<interfaces::FileInfo>>(result.unwrap()));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Directory& dir = dirs_[path];  // Not evicted while loading
+        dir.loading--;
+        drop_listing_locked(dir);
+
+        if (result.is_err()) {
+            if (dir.loading == 0) erase_locked(path);
+            reset();
+            return result.error();
+        }
+
+        auto entries = std::make_shared<std::vector<interfaces::FileInfo>>(result.unwrap());
+        dir.index.reserve(entries->size());
+        for (size_t i = 0; i < entries->size(); ++i) {
+            const auto& info = (*entries)[i];
+            dir.index[info.name] = i;
+            dir.bytes += entry_bytes(info);
+        }
+        dir.listing = entries;
+        bytes_ += dir.bytes;
+        lru_.splice(lru_.begin(), lru_, dir.lru);
+        if (existed) {
+            stats_.relisted++;
+        } else {
+            stats_.misses++;
+        }
+        reset();
+        dir.version = ++version_;
+        if (version) *version = dir.version;
+
+        if (dir.bytes > max_bytes_ && dir.loading == 0) {  // Larger than the whole cache
+            erase_locked(path);
+            stats_.uncached++;
+            if (version) *version = 0;
+        }
+        evict_locked();
+        return Listing(std::move(entries));
+    }
+
+    bool ListingCache::update_locked(const std::string& path, Directory& dir) {
+        if (!dir.listing) return false;
+
+        Pending pending;
+        {
+            std::lock_guard<std::mutex> lock(inbox_->mutex);
+            auto it = inbox_->pending.find(path);
+            if (it == inbox_->pending.end()) return true;
+            pending = std::move(it->second);
+            inbox_->pending.erase(it);
+        }
+        if (pending.stale) {
+            drop_listing_locked(dir);
+            return false;
+        }
+
+        // Readers hold their own reference: copy on write if there are any
+        // (new references are only handed out under mutex_)
+        std::shared_ptr<std::vector<interfaces::FileInfo>> entries;
+        if (dir.listing.use_count() == 1) {
+            entries = std::const_pointer_cast<std::vector<interfaces::FileInfo>>(dir.listing);
+        } else {
+            entries = std::make_shared<std::vector<interfaces::FileInfo>>(*dir.listing);
+        }
+
+        Delta delta;
+        delta.directory = path;
+        for (const auto& [name, entry_path] : pending.entries) {
+            stats_.patched++;
+            auto info = transfer_.get_file_info(entry_path);
+            auto pos = dir.index.find(name);
+            if (info.is_err()) {
+                if (pos == dir.index.end()) continue;
+                size_t i = pos->second;
+                size_t last = entries->size() - 1;
+                dir.bytes -= entry_bytes((*entries)[i]);
+                bytes_ -= entry_bytes((*entries)[i]);
+                if (i != last) {
+                    (*entries)[i] = std::move((*entries)[last]);
+                    dir.index[(*entries)[i].name] = i;
+                }
+                entries->pop_back();
+                dir.index.erase(name);
+                delta.removed.push_back(name);
+                continue;
+            }
+
+            const interfaces::FileInfo& fresh = info.unwrap();
+            if (pos != dir.index.end()) {
+                auto& current = (*entries)[pos->second];
+                if (same_entry(current, fresh)) continue;
+                dir.bytes -= entry_bytes(current);
+                bytes_ -= entry_bytes(current);
+                current = fresh;
+            } else {
+                dir.index[name] = entries->size();
+                entries->push_back(fresh);
+            }
+            dir.bytes += entry_bytes(fresh);
+            bytes_ += entry_bytes(fresh);
+            delta.changed.push_back(fresh);
+        }
+
+        dir.listing = std::move(entries);
+        if (!delta.changed.empty() || !delta.removed.empty()) {
+            dir.version = delta.version = ++version_;
+            notify_locked(delta);
+        }
+        return true;
+    }
+
+    void ListingCache::drop_listing_locked(Directory& dir) {
+        bytes_ -= dir.bytes;
+        dir.bytes = 0;
+        dir.index.clear();
+        dir.listing.reset();
+    }
+
+    void ListingCache::erase_locked(const std::string& path) {
+        auto it = dirs_.find(path);
+        if (it == dirs_.end()) return;
+        drop_listing_locked(it->second);
+        lru_.erase(it->second.lru);
+        dirs_.erase(it);
+        transfer_.unwatch_directory(path);
+
+        std::lock_guard<std::mutex> lock(inbox_->mutex);
+        inbox_->pending.erase(path);
+    }
+
+    void ListingCache::evict_locked() {
+        auto it = lru_.end();
+        while ((bytes_ > max_bytes_ || dirs_.size() > max_directories_) && it != lru_.begin()) {
+            --it;
+            const std::string& path = *it;
+            if (dirs_[path].loading > 0) continue;
+            if (std::any_of(subscribers_.begin(), subscribers_.end(),
+                            [&](const auto& s) { return s.second.path == path; })) {
+                continue;
+            }
+            auto next = std::next(it);
+            erase_locked(std::string(path));
+            it = next;
+            stats_.evicted++;
+        }
+    }
+
+    uint64_t ListingCache::entry_bytes(const interfaces::FileInfo& info) {
+        // The entry, its strings and its index node (which repeats the name)
+        return sizeof(interfaces::FileInfo) + info.name.capacity() + info.path.capacity() +
+               sizeof(std::string) + info.name.size() + 32;
+    }
+
+    bool ListingCache::same_entry(const interfaces::FileInfo& a, const interfaces::FileInfo& b) {
+        return a.size == b.size && a.modified_time == b.modified_time &&
+               a.is_directory == b.is_directory && a.is_hidden == b.is_hidden &&
+               a.is_readonly == b.is_readonly && a.inode == b.inode && a.device == b.device;
+    }
+
+    // ============================================================================
+    // Subscribers
+    // ============================================================================
+
+    void ListingCache::subscribe(uint64_t subscriber, const std::string& path, DeltaCallback on_delta) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> inbox_lock(inbox_->mutex);
+
+        auto release = [&](std::unordered_map<uint64_t, Subscriber>::iterator it) {
+            auto count = inbox_->subscribed.find(it->second.path);
+            if (count != inbox_->subscribed.end() && --count->second == 0) inbox_->subscribed.erase(count);
+            subscribers_.erase(it);
+        };
+
+        auto existing = subscribers_.find(subscriber);
+        if (existing != subscribers_.end()) release(existing);
+        if (subscribers_.size() >= MAX_SUBSCRIBERS) {
+            release(std::min_element(subscribers_.begin(), subscribers_.end(), [](const auto& a, const auto& b) {
+                return a.second.sequence < b.second.sequence;
+            }));
+        }
+
+        subscribers_[subscriber] = Subscriber{path, std::move(on_delta), ++subscriber_sequence_};
+        inbox_->subscribed[path]++;
+    }
+
+    void ListingCache::unsubscribe(uint64_t subscriber) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = subscribers_.find(subscriber);
+        if (it == subscribers_.end()) return;
+
+        std::lock_guard<std::mutex> inbox_lock(inbox_->mutex);
+        auto count = inbox_->subscribed.find(it->second.path);
+        if (count != inbox_->subscribed.end() && --count->second == 0) inbox_->subscribed.erase(count);
+        subscribers_.erase(it);
+    }
+
+    void ListingCache::notify_locked(const Delta& delta) {
+        for (const auto& [id, s] : subscribers_) {
+            if (s.path != delta.directory) continue;
+            s.on_delta(delta);
+            stats_.pushed++;
+        }
+    }
+
+    void ListingCache::push_loop() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(inbox_->mutex);
+                inbox_->cv.wait(lock, [&]() { return inbox_->wake || inbox_->stop; });
+                // A burst of events (a copy, an extraction) becomes one delta
+                inbox_->cv.wait_for(lock, PUSH_DELAY, [&]() { return inbox_->stop; });
+                if (inbox_->stop) return;
+                inbox_->wake = false;
+            }
+
+            std::vector<std::string> paths;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& [id, s] : subscribers_) {
+                    // Listed at least once: a subscriber's first listing comes from list()
+                    if (dirs_.count(s.path) != 0 &&
+                        std::find(paths.begin(), paths.end(), s.path) == paths.end()) {
+                        paths.push_back(s.path);
+                    }
+                }
+            }
+
+            for (const auto& path : paths) fetch(path, nullptr, false);
+        }
+    }
+
+    ListingCache::Stats ListingCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s = stats_;
+        s.directories = dirs_.size();
+        s.bytes = bytes_;
+        for (const auto& [path, dir] : dirs_) {
+            if (dir.listing) s.entries += dir.listing->size();
+        }
+        return s;
+    }
+
+} // namespace core
@@ -0,0 +1,132 @@
+#include "core/ListingOrder.hpp"
+#include "common/Base64.hpp"
+#include <algorithm>
+
+namespace core {
+
+    namespace {
+        int compare_names(const std::string& a, const std::string& b) {
+            size_t n = (std::min)(a.size(), b.size());
+            for (size_t i = 0; i < n; ++i) {
+                unsigned char ca = static_cast<unsigned char>(a[i]);
+                unsigned char cb = static_cast<unsigned char>(b[i]);
+                if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+                if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+                if (ca != cb) return ca < cb ? -1 : 1;
+            }
+            if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+            return a.compare(b);
+        }
+    }
+
+    bool ListingOrder::parse(const std::string& text, ListingOrder& order) {
+        ListingOrder parsed;
+        std::string key = text;
+        if (!key.empty() && key[0] == '-') {
+            parsed.descending = true;
+            key.erase(0, 1);
+        }
+        if (key == "name") {
+            parsed.key = Key::Name;
+        } else if (key == "size") {
+            parsed.key = Key::Size;
+        } else if (key == "mtime") {
+            parsed.key = Key::Modified;
+        } else {
+            return false;
+        }
+        order = parsed;
+        return true;
+    }
+
+    std::string ListingOrder::to_string() const {
+        const char* name = key == Key::Size ? "size" : key == Key::Modified ? "mtime" : "name";
+        return (descending ? "-" : "") + std::string(name);
+    }
+
+    uint64_t ListingOrder::key_of(const interfaces::FileInfo& info) const {
+        if (info.is_directory) return 0;
+        if (key == Key::Size) return info.size;
+        if (key == Key::Modified) return info.modified_time;
+        return 0;
+    }
+
+    bool ListingOrder::before(const interfaces::FileInfo& a, const interfaces::FileInfo& b) const {
+        if (a.is_directory != b.is_directory) return a.is_directory;
+
+        // Directories have no size or time of their own to sort by: by name,
+        // in the requested direction only when that is the key
+        uint64_t ka = key_of(a), kb = key_of(b);
+        if (ka != kb) return descending ? ka > kb : ka < kb;
+        int names = compare_names(a.name, b.name);
+        bool by_name = (key == Key::Name);
+        return (descending && by_name) ? names > 0 : names < 0;
+    }
+
+    std::vector<const interfaces::FileInfo*> ListingOrder::sort(const std::vector<interfaces::FileInfo>& entries) const {
+        std::vector<const interfaces::FileInfo*> sorted;
+        select(entries, "", sorted);
+        arrange(sorted, 0, sorted.size());
+        return sorted;
+    }
+
+    std::string ListingOrder::cursor(const interfaces::FileInfo& last) const {
+        std::string text = std::string(last.is_directory ? "d/" : "f/") + std::to_string(key_of(last)) + "/" +
+                           last.name;
+        return common::base64::encode(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+
+    bool ListingOrder::parse_cursor(const std::string& token, interfaces::FileInfo& probe) const {
+        // The decoder stops at junk: only an exact round trip is a cursor
+        auto bytes = common::base64::decode(token);
+        if (common::base64::encode(bytes.data(), bytes.size()) != token) return false;
+        std::string cursor(bytes.begin(), bytes.end());
+
+        size_t slash = cursor.find('/', 2);
+        if (cursor.size() < 4 || (cursor[0] != 'd' && cursor[0] != 'f') || cursor[1] != '/' ||
+            slash == std::string::npos || slash == 2 || slash > 22 || slash + 1 == cursor.size()) {
+            return false;
+        }
+        uint64_t number = 0;
+        for (size_t i = 2; i < slash; ++i) {
+            if (cursor[i] < '0' || cursor[i] > '9') return false;
+            number = number * 10 + static_cast<uint64_t>(cursor[i] - '0');
+        }
+
+        // An entry with the cursor's sort key (it may no longer exist)
+        probe = interfaces::FileInfo{};
+        probe.is_directory = (cursor[0] == 'd');
+        probe.name = cursor.substr(slash + 1);
+        if (!probe.is_directory) {
+            if (key == Key::Size) probe.size = number;
+            if (key == Key::Modified) probe.modified_time = number;
+        }
+        return true;
+    }
+
+    bool ListingOrder::select(const std::vector<interfaces::FileInfo>& entries, const std::string& cursor,
+                              std::vector<const interfaces::FileInfo*>& selected) const {
+        selected.clear();
+        interfaces::FileInfo probe{};
+        if (!cursor.empty() && !parse_cursor(cursor, probe)) return false;
+
+        selected.reserve(entries.size());
+        for (const auto& info : entries) {
+            if (cursor.empty() || before(probe, info)) selected.push_back(&info);
+        }
+        return true;
+    }
+
+    void ListingOrder::arrange(std::vector<const interfaces::FileInfo*>& selected, size_t from, size_t to) const {
+        auto less = [this](const interfaces::FileInfo* a, const interfaces::FileInfo* b) { return before(*a, *b); };
+        to = (std::min)(to, selected.size());
+        if (from >= to) return;
+        if (to == selected.size()) {
+            std::sort(selected.begin() + static_cast<long>(from), selected.end(), less);
+        } else {
+            std::partial_sort(selected.begin() + static_cast<long>(from), selected.begin() + static_cast<long>(to),
+                              selected.end(), less);
+        }
+    }
+
+} // namespace core
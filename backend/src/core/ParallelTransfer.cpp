@@ -0,0 +1,145 @@
+#include "core/ParallelTransfer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <vector>
+
+namespace core {
+
+    using interfaces::ByteRange;
+    using interfaces::FILE_TRANSFER_CHUNK_SIZE;
+
+    ParallelTransfer::ParallelTransfer(interfaces::IFileTransfer& transfer)
+        : ParallelTransfer(transfer, Config{}) {}
+
+    ParallelTransfer::ParallelTransfer(interfaces::IFileTransfer& transfer, Config config)
+        : transfer_(transfer),
+          config_(config),
+          pool_((std::max)(size_t(1), (std::min)(config.max_streams, MAX_STREAMS))) {
+        config_.max_streams = pool_.num_workers();
+    }
+
+    common::EmptyResult ParallelTransfer::read(const std::string& path, ByteRange range, ChunkFn on_chunk,
+                                               common::CancellationToken cancel) {
+        if (range.length < config_.min_parallel_bytes) {
+            return read_with(1, path, range, std::move(on_chunk), std::move(cancel));
+        }
+
+        size_t streams = next_streams();
+        auto start = std::chrono::steady_clock::now();
+        auto result = read_with(streams, path, range, std::move(on_chunk), std::move(cancel));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (result.is_ok()) record(streams, range.length, seconds);
+        return result;
+    }
+
+    common::EmptyResult ParallelTransfer::read_with(size_t streams, const std::string& path,
+                                                    ByteRange range, ChunkFn on_chunk,
+                                                    common::CancellationToken cancel) {
+        const uint64_t end = range.offset + range.length;
+        auto cancelled_result = [&]() {
+            return common::EmptyResult::err(common::ErrorCode::Cancelled, "Transfer cancelled: " + path);
+        };
+
+        // One stream: plain sequential read on the caller's thread
+        // (download_file cannot be interrupted: after a cancel the rest of
+        // the range is read but not delivered)
+        if (streams <= 1 || range.length == 0) {
+            uint64_t pos = range.offset;
+            auto result = transfer_.download_file(path,
+                [&](const uint8_t* data, size_t size, bool is_last) {
+                    if (cancel.is_cancellation_requested()) return;
+                    on_chunk(pos, data, size, is_last);
+                    pos += size;
+                }, nullptr, range);
+            return cancel.is_cancellation_requested() ? cancelled_result() : result;
+        }
+
+        // Stripes are whole runs of file-coordinate chunks, so every stripe
+        // produces exactly the chunks a sequential read would have
+        uint64_t first_chunk = range.offset / FILE_TRANSFER_CHUNK_SIZE;
+        uint64_t chunk_count = (end - 1) / FILE_TRANSFER_CHUNK_SIZE - first_chunk + 1;
+        streams = static_cast<size_t>((std::min)(uint64_t(streams), chunk_count));
+
+        std::mutex error_mutex;
+        common::EmptyResult first_error = common::EmptyResult::success();
+        std::atomic<bool> failed{false};
+
+        std::vector<std::future<void>> stripes;
+        stripes.reserve(streams);
+
+        for (size_t i = 0; i < streams; ++i) {
+            uint64_t begin_chunk = first_chunk + chunk_count * i / streams;
+            uint64_t end_chunk = first_chunk + chunk_count * (i + 1) / streams;
+            uint64_t stripe_begin = (std::max)(range.offset, begin_chunk * FILE_TRANSFER_CHUNK_SIZE);
+            uint64_t stripe_end = (std::min)(end, end_chunk * FILE_TRANSFER_CHUNK_SIZE);
+
+            stripes.push_back(pool_.submit([&, stripe_begin, stripe_end]() {
+                if (cancel.is_cancellation_requested()) return;
+                uint64_t pos = stripe_begin;
+                auto result = transfer_.download_file(path,
+                    [&](const uint8_t* data, size_t size, bool) {
+                        if (failed.load(std::memory_order_relaxed) || cancel.is_cancellation_requested()) return;
+                        on_chunk(pos, data, size, pos + size >= end);
+                        pos += size;
+                    }, nullptr, ByteRange{stripe_begin, stripe_end - stripe_begin});
+
+                if (result.is_err()) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!failed.exchange(true)) first_error = result;
+                }
+            }));
+        }
+
+        // Every stripe references this frame: wait for all of them, even after a failure
+        for (auto& stripe : stripes) {
+            try {
+                stripe.get();
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!failed.exchange(true)) {
+                    first_error = common::EmptyResult::err(common::ErrorCode::Unknown, e.what());
+                }
+            }
+        }
+
+        return cancel.is_cancellation_requested() ? cancelled_result() : first_error;
+    }
+
+    size_t ParallelTransfer::next_streams() const {
+        std::lock_guard<std::mutex> lock(tune_mutex_);
+        return pick_streams_locked();
+    }
+
+    double ParallelTransfer::measured_mbps(size_t streams) const {
+        std::lock_guard<std::mutex> lock(tune_mutex_);
+        return streams < mbps_.size() ? mbps_[streams] : 0.0;
+    }
+
+    size_t ParallelTransfer::pick_streams_locked() const {
+        size_t best = 1;
+        for (size_t n = 1; n <= config_.max_streams; n *= 2) {
+            if (mbps_[n] == 0.0) return n;  // Not measured yet: try it
+            if (n > 1 && mbps_[n] < mbps_[best] * (1.0 + MIN_GAIN)) break;
+            best = n;
+        }
+
+        // Periodically re-measure the next count up
+        if (measured_transfers_ % REPROBE_EVERY == 0 && best * 2 <= config_.max_streams) {
+            return best * 2;
+        }
+        return best;
+    }
+
+    void ParallelTransfer::record(size_t streams, uint64_t bytes, double seconds) {
+        if (seconds <= 0.0 || streams >= mbps_.size()) return;
+        double mbps = bytes / seconds / (1024.0 * 1024.0);
+
+        std::lock_guard<std::mutex> lock(tune_mutex_);
+        double& slot = mbps_[streams];
+        slot = slot == 0.0 ? mbps : slot * 0.5 + mbps * 0.5;
+        measured_transfers_++;
+    }
+
+} // namespace core
@@ -0,0 +1,204 @@
+#include "core/TransferScheduler.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace core {
+
+    // ============================================================================
+    // Transfer (flow window)
+    // ============================================================================
+
+    class TransferScheduler::Transfer::Lease : public interfaces::TransferLease {
+    public:
+        explicit Lease(Transfer& transfer) : transfer_(transfer) {}
+        ~Lease() override { transfer_.release_slot(); }
+        bool cancelled() const override { return transfer_.cancelled(); }
+
+    private:
+        Transfer& transfer_;  // Outlives its leases: wait_drained() runs before the job is retired
+    };
+
+    TransferScheduler::Transfer::Transfer(uint64_t id, uint64_t client_id, Priority priority, std::string label)
+        : id_(id), client_id_(client_id), priority_(priority), label_(std::move(label)),
+          token_(source_.get_token()) {}
+
+    std::shared_ptr<const interfaces::TransferLease> TransferScheduler::Transfer::acquire_lease() {
+        std::unique_lock<std::mutex> lock(flow_mutex_);
+        flow_cv_.wait(lock, [this]() { return cancelled() || in_flight_ < FLOW_WINDOW; });
+        if (cancelled()) return nullptr;
+        in_flight_++;
+        return std::make_shared<Lease>(*this);
+    }
+
+    void TransferScheduler::Transfer::cancel() {
+        source_.cancel();
+        std::lock_guard<std::mutex> lock(flow_mutex_);
+        flow_cv_.notify_all();
+    }
+
+    void TransferScheduler::Transfer::release_slot() {
+        std::lock_guard<std::mutex> lock(flow_mutex_);
+        in_flight_--;
+        flow_cv_.notify_all();
+    }
+
+    void TransferScheduler::Transfer::wait_drained() {
+        // Leases of a cancelled transfer are released as the writer discards
+        // its packets (or drops its queues on disconnect): wait for those too
+        std::unique_lock<std::mutex> lock(flow_mutex_);
+        flow_cv_.wait(lock, [this]() { return in_flight_ == 0; });
+    }
+
+    // ============================================================================
+    // TransferScheduler
+    // ============================================================================
+
+    TransferScheduler::TransferScheduler(size_t max_active)
+        : max_active_((std::max)(size_t(1), max_active)) {
+        for (size_t i = 0; i < max_active_; ++i) {
+            workers_.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    TransferScheduler::~TransferScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            for (auto& lane : lanes_) {
+                cancelled_ += lane.size;
+                lane = Lane{};
+            }
+            for (auto& entry : running_) entry.second->cancel();
+        }
+        cv_.notify_all();
+
+        for (auto& worker : workers_) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+    uint64_t TransferScheduler::submit(uint64_t client_id, Priority priority, std::string label, Job job) {
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) return 0;
+
+            id = next_id_++;
+            Lane& lane = lanes_[static_cast<size_t>(priority)];
+            auto& queue = lane.by_client[client_id];
+            if (queue.empty()) lane.rotation.push_back(client_id);
+            queue.push_back(Pending{
+                std::shared_ptr<Transfer>(new Transfer(id, client_id, priority, std::move(label))),
+                std::move(job)});
+            lane.size++;
+        }
+        cv_.notify_one();
+        return id;
+    }
+
+    size_t TransferScheduler::cancel(uint64_t client_id, Priority priority, const std::string& label) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = 0;
+
+        Lane& lane = lanes_[static_cast<size_t>(priority)];
+        auto it = lane.by_client.find(client_id);
+        if (it != lane.by_client.end()) {
+            auto& queue = it->second;
+            for (auto p = queue.begin(); p != queue.end();) {
+                if (label.empty() || p->transfer->label() == label) {
+                    p = queue.erase(p);
+                    lane.size--;
+                    count++;
+                } else {
+                    ++p;
+                }
+            }
+            if (queue.empty()) {
+                lane.by_client.erase(it);
+                lane.rotation.erase(std::remove(lane.rotation.begin(), lane.rotation.end(), client_id),
+                                    lane.rotation.end());
+            }
+        }
+        cancelled_ += count;
+
+        // Running jobs are counted as cancelled when they finish
+        for (auto& entry : running_) {
+            Transfer& t = *entry.second;
+            if (t.client_id() == client_id && t.priority_ == priority && !t.cancelled() &&
+                (label.empty() || t.label() == label)) {
+                t.cancel();
+                count++;
+            }
+        }
+        return count;
+    }
+
+    TransferScheduler::Stats TransferScheduler::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats st;
+        st.queued = lanes_[0].size + lanes_[1].size;
+        st.active = running_.size();
+        st.completed = completed_;
+        st.cancelled = cancelled_;
+        return st;
+    }
+
+    bool TransferScheduler::can_start_locked(Priority priority) const {
+        if (running_.size() >= max_active_) return false;
+        if (priority == Priority::Bulk && max_active_ > 1) return running_bulk_ < max_active_ - 1;
+        return true;
+    }
+
+    bool TransferScheduler::take_locked(Pending& out) {
+        for (size_t p = 0; p < lanes_.size(); ++p) {
+            Lane& lane = lanes_[p];
+            if (lane.size == 0 || !can_start_locked(static_cast<Priority>(p))) continue;
+
+            uint64_t client = lane.rotation.front();
+            lane.rotation.pop_front();
+            auto& queue = lane.by_client[client];
+            out = std::move(queue.front());
+            queue.pop_front();
+            lane.size--;
+
+            if (queue.empty()) lane.by_client.erase(client);
+            else lane.rotation.push_back(client);  // Back of the line
+            return true;
+        }
+        return false;
+    }
+
+    void TransferScheduler::worker_loop() {
+        while (true) {
+            Pending next;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() { return stop_ || take_locked(next); });
+                if (stop_ && !next.transfer) return;
+
+                running_[next.transfer->id()] = next.transfer;
+                if (next.transfer->priority_ == Priority::Bulk) running_bulk_++;
+            }
+
+            Transfer& t = *next.transfer;
+            try {
+                next.job(t);
+            } catch (const std::exception& e) {
+                std::cerr << "[TransferScheduler] Transfer " << t.id() << " (" << t.label()
+                          << ") failed: " << e.what() << std::endl;
+            }
+            t.wait_drained();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_.erase(t.id());
+                if (t.priority_ == Priority::Bulk) running_bulk_--;
+                if (t.cancelled()) cancelled_++;
+                else completed_++;
+            }
+            // A slot (and possibly a Bulk slot) freed up
+            cv_.notify_all();
+        }
+    }
+
+} // namespace core
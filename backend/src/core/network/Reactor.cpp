@@ -0,0 +1,288 @@
+#include "Reactor.hpp"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+    #include <errno.h>
+#elif defined(_WIN32)
+    #include <winsock2.h>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+namespace core {
+namespace network {
+
+    Reactor::Reactor() {
+        #ifdef __linux__
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epoll_fd_ < 0 || event_fd_ < 0) {
+                std::cerr << "[Reactor] epoll/eventfd setup failed: " << strerror(errno) << std::endl;
+                return;
+            }
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = event_fd_;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) < 0) return;
+        #else
+            // Wake-up socket: UDP bound to loopback and connected to itself
+            wake_sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+            if (!IS_VALID_SOCKET(wake_sock_)) return;
+
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if (bind(wake_sock_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+                getsockname(wake_sock_, (struct sockaddr*)&addr, &len) < 0 ||
+                connect(wake_sock_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+                std::cerr << "[Reactor] Wake-up socket setup failed" << std::endl;
+                return;
+            }
+            set_nonblocking(wake_sock_);
+        #endif
+        valid_ = true;
+    }
+
+    Reactor::~Reactor() {
+        #ifdef __linux__
+            if (event_fd_ >= 0) close(event_fd_);
+            if (epoll_fd_ >= 0) close(epoll_fd_);
+        #else
+            if (IS_VALID_SOCKET(wake_sock_)) CLOSE_SOCKET(wake_sock_);
+        #endif
+    }
+
+    bool Reactor::add(socket_t fd, uint32_t interest, IoHandler handler) {
+        #ifdef __linux__
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLET | EPOLLRDHUP;
+            if (interest & IO_READ) ev.events |= EPOLLIN;
+            if (interest & IO_WRITE) ev.events |= EPOLLOUT;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) return false;
+        #endif
+        watches_[fd] = Watch{interest, std::move(handler)};
+        return true;
+    }
+
+    bool Reactor::modify(socket_t fd, uint32_t interest) {
+        auto it = watches_.find(fd);
+        if (it == watches_.end()) return false;
+        if (it->second.interest == interest) return true;
+
+        #ifdef __linux__
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLET | EPOLLRDHUP;
+            if (interest & IO_READ) ev.events |= EPOLLIN;
+            if (interest & IO_WRITE) ev.events |= EPOLLOUT;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0) return false;
+        #endif
+        it->second.interest = interest;
+        return true;
+    }
+
+    void Reactor::remove(socket_t fd) {
+        #ifdef __linux__
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        #endif
+        watches_.erase(fd);
+    }
+
+    uint64_t Reactor::add_timer(std::chrono::milliseconds period, TimerHandler handler) {
+        uint64_t id = next_timer_id_++;
+        timers_[id] = Timer{std::chrono::steady_clock::now() + period, period, std::move(handler)};
+        return id;
+    }
+
+    uint64_t Reactor::add_oneshot(std::chrono::milliseconds delay, TimerHandler handler) {
+        uint64_t id = next_timer_id_++;
+        timers_[id] = Timer{std::chrono::steady_clock::now() + delay, delay, std::move(handler), false};
+        return id;
+    }
+
+    void Reactor::cancel_timer(uint64_t id) {
+        timers_.erase(id);
+    }
+
+    void Reactor::post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(task_mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        wake();
+    }
+
+    void Reactor::stop() {
+        stopped_ = true;
+        wake();
+    }
+
+    void Reactor::wake() {
+        // Coalesce: one wake-up token in flight is enough
+        if (wake_pending_.exchange(true)) return;
+        #ifdef __linux__
+            uint64_t one = 1;
+            ssize_t r = write(event_fd_, &one, sizeof(one));
+            (void)r;
+        #else
+            char b = 1;
+            send(wake_sock_, &b, 1, 0);
+        #endif
+    }
+
+    void Reactor::drain_wakeup() {
+        wake_pending_ = false;
+        #ifdef __linux__
+            uint64_t value;
+            while (read(event_fd_, &value, sizeof(value)) > 0) {}
+        #else
+            char buf[64];
+            while (recv(wake_sock_, buf, sizeof(buf), 0) > 0) {}
+        #endif
+    }
+
+    void Reactor::run_tasks() {
+        std::deque<Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(task_mutex_);
+            tasks.swap(tasks_);
+        }
+        for (auto& task : tasks) {
+            if (stopped_) break;
+            task();
+        }
+    }
+
+    int Reactor::next_timeout_ms() const {
+        if (timers_.empty()) return -1;
+        auto now = std::chrono::steady_clock::now();
+        auto next = timers_.begin()->second.next;
+        for (const auto& t : timers_) next = (std::min)(next, t.second.next);
+        if (next <= now) return 0;
+        // Round up so we do not wake just before the deadline
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() + 1;
+        return static_cast<int>(ms);
+    }
+
+    void Reactor::run_timers() {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<uint64_t> due;
+        for (const auto& t : timers_) {
+            if (t.second.next <= now) due.push_back(t.first);
+        }
+        for (uint64_t id : due) {
+            auto it = timers_.find(id);
+            if (it == timers_.end()) continue; // Cancelled by an earlier handler
+            auto handler = it->second.handler; // Handler may cancel itself
+            if (it->second.repeat) it->second.next = now + it->second.period;
+            else timers_.erase(it);
+            handler();
+            if (stopped_) return;
+        }
+    }
+
+    void Reactor::dispatch(socket_t fd, uint32_t events) {
+        auto it = watches_.find(fd);
+        if (it == watches_.end()) return;
+        auto handler = it->second.handler; // Handler may remove itself
+        handler(events);
+    }
+
+    void Reactor::run() {
+        if (!valid_) return;
+
+        #ifdef __linux__
+            struct epoll_event events[16];
+            while (!stopped_) {
+                int n = epoll_wait(epoll_fd_, events, 16, next_timeout_ms());
+                wakeups_++;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    std::cerr << "[Reactor] epoll_wait failed: " << strerror(errno) << std::endl;
+                    break;
+                }
+
+                for (int i = 0; i < n && !stopped_; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == event_fd_) {
+                        drain_wakeup();
+                        continue;
+                    }
+                    uint32_t ev = 0;
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP)) ev |= IO_READ;
+                    if (events[i].events & EPOLLOUT) ev |= IO_WRITE;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) ev |= IO_ERROR;
+                    dispatch(fd, ev);
+                }
+
+                if (!stopped_) run_tasks();
+                if (!stopped_) run_timers();
+            }
+        #else
+            std::vector<socket_t> fds;
+            #ifdef _WIN32
+                std::vector<WSAPOLLFD> pfds;
+            #else
+                std::vector<struct pollfd> pfds;
+            #endif
+            while (!stopped_) {
+                pfds.clear();
+                fds.clear();
+
+                pfds.push_back({});
+                pfds.back().fd = wake_sock_;
+                pfds.back().events = POLLIN;
+                for (const auto& w : watches_) {
+                    pfds.push_back({});
+                    pfds.back().fd = w.first;
+                    pfds.back().events = 0;
+                    if (w.second.interest & IO_READ) pfds.back().events |= POLLIN;
+                    if (w.second.interest & IO_WRITE) pfds.back().events |= POLLOUT;
+                    fds.push_back(w.first);
+                }
+
+                #ifdef _WIN32
+                    int n = WSAPoll(pfds.data(), (ULONG)pfds.size(), next_timeout_ms());
+                #else
+                    int n = poll(pfds.data(), pfds.size(), next_timeout_ms());
+                #endif
+                wakeups_++;
+                if (n < 0) {
+                    #ifndef _WIN32
+                    if (errno == EINTR) continue;
+                    #endif
+                    std::cerr << "[Reactor] poll failed" << std::endl;
+                    break;
+                }
+
+                if (pfds[0].revents & POLLIN) drain_wakeup();
+                for (size_t i = 1; i < pfds.size() && !stopped_; ++i) {
+                    uint32_t ev = 0;
+                    if (pfds[i].revents & POLLIN) ev |= IO_READ;
+                    if (pfds[i].revents & POLLOUT) ev |= IO_WRITE;
+                    if (pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) ev |= IO_ERROR;
+                    if (ev) dispatch(fds[i - 1], ev);
+                }
+
+                if (!stopped_) run_tasks();
+                if (!stopped_) run_timers();
+            }
+        #endif
+    }
+
+} // namespace network
+} // namespace core
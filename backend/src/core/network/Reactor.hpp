@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "core/NetworkDefs.hpp"
+
+namespace core {
+namespace network {
+
+    // Readiness bits passed to IoHandler / used as interest mask
+    enum IoEvent : uint32_t {
+        IO_READ  = 1u << 0,
+        IO_WRITE = 1u << 1,
+        IO_ERROR = 1u << 2  // Error or hang-up (always reported)
+    };
+
+    // ============================================================================
+    // Reactor - Single-threaded socket event loop with timers
+    // ============================================================================
+    // Linux: epoll, edge-triggered (EPOLLET) for read and write. Handlers must
+    //        consume until WouldBlock; write interest should only be set while
+    //        output is pending (modify()).
+    // Other: poll()/WSAPoll, level-triggered. Handlers written for the
+    //        edge-triggered contract work unchanged.
+    //
+    // Cross-thread wake-up (post/stop) uses an eventfd on Linux and a
+    // loopback UDP socket connected to itself elsewhere, so the loop sleeps
+    // until there is I/O, a posted task, or a timer deadline - no periodic
+    // polling.
+    //
+    // add/modify/remove/add_timer/cancel_timer must be called on the reactor
+    // thread (or before run()); post() and stop() are thread-safe.
+    // ============================================================================
+
+    class Reactor {
+    public:
+        using IoHandler = std::function<void(uint32_t events)>;
+        using TimerHandler = std::function<void()>;
+        using Task = std::function<void()>;
+
+        Reactor();
+        ~Reactor();
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        bool is_valid() const { return valid_; }
+
+        bool add(socket_t fd, uint32_t interest, IoHandler handler);
+        bool modify(socket_t fd, uint32_t interest);
+        void remove(socket_t fd);
+
+        // Repeating timer; first fire after one period. Returns timer id.
+        uint64_t add_timer(std::chrono::milliseconds period, TimerHandler handler);
+        // One-shot timer; removed after it fires. Returns timer id.
+        uint64_t add_oneshot(std::chrono::milliseconds delay, TimerHandler handler);
+        void cancel_timer(uint64_t id);
+
+        // Queue a task to run on the reactor thread (thread-safe)
+        void post(Task task);
+
+        // Run until stop(). Returns immediately if already stopped.
+        void run();
+
+        // Thread-safe
+        void stop();
+        bool is_stopped() const { return stopped_; }
+
+        // Number of times the loop woke up (idle CPU diagnostics)
+        uint64_t wakeups() const { return wakeups_; }
+
+    private:
+        struct Watch {
+            uint32_t interest = 0;
+            IoHandler handler;
+        };
+
+        struct Timer {
+            std::chrono::steady_clock::time_point next;
+            std::chrono::milliseconds period;
+            TimerHandler handler;
+            bool repeat = true;
+        };
+
+        void wake();
+        void drain_wakeup();
+        void run_tasks();
+        int next_timeout_ms() const;
+        void run_timers();
+        void dispatch(socket_t fd, uint32_t events);
+
+        bool valid_ = false;
+        std::atomic<bool> stopped_{false};
+        std::atomic<uint64_t> wakeups_{0};
+
+        std::map<socket_t, Watch> watches_;
+        std::map<uint64_t, Timer> timers_;
+        uint64_t next_timer_id_ = 1;
+
+        std::mutex task_mutex_;
+        std::deque<Task> tasks_;
+        std::atomic<bool> wake_pending_{false};
+
+        #ifdef __linux__
+            int epoll_fd_ = -1;
+            int event_fd_ = -1;
+        #else
+            socket_t wake_sock_ = INVALID_SOCKET; // UDP socket connected to itself
+        #endif
+    };
+
+} // namespace network
+} // namespace core
@@ -8,10 +8,14 @@
 #else
     #include <unistd.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
     #include <netinet/tcp.h>
     #include <fcntl.h>
     #include <errno.h>
+    #ifdef __linux__
+        #include <sys/sendfile.h>
+    #endif
 #endif
 
 namespace core {
@@ -48,6 +52,30 @@ namespace network {
         setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size));
     }
 
+    bool TcpSocket::set_keep_alive(int idle_s, int interval_s, int count) {
+        if (fd_ < 0) return false;
+        int on = 1;
+        if (setsockopt(fd_, SOL_SOCKET, SO_KEEPALIVE, (const char*)&on, sizeof(on)) != 0) return false;
+
+        #ifdef _WIN32
+            // Windows 10 1709+ exposes the Linux-style per-socket options
+            #if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+                setsockopt(fd_, IPPROTO_TCP, TCP_KEEPIDLE, (const char*)&idle_s, sizeof(idle_s));
+                setsockopt(fd_, IPPROTO_TCP, TCP_KEEPINTVL, (const char*)&interval_s, sizeof(interval_s));
+                setsockopt(fd_, IPPROTO_TCP, TCP_KEEPCNT, (const char*)&count, sizeof(count));
+            #endif
+        #elif defined(__APPLE__)
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPALIVE, &idle_s, sizeof(idle_s));
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPINTVL, &interval_s, sizeof(interval_s));
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+        #else
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPIDLE, &idle_s, sizeof(idle_s));
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPINTVL, &interval_s, sizeof(interval_s));
+            setsockopt(fd_, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+        #endif
+        return true;
+    }
+
     std::pair<size_t, SocketError> TcpSocket::send(const uint8_t* data, size_t size) {
         if (fd_ < 0) return {0, SocketError::Fatal};
 
@@ -67,6 +95,83 @@ namespace network {
         return {(size_t)sent, SocketError::Ok};
     }
 
+    std::pair<size_t, SocketError> TcpSocket::send_file(int file_fd, uint64_t offset, size_t count) {
+        if (fd_ < 0) return {0, SocketError::Fatal};
+        if (count == 0) return {0, SocketError::Ok};
+
+        #ifdef _WIN32
+            (void)file_fd; (void)offset;
+            return {0, SocketError::Fatal}; // No POSIX descriptors (TransmitFile not wired up)
+        #elif defined(__linux__)
+            // Page cache -> socket inside the kernel. Returns 0 at end of file.
+            off_t off = static_cast<off_t>(offset);
+            ssize_t sent;
+            do {
+                sent = ::sendfile(fd_, file_fd, &off, count);
+            } while (sent < 0 && errno == EINTR);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return {0, SocketError::WouldBlock};
+                if (errno == EPIPE || errno == ECONNRESET) return {0, SocketError::Disconnected};
+                return {0, SocketError::Fatal};
+            }
+            return {(size_t)sent, SocketError::Ok};
+        #else
+            // Portable fallback: one bounded pread + send (still no packet copy)
+            uint8_t buf[64 * 1024];
+            ssize_t got = ::pread(file_fd, buf, count < sizeof(buf) ? count : sizeof(buf), static_cast<off_t>(offset));
+            if (got < 0) return {0, SocketError::Fatal};
+            if (got == 0) return {0, SocketError::Ok};
+            return send(buf, static_cast<size_t>(got));
+        #endif
+    }
+
+    std::pair<size_t, SocketError> TcpSocket::send_vectored(const IoSlice* slices, size_t count) {
+        if (fd_ < 0) return {0, SocketError::Fatal};
+        if (count == 0) return {0, SocketError::Ok};
+        if (count > MAX_IO_SLICES) count = MAX_IO_SLICES;
+
+        #ifdef _WIN32
+            WSABUF bufs[MAX_IO_SLICES];
+            for (size_t i = 0; i < count; ++i) {
+                bufs[i].buf = (CHAR*)slices[i].data;
+                bufs[i].len = (ULONG)slices[i].size;
+            }
+
+            DWORD sent = 0;
+            if (WSASend(fd_, bufs, (DWORD)count, &sent, 0, NULL, NULL) == SOCKET_ERROR) {
+                int err = WSAGetLastError();
+                if (err == WSAEWOULDBLOCK) return {0, SocketError::WouldBlock};
+                if (err == WSAECONNRESET || err == WSAECONNABORTED) return {0, SocketError::Disconnected};
+                return {0, SocketError::Fatal};
+            }
+            return {(size_t)sent, SocketError::Ok};
+        #else
+            struct iovec iov[MAX_IO_SLICES];
+            for (size_t i = 0; i < count; ++i) {
+                iov[i].iov_base = const_cast<uint8_t*>(slices[i].data);
+                iov[i].iov_len = slices[i].size;
+            }
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+
+            int flags = 0;
+            #ifdef MSG_NOSIGNAL
+                flags |= MSG_NOSIGNAL; // Peer reset must not raise SIGPIPE
+            #endif
+
+            ssize_t sent = ::sendmsg(fd_, &msg, flags);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return {0, SocketError::WouldBlock};
+                if (errno == EPIPE || errno == ECONNRESET) return {0, SocketError::Disconnected};
+                return {0, SocketError::Fatal};
+            }
+            return {(size_t)sent, SocketError::Ok};
+        #endif
+    }
+
     std::pair<size_t, SocketError> TcpSocket::recv(uint8_t* buffer, size_t max_size) {
         if (fd_ < 0) return {0, SocketError::Fatal};
 
@@ -13,13 +13,18 @@ namespace network {
         bool set_non_blocking(bool enable) override;
         bool set_no_delay(bool enable) override;
         void set_send_buffer_size(int size) override;
+        bool set_keep_alive(int idle_s, int interval_s, int count) override;
 
         std::pair<size_t, SocketError> send(const uint8_t* data, size_t size) override;
+        std::pair<size_t, SocketError> send_vectored(const IoSlice* slices, size_t count) override;
+        std::pair<size_t, SocketError> send_file(int file_fd, uint64_t offset, size_t count) override;
         std::pair<size_t, SocketError> recv(uint8_t* buffer, size_t max_size) override;
 
         void close_socket() override;
         bool is_valid() const override;
 
+        socket_t native_handle() const { return fd_; }
+
     private:
         socket_t fd_;
     };
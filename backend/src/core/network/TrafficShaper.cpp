@@ -0,0 +1,148 @@
+#include "TrafficShaper.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace core {
+namespace network {
+
+    const char* traffic_class_name(TrafficClass c) {
+        switch (c) {
+            case TrafficClass::Control: return "control";
+            case TrafficClass::Video: return "video";
+            case TrafficClass::File: return "file";
+        }
+        return "unknown";
+    }
+
+    bool parse_traffic_class(const std::string& name, TrafficClass& out) {
+        for (size_t i = 0; i < TRAFFIC_CLASS_COUNT; ++i) {
+            if (name == traffic_class_name(static_cast<TrafficClass>(i))) {
+                out = static_cast<TrafficClass>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // ============================================================================
+    // TokenBucket
+    // ============================================================================
+
+    void TokenBucket::configure(uint64_t rate_bytes_per_sec, uint64_t burst_bytes, Clock::time_point now) {
+        rate_ = rate_bytes_per_sec;
+        burst_ = static_cast<double>(burst_bytes);
+        tokens_ = burst_;
+        last_ = now;
+    }
+
+    bool TokenBucket::ready(Clock::time_point now) {
+        if (unlimited()) return true;
+        if (now > last_) {
+            double elapsed = std::chrono::duration<double>(now - last_).count();
+            tokens_ = (std::min)(burst_, tokens_ + elapsed * rate_);
+            last_ = now;
+        }
+        return tokens_ >= 0;
+    }
+
+    std::chrono::microseconds TokenBucket::wait_time() const {
+        if (unlimited() || tokens_ >= 0) return std::chrono::microseconds(0);
+        return std::chrono::microseconds(static_cast<int64_t>(-tokens_ * 1e6 / rate_) + 1);
+    }
+
+    // ============================================================================
+    // TrafficShaper
+    // ============================================================================
+
+    TrafficShaper::TrafficShaper() {
+        stats_[static_cast<size_t>(TrafficClass::Control)].weight = 1;  // Own socket: not weighted
+        stats_[static_cast<size_t>(TrafficClass::Video)].weight = 4;
+        stats_[static_cast<size_t>(TrafficClass::File)].weight = 1;
+    }
+
+    uint64_t TrafficShaper::default_burst(uint64_t bytes_per_sec) {
+        return (std::max)(MIN_BURST, bytes_per_sec / 10);
+    }
+
+    void TrafficShaper::set_rate(TrafficClass c, uint64_t bytes_per_sec, uint64_t burst_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t i = static_cast<size_t>(c);
+        buckets_[i].configure(bytes_per_sec, burst_bytes ? burst_bytes : default_burst(bytes_per_sec), Clock::now());
+        stats_[i].rate = bytes_per_sec;
+    }
+
+    void TrafficShaper::set_global_rate(uint64_t bytes_per_sec, uint64_t burst_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        global_.configure(bytes_per_sec, burst_bytes ? burst_bytes : default_burst(bytes_per_sec), Clock::now());
+    }
+
+    void TrafficShaper::set_weight(TrafficClass c, uint32_t weight) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_[static_cast<size_t>(c)].weight = (std::max)(1u, weight);
+    }
+
+    uint32_t TrafficShaper::weight(TrafficClass c) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_[static_cast<size_t>(c)].weight;
+    }
+
+    bool TrafficShaper::admit(TrafficClass c, size_t bytes, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t i = static_cast<size_t>(c);
+        ClassStats& st = stats_[i];
+
+        if (!buckets_[i].ready(now)) {
+            st.throttled++;
+            return false;
+        }
+        bool global_ready = global_.ready(now);
+        if (c != TrafficClass::Control && !global_ready) {
+            st.throttled++;
+            global_throttled_++;
+            return false;
+        }
+
+        buckets_[i].consume(bytes);
+        global_.consume(bytes);
+        st.bytes += bytes;
+        st.packets++;
+        return true;
+    }
+
+    std::chrono::microseconds TrafficShaper::wait_time(TrafficClass c, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t i = static_cast<size_t>(c);
+        buckets_[i].ready(now);
+        auto wait = buckets_[i].wait_time();
+        if (c != TrafficClass::Control) {
+            global_.ready(now);
+            wait = (std::max)(wait, global_.wait_time());
+        }
+        return wait;
+    }
+
+    TrafficShaper::Stats TrafficShaper::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats st;
+        st.classes = stats_;
+        st.global_rate = global_.rate();
+        st.global_throttled = global_throttled_;
+        return st;
+    }
+
+    std::string TrafficShaper::format_stats() const {
+        auto st = stats();
+        std::ostringstream out;
+        for (size_t i = 0; i < TRAFFIC_CLASS_COUNT; ++i) {
+            const char* name = traffic_class_name(static_cast<TrafficClass>(i));
+            const auto& c = st.classes[i];
+            out << name << "_bytes=" << c.bytes << "," << name << "_packets=" << c.packets << ","
+                << name << "_throttled=" << c.throttled << "," << name << "_rate=" << c.rate << ","
+                << name << "_weight=" << c.weight << ",";
+        }
+        out << "global_rate=" << st.global_rate << ",global_throttled=" << st.global_throttled;
+        return out.str();
+    }
+
+} // namespace network
+} // namespace core
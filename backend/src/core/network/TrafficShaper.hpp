@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace core {
+namespace network {
+
+    // Traffic classes shaped by the session writers (index into per-class arrays)
+    enum class TrafficClass : uint8_t { Control = 0, Video = 1, File = 2 };
+    constexpr size_t TRAFFIC_CLASS_COUNT = 3;
+
+    const char* traffic_class_name(TrafficClass c);
+    bool parse_traffic_class(const std::string& name, TrafficClass& out);
+
+    // ============================================================================
+    // TokenBucket - Rate limit in bytes per second
+    // ============================================================================
+    // A packet may go while the bucket is not in debt; it then takes its whole
+    // size, possibly driving the bucket negative. Packets larger than the
+    // burst (250 KB file chunks) still pass, and the debt delays the next one,
+    // so the long-run rate holds without splitting packets.
+    // Rate 0 means unlimited.
+    // ============================================================================
+
+    class TokenBucket {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        void configure(uint64_t rate_bytes_per_sec, uint64_t burst_bytes, Clock::time_point now);
+
+        bool unlimited() const { return rate_ == 0; }
+        uint64_t rate() const { return rate_; }
+
+        // Refills, then true if a packet may go now
+        bool ready(Clock::time_point now);
+        void consume(size_t bytes) { if (!unlimited()) tokens_ -= static_cast<double>(bytes); }
+
+        // Until ready() turns true (after a ready() call at `now`)
+        std::chrono::microseconds wait_time() const;
+
+    private:
+        uint64_t rate_ = 0;
+        double burst_ = 0;
+        double tokens_ = 0;
+        Clock::time_point last_{};
+    };
+
+    // ============================================================================
+    // TrafficShaper - Per-class and global bandwidth limits for all sessions
+    // ============================================================================
+    // One instance is shared by every gateway session, so the global cap holds
+    // for the agent as a whole (e.g. to leave a cafe's uplink usable at peak
+    // hours). Writers ask admit() before moving a packet into a socket outbox:
+    // - Control: its own bucket only; it is charged to the global bucket but
+    //   never held back by it, so commands stay responsive under a tight cap
+    // - Video, File: their own bucket and the global bucket
+    //
+    // Between Video and File, each session's writer runs deficit round-robin
+    // with the weights below (bytes per turn = weight x DRR_QUANTUM).
+    //
+    // Defaults: everything unlimited, weights Video 4 / File 1.
+    // ============================================================================
+
+    class TrafficShaper {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr size_t DRR_QUANTUM = 64 * 1024;
+        static constexpr uint64_t MIN_BURST = 256 * 1024;  // At least one file chunk
+
+        struct ClassStats {
+            uint64_t bytes = 0;
+            uint64_t packets = 0;
+            uint64_t throttled = 0;  // admit() refusals (packet waited for tokens)
+            uint64_t rate = 0;       // Configured bytes/s, 0 = unlimited
+            uint32_t weight = 0;
+        };
+
+        struct Stats {
+            std::array<ClassStats, TRAFFIC_CLASS_COUNT> classes;
+            uint64_t global_rate = 0;
+            uint64_t global_throttled = 0;  // Refusals caused by the global bucket
+        };
+
+        TrafficShaper();
+
+        // burst 0: a tenth of a second of traffic, at least MIN_BURST
+        void set_rate(TrafficClass c, uint64_t bytes_per_sec, uint64_t burst_bytes = 0);
+        void set_global_rate(uint64_t bytes_per_sec, uint64_t burst_bytes = 0);
+        void set_weight(TrafficClass c, uint32_t weight);
+
+        uint32_t weight(TrafficClass c) const;
+
+        // True: send now (tokens taken, counted). False: wait_time() says how long.
+        bool admit(TrafficClass c, size_t bytes, Clock::time_point now);
+
+        // Time until class c may send again (0 if it may now)
+        std::chrono::microseconds wait_time(TrafficClass c, Clock::time_point now);
+
+        Stats stats() const;
+        std::string format_stats() const;  // key=value list for STATUS replies
+
+    private:
+        static uint64_t default_burst(uint64_t bytes_per_sec);
+
+        mutable std::mutex mutex_;
+        std::array<TokenBucket, TRAFFIC_CLASS_COUNT> buckets_;
+        TokenBucket global_;
+        std::array<ClassStats, TRAFFIC_CLASS_COUNT> stats_;
+        uint64_t global_throttled_ = 0;
+    };
+
+} // namespace network
+} // namespace core
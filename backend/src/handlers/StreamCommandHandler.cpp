@@ -8,7 +8,7 @@ std::unique_ptr<core::command::ICommand> StreamCommandHandler::parse_command(
     const core::command::CommandContext& ctx
 ) {
     if (cmd == "start_monitor_stream") {
-        uint32_t cid = ctx.client_id;
+        uint32_t cid = static_cast<uint32_t>(ctx.client_id);  // The gateway's own cid
         uint32_t bid = ctx.backend_id;
         auto subscribe_fn = [this, cid, bid]() {
             if (monitor_subscribe_fn_) {
@@ -23,7 +23,7 @@ std::unique_ptr<core::command::ICommand> StreamCommandHandler::parse_command(
             bus_monitor_, session_monitor_, ctx.client_id, ctx);
     }
     else if (cmd == "start_webcam_stream") {
-        uint32_t cid = ctx.client_id;
+        uint32_t cid = static_cast<uint32_t>(ctx.client_id);  // The gateway's own cid
         uint32_t bid = ctx.backend_id;
         auto subscribe_fn = [this, cid, bid]() {
             if (webcam_subscribe_fn_) {
@@ -1,14 +1,21 @@
 #include "LinuxFileTransfer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <cstring>
+#include <cerrno>
 
 // POSIX headers
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 namespace platform {
@@ -18,16 +25,28 @@ namespace linux_os {
 // Construction
 // ============================================================================
 
-LinuxFileTransfer::LinuxFileTransfer() = default;
+LinuxFileTransfer::LinuxFileTransfer()
+    : write_behind_thread_([this]() { write_behind_loop(); }) {}
 
 LinuxFileTransfer::~LinuxFileTransfer() {
-    // Cleanup any active uploads
-    std::lock_guard<std::mutex> lock(uploads_mutex_);
-    for (auto& [path, state] : active_uploads_) {
-        if (state.fd >= 0) {
-            close(state.fd);
-        }
+    {
+        std::lock_guard<std::mutex> lock(write_behind_mutex_);
+        write_behind_stop_ = true;
+        write_behind_queue_.clear();
     }
+    write_behind_cv_.notify_all();
+    if (write_behind_thread_.joinable()) write_behind_thread_.join();
+
+    if (watch_thread_.joinable()) {
+        uint64_t one = 1;
+        if (write(watch_wake_fd_, &one, sizeof(one)) < 0) {}
+        watch_thread_.join();
+    }
+    if (inotify_fd_ >= 0) close(inotify_fd_);  // Drops every watch
+    if (watch_wake_fd_ >= 0) close(watch_wake_fd_);
+
+    // Cleanup any active uploads (descriptors close with their state)
+    std::lock_guard<std::mutex> lock(uploads_mutex_);
     active_uploads_.clear();
 }
 
@@ -35,6 +54,24 @@ LinuxFileTransfer::~LinuxFileTransfer() {
 // Helper Functions
 // ============================================================================
 
+namespace {
+
+// Read-only descriptor shared by the queued regions of one download
+class LinuxFileSource final : public interfaces::IFileSource {
+public:
+    LinuxFileSource(int fd, uint64_t size) : fd_(fd), size_(size) {}
+    ~LinuxFileSource() override { close(fd_); }
+
+    int native_handle() const override { return fd_; }
+    uint64_t size() const override { return size_; }
+
+private:
+    int fd_;
+    uint64_t size_;
+};
+
+} // namespace
+
 bool LinuxFileTransfer::create_dirs_recursive(const std::string& path) {
     size_t pos = 0;
     std::string current_path;
@@ -66,14 +103,10 @@ bool LinuxFileTransfer::create_dirs_recursive(const std::string& path) {
 common::Result<std::vector<interfaces::FileInfo>> LinuxFileTransfer::list_directory(
     const std::string& path
 ) {
-    // ROOT ENUMERATION: If path is empty, list root filesystem
-    std::string actual_path = path;
-    if (path.empty() || path == "." || path == "~") {
-        actual_path = "/";
-    }
+    std::string actual_path = resolve_directory(path);
 
-    DIR* dir = opendir(actual_path.c_str());
-    if (!dir) {
+    int dir_fd = open(actual_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
         if (errno == ENOENT) {
             return common::Result<std::vector<interfaces::FileInfo>>::err(
                 common::ErrorCode::DeviceNotFound,
@@ -84,80 +117,155 @@ common::Result<std::vector<interfaces::FileInfo>> LinuxFileTransfer::list_direct
             "Cannot access directory: " + actual_path);
     }
 
-    std::vector<interfaces::FileInfo> results;
-    struct dirent* entry;
+    // Names first, in bulk: one getdents64 call returns hundreds of entries
+    std::vector<DirEntry> entries;
+    if (!read_dir_entries(dir_fd, entries)) {
+        int error = errno;
+        close(dir_fd);
+        return common::Result<std::vector<interfaces::FileInfo>>::err(
+            common::ErrorCode::Unknown,
+            "Cannot read directory " + actual_path + ": " + strerror(error));
+    }
 
-    while ((entry = readdir(dir)) != nullptr) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+    std::string prefix = actual_path;
+    if (prefix.back() != '/') prefix += '/';
 
-        interfaces::FileInfo info;
-        info.name = entry->d_name;
+    // Then metadata, relative to the open directory (no path walk per entry);
+    // large directories are split across threads
+    std::vector<interfaces::FileInfo> results(entries.size());
+    auto fill = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) fill_entry(dir_fd, prefix, entries[i], results[i]);
+    };
 
-        // Build full path
-        std::string full_path = actual_path;
-        if (!full_path.empty() && full_path.back() != '/') {
-            full_path += '/';
+    size_t threads = entries.size() / LIST_ENTRIES_PER_THREAD;
+    threads = (std::min)({threads, size_t(LIST_MAX_THREADS), size_t(std::thread::hardware_concurrency())});
+    if (threads <= 1) {
+        fill(0, entries.size());
+    } else {
+        std::vector<std::thread> workers;
+        size_t per = (entries.size() + threads - 1) / threads;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(fill, t * per, (std::min)(entries.size(), (t + 1) * per));
         }
-        full_path += entry->d_name;
-        info.path = full_path;
+        fill(0, per);
+        for (auto& w : workers) w.join();
+    }
 
-        // Get detailed info via lstat (to detect symlinks)
-        struct stat st;
-        bool is_symlink = false;
-
-        // Use lstat first to check if it's a symlink
-        if (lstat(full_path.c_str(), &st) == 0) {
-            is_symlink = S_ISLNK(st.st_mode);
-
-            // If symlink, follow it with stat to get target info
-            if (is_symlink) {
-                struct stat target_st;
-                if (stat(full_path.c_str(), &target_st) == 0) {
-                    info.size = target_st.st_size;
-                    info.modified_time = target_st.st_mtime;
-                    info.is_directory = S_ISDIR(target_st.st_mode);
-                    info.is_readonly = !(target_st.st_mode & S_IWUSR);
-                } else {
-                    // Broken symlink
-                    info.size = 0;
-                    info.modified_time = st.st_mtime;
-                    info.is_directory = false;
-                    info.is_readonly = true;
-                }
-            } else {
-                info.size = st.st_size;
-                info.modified_time = st.st_mtime;
-                info.is_directory = S_ISDIR(st.st_mode);
-                info.is_readonly = !(st.st_mode & S_IWUSR);
-            }
-        } else {
-            info.size = 0;
-            info.modified_time = 0;
-            info.is_directory = (entry->d_type == DT_DIR);
-            info.is_readonly = false;
+    close(dir_fd);
+    return common::Result<std::vector<interfaces::FileInfo>>::ok(std::move(results));
+}
+
+std::string LinuxFileTransfer::resolve_directory(const std::string& path) {
+    // ROOT ENUMERATION: If path is empty, list root filesystem
+    if (path.empty() || path == "." || path == "~") return "/";
+    return path;
+}
+
+bool LinuxFileTransfer::read_dir_entries(int dir_fd, std::vector<DirEntry>& entries) {
+    // struct linux_dirent64: u64 d_ino, s64 d_off, u16 d_reclen, u8 d_type, char d_name[]
+    constexpr size_t RECLEN_AT = 16, TYPE_AT = 18, NAME_AT = 19;
+    std::vector<char> buffer(LIST_BUFFER_SIZE);
+    for (;;) {
+        long n = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) return true;
+
+        for (long pos = 0; pos < n;) {
+            const char* record = buffer.data() + pos;
+            uint16_t reclen;
+            memcpy(&reclen, record + RECLEN_AT, sizeof(reclen));
+            pos += reclen;
+
+            const char* name = record + NAME_AT;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+            entries.push_back(DirEntry{name, static_cast<unsigned char>(record[TYPE_AT])});
         }
+    }
+}
 
-        // Check for hidden files (starts with .)
-        info.is_hidden = (entry->d_name[0] == '.');
+bool LinuxFileTransfer::stat_entry(int dir_fd, const char* name, bool follow, EntryStat& out) {
+    // statx with only the fields FileInfo uses (filesystems may skip the
+    // rest); fstatat on kernels or C libraries without it
+    const int flags = AT_NO_AUTOMOUNT | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+#ifdef STATX_TYPE
+    static std::atomic<bool> no_statx{false};
+    if (!no_statx.load(std::memory_order_relaxed)) {
+        struct statx sx;
+        if (statx(dir_fd, name, flags, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO, &sx) == 0) {
+            out.mode = sx.stx_mode;
+            out.size = sx.stx_size;
+            out.mtime = static_cast<uint64_t>(sx.stx_mtime.tv_sec);
+            out.device = makedev(sx.stx_dev_major, sx.stx_dev_minor);
+            out.inode = sx.stx_ino;
+            return true;
+        }
+        if (errno != ENOSYS) return false;
+        no_statx.store(true, std::memory_order_relaxed);
+    }
+#endif
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, flags) != 0) return false;
+    out.mode = st.st_mode;
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.mtime = static_cast<uint64_t>(st.st_mtime);
+    out.device = st.st_dev;
+    out.inode = st.st_ino;
+    return true;
+}
 
-        results.push_back(std::move(info));
+void LinuxFileTransfer::fill_entry(int dir_fd, const std::string& prefix, DirEntry& entry,
+                                   interfaces::FileInfo& info) {
+    info.path.reserve(prefix.size() + entry.name.size());
+    info.path = prefix;
+    info.path += entry.name;
+    info.is_hidden = (entry.name[0] == '.');
+
+    // Symlinks report their target; d_type says which entries are links, so
+    // everything else needs one stat (DT_UNKNOWN: find out with the first)
+    EntryStat st;
+    bool link = entry.type == DT_LNK;
+    bool ok = stat_entry(dir_fd, entry.name.c_str(), link, st);
+    if (!link && ok && S_ISLNK(st.mode)) {
+        link = true;
+        ok = stat_entry(dir_fd, entry.name.c_str(), true, st);
     }
 
-    closedir(dir);
-    return common::Result<std::vector<interfaces::FileInfo>>::ok(std::move(results));
+    if (ok) {
+        info.size = st.size;
+        info.modified_time = st.mtime;
+        info.is_directory = S_ISDIR(st.mode);
+        info.is_readonly = !(st.mode & S_IWUSR);
+        info.device = st.device;
+        info.inode = st.inode;
+    } else if (link && stat_entry(dir_fd, entry.name.c_str(), false, st)) {
+        // Broken symlink
+        info.size = 0;
+        info.modified_time = st.mtime;
+        info.is_directory = false;
+        info.is_readonly = true;
+    } else {
+        info.size = 0;
+        info.modified_time = 0;
+        info.is_directory = (entry.type == DT_DIR);
+        info.is_readonly = false;
+    }
+    info.name = std::move(entry.name);
 }
 
 common::Result<interfaces::FileInfo> LinuxFileTransfer::get_file_info(
     const std::string& path
 ) {
+    // Symlinks report their target, dangling ones themselves (as listed)
     struct stat st;
+    bool broken_link = false;
     if (stat(path.c_str(), &st) != 0) {
-        return common::Result<interfaces::FileInfo>::err(
-            common::ErrorCode::DeviceNotFound,
-            "File not found: " + path);
+        if (lstat(path.c_str(), &st) != 0 || !S_ISLNK(st.st_mode)) {
+            return common::Result<interfaces::FileInfo>::err(
+                common::ErrorCode::DeviceNotFound,
+                "File not found: " + path);
+        }
+        broken_link = true;
     }
 
     interfaces::FileInfo info;
@@ -166,11 +274,13 @@ common::Result<interfaces::FileInfo> LinuxFileTransfer::get_file_info(
     size_t last_sep = path.find_last_of('/');
     info.name = (last_sep != std::string::npos) ? path.substr(last_sep + 1) : path;
     info.path = path;
-    info.size = st.st_size;
+    info.size = broken_link ? 0 : st.st_size;
     info.modified_time = st.st_mtime;
     info.is_directory = S_ISDIR(st.st_mode);
-    info.is_readonly = !(st.st_mode & S_IWUSR);
+    info.is_readonly = broken_link || !(st.st_mode & S_IWUSR);
     info.is_hidden = (!info.name.empty() && info.name[0] == '.');
+    info.device = st.st_dev;
+    info.inode = st.st_ino;
 
     return common::Result<interfaces::FileInfo>::ok(std::move(info));
 }
@@ -185,8 +295,9 @@ common::EmptyResult LinuxFileTransfer::create_directory(const std::string& path)
 }
 
 common::EmptyResult LinuxFileTransfer::delete_path(const std::string& path) {
+    // The link itself, not its target (dangling links can be deleted too)
     struct stat st;
-    if (stat(path.c_str(), &st) != 0) {
+    if (lstat(path.c_str(), &st) != 0) {
         return common::EmptyResult::err(
             common::ErrorCode::DeviceNotFound,
             "Path not found: " + path);
@@ -208,6 +319,167 @@ common::EmptyResult LinuxFileTransfer::delete_path(const std::string& path) {
     return common::EmptyResult::success();
 }
 
+// ============================================================================
+// Directory Watches
+// ============================================================================
+
+static constexpr uint32_t WATCH_MASK =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE |
+    IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+common::EmptyResult LinuxFileTransfer::watch_directory(
+    const std::string& path,
+    interfaces::DirectoryChangeCallback on_change
+) {
+    std::string actual_path = resolve_directory(path);
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+
+    if (inotify_fd_ < 0) {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0) {
+            return common::EmptyResult::err(
+                common::ErrorCode::NotImplemented,
+                std::string("inotify unavailable: ") + strerror(errno));
+        }
+        watch_wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (watch_wake_fd_ < 0) {
+            close(inotify_fd_);
+            inotify_fd_ = -1;
+            return common::EmptyResult::err(
+                common::ErrorCode::NotImplemented,
+                std::string("eventfd unavailable: ") + strerror(errno));
+        }
+        watch_thread_ = std::thread([this]() { watch_loop(); });
+    }
+
+    int wd = inotify_add_watch(inotify_fd_, actual_path.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        int error = errno;
+        if (error == ENOENT || error == ENOTDIR) {
+            return common::EmptyResult::err(
+                common::ErrorCode::DeviceNotFound,
+                "Directory not found: " + actual_path);
+        }
+        if (error == ENOSPC || error == ENOMEM) {
+            return common::EmptyResult::err(
+                common::ErrorCode::Busy,
+                "Directory watch limit reached: " + actual_path);
+        }
+        return common::EmptyResult::err(
+            common::ErrorCode::PermissionDenied,
+            "Cannot watch directory " + actual_path + ": " + strerror(error));
+    }
+
+    auto previous = watches_.find(path);
+    if (previous != watches_.end()) {
+        if (previous->second->wd == wd) {
+            // Same inode: inotify_add_watch returned the kernel watch already
+            // in place, which must stay; only the callback is replaced
+            auto& sharing = watches_by_wd_[wd];
+            sharing.erase(std::remove(sharing.begin(), sharing.end(), previous->second), sharing.end());
+            watches_.erase(previous);
+        } else {
+            remove_watch_locked(previous->second);
+        }
+    }
+
+    std::string prefix = actual_path;
+    if (prefix.back() != '/') prefix += '/';
+    auto watch = std::make_shared<Watch>(Watch{path, std::move(prefix), wd, std::move(on_change)});
+    watches_[path] = watch;
+    watches_by_wd_[wd].push_back(std::move(watch));
+    return common::EmptyResult::success();
+}
+
+void LinuxFileTransfer::unwatch_directory(const std::string& path) {
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+    auto it = watches_.find(path);
+    if (it != watches_.end()) remove_watch_locked(it->second);
+}
+
+void LinuxFileTransfer::remove_watch_locked(std::shared_ptr<Watch> watch) {
+    watches_.erase(watch->path);
+    auto it = watches_by_wd_.find(watch->wd);
+    if (it == watches_by_wd_.end()) return;
+    auto& sharing = it->second;
+    sharing.erase(std::remove(sharing.begin(), sharing.end(), watch), sharing.end());
+    if (sharing.empty()) {
+        inotify_rm_watch(inotify_fd_, watch->wd);  // The last path on this inode
+        watches_by_wd_.erase(it);
+    }
+}
+
+void LinuxFileTransfer::flush_directory_changes() {
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        if (inotify_fd_ < 0) return;
+    }
+    std::lock_guard<std::mutex> lock(watch_read_mutex_);
+    read_watch_events();
+}
+
+void LinuxFileTransfer::watch_loop() {
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {watch_wake_fd_, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[LinuxFileTransfer] Directory watch stopped: " << strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[1].revents) return;
+        std::lock_guard<std::mutex> lock(watch_read_mutex_);
+        read_watch_events();
+    }
+}
+
+void LinuxFileTransfer::read_watch_events() {
+    std::vector<char>& buffer = watch_buffer_;  // (operator new: aligned for inotify_event)
+    buffer.resize(WATCH_BUFFER_SIZE);
+    std::vector<std::shared_ptr<Watch>> targets;
+    for (;;) {
+        ssize_t n = read(inotify_fd_, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;  // EAGAIN: queue drained
+
+        for (ssize_t pos = 0; pos < n;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            // Directory-wide: gone, moved, unmounted, or events were dropped
+            bool whole = (event->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF |
+                                         IN_MOVE_SELF | IN_UNMOUNT)) != 0;
+            std::string name;
+            if (!whole && event->len > 0) name.assign(event->name, strnlen(event->name, event->len));
+            if (!whole && name.empty()) continue;
+
+            targets.clear();
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    for (const auto& [path, watch] : watches_) targets.push_back(watch);
+                } else {
+                    auto it = watches_by_wd_.find(event->wd);
+                    if (it == watches_by_wd_.end()) continue;
+                    targets = it->second;
+                    if (event->mask & IN_IGNORED) {  // Removed by the kernel
+                        for (const auto& watch : targets) watches_.erase(watch->path);
+                        watches_by_wd_.erase(it);
+                    }
+                }
+            }
+
+            interfaces::DirectoryChange change;
+            change.name = name;
+            change.removed = whole || (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+            for (const auto& watch : targets) {
+                change.directory = watch->path;
+                change.path = name.empty() ? std::string() : watch->prefix + name;
+                watch->on_change(change);
+            }
+        }
+    }
+}
+
 // ============================================================================
 // Download
 // ============================================================================
@@ -215,7 +487,8 @@ common::EmptyResult LinuxFileTransfer::delete_path(const std::string& path) {
 common::EmptyResult LinuxFileTransfer::download_file(
     const std::string& path,
     interfaces::DataChunkCallback on_chunk,
-    interfaces::ProgressCallback on_progress
+    interfaces::ProgressCallback on_progress,
+    interfaces::ByteRange range
 ) {
     // Open file with O_RDONLY
     int fd = open(path.c_str(), O_RDONLY);
@@ -234,7 +507,16 @@ common::EmptyResult LinuxFileTransfer::download_file(
             "Cannot get file size: " + path);
     }
 
-    uint64_t total_size = st.st_size;
+    if (!interfaces::resolve_range(range, static_cast<uint64_t>(st.st_size))) {
+        close(fd);
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Offset " + std::to_string(range.offset) + " past end of file (" +
+            std::to_string(st.st_size) + " bytes)");
+    }
+
+    uint64_t total_size = range.length;
+    uint64_t end = range.offset + range.length;
     uint64_t bytes_read = 0;
 
     auto start_time = std::chrono::steady_clock::now();
@@ -243,12 +525,14 @@ common::EmptyResult LinuxFileTransfer::download_file(
     std::vector<uint8_t> buffer(interfaces::FILE_TRANSFER_CHUNK_SIZE);
 
     while (bytes_read < total_size) {
-        ssize_t n = read(fd, buffer.data(), buffer.size());
+        uint64_t pos = range.offset + bytes_read;
+        ssize_t n = pread(fd, buffer.data(), interfaces::chunk_span(pos, end), static_cast<off_t>(pos));
         if (n < 0) {
+            if (errno == EINTR) continue;
             close(fd);
             return common::EmptyResult::err(
                 common::ErrorCode::Unknown,
-                "Read error at offset " + std::to_string(bytes_read));
+                "Read error at offset " + std::to_string(pos));
         }
         if (n == 0) break;  // EOF
 
@@ -282,10 +566,58 @@ common::EmptyResult LinuxFileTransfer::download_file(
     return common::EmptyResult::success();
 }
 
+common::Result<std::shared_ptr<const interfaces::IFileSource>> LinuxFileTransfer::open_for_send(
+    const std::string& path
+) {
+    using SourceResult = common::Result<std::shared_ptr<const interfaces::IFileSource>>;
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return SourceResult::err(
+            common::ErrorCode::DeviceNotFound,
+            "Cannot open file: " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return SourceResult::err(
+            common::ErrorCode::Unknown,
+            "Not a regular file: " + path);
+    }
+
+    // Whole file is read front to back: let readahead run ahead of sendfile
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return SourceResult::ok(std::make_shared<LinuxFileSource>(fd, static_cast<uint64_t>(st.st_size)));
+}
+
 // ============================================================================
 // Upload
 // ============================================================================
 
+LinuxFileTransfer::UploadState::~UploadState() {
+    if (fd >= 0) close(fd);
+    if (basis_fd >= 0) close(basis_fd);
+    if (!temp_path.empty()) unlink(temp_path.c_str());  // Delta upload that did not finish
+}
+
+std::shared_ptr<LinuxFileTransfer::UploadState> LinuxFileTransfer::find_upload(const std::string& path) {
+    std::lock_guard<std::mutex> lock(uploads_mutex_);
+    auto it = active_uploads_.find(path);
+    return it == active_uploads_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<LinuxFileTransfer::UploadState> LinuxFileTransfer::take_upload(const std::string& path) {
+    std::lock_guard<std::mutex> lock(uploads_mutex_);
+    auto it = active_uploads_.find(path);
+    if (it == active_uploads_.end()) return nullptr;
+    auto state = std::move(it->second);
+    active_uploads_.erase(it);
+    state->done = true;  // Pending write-back for it is skipped
+    return state;
+}
+
 common::EmptyResult LinuxFileTransfer::upload_start(
     const std::string& path,
     uint64_t expected_size
@@ -297,36 +629,109 @@ common::EmptyResult LinuxFileTransfer::upload_start(
         create_dirs_recursive(parent);
     }
 
-    // Create or truncate file
-    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    // Cancel any existing upload for this path (closed with its last reference)
+    take_upload(path);
+
+    // Create or truncate file (read-write: finishing may read blocks back)
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
     if (fd < 0) {
         return common::EmptyResult::err(
             common::ErrorCode::PermissionDenied,
             "Cannot create file: " + path);
     }
 
-    // Store upload state
+    // Reserve the blocks now: one contiguous allocation instead of one per
+    // chunk, and a full disk fails here rather than halfway through.
+    // KEEP_SIZE: the file only grows as data arrives.
+    if (expected_size > 0 &&
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expected_size)) != 0 &&
+        errno == ENOSPC) {
+        close(fd);
+        unlink(path.c_str());
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Not enough disk space for " + std::to_string(expected_size) + " bytes: " + path);
+    }
+    // Other failures (EOPNOTSUPP on some filesystems) just skip preallocation
+
+    auto state = std::make_shared<UploadState>();
+    state->fd = fd;
+    state->path = path;
+    state->expected_size = expected_size;
+    state->start_time = std::chrono::steady_clock::now();
+
     std::lock_guard<std::mutex> lock(uploads_mutex_);
+    active_uploads_[path] = std::move(state);
 
-    // Cancel any existing upload for this path
-    auto it = active_uploads_.find(path);
-    if (it != active_uploads_.end()) {
-        if (it->second.fd >= 0) {
-            close(it->second.fd);
+    return common::EmptyResult::success();
+}
+
+common::EmptyResult LinuxFileTransfer::write_locked(
+    UploadState& state,
+    uint64_t offset,
+    const uint8_t* data,
+    size_t size
+) {
+    if (state.done) {  // Finished or cancelled after the caller looked it up
+        return common::EmptyResult::err(
+            common::ErrorCode::Cancelled,
+            "Upload closed: " + state.path);
+    }
+
+    // pwrite: the caller gives the offset, no shared file position
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(state.fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return common::EmptyResult::err(
+                common::ErrorCode::Unknown,
+                "Write error at offset " + std::to_string(offset + done) + ": " + strerror(errno));
         }
-        active_uploads_.erase(it);
+        done += static_cast<size_t>(n);
     }
 
-    UploadState state;
-    state.fd = fd;
-    state.path = path;
-    state.expected_size = expected_size;
-    state.bytes_written = 0;
-    state.start_time = std::chrono::steady_clock::now();
+    state.bytes_written += size;
+    state.digest.update(offset, data, size);
+    mark_dirty(state, offset, size);
+    return common::EmptyResult::success();
+}
 
-    active_uploads_[path] = std::move(state);
+common::EmptyResult LinuxFileTransfer::check_range(const UploadState& state, uint64_t offset, uint64_t length) {
+    if (offset <= state.expected_size && length <= state.expected_size - offset) {
+        return common::EmptyResult::success();
+    }
+    return common::EmptyResult::err(
+        common::ErrorCode::Unknown,
+        "Range " + std::to_string(offset) + "+" + std::to_string(length) + " outside the " +
+        std::to_string(state.expected_size) + " byte upload: " + state.path);
+}
 
-    return common::EmptyResult::success();
+void LinuxFileTransfer::mark_dirty(UploadState& state, uint64_t offset, uint64_t length) {
+    // Track the dirty span; once it is large enough, writers queue it for write-back
+    if (state.dirty_end == state.dirty_begin) {
+        state.dirty_begin = offset;
+        state.dirty_end = offset + length;
+    } else {
+        state.dirty_begin = (std::min)(state.dirty_begin, offset);
+        state.dirty_end = (std::max)(state.dirty_end, offset + length);
+    }
+}
+
+LinuxFileTransfer::WriteBehind LinuxFileTransfer::take_dirty(const std::shared_ptr<UploadState>& state) {
+    if (state->dirty_end - state->dirty_begin < WRITE_BEHIND_BYTES) return WriteBehind{};
+    WriteBehind flush{state, state->dirty_begin, state->dirty_end - state->dirty_begin};
+    state->dirty_begin = state->dirty_end = 0;
+    return flush;
+}
+
+void LinuxFileTransfer::queue_write_behind(WriteBehind flush) {
+    if (!flush.upload) return;
+    {
+        std::lock_guard<std::mutex> lock(write_behind_mutex_);
+        write_behind_queue_.push_back(std::move(flush));
+    }
+    write_behind_cv_.notify_one();
 }
 
 common::EmptyResult LinuxFileTransfer::upload_chunk(
@@ -334,78 +739,412 @@ common::EmptyResult LinuxFileTransfer::upload_chunk(
     const uint8_t* data,
     size_t size
 ) {
-    std::lock_guard<std::mutex> lock(uploads_mutex_);
+    return write_upload(path, true, 0, data, size);
+}
 
-    auto it = active_uploads_.find(path);
-    if (it == active_uploads_.end()) {
+common::EmptyResult LinuxFileTransfer::upload_write_at(
+    const std::string& path,
+    uint64_t offset,
+    const uint8_t* data,
+    size_t size
+) {
+    return write_upload(path, false, offset, data, size);
+}
+
+common::EmptyResult LinuxFileTransfer::write_upload(
+    const std::string& path,
+    bool append,
+    uint64_t offset,
+    const uint8_t* data,
+    size_t size
+) {
+    auto state = find_upload(path);
+    if (!state) {
         return common::EmptyResult::err(
             common::ErrorCode::Unknown,
             "No active upload for: " + path);
     }
 
-    UploadState& state = it->second;
+    WriteBehind flush{};
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (append) {
+            offset = state->append_offset;
+        } else {
+            auto range = check_range(*state, offset, size);
+            if (range.is_err()) return range;
+        }
+        auto result = write_locked(*state, offset, data, size);
+        if (result.is_err()) return result;
+        if (append) state->append_offset = offset + size;
+        flush = take_dirty(state);
+    }
+
+    queue_write_behind(std::move(flush));
+    return common::EmptyResult::success();
+}
 
-    ssize_t bytes_written = write(state.fd, data, size);
-    if (bytes_written < 0) {
+void LinuxFileTransfer::write_behind_loop() {
+    while (true) {
+        WriteBehind item;
+        {
+            std::unique_lock<std::mutex> lock(write_behind_mutex_);
+            write_behind_cv_.wait(lock, [this]() { return write_behind_stop_ || !write_behind_queue_.empty(); });
+            if (write_behind_queue_.empty()) return;  // Stopping
+            item = std::move(write_behind_queue_.front());
+            write_behind_queue_.pop_front();
+        }
+
+        // Start write-back of the range without waiting for it; the
+        // descriptor stays open while `item` holds the upload
+        UploadState& state = *item.upload;
+        if (state.done) continue;
+        sync_file_range(state.fd, static_cast<off_t>(item.offset), static_cast<off_t>(item.length),
+                        SYNC_FILE_RANGE_WRITE);
+    }
+}
+
+common::EmptyResult LinuxFileTransfer::upload_copy_from(
+    const std::string& path,
+    uint64_t offset,
+    const std::string& source,
+    uint64_t source_offset,
+    uint64_t length
+) {
+    auto state = find_upload(path);
+    if (!state) {
         return common::EmptyResult::err(
             common::ErrorCode::Unknown,
-            "Write error at offset " + std::to_string(state.bytes_written));
+            "No active upload for: " + path);
     }
 
-    state.bytes_written += bytes_written;
+    int source_fd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source_fd < 0) {
+        return common::EmptyResult::err(
+            errno == ENOENT ? common::ErrorCode::DeviceNotFound : common::ErrorCode::Unknown,
+            "Cannot open " + source + ": " + strerror(errno));
+    }
 
-    return common::EmptyResult::success();
+    WriteBehind flush{};
+    common::EmptyResult result = common::EmptyResult::success();
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        result = copy_locked(*state, source_fd, source, offset, source_offset, length);
+        if (result.is_ok()) flush = take_dirty(state);
+    }
+    close(source_fd);
+    queue_write_behind(std::move(flush));
+    return result;
 }
 
 common::EmptyResult LinuxFileTransfer::upload_finish(const std::string& path) {
-    std::lock_guard<std::mutex> lock(uploads_mutex_);
+    return finish_upload(path, nullptr);
+}
 
-    auto it = active_uploads_.find(path);
-    if (it == active_uploads_.end()) {
+common::Result<uint64_t> LinuxFileTransfer::upload_finish_digest(const std::string& path) {
+    uint64_t digest = 0;
+    auto result = finish_upload(path, &digest);
+    if (result.is_err()) return result.error();
+    return digest;
+}
+
+common::EmptyResult LinuxFileTransfer::finish_upload(const std::string& path, uint64_t* digest) {
+    auto state = take_upload(path);
+    if (!state) {
         return common::EmptyResult::err(
             common::ErrorCode::Unknown,
             "No active upload for: " + path);
     }
 
-    UploadState& state = it->second;
+    if (!state->temp_path.empty()) {  // Dropped with its temporary file
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Delta upload must end with delta_finish: " + path);
+    }
 
-    // Sync and close
-    fsync(state.fd);
-    close(state.fd);
+    std::lock_guard<std::mutex> lock(state->mutex);
+
+    // Sync and close: write-behind has already pushed out all but the tail
+    int sync_result = fsync(state->fd);
 
     // Verify size if expected size was specified
-    if (state.expected_size > 0 && state.bytes_written != state.expected_size) {
+    if (state->expected_size > 0 && state->bytes_written != state->expected_size) {
         // Delete incomplete file
         unlink(path.c_str());
-        active_uploads_.erase(it);
         return common::EmptyResult::err(
             common::ErrorCode::Unknown,
-            "Size mismatch: expected " + std::to_string(state.expected_size) +
-            ", got " + std::to_string(state.bytes_written));
+            "Size mismatch: expected " + std::to_string(state->expected_size) +
+            ", got " + std::to_string(state->bytes_written));
     }
 
-    active_uploads_.erase(it);
+    if (sync_result != 0) {
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Sync failed for " + path + ": " + strerror(errno));
+    }
+
+    if (digest) {
+        // Blocks that did not arrive front to back are read back (page cache)
+        struct stat st;
+        if (fstat(state->fd, &st) != 0) {
+            return common::EmptyResult::err(
+                common::ErrorCode::Unknown,
+                "Cannot stat upload: " + path);
+        }
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        const uint64_t block = state->digest.block_size();
+        std::vector<uint8_t> buffer;
+        for (uint64_t index : state->digest.incomplete_blocks(file_size)) {
+            uint64_t offset = index * block;
+            buffer.resize(static_cast<size_t>((std::min)(block, file_size - offset)));
+            ssize_t n = pread(state->fd, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+            if (n != static_cast<ssize_t>(buffer.size())) {
+                return common::EmptyResult::err(
+                    common::ErrorCode::Unknown,
+                    "Read back failed at offset " + std::to_string(offset) + ": " + path);
+            }
+            state->digest.set_block(index, common::checksum::xxh64(buffer.data(), buffer.size()));
+        }
+        *digest = state->digest.finish(file_size);
+    }
     return common::EmptyResult::success();
 }
 
 common::EmptyResult LinuxFileTransfer::upload_cancel(const std::string& path) {
+    auto state = take_upload(path);
+    if (!state) {
+        return common::EmptyResult::success();  // Already cancelled/finished
+    }
+
+    // Delete partial file; the handle closes with the last reference.
+    // A delta upload only removes its temporary file (with the state).
+    if (state->temp_path.empty()) unlink(path.c_str());
+
+    return common::EmptyResult::success();
+}
+
+// ============================================================================
+// Delta Upload
+// ============================================================================
+
+common::EmptyResult LinuxFileTransfer::delta_start(
+    const std::string& path,
+    uint64_t new_size
+) {
+    take_upload(path);
+
+    int basis_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (basis_fd < 0) {
+        return common::EmptyResult::err(
+            errno == EACCES ? common::ErrorCode::PermissionDenied : common::ErrorCode::Unknown,
+            "Cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(basis_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(basis_fd);
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Not a regular file: " + path);
+    }
+
+    auto state = std::make_shared<UploadState>();
+    state->basis_fd = basis_fd;
+
+    // Same directory as the target, so the final rename cannot cross filesystems
+    static std::atomic<uint64_t> sequence{0};
+    std::string temp_path = path + ".delta." + std::to_string(getpid()) + "." + std::to_string(sequence++);
+    int fd = open(temp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+    if (fd < 0) {
+        return common::EmptyResult::err(
+            common::ErrorCode::PermissionDenied,
+            "Cannot create " + temp_path + ": " + strerror(errno));
+    }
+    state->fd = fd;
+    state->temp_path = temp_path;
+    fchmod(fd, st.st_mode & 07777);  // Creation mode is masked by the umask
+
+    if (new_size > 0 &&
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(new_size)) != 0 &&
+        errno == ENOSPC) {
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Not enough disk space for " + std::to_string(new_size) + " bytes: " + path);
+    }
+
+    state->path = path;
+    state->expected_size = new_size;
+    state->start_time = std::chrono::steady_clock::now();
+
     std::lock_guard<std::mutex> lock(uploads_mutex_);
+    active_uploads_[path] = std::move(state);
+    return common::EmptyResult::success();
+}
 
-    auto it = active_uploads_.find(path);
-    if (it == active_uploads_.end()) {
-        return common::EmptyResult::success();  // Already cancelled/finished
+common::EmptyResult LinuxFileTransfer::copy_locked(
+    UploadState& state,
+    int source_fd,
+    const std::string& source,
+    uint64_t dst,
+    uint64_t src,
+    uint64_t length
+) {
+    if (state.done) {
+        return common::EmptyResult::err(
+            common::ErrorCode::Cancelled,
+            "Upload closed: " + state.path);
+    }
+    auto range = check_range(state, dst, length);
+    if (range.is_err()) return range;
+
+    // copy_file_range stays in the kernel (and shares extents on
+    // filesystems with reflinks); pread/pwrite where it is unsupported
+    uint64_t done = 0;
+    bool kernel_copy = true;
+    std::vector<uint8_t> buffer;
+    while (done < length) {
+        size_t want = static_cast<size_t>((std::min)(length - done, uint64_t(1) << 30));
+        ssize_t n;
+        if (kernel_copy) {
+            loff_t in = static_cast<loff_t>(src + done);
+            loff_t out = static_cast<loff_t>(dst + done);
+            n = copy_file_range(source_fd, &in, state.fd, &out, want, 0);
+            if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                kernel_copy = false;
+                continue;
+            }
+        } else {
+            buffer.resize((std::min)(want, size_t(interfaces::FILE_TRANSFER_CHUNK_SIZE)));
+            n = pread(source_fd, buffer.data(), buffer.size(), static_cast<off_t>(src + done));
+            if (n > 0) {
+                size_t got = static_cast<size_t>(n);
+                size_t written = 0;
+                while (written < got) {
+                    ssize_t w = pwrite(state.fd, buffer.data() + written, got - written,
+                                       static_cast<off_t>(dst + done + written));
+                    if (w < 0 && errno == EINTR) continue;
+                    if (w < 0) {
+                        return common::EmptyResult::err(
+                            common::ErrorCode::Unknown,
+                            "Write error at offset " + std::to_string(dst + done + written) + ": " + strerror(errno));
+                    }
+                    written += static_cast<size_t>(w);
+                }
+            }
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            return common::EmptyResult::err(
+                common::ErrorCode::Unknown,
+                "Copy error at offset " + std::to_string(src + done) + ": " + strerror(errno));
+        }
+        if (n == 0) {
+            return common::EmptyResult::err(
+                common::ErrorCode::Unknown,
+                "Copy past the end of " + source + " at offset " + std::to_string(src + done));
+        }
+        done += static_cast<uint64_t>(n);
     }
 
-    UploadState& state = it->second;
+    state.bytes_written += length;
+    state.copied_bytes += length;
+    mark_dirty(state, dst, length);
+    return common::EmptyResult::success();
+}
 
-    // Close handle and delete partial file
-    close(state.fd);
-    unlink(path.c_str());
+common::EmptyResult LinuxFileTransfer::delta_copy(
+    const std::string& path,
+    uint64_t dst,
+    uint64_t src,
+    uint64_t length
+) {
+    auto state = find_upload(path);
+    if (!state || state->temp_path.empty()) {
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "No active delta upload for: " + path);
+    }
 
-    active_uploads_.erase(it);
+    WriteBehind flush{};
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto result = copy_locked(*state, state->basis_fd, path, dst, src, length);
+        if (result.is_err()) return result;
+        flush = take_dirty(state);
+    }
+    queue_write_behind(std::move(flush));
     return common::EmptyResult::success();
 }
 
+common::Result<uint64_t> LinuxFileTransfer::delta_finish(
+    const std::string& path,
+    uint32_t expected_crc32c
+) {
+    auto state = take_upload(path);
+    if (!state || state->temp_path.empty()) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::Unknown,
+            "No active delta upload for: " + path);
+    }
+
+    // Errors return with the state, which removes the temporary file
+    std::lock_guard<std::mutex> lock(state->mutex);
+
+    if (state->bytes_written != state->expected_size) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::Unknown,
+            "Size mismatch: expected " + std::to_string(state->expected_size) +
+            ", got " + std::to_string(state->bytes_written));
+    }
+    if (ftruncate(state->fd, static_cast<off_t>(state->expected_size)) != 0) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::Unknown,
+            "Cannot size " + state->temp_path + ": " + strerror(errno));
+    }
+
+    // One pass over the result (mostly page cache): the CRC32C proves the
+    // block matches and copies, the digest blocks are what a download reports
+    common::checksum::ChunkDigest digest(interfaces::FILE_TRANSFER_CHUNK_SIZE);
+    uint32_t crc = 0;
+    std::vector<uint8_t> buffer(interfaces::FILE_TRANSFER_CHUNK_SIZE);
+    uint64_t pos = 0;
+    while (pos < state->expected_size) {
+        size_t want = static_cast<size_t>((std::min)(uint64_t(buffer.size()), state->expected_size - pos));
+        ssize_t n = pread(state->fd, buffer.data(), want, static_cast<off_t>(pos));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            return common::Result<uint64_t>::err(
+                common::ErrorCode::Unknown,
+                "Read back failed at offset " + std::to_string(pos) + ": " + path);
+        }
+        crc = common::checksum::crc32c(buffer.data(), static_cast<size_t>(n), crc);
+        digest.update(pos, buffer.data(), static_cast<size_t>(n));
+        pos += static_cast<uint64_t>(n);
+    }
+    if (crc != expected_crc32c) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::Unknown,
+            "Checksum mismatch for " + path + ": the file changed or a block matched falsely");
+    }
+
+    if (fsync(state->fd) != 0) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::Unknown,
+            "Sync failed for " + path + ": " + strerror(errno));
+    }
+    if (::rename(state->temp_path.c_str(), path.c_str()) != 0) {
+        return common::Result<uint64_t>::err(
+            common::ErrorCode::PermissionDenied,
+            "Cannot replace " + path + ": " + strerror(errno));
+    }
+    state->temp_path.clear();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - state->start_time).count();
+    std::cout << "[LinuxFileTransfer] Delta upload " << path << ": " << state->copied_bytes
+              << " bytes reused, " << (state->expected_size - state->copied_bytes)
+              << " sent, " << seconds << "s" << std::endl;
+    return digest.finish(state->expected_size);
+}
+
 // ============================================================================
 // Utility
 // ============================================================================
@@ -1,5 +1,10 @@
 #pragma once
 #include "interfaces/IFileTransfer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 #include <mutex>
 
@@ -10,8 +15,18 @@ namespace linux_os {
 // LinuxFileTransfer - High-performance file transfer for Linux
 // ============================================================================
 // Uses POSIX APIs for optimal performance:
-// - opendir/readdir/stat for directory listing
+// - Listing: getdents64 in bulk, then one statx per entry relative to
+//   the directory descriptor (d_type spares the second stat of non-links);
+//   directories with many thousand entries are stat'ed on several threads
+// - Directory watches: one inotify descriptor for all watched directories,
+//   read by a thread started with the first watch
 // - open/read/write with buffering for file I/O
+// - Uploads: fallocate up front, pwrite at explicit offsets under a
+//   per-upload lock (the map lock only covers lookups), write-behind
+//   with sync_file_range so upload_finish's fsync has little left to do
+// - Delta uploads: temp file beside the target, basis ranges copied with
+//   copy_file_range (reflinks where the filesystem can), atomic rename
+// - open_for_send: descriptor handed to the connection writer (sendfile)
 // - statvfs for disk space queries
 //
 // Memory Optimization Notes:
@@ -39,12 +54,29 @@ public:
     common::EmptyResult delete_path(
         const std::string& path) override;
 
+    // inotify: entries created, deleted, moved, written or changed attributes
+    common::EmptyResult watch_directory(
+        const std::string& path,
+        interfaces::DirectoryChangeCallback on_change) override;
+
+    void unwatch_directory(
+        const std::string& path) override;
+
+    // Reads the inotify queue on the calling thread (the kernel queued the
+    // events before the operations causing them returned)
+    void flush_directory_changes() override;
+
     // ========== Download ==========
 
     common::EmptyResult download_file(
         const std::string& path,
         interfaces::DataChunkCallback on_chunk,
-        interfaces::ProgressCallback on_progress = nullptr) override;
+        interfaces::ProgressCallback on_progress = nullptr,
+        interfaces::ByteRange range = {}) override;
+
+    // Kernel send path: the writer sendfile()s straight from this descriptor
+    common::Result<std::shared_ptr<const interfaces::IFileSource>> open_for_send(
+        const std::string& path) override;
 
     // ========== Upload ==========
 
@@ -57,12 +89,46 @@ public:
         const uint8_t* data,
         size_t size) override;
 
+    common::EmptyResult upload_write_at(
+        const std::string& path,
+        uint64_t offset,
+        const uint8_t* data,
+        size_t size) override;
+
+    // copy_file_range from the source descriptor into the upload
+    common::EmptyResult upload_copy_from(
+        const std::string& path,
+        uint64_t offset,
+        const std::string& source,
+        uint64_t source_offset,
+        uint64_t length) override;
+
     common::EmptyResult upload_finish(
         const std::string& path) override;
 
+    // Digest from the blocks hashed as they were written
+    common::Result<uint64_t> upload_finish_digest(
+        const std::string& path) override;
+
     common::EmptyResult upload_cancel(
         const std::string& path) override;
 
+    // ========== Delta Upload ==========
+
+    common::EmptyResult delta_start(
+        const std::string& path,
+        uint64_t new_size) override;
+
+    common::EmptyResult delta_copy(
+        const std::string& path,
+        uint64_t dst,
+        uint64_t src,
+        uint64_t length) override;
+
+    common::Result<uint64_t> delta_finish(
+        const std::string& path,
+        uint32_t expected_crc32c) override;
+
     // ========== Utility ==========
 
     common::Result<uint64_t> get_free_space(
@@ -72,18 +138,123 @@ public:
         const std::string& old_path,
         const std::string& new_path) override;
 
+    // Dirty bytes an upload accumulates before write-back is started
+    static constexpr uint64_t WRITE_BEHIND_BYTES = 8 * 1024 * 1024;
+
+    // Listing: getdents64 buffer, and entries per metadata thread
+    static constexpr size_t LIST_BUFFER_SIZE = 256 * 1024;
+    static constexpr size_t LIST_ENTRIES_PER_THREAD = 4096;
+    static constexpr size_t LIST_MAX_THREADS = 8;
+
+    // inotify read buffer
+    static constexpr size_t WATCH_BUFFER_SIZE = 64 * 1024;
+
 private:
-    // Upload state tracking
+    // list_directory's reading of a path ("", "." and "~" list the root)
+    static std::string resolve_directory(const std::string& path);
+
+    struct DirEntry {
+        std::string name;
+        unsigned char type;  // d_type (DT_UNKNOWN where the filesystem does not say)
+    };
+    struct EntryStat {
+        uint32_t mode = 0;
+        uint64_t size = 0;
+        uint64_t mtime = 0;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+    };
+    // False with errno set on a read error
+    static bool read_dir_entries(int dir_fd, std::vector<DirEntry>& entries);
+    static bool stat_entry(int dir_fd, const char* name, bool follow, EntryStat& out);
+    static void fill_entry(int dir_fd, const std::string& prefix, DirEntry& entry,
+                           interfaces::FileInfo& info);
+
+    // Upload state tracking. Owns the descriptor: the write-behind thread
+    // may still hold a reference after the upload has finished.
     struct UploadState {
-        int fd = -1;
+        ~UploadState();
+
+        std::mutex mutex;             // Serialises writes to this upload only
+        int fd = -1;                  // Fixed for the state's lifetime
         std::string path;
         uint64_t expected_size = 0;
         uint64_t bytes_written = 0;
+        uint64_t append_offset = 0;   // upload_chunk position
+        uint64_t dirty_begin = 0;     // Written since the last write-back
+        uint64_t dirty_end = 0;
+        common::checksum::ChunkDigest digest{interfaces::FILE_TRANSFER_CHUNK_SIZE};
+        std::atomic<bool> done{false};
         std::chrono::steady_clock::time_point start_time;
+
+        // Delta uploads: fd is the temporary file (removed with the state
+        // unless it was renamed into place), basis_fd the file it replaces
+        std::string temp_path;
+        int basis_fd = -1;
+        uint64_t copied_bytes = 0;    // Filled by copies rather than sent bytes
+    };
+
+    // Lookup under uploads_mutex_; the upload's own mutex guards the rest
+    std::shared_ptr<UploadState> find_upload(const std::string& path);
+    std::shared_ptr<UploadState> take_upload(const std::string& path);
+
+    common::EmptyResult write_upload(const std::string& path, bool append, uint64_t offset,
+                                     const uint8_t* data, size_t size);
+    common::EmptyResult write_locked(UploadState& state, uint64_t offset,
+                                     const uint8_t* data, size_t size);
+    common::EmptyResult copy_locked(UploadState& state, int source_fd, const std::string& source,
+                                    uint64_t dst, uint64_t src, uint64_t length);
+    // Positional writes and copies must land inside the announced size:
+    // an offset from the client must not grow a sparse file (or the digest)
+    static common::EmptyResult check_range(const UploadState& state, uint64_t offset, uint64_t length);
+
+    // digest: null to skip hashing the blocks written out of order
+    common::EmptyResult finish_upload(const std::string& path, uint64_t* digest);
+
+    // Write-behind: dirty ranges queued by writers, handed to the kernel
+    // (SYNC_FILE_RANGE_WRITE) off the upload path
+    struct WriteBehind {
+        std::shared_ptr<UploadState> upload;
+        uint64_t offset;
+        uint64_t length;
     };
+    static void mark_dirty(UploadState& state, uint64_t offset, uint64_t length);
+    // Under the upload's mutex: the dirty span, once it is large enough
+    static WriteBehind take_dirty(const std::shared_ptr<UploadState>& state);
+    void queue_write_behind(WriteBehind flush);
+    void write_behind_loop();
 
     std::mutex uploads_mutex_;
-    std::unordered_map<std::string, UploadState> active_uploads_;
+    std::unordered_map<std::string, std::shared_ptr<UploadState>> active_uploads_;
+
+    std::mutex write_behind_mutex_;
+    std::condition_variable write_behind_cv_;
+    std::deque<WriteBehind> write_behind_queue_;
+    bool write_behind_stop_ = false;
+    std::thread write_behind_thread_;
+
+    // Directory watches. Several paths may share a watch descriptor (the
+    // kernel keys watches by inode); callbacks run without watch_mutex_ held,
+    // serialised by watch_read_mutex_ (the watch thread and
+    // flush_directory_changes both read the inotify queue)
+    struct Watch {
+        std::string path;     // As passed to watch_directory
+        std::string prefix;   // Directory path with a trailing '/'
+        int wd;
+        interfaces::DirectoryChangeCallback on_change;
+    };
+    void remove_watch_locked(std::shared_ptr<Watch> watch);  // (A copy: the map entry is erased)
+    void read_watch_events();  // Under watch_read_mutex_
+    void watch_loop();
+
+    std::mutex watch_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Watch>> watches_;
+    std::unordered_map<int, std::vector<std::shared_ptr<Watch>>> watches_by_wd_;
+    int inotify_fd_ = -1;     // Created with the first watch
+    int watch_wake_fd_ = -1;  // eventfd: stops watch_thread_
+    std::thread watch_thread_;
+    std::mutex watch_read_mutex_;
+    std::vector<char> watch_buffer_;  // Under watch_read_mutex_
 
     // Helper: Create recursive directories
     static bool create_dirs_recursive(const std::string& path);
@@ -11,6 +11,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <errno.h>
+#include <thread>
+#include <chrono>
 
 namespace platform {
 namespace linux_os {
@@ -206,21 +209,45 @@ namespace linux_os {
         ev.type = type;
         ev.code = code;
         ev.value = value;
-        write(uinput_fd_, &ev, sizeof(ev));
+        events_.push_back(ev);
     }
 
     void LinuxUInputInjector::syn() {
         emit(EV_SYN, SYN_REPORT, 0);
     }
 
-    common::EmptyResult LinuxUInputInjector::move_mouse(float x_percent, float y_percent) {
-        if (!initialized_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "uinput injector not initialized: " + error_message_
-            );
+    common::EmptyResult LinuxUInputInjector::flush() {
+        if (events_.empty()) return common::Result<common::Ok>::success();
+
+        // uinput consumes whole input_events; one write() for the batch
+        const size_t total = events_.size() * sizeof(struct input_event);
+        const char* data = reinterpret_cast<const char*>(events_.data());
+        size_t written = 0;
+        while (written < total) {
+            ssize_t n = write(uinput_fd_, data + written, total - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                events_.clear();
+                return common::Result<common::Ok>::err(
+                    common::ErrorCode::Unknown,
+                    std::string("uinput write failed: ") + strerror(errno)
+                );
+            }
+            written += static_cast<size_t>(n);
         }
+        events_.clear();
+
+        return common::Result<common::Ok>::success();
+    }
+
+    common::EmptyResult LinuxUInputInjector::not_initialized() const {
+        return common::Result<common::Ok>::err(
+            common::ErrorCode::PermissionDenied,
+            "uinput injector not initialized: " + error_message_
+        );
+    }
 
+    void LinuxUInputInjector::queue_move(float x_percent, float y_percent) {
         // Clamp input to 0.0 - 1.0 range
         x_percent = std::clamp(x_percent, 0.0f, 1.0f);
         y_percent = std::clamp(y_percent, 0.0f, 1.0f);
@@ -233,18 +260,9 @@ namespace linux_os {
         emit(EV_ABS, ABS_X, x);
         emit(EV_ABS, ABS_Y, y);
         syn();
-
-        return common::Result<common::Ok>::success();
     }
 
-    common::EmptyResult LinuxUInputInjector::click_mouse(interfaces::MouseButton button, bool is_down) {
-        if (!initialized_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "uinput injector not initialized: " + error_message_
-            );
-        }
-
+    void LinuxUInputInjector::queue_button(interfaces::MouseButton button, bool is_down) {
         // Map our button enum to Linux button codes
         int btn_code;
         switch (button) {
@@ -265,18 +283,9 @@ namespace linux_os {
         // Emit button event (1 = pressed, 0 = released)
         emit(EV_KEY, btn_code, is_down ? 1 : 0);
         syn();
-
-        return common::Result<common::Ok>::success();
     }
 
-    common::EmptyResult LinuxUInputInjector::scroll_mouse(int delta) {
-        if (!initialized_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "uinput injector not initialized: " + error_message_
-            );
-        }
-
+    void LinuxUInputInjector::queue_scroll(int delta) {
         // REL_WHEEL: positive = scroll up, negative = scroll down
         // Normalize delta to reasonable range (-10 to 10)
         int normalized = std::clamp(delta / 120, -10, 10);  // Windows WHEEL_DELTA is 120
@@ -284,8 +293,27 @@ namespace linux_os {
 
         emit(EV_REL, REL_WHEEL, normalized);
         syn();
+    }
 
-        return common::Result<common::Ok>::success();
+    common::EmptyResult LinuxUInputInjector::move_mouse(float x_percent, float y_percent) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_move(x_percent, y_percent);
+        return flush();
+    }
+
+    common::EmptyResult LinuxUInputInjector::click_mouse(interfaces::MouseButton button, bool is_down) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_button(button, is_down);
+        return flush();
+    }
+
+    common::EmptyResult LinuxUInputInjector::scroll_mouse(int delta) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_scroll(delta);
+        return flush();
     }
 
     // =========================================================================
@@ -395,33 +423,22 @@ namespace linux_os {
         }
     }
 
-    common::EmptyResult LinuxUInputInjector::press_key(interfaces::KeyCode key, bool is_down) {
-        if (!initialized_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "uinput injector not initialized: " + error_message_
-            );
-        }
-
+    void LinuxUInputInjector::queue_key(interfaces::KeyCode key, bool is_down) {
         int evdev_key = to_evdev_key(key);
-        if (evdev_key == 0) {
-            return common::Result<common::Ok>::success();  // Unknown key, ignore
-        }
+        if (evdev_key == 0) return;  // Unknown key, ignore
 
         emit(EV_KEY, evdev_key, is_down ? 1 : 0);
         syn();
-
-        return common::Result<common::Ok>::success();
     }
 
-    common::EmptyResult LinuxUInputInjector::send_text(const std::string& text) {
-        if (!initialized_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "uinput injector not initialized: " + error_message_
-            );
-        }
+    common::EmptyResult LinuxUInputInjector::press_key(interfaces::KeyCode key, bool is_down) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_key(key, is_down);
+        return flush();
+    }
 
+    void LinuxUInputInjector::queue_text(const std::string& text) {
         // Simple text sending: map ASCII characters to key events
         // This is limited - for full Unicode support, consider using ydotool or similar
         for (char c : text) {
@@ -494,8 +511,43 @@ namespace linux_os {
                 }
             }
         }
+    }
 
-        return common::Result<common::Ok>::success();
+    common::EmptyResult LinuxUInputInjector::send_text(const std::string& text) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_text(text);
+        return flush(); // Whole string in one write()
+    }
+
+    common::EmptyResult LinuxUInputInjector::inject_batch(const interfaces::InputOp* ops, size_t count) {
+        if (!initialized_) return not_initialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        using Type = interfaces::InputOp::Type;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& op = ops[i];
+            auto button = static_cast<interfaces::MouseButton>(op.code);
+            switch (op.type) {
+                case Type::Move:   queue_move(op.x, op.y); break;
+                case Type::Button: queue_button(button, op.down); break;
+                case Type::Scroll: queue_scroll(op.code); break;
+                case Type::Key:    queue_key(static_cast<interfaces::KeyCode>(op.code), op.down); break;
+                case Type::Text:   queue_text(op.text); break;
+                case Type::Click: {
+                    // The button must stay down for a moment: write what we
+                    // have plus the press, hold, and continue with the release
+                    queue_button(button, true);
+                    auto res = flush();
+                    if (res.is_err()) return res;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(CLICK_HOLD_MS));
+                    queue_button(button, false);
+                    break;
+                }
+            }
+        }
+
+        return flush();
     }
 
 } // namespace linux_os
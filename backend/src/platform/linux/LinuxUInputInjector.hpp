@@ -1,6 +1,10 @@
 #pragma once
 #include "interfaces/IInputInjector.hpp"
+#include <mutex>
 #include <string>
+#include <vector>
+
+struct input_event; // <linux/input.h>
 
 namespace platform {
 namespace linux_os {
@@ -26,6 +30,10 @@ namespace linux_os {
      *
      * Works on: All Linux distros (Ubuntu, Fedora, Arch, Debian, etc.)
      * Display Server: X11, Wayland, Headless (via libinput)
+     *
+     * Events are accumulated in a buffer and written with a single write()
+     * per call (a move is ABS_X + ABS_Y + SYN in one syscall, a whole
+     * send_text string in one syscall), or per inject_batch().
      */
     class LinuxUInputInjector : public interfaces::IInputInjector {
     public:
@@ -38,6 +46,7 @@ namespace linux_os {
         common::EmptyResult scroll_mouse(int delta) override;
         common::EmptyResult press_key(interfaces::KeyCode key, bool is_down) override;
         common::EmptyResult send_text(const std::string& text) override;
+        common::EmptyResult inject_batch(const interfaces::InputOp* ops, size_t count) override;
 
         // Check if uinput is available
         bool is_available() const { return initialized_; }
@@ -54,11 +63,25 @@ namespace linux_os {
         int screen_width_;
         int screen_height_;
 
+        // Pending events, written by flush(). Sessions inject concurrently:
+        // one call at a time, which also keeps a batch's events together
+        std::mutex mutex_;
+        std::vector<struct input_event> events_;
+
         // Helper functions
         bool setup_device();
         void emit(int type, int code, int value);
         void syn();
+        common::EmptyResult flush();
+        common::EmptyResult not_initialized() const;
         bool detect_screen_size();
+
+        // Append one operation's events to events_ (no I/O; mutex_ held)
+        void queue_move(float x_percent, float y_percent);
+        void queue_button(interfaces::MouseButton button, bool is_down);
+        void queue_scroll(int delta);
+        void queue_key(interfaces::KeyCode key, bool is_down);
+        void queue_text(const std::string& text);
     };
 
 } // namespace linux_os
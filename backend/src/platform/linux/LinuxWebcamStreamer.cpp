@@ -1,4 +1,5 @@
 #include "LinuxWebcamStreamer.hpp"
+#include "common/JpegFrameSplitter.hpp"
 #include <iostream>
 #include <vector>
 #include <cstdio>
@@ -51,62 +52,35 @@ namespace linux_os {
             return common::Result<common::Ok>::err(common::ErrorCode::EncoderError, "Failed to start ffmpeg");
         }
 
-        // JPEG markers
-        const uint8_t soi_marker[2] = {0xFF, 0xD8}; // Start Of Image
-        const uint8_t eoi_marker[2] = {0xFF, 0xD9}; // End Of Image
-
-        std::vector<uint8_t> read_buffer(65536);
-        std::vector<uint8_t> frame_buffer;
-        frame_buffer.reserve(256 * 1024);
+        // Incremental SOI..EOI splitter (linear scan, reads straight into its buffer)
+        common::JpegFrameSplitter splitter;
+        const size_t READ_SIZE = 65536;
 
         uint64_t pts = 0;
         int frame_count = 0;
 
-        while (!token.is_cancellation_requested()) {
-            size_t n = fread(read_buffer.data(), 1, read_buffer.size(), ffmpeg_pipe_);
-            if (n <= 0) break;
-
-            frame_buffer.insert(frame_buffer.end(), read_buffer.begin(), read_buffer.begin() + n);
-
-            // Extract complete JPEG frames
-            while (true) {
-                auto soi_it = std::search(frame_buffer.begin(), frame_buffer.end(), soi_marker, soi_marker + 2);
-                if (soi_it == frame_buffer.end()) {
-                    frame_buffer.clear();
-                    break;
-                }
-
-                auto eoi_it = std::search(soi_it + 2, frame_buffer.end(), eoi_marker, eoi_marker + 2);
-                if (eoi_it == frame_buffer.end()) {
-                    if (soi_it != frame_buffer.begin()) {
-                        frame_buffer.erase(frame_buffer.begin(), soi_it);
-                    }
-                    break;
-                }
-
-                eoi_it += 2;
-                std::vector<uint8_t> jpeg_frame(soi_it, eoi_it);
-
-                auto data_ptr = std::make_shared<const std::vector<uint8_t>>(std::move(jpeg_frame));
-                callback(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
-
-                frame_count++;
-                if (frame_count % 30 == 0) {
-                    std::cout << "[Webcam] Sent MJPEG frame #" << frame_count << " (" << data_ptr->size() << " bytes)" << std::endl;
-                }
+        auto on_frame = [&](const uint8_t* data, size_t size) {
+            // Send frame - all MJPEG frames are KeyFrames
+            auto data_ptr = common::FrameBufferPool::global().acquire_copy(data, size);
+            callback(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
 
-                frame_buffer.erase(frame_buffer.begin(), eoi_it);
+            frame_count++;
+            if (frame_count % 30 == 0) {
+                std::cout << "[Webcam] Sent MJPEG frame #" << frame_count << " (" << size << " bytes)" << std::endl;
             }
+        };
 
-            if (frame_buffer.size() > 1024 * 1024) {
-                std::cerr << "[Webcam] WARNING: Frame buffer overflow, clearing" << std::endl;
-                frame_buffer.clear();
-            }
+        while (!token.is_cancellation_requested()) {
+            size_t n = fread(splitter.prepare(READ_SIZE), 1, READ_SIZE, ffmpeg_pipe_);
+            if (n <= 0) break;
+
+            splitter.commit(n, on_frame);
         }
 
         pclose(ffmpeg_pipe_);
         ffmpeg_pipe_ = nullptr;
-        std::cout << "[Webcam] MJPEG stream stopped. Total frames: " << frame_count << std::endl;
+        std::cout << "[Webcam] MJPEG stream stopped. Total frames: " << frame_count
+                  << ", discarded: " << (splitter.stats().resyncs + splitter.stats().overflows) << std::endl;
         return common::Result<common::Ok>::success();
     }
 
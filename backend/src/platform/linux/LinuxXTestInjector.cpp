@@ -52,14 +52,7 @@ namespace linux_os {
         }
     }
 
-    common::EmptyResult LinuxXTestInjector::move_mouse(float x_percent, float y_percent) {
-        if (!initialized_ || !display_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "XTest injector not initialized"
-            );
-        }
-
+    bool LinuxXTestInjector::queue_move(float x_percent, float y_percent) {
         // Clamp input to 0.0 - 1.0 range
         x_percent = std::clamp(x_percent, 0.0f, 1.0f);
         y_percent = std::clamp(y_percent, 0.0f, 1.0f);
@@ -69,7 +62,51 @@ namespace linux_os {
         int y = static_cast<int>(y_percent * screen_height_);
 
         // Use XTest to move the mouse cursor
-        Bool result = XTestFakeMotionEvent(display_, -1, x, y, CurrentTime);
+        return XTestFakeMotionEvent(display_, -1, x, y, CurrentTime);
+    }
+
+    bool LinuxXTestInjector::queue_button(interfaces::MouseButton button, bool is_down, unsigned long delay_ms) {
+        // Map our button enum to X11 button codes
+        unsigned int x_button;
+        switch (button) {
+            case interfaces::MouseButton::Left:
+                x_button = Button1;
+                break;
+            case interfaces::MouseButton::Right:
+                x_button = Button3;
+                break;
+            case interfaces::MouseButton::Middle:
+                x_button = Button2;
+                break;
+            default:
+                x_button = Button1;
+                break;
+        }
+
+        return XTestFakeButtonEvent(display_, x_button, is_down ? True : False, delay_ms);
+    }
+
+    void LinuxXTestInjector::queue_scroll(int delta) {
+        // X11 scroll: Button4 = scroll up, Button5 = scroll down
+        int clicks = std::abs(delta) / 120;
+        if (clicks == 0) clicks = 1;
+        unsigned int button = (delta > 0) ? Button4 : Button5;
+
+        for (int i = 0; i < clicks; ++i) {
+            XTestFakeButtonEvent(display_, button, True, CurrentTime);
+            XTestFakeButtonEvent(display_, button, False, CurrentTime);
+        }
+    }
+
+    common::EmptyResult LinuxXTestInjector::move_mouse(float x_percent, float y_percent) {
+        if (!initialized_ || !display_) {
+            return common::Result<common::Ok>::err(
+                common::ErrorCode::PermissionDenied,
+                "XTest injector not initialized"
+            );
+        }
+
+        Bool result = queue_move(x_percent, y_percent);
         XFlush(display_);
 
         if (!result) {
@@ -90,24 +127,7 @@ namespace linux_os {
             );
         }
 
-        // Map our button enum to X11 button codes
-        unsigned int x_button;
-        switch (button) {
-            case interfaces::MouseButton::Left:
-                x_button = Button1;
-                break;
-            case interfaces::MouseButton::Right:
-                x_button = Button3;
-                break;
-            case interfaces::MouseButton::Middle:
-                x_button = Button2;
-                break;
-            default:
-                x_button = Button1;
-                break;
-        }
-
-        Bool result = XTestFakeButtonEvent(display_, x_button, is_down ? True : False, CurrentTime);
+        Bool result = queue_button(button, is_down);
         XFlush(display_);
 
         if (!result) {
@@ -128,15 +148,7 @@ namespace linux_os {
             );
         }
 
-        // X11 scroll: Button4 = scroll up, Button5 = scroll down
-        int clicks = std::abs(delta) / 120;
-        if (clicks == 0) clicks = 1;
-        unsigned int button = (delta > 0) ? Button4 : Button5;
-
-        for (int i = 0; i < clicks; ++i) {
-            XTestFakeButtonEvent(display_, button, True, CurrentTime);
-            XTestFakeButtonEvent(display_, button, False, CurrentTime);
-        }
+        queue_scroll(delta);
         XFlush(display_);
 
         return common::Result<common::Ok>::success();
@@ -248,31 +260,17 @@ namespace linux_os {
         }
     }
 
-    common::EmptyResult LinuxXTestInjector::press_key(interfaces::KeyCode key, bool is_down) {
-        if (!initialized_ || !display_) {
-            return common::Result<common::Ok>::err(
-                common::ErrorCode::PermissionDenied,
-                "XTest injector not initialized"
-            );
-        }
-
+    void LinuxXTestInjector::queue_key(interfaces::KeyCode key, bool is_down) {
         KeySym keysym = to_x11_keysym(key);
-        if (keysym == NoSymbol) {
-            return common::Result<common::Ok>::success();  // Unknown key, ignore
-        }
+        if (keysym == NoSymbol) return;  // Unknown key, ignore
 
         X11KeyCode keycode = XKeysymToKeycode(display_, keysym);
-        if (keycode == 0) {
-            return common::Result<common::Ok>::success();  // No keycode mapping
-        }
+        if (keycode == 0) return;  // No keycode mapping
 
         XTestFakeKeyEvent(display_, keycode, is_down ? True : False, CurrentTime);
-        XFlush(display_);
-
-        return common::Result<common::Ok>::success();
     }
 
-    common::EmptyResult LinuxXTestInjector::send_text(const std::string& text) {
+    common::EmptyResult LinuxXTestInjector::press_key(interfaces::KeyCode key, bool is_down) {
         if (!initialized_ || !display_) {
             return common::Result<common::Ok>::err(
                 common::ErrorCode::PermissionDenied,
@@ -280,6 +278,13 @@ namespace linux_os {
             );
         }
 
+        queue_key(key, is_down);
+        XFlush(display_);
+
+        return common::Result<common::Ok>::success();
+    }
+
+    void LinuxXTestInjector::queue_text(const std::string& text) {
         for (char c : text) {
             KeySym keysym = NoSymbol;
             bool shift = false;
@@ -350,10 +355,58 @@ namespace linux_os {
                 }
             }
         }
+    }
 
+    common::EmptyResult LinuxXTestInjector::send_text(const std::string& text) {
+        if (!initialized_ || !display_) {
+            return common::Result<common::Ok>::err(
+                common::ErrorCode::PermissionDenied,
+                "XTest injector not initialized"
+            );
+        }
+
+        queue_text(text);
         XFlush(display_);
         return common::Result<common::Ok>::success();
     }
 
+    common::EmptyResult LinuxXTestInjector::inject_batch(const interfaces::InputOp* ops, size_t count) {
+        if (!initialized_ || !display_) {
+            return common::Result<common::Ok>::err(
+                common::ErrorCode::PermissionDenied,
+                "XTest injector not initialized"
+            );
+        }
+
+        using Type = interfaces::InputOp::Type;
+        bool ok = true;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& op = ops[i];
+            auto button = static_cast<interfaces::MouseButton>(op.code);
+            switch (op.type) {
+                case Type::Move:   ok &= queue_move(op.x, op.y); break;
+                case Type::Button: ok &= queue_button(button, op.down); break;
+                case Type::Click:
+                    // The server holds the release back, no client-side sleep
+                    ok &= queue_button(button, true);
+                    ok &= queue_button(button, false, CLICK_HOLD_MS);
+                    break;
+                case Type::Scroll: queue_scroll(op.code); break;
+                case Type::Key:    queue_key(static_cast<interfaces::KeyCode>(op.code), op.down); break;
+                case Type::Text:   queue_text(op.text); break;
+            }
+        }
+        XFlush(display_); // One flush for the whole batch
+
+        if (!ok) {
+            return common::Result<common::Ok>::err(
+                common::ErrorCode::Unknown,
+                "XTest event injection failed"
+            );
+        }
+
+        return common::Result<common::Ok>::success();
+    }
+
 } // namespace linux_os
 } // namespace platform
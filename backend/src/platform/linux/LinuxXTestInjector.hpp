@@ -20,6 +20,9 @@ namespace linux_os {
      * Dependencies:
      *   - libX11-dev / libX11-devel
      *   - libXtst-dev / libXtst-devel
+     *
+     * Each public call ends with one XFlush; inject_batch() queues all ops
+     * in Xlib's output buffer and flushes once for the whole batch.
      */
     class LinuxXTestInjector : public interfaces::IInputInjector {
     public:
@@ -32,11 +35,20 @@ namespace linux_os {
         common::EmptyResult scroll_mouse(int delta) override;
         common::EmptyResult press_key(interfaces::KeyCode key, bool is_down) override;
         common::EmptyResult send_text(const std::string& text) override;
+        common::EmptyResult inject_batch(const interfaces::InputOp* ops, size_t count) override;
 
         // Check if XTest is available
         bool is_available() const { return display_ != nullptr; }
 
     private:
+        // Queue the XTest requests for one operation (no XFlush).
+        // `delay_ms` is applied by the server before the event.
+        bool queue_move(float x_percent, float y_percent);
+        bool queue_button(interfaces::MouseButton button, bool is_down, unsigned long delay_ms = 0);
+        void queue_scroll(int delta);
+        void queue_key(interfaces::KeyCode key, bool is_down);
+        void queue_text(const std::string& text);
+
         Display* display_;
         int screen_width_;
         int screen_height_;
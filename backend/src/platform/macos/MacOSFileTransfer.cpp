@@ -57,6 +57,8 @@ interfaces::FileInfo MacOSFileTransfer::make_file_info(
         info.modified_time = static_cast<uint64_t>(st.st_mtime);
         info.is_directory = S_ISDIR(st.st_mode);
         info.is_readonly = !(st.st_mode & S_IWUSR);
+        info.device = static_cast<uint64_t>(st.st_dev);
+        info.inode = static_cast<uint64_t>(st.st_ino);
     } else {
         info.size = 0;
         info.modified_time = 0;
@@ -192,7 +194,8 @@ common::EmptyResult MacOSFileTransfer::delete_path(const std::string& path) {
 common::EmptyResult MacOSFileTransfer::download_file(
     const std::string& path,
     interfaces::DataChunkCallback on_chunk,
-    interfaces::ProgressCallback on_progress
+    interfaces::ProgressCallback on_progress,
+    interfaces::ByteRange range
 ) {
     int fd = open(path.c_str(), O_RDONLY);
     if (fd < 0) {
@@ -212,7 +215,16 @@ common::EmptyResult MacOSFileTransfer::download_file(
         );
     }
 
-    uint64_t total_size = static_cast<uint64_t>(st.st_size);
+    if (!interfaces::resolve_range(range, static_cast<uint64_t>(st.st_size))) {
+        close(fd);
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Offset " + std::to_string(range.offset) + " past end of file"
+        );
+    }
+
+    uint64_t total_size = range.length;
+    uint64_t end = range.offset + range.length;
     uint64_t bytes_read = 0;
 
     auto start_time = std::chrono::steady_clock::now();
@@ -220,7 +232,8 @@ common::EmptyResult MacOSFileTransfer::download_file(
     std::vector<uint8_t> buffer(interfaces::FILE_TRANSFER_CHUNK_SIZE);
 
     while (bytes_read < total_size) {
-        ssize_t n = read(fd, buffer.data(), buffer.size());
+        uint64_t pos = range.offset + bytes_read;
+        ssize_t n = pread(fd, buffer.data(), interfaces::chunk_span(pos, end), static_cast<off_t>(pos));
         if (n <= 0) break;
 
         bytes_read += static_cast<uint64_t>(n);
@@ -29,7 +29,8 @@ public:
     common::EmptyResult download_file(
         const std::string& path,
         interfaces::DataChunkCallback on_chunk,
-        interfaces::ProgressCallback on_progress = nullptr) override;
+        interfaces::ProgressCallback on_progress = nullptr,
+        interfaces::ByteRange range = {}) override;
 
     // Upload
     common::EmptyResult upload_start(
@@ -239,7 +239,8 @@ common::EmptyResult WindowsFileTransfer::delete_path(const std::string& path) {
 common::EmptyResult WindowsFileTransfer::download_file(
     const std::string& path,
     interfaces::DataChunkCallback on_chunk,
-    interfaces::ProgressCallback on_progress
+    interfaces::ProgressCallback on_progress,
+    interfaces::ByteRange range
 ) {
     std::wstring wpath = to_wide(path);
 
@@ -273,7 +274,24 @@ common::EmptyResult WindowsFileTransfer::download_file(
             "Cannot get file size: " + path);
     }
 
-    uint64_t total_size = static_cast<uint64_t>(file_size.QuadPart);
+    if (!interfaces::resolve_range(range, static_cast<uint64_t>(file_size.QuadPart))) {
+        CloseHandle(h_file);
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Offset " + std::to_string(range.offset) + " past end of file");
+    }
+
+    LARGE_INTEGER start_pos;
+    start_pos.QuadPart = static_cast<LONGLONG>(range.offset);
+    if (range.offset > 0 && !SetFilePointerEx(h_file, start_pos, nullptr, FILE_BEGIN)) {
+        CloseHandle(h_file);
+        return common::EmptyResult::err(
+            common::ErrorCode::Unknown,
+            "Cannot seek to offset " + std::to_string(range.offset));
+    }
+
+    uint64_t total_size = range.length;
+    uint64_t end = range.offset + range.length;
     uint64_t bytes_read = 0;
 
     auto start_time = std::chrono::steady_clock::now();
@@ -283,17 +301,15 @@ common::EmptyResult WindowsFileTransfer::download_file(
     std::vector<uint8_t> buffer(interfaces::FILE_TRANSFER_CHUNK_SIZE);
 
     while (bytes_read < total_size) {
-        DWORD to_read = static_cast<DWORD>((std::min)(
-            static_cast<uint64_t>(buffer.size()),
-            total_size - bytes_read
-        ));
+        // Reads end on chunk boundaries (see interfaces::chunk_span)
+        DWORD to_read = static_cast<DWORD>(interfaces::chunk_span(range.offset + bytes_read, end));
 
         DWORD actually_read = 0;
         if (!ReadFile(h_file, buffer.data(), to_read, &actually_read, nullptr)) {
             CloseHandle(h_file);
             return common::EmptyResult::err(
                 common::ErrorCode::Unknown,
-                "Read error at offset " + std::to_string(bytes_read));
+                "Read error at offset " + std::to_string(range.offset + bytes_read));
         }
 
         if (actually_read == 0) break;  // EOF
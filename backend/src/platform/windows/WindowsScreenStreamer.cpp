@@ -1,4 +1,5 @@
 #include "WindowsScreenStreamer.hpp"
+#include "common/JpegFrameSplitter.hpp"
 #include <iostream>
 #include <cstdio>
 #include <vector>
@@ -40,70 +41,34 @@ namespace windows_os {
             return common::Result<common::Ok>::err(common::ErrorCode::EncoderError, "Failed to start ffmpeg");
         }
 
-        // JPEG markers
-        const uint8_t soi_marker[2] = {0xFF, 0xD8}; // Start Of Image
-        const uint8_t eoi_marker[2] = {0xFF, 0xD9}; // End Of Image
-
-        std::vector<uint8_t> read_buffer(65536);
-        std::vector<uint8_t> frame_buffer;
-        frame_buffer.reserve(256 * 1024); // Pre-allocate for typical JPEG size
+        // Incremental SOI..EOI splitter (linear scan, reads straight into its buffer)
+        common::JpegFrameSplitter splitter;
+        const size_t READ_SIZE = 65536;
 
         uint64_t pts = 0;
         int frame_count = 0;
 
-        while (!token.is_cancellation_requested()) {
-            size_t n = fread(read_buffer.data(), 1, read_buffer.size(), pipe);
-            if (n <= 0) break;
+        auto on_frame = [&](const uint8_t* data, size_t size) {
+            // Send frame - all MJPEG frames are KeyFrames
+            auto data_ptr = common::FrameBufferPool::global().acquire_copy(data, size);
+            on_packet(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
 
-            // Append to frame buffer
-            frame_buffer.insert(frame_buffer.end(), read_buffer.begin(), read_buffer.begin() + n);
-
-            // Extract complete JPEG frames
-            while (true) {
-                // Find SOI (Start of Image)
-                auto soi_it = std::search(frame_buffer.begin(), frame_buffer.end(), soi_marker, soi_marker + 2);
-                if (soi_it == frame_buffer.end()) {
-                    frame_buffer.clear(); // No SOI, discard garbage
-                    break;
-                }
-
-                // Find EOI (End of Image) after SOI
-                auto eoi_it = std::search(soi_it + 2, frame_buffer.end(), eoi_marker, eoi_marker + 2);
-                if (eoi_it == frame_buffer.end()) {
-                    // Incomplete frame, wait for more data
-                    // But trim any garbage before SOI
-                    if (soi_it != frame_buffer.begin()) {
-                        frame_buffer.erase(frame_buffer.begin(), soi_it);
-                    }
-                    break;
-                }
-
-                // Found complete JPEG frame (SOI to EOI inclusive)
-                eoi_it += 2; // Include EOI bytes
-                std::vector<uint8_t> jpeg_frame(soi_it, eoi_it);
-
-                // Send frame
-                auto data_ptr = std::make_shared<const std::vector<uint8_t>>(std::move(jpeg_frame));
-                on_packet(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
-
-                frame_count++;
-                if (frame_count % 30 == 0) {
-                    std::cout << "[Screen] Sent MJPEG frame #" << frame_count << " (" << data_ptr->size() << " bytes)" << std::endl;
-                }
-
-                // Remove processed frame from buffer
-                frame_buffer.erase(frame_buffer.begin(), eoi_it);
+            frame_count++;
+            if (frame_count % 30 == 0) {
+                std::cout << "[Screen] Sent MJPEG frame #" << frame_count << " (" << size << " bytes)" << std::endl;
             }
+        };
 
-            // Prevent unbounded buffer growth (safety limit)
-            if (frame_buffer.size() > 1024 * 1024) {
-                std::cerr << "[Screen] WARNING: Frame buffer overflow, clearing" << std::endl;
-                frame_buffer.clear();
-            }
+        while (!token.is_cancellation_requested()) {
+            size_t n = fread(splitter.prepare(READ_SIZE), 1, READ_SIZE, pipe);
+            if (n <= 0) break;
+
+            splitter.commit(n, on_frame);
         }
 
         _pclose(pipe);
-        std::cout << "[Screen] MJPEG stream stopped. Total frames: " << frame_count << std::endl;
+        std::cout << "[Screen] MJPEG stream stopped. Total frames: " << frame_count
+                  << ", discarded: " << (splitter.stats().resyncs + splitter.stats().overflows) << std::endl;
         return common::Result<common::Ok>::success();
     }
 
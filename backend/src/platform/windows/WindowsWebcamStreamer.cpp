@@ -61,7 +61,7 @@ namespace windows_os {
                     frame_buffer[frame_buffer.size() - 1] == 0xD9) {
                     if (frame_buffer[0] == 0xFF && frame_buffer[1] == 0xD8) {
                          static uint64_t pts = 0;
-                         auto data_ptr = std::make_shared<const std::vector<uint8_t>>(frame_buffer);
+                         auto data_ptr = common::FrameBufferPool::global().acquire_copy(frame_buffer.data(), frame_buffer.size());
                          on_packet(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
                     }
                     frame_buffer.clear();
@@ -89,7 +89,7 @@ namespace windows_os {
                         frame_buffer[frame_buffer.size() - 1] == 0xD9) {
                         if (frame_buffer[0] == 0xFF && frame_buffer[1] == 0xD8) {
                              static uint64_t pts = 0;
-                             auto data_ptr = std::make_shared<const std::vector<uint8_t>>(frame_buffer);
+                             auto data_ptr = common::FrameBufferPool::global().acquire_copy(frame_buffer.data(), frame_buffer.size());
                              on_packet(common::VideoPacket{data_ptr, pts++, 1, common::PacketKind::KeyFrame});
                         }
                         frame_buffer.clear();
@@ -2,11 +2,34 @@
 // Linux Platform HAL Test Program
 // ============================================================================
 // Tests all existing Linux platform components:
-// - InputInjector (XTest/uinput mouse move, click)
+// - InputInjector (XTest/uinput mouse move, click, batch)
 // - ScreenStreamer (capture snapshot, stream)
+// - JpegFrameSplitter (MJPEG splitting throughput in MB/s)
+// - FrameBufferPool (pooled frame reuse counters, headroom prefix)
+// - InputPipeline (mouse_move coalescing, ordering)
 // - Keylogger (evdev key event capture)
 // - AppManager (list apps, processes)
-// - FileTransfer (directory operations, upload/download)
+// - FileTransfer (directory operations, upload/download, 8 concurrent uploads,
+//   per-upload strands, 8 uploads through a gateway session, uploads left
+//   open at disconnect)
+// - ParallelTransfer (1 vs N read streams into a loopback socket, tuning)
+// - TransferScheduler (priority, per-client round-robin, cancel, flow window, per-session clients)
+// - TrafficShaper (token-bucket rates, global cap, control exemption)
+// - Checksums (CRC32C hardware vs table, XXH64, order-free file digest,
+//   SHA-256 vectors and SHA extensions vs portable)
+// - FileHasher (parallel tree hash vs one pass, persistent cache hits)
+// - ArchiveStream (directory tree as a streamed tar, read back and compared)
+// - Delta upload (rsync-style signatures and delta of an edited 64 MB file,
+//   bytes saved, CPU cost, atomic replace and rejected reconstructions)
+// - Directory listing (getdents64 + statx vs readdir + lstat on a generated
+//   100k-entry directory: same results, entries per second)
+// - ChunkStore (FastCDC + SHA-256 deduplicated pushes of a 48 MB file and
+//   an edited version, reload across restarts, LRU eviction, pinning,
+//   plans released when an upload is cancelled)
+// - ListingCache (cached vs read listing of 20k entries, inotify patches,
+//   pushed deltas, directory and memory limits)
+// - ListingOrder (sort keys, cursor paging while entries change, time to
+//   the first page of 200k entries)
 //
 // Run with: ./BackendTest
 // Output: Console log with PASS/FAIL for each test
@@ -22,8 +45,24 @@
 #include <sstream>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <string>
 #include <cstdio>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
 
 // Platform includes
 #include "LinuxInputInjectorFactory.hpp"
@@ -35,6 +74,29 @@
 // Common includes
 #include "common/VideoTypes.hpp"
 #include "common/Cancellation.hpp"
+#include "common/JpegFrameSplitter.hpp"
+#include "common/FrameBuffer.hpp"
+#include "common/Base64.hpp"
+#include "common/Checksum.hpp"
+#include "common/Delta.hpp"
+#include "common/FastCdc.hpp"
+#include "common/Sha256.hpp"
+#include "common/Tar.hpp"
+#include "core/ArchiveStream.hpp"
+#include "core/BackendServer.hpp"
+#include "core/BroadcastBus.hpp"
+#include "core/ChunkStore.hpp"
+#include "core/DirectoryWalk.hpp"
+#include "core/FileHasher.hpp"
+#include "core/InputPipeline.hpp"
+#include "core/InputProtocol.hpp"
+#include "core/ListingCache.hpp"
+#include "core/ListingOrder.hpp"
+#include "core/network/TcpSocket.hpp"
+#include "core/network/TrafficShaper.hpp"
+#include "core/ParallelTransfer.hpp"
+#include "core/TransferScheduler.hpp"
+#include "handlers/FileCommandHandler.hpp"
 
 using namespace platform::linux_os;
 using namespace std::chrono_literals;
@@ -134,6 +196,26 @@ void test_input_injector() {
                  "Click at bottom-right corner", ms);
     }
 
+    // Test 4: One batch (single write()/XFlush): moves around a click
+    {
+        std::vector<interfaces::InputOp> ops(4);
+        ops[0].type = interfaces::InputOp::Type::Move;
+        ops[0].x = 0.9f; ops[0].y = 0.9f;
+        ops[1].type = interfaces::InputOp::Type::Move;
+        ops[1].x = 0.95f; ops[1].y = 0.95f;
+        ops[2].type = interfaces::InputOp::Type::Click;
+        ops[2].code = static_cast<int>(interfaces::MouseButton::Left);
+        ops[3].type = interfaces::InputOp::Type::Move;
+        ops[3].x = 0.5f; ops[3].y = 0.5f;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto result = injector->inject_batch(ops.data(), ops.size());
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        log_test("InputInjector::inject_batch", result.is_ok(), "3 moves + click", ms);
+    }
+
     // Move back to center
     injector->move_mouse(0.5f, 0.5f);
 }
@@ -211,6 +293,336 @@ void test_screen_streamer() {
     }
 }
 
+// ============================================================================
+// Test: JpegFrameSplitter (microbenchmark, no hardware needed)
+// ============================================================================
+
+// Builds a structurally valid JPEG: APP1 "thumbnail" containing FF D9,
+// DQT, SOS header and entropy data with 0xFF00 stuffing and RSTn markers.
+static std::vector<uint8_t> make_fake_jpeg(std::mt19937& rng, size_t entropy_size) {
+    std::vector<uint8_t> j = {0xFF, 0xD8};
+
+    std::vector<uint8_t> app1 = {'E', 'x', 'i', 'f', 0, 0, 0xFF, 0xD8, 0x12, 0xFF, 0xD9, 0x00};
+    j.push_back(0xFF); j.push_back(0xE1);
+    j.push_back(static_cast<uint8_t>((app1.size() + 2) >> 8));
+    j.push_back(static_cast<uint8_t>(app1.size() + 2));
+    j.insert(j.end(), app1.begin(), app1.end());
+
+    j.insert(j.end(), {0xFF, 0xDB, 0x00, 0x43});
+    j.insert(j.end(), 65, 0x10);
+
+    j.insert(j.end(), {0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00});
+
+    std::uniform_int_distribution<int> byte(0, 255);
+    int rst = 0;
+    for (size_t i = 0; i < entropy_size; ++i) {
+        uint8_t v = static_cast<uint8_t>(byte(rng));
+        j.push_back(v);
+        if (v == 0xFF) j.push_back(0x00); // Byte stuffing
+        if (i % 4096 == 4095) {
+            j.push_back(0xFF);
+            j.push_back(static_cast<uint8_t>(0xD0 + (rst++ & 7)));
+        }
+    }
+
+    j.push_back(0xFF); j.push_back(0xD9);
+    return j;
+}
+
+void test_jpeg_splitter() {
+    std::cout << "\n=== Testing JpegFrameSplitter ===" << std::endl;
+
+    const int FRAME_COUNT = 300;
+    const size_t READ_SIZE = 65536; // Same read size as the streamers
+
+    std::mt19937 rng(42);
+    std::vector<uint8_t> stream;
+    std::vector<size_t> frame_sizes;
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        auto jpeg = make_fake_jpeg(rng, 100 * 1024 + (i % 7) * 20 * 1024);
+        frame_sizes.push_back(jpeg.size());
+        stream.insert(stream.end(), jpeg.begin(), jpeg.end());
+    }
+    double mb = stream.size() / (1024.0 * 1024.0);
+
+    // Test 1: Correctness + throughput (fread-style chunking)
+    {
+        common::JpegFrameSplitter splitter;
+        size_t frames = 0;
+        bool sizes_ok = true;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t off = 0; off < stream.size(); off += READ_SIZE) {
+            size_t n = (std::min)(READ_SIZE, stream.size() - off);
+            uint8_t* dst = splitter.prepare(READ_SIZE);
+            std::memcpy(dst, stream.data() + off, n);
+            splitter.commit(n, [&](const uint8_t*, size_t size) {
+                if (frames >= frame_sizes.size() || frame_sizes[frames] != size) sizes_ok = false;
+                frames++;
+            });
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::stringstream ss;
+        ss << frames << "/" << FRAME_COUNT << " frames, "
+           << std::fixed << std::setprecision(0) << (mb / (ms / 1000.0)) << " MB/s";
+        log_test("JpegFrameSplitter::commit(64KB reads)",
+                 frames == static_cast<size_t>(FRAME_COUNT) && sizes_ok, ss.str(), ms);
+    }
+
+    // Test 2: Byte-at-a-time feeding (resumable state across every boundary)
+    {
+        common::JpegFrameSplitter splitter;
+        size_t frames = 0;
+        size_t limit = frame_sizes[0] + frame_sizes[1] + frame_sizes[2];
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t off = 0; off < limit; ++off) {
+            splitter.feed(stream.data() + off, 1, [&](const uint8_t*, size_t size) {
+                if (frame_sizes[frames] == size) frames++;
+            });
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        log_test("JpegFrameSplitter::feed(1 byte)", frames == 3,
+                 std::to_string(frames) + "/3 frames", ms);
+    }
+
+    // Test 3: Legacy std::search + erase splitter, for comparison only
+    // (it also splits on the FF D9 inside the APP1 thumbnail)
+    {
+        const uint8_t soi[2] = {0xFF, 0xD8};
+        const uint8_t eoi[2] = {0xFF, 0xD9};
+        std::vector<uint8_t> frame_buffer;
+        size_t frames = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t off = 0; off < stream.size(); off += READ_SIZE) {
+            size_t n = (std::min)(READ_SIZE, stream.size() - off);
+            frame_buffer.insert(frame_buffer.end(), stream.begin() + off, stream.begin() + off + n);
+            while (true) {
+                auto soi_it = std::search(frame_buffer.begin(), frame_buffer.end(), soi, soi + 2);
+                if (soi_it == frame_buffer.end()) { frame_buffer.clear(); break; }
+                auto eoi_it = std::search(soi_it + 2, frame_buffer.end(), eoi, eoi + 2);
+                if (eoi_it == frame_buffer.end()) {
+                    frame_buffer.erase(frame_buffer.begin(), soi_it);
+                    break;
+                }
+                eoi_it += 2;
+                std::vector<uint8_t> jpeg_frame(soi_it, eoi_it);
+                frames++;
+                frame_buffer.erase(frame_buffer.begin(), eoi_it);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::stringstream ss;
+        ss << frames << " frames (legacy), "
+           << std::fixed << std::setprecision(0) << (mb / (ms / 1000.0)) << " MB/s";
+        log_test("JpegFrameSplitter::legacy_baseline", true, ss.str(), ms);
+    }
+}
+
+// ============================================================================
+// Test: FrameBufferPool (no hardware needed)
+// ============================================================================
+
+void test_frame_buffer_pool() {
+    std::cout << "\n=== Testing FrameBufferPool ===" << std::endl;
+
+    // Test 1: Steady-state stream reuses blocks (3 frames in flight)
+    {
+        common::FrameBufferPool pool;
+        std::vector<uint8_t> jpeg(180 * 1024, 0xAB);
+        std::deque<std::shared_ptr<common::FrameBuffer>> in_flight;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            size_t size = jpeg.size() - (i % 5) * 1024; // Slowly varying frame size
+            in_flight.push_back(pool.acquire_copy(jpeg.data(), size));
+            if (in_flight.size() > 3) in_flight.pop_front();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        auto st = pool.stats();
+        std::stringstream ss;
+        ss << "allocations=" << st.allocations << ", reuses=" << st.reuses
+           << ", in_flight=" << st.in_flight;
+        log_test("FrameBufferPool::acquire(reuse)",
+                 st.allocations <= 4 && st.reuses >= 996 && st.in_flight == 3, ss.str(), ms);
+    }
+
+    // Test 2: Wire prefix lands in the headroom, contiguous with the payload
+    {
+        common::FrameBufferPool pool;
+        const uint8_t payload[4] = {0xFF, 0xD8, 0xFF, 0xD9};
+        const uint8_t prefix[14] = {0, 0, 0, 6, 0, 0, 0, 7, 0, 0, 0, 1, 0x02, 0x01};
+        auto fb = pool.acquire_copy(payload, sizeof(payload));
+
+        const uint8_t* wire = fb->stamp_prefix(prefix, sizeof(prefix));
+        bool ok = wire != nullptr
+               && wire + sizeof(prefix) == fb->data()
+               && std::memcmp(wire, prefix, sizeof(prefix)) == 0
+               && std::memcmp(fb->data(), payload, sizeof(payload)) == 0
+               && fb->stamp_prefix(prefix, common::FrameBuffer::HEADROOM + 1) == nullptr;
+
+        log_test("FrameBuffer::stamp_prefix", ok, "14B prefix + 4B payload");
+    }
+
+    // Test 3: Buffers outliving their pool are freed, not recycled
+    {
+        std::shared_ptr<common::FrameBuffer> survivor;
+        {
+            common::FrameBufferPool pool;
+            survivor = pool.acquire(1024);
+        }
+        survivor.reset(); // Must not touch the destroyed pool (run under ASan)
+        log_test("FrameBufferPool::outlive_pool", true, "released after pool destruction");
+    }
+
+    // Test 4: Headroom has one owner per frame; a recycled block is unclaimed
+    {
+        common::FrameBufferPool pool;
+        int session_a = 0, session_b = 0;
+        auto fb = pool.acquire(1024);
+        bool ok = fb->claim_headroom(&session_a)
+               && fb->claim_headroom(&session_a)
+               && !fb->claim_headroom(&session_b);
+        fb.reset();
+        fb = pool.acquire(1024); // Same block from the free list
+        ok = ok && pool.stats().reuses == 1 && fb->claim_headroom(&session_b);
+
+        log_test("FrameBuffer::claim_headroom", ok, "first session owns the prefix space");
+    }
+}
+
+// ============================================================================
+// Test: InputPipeline
+// ============================================================================
+
+// Records calls instead of injecting ("M x y", "B btn down", "K code down", ...)
+class RecordingInjector : public interfaces::IInputInjector {
+public:
+    std::vector<std::string> calls;
+
+    common::EmptyResult move_mouse(float x, float y) override {
+        std::ostringstream ss;
+        ss << "M " << x << " " << y;
+        calls.push_back(ss.str());
+        return common::EmptyResult::success();
+    }
+    common::EmptyResult click_mouse(interfaces::MouseButton b, bool down) override {
+        calls.push_back("B " + std::to_string((int)b) + (down ? " down" : " up"));
+        return common::EmptyResult::success();
+    }
+    common::EmptyResult scroll_mouse(int delta) override {
+        calls.push_back("S " + std::to_string(delta));
+        return common::EmptyResult::success();
+    }
+    common::EmptyResult press_key(interfaces::KeyCode k, bool down) override {
+        calls.push_back("K " + std::to_string((int)k) + (down ? " down" : " up"));
+        return common::EmptyResult::success();
+    }
+    common::EmptyResult send_text(const std::string& text) override {
+        calls.push_back("T " + text);
+        return common::EmptyResult::success();
+    }
+};
+
+void test_input_pipeline() {
+    std::cout << "\n=== Testing InputPipeline ===" << std::endl;
+    using interfaces::InputOp;
+
+    auto move = [](float x, float y) {
+        InputOp op;
+        op.type = InputOp::Type::Move;
+        op.x = x;
+        op.y = y;
+        return op;
+    };
+
+    // Test 1: A burst of moves around a click keeps order, latest position wins
+    {
+        auto rec = std::make_shared<RecordingInjector>();
+        core::InputPipeline pipeline(rec);
+
+        for (int i = 1; i <= 120; ++i) pipeline.push(move(i / 1000.0f, 0.25f));
+        InputOp down;
+        down.type = InputOp::Type::Button;
+        down.code = 0;
+        down.down = true;
+        pipeline.push(down);
+        pipeline.push(move(0.5f, 0.5f));
+        pipeline.push(move(0.75f, 0.5f));
+
+        size_t injected = pipeline.flush();
+        const auto& st = pipeline.stats();
+        std::vector<std::string> expected = {"M 0.12 0.25", "B 0 down", "M 0.75 0.5"};
+
+        std::stringstream ss;
+        ss << st.received << " received, " << st.coalesced << " coalesced, " << injected << " injected";
+        log_test("InputPipeline::coalesce_moves",
+                 rec->calls == expected && st.coalesced == 120 && injected == 3, ss.str());
+    }
+
+    // Test 2: Flushes are paced to the refresh interval
+    {
+        core::InputPipeline pipeline(std::make_shared<RecordingInjector>());
+        auto t0 = std::chrono::steady_clock::now();
+        pipeline.push(move(0.1f, 0.1f));
+        pipeline.flush(t0);
+
+        auto half = t0 + core::InputPipeline::REFRESH_INTERVAL / 2;
+        auto next = t0 + core::InputPipeline::REFRESH_INTERVAL;
+        bool ok = pipeline.flush_delay(half).count() > 0
+               && pipeline.flush_delay(next).count() == 0
+               && pipeline.flush(next) == 0; // Nothing pending: no flush
+
+        log_test("InputPipeline::refresh_pacing", ok, "one injection burst per refresh");
+    }
+
+    // Test 3: Binary input records round-trip and dispatch like the text commands
+    {
+        using core::input::Op;
+        using core::input::Record;
+        std::vector<Record> records(5);
+        records[0].op = Op::Move;       records[0].x = core::input::COORD_MAX; records[0].y = -5; // Clamped to 0
+        records[1].op = Op::ButtonDown; records[1].code = 1;
+        records[2].op = Op::Scroll;     records[2].code = static_cast<uint16_t>(-3);
+        records[3].op = Op::KeyUp;      records[3].code = 7;
+        records[4].op = static_cast<Op>(0x7F); // Unknown: skipped
+        records[4].timestamp_ms = 0xDEADBEEF;
+
+        std::vector<uint8_t> body(records.size() * core::input::RECORD_SIZE);
+        for (size_t i = 0; i < records.size(); ++i) {
+            core::input::encode_record(records[i], body.data() + i * core::input::RECORD_SIZE);
+        }
+
+        auto rec = std::make_shared<RecordingInjector>();
+        core::InputPipeline pipeline(rec);
+        size_t count = core::input::record_count(body.size());
+        for (size_t i = 0; i < count; ++i) {
+            InputOp op;
+            auto r = core::input::decode_record(body.data() + i * core::input::RECORD_SIZE);
+            if (core::input::to_input_op(r, op)) pipeline.push(std::move(op));
+        }
+        pipeline.flush();
+
+        auto last = core::input::decode_record(body.data() + 4 * core::input::RECORD_SIZE);
+        std::vector<std::string> expected = {"M 1 0", "B 1 down", "S -3", "K 7 up"};
+        bool ok = count == 5 && rec->calls == expected && last.timestamp_ms == 0xDEADBEEF
+               && core::input::record_count(body.size() - 1) == 0;
+
+        std::stringstream ss;
+        ss << count << " records, " << rec->calls.size() << " injected";
+        log_test("InputProtocol::decode_records", ok, ss.str());
+    }
+}
+
 // ============================================================================
 // Test: Keylogger
 // ============================================================================
@@ -421,7 +833,38 @@ void test_file_transfer() {
                  passed ? "Content match" : "Content mismatch", ms);
     }
 
-    // Test 6: Get file info
+    // Test 6: Zero-copy send (open_for_send + TcpSocket::send_file)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string received;
+        bool passed = false;
+        auto source = ft.open_for_send(file_path);
+        int sv[2];
+        if (source.is_ok() && socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0) {
+            auto& src = source.unwrap();
+            {
+                core::network::TcpSocket sock(sv[0]);
+                size_t off = 6; // Region starts mid-file: "World from Linux!"
+                while (off < src->size()) {
+                    auto [n, err] = sock.send_file(src->native_handle(), off, src->size() - off);
+                    if (err != core::network::SocketError::Ok || n == 0) break;
+                    off += n;
+                }
+            } // Closes sv[0]
+            char buf[256];
+            ssize_t n;
+            while ((n = read(sv[1], buf, sizeof(buf))) > 0) received.append(buf, n);
+            close(sv[1]);
+            passed = src->size() == content.size() && received == content.substr(6);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        log_test("FileTransfer::open_for_send", passed,
+                 passed ? "sendfile region match" : "Region mismatch: " + received, ms);
+    }
+
+    // Test 7: Get file info
     {
         auto start = std::chrono::high_resolution_clock::now();
         auto result = ft.get_file_info(file_path);
@@ -438,7 +881,7 @@ void test_file_transfer() {
         }
     }
 
-    // Test 7: Rename file
+    // Test 8: Rename file
     std::string new_path = test_dir + "/test_renamed.txt";
     {
         auto start = std::chrono::high_resolution_clock::now();
@@ -449,15 +892,1896 @@ void test_file_transfer() {
         log_test("FileTransfer::rename", result.is_ok(), new_path, ms);
     }
 
+    // Test 9: Binary upload chunks written out of order at their offsets
+    std::string chunked_path = test_dir + "/chunked.bin";
+    {
+        std::string data(300000, '\0');
+        std::mt19937 rng(42);
+        for (auto& c : data) c = static_cast<char>(rng());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ft.upload_start(chunked_path, data.size());
+        const size_t chunk = 64 * 1024;
+        for (size_t off = (data.size() - 1) / chunk * chunk; ; off -= chunk) {
+            size_t n = (std::min)(chunk, data.size() - off);
+            ft.upload_write_at(chunked_path, off, (const uint8_t*)data.data() + off, n);
+            if (off == 0) break;
+        }
+        // Past the announced size (or straddling it): rejected, not written
+        const uint8_t stray[16] = {};
+        bool beyond_rejected = ft.upload_write_at(chunked_path, uint64_t(1) << 40, stray, sizeof(stray)).is_err() &&
+                               ft.upload_write_at(chunked_path, data.size() - 8, stray, sizeof(stray)).is_err();
+        auto result = ft.upload_finish(chunked_path);
+
+        std::string written;
+        ft.download_file(chunked_path, [&](const uint8_t* d, size_t n, bool) { written.append((const char*)d, n); });
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        log_test("FileTransfer::upload_write_at", result.is_ok() && written == data && beyond_rejected,
+                 !result.is_ok() ? result.error().message :
+                 beyond_rejected ? "Reverse-order chunks, out-of-range rejected" : "Out-of-range chunk written", ms);
+    }
+
+    // Test 10: Ranged download resumes mid-chunk; chunks stay aligned to
+    // FILE_TRANSFER_CHUNK_SIZE so sequence numbers are file positions
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string full, ranged;
+        std::vector<uint64_t> chunk_starts;
+        ft.download_file(chunked_path, [&](const uint8_t* d, size_t n, bool) { full.append((const char*)d, n); });
+
+        interfaces::ByteRange range{100000, 180000};
+        uint64_t pos = range.offset;
+        bool last_seen = false;
+        auto result = ft.download_file(chunked_path,
+            [&](const uint8_t* d, size_t n, bool is_last) {
+                chunk_starts.push_back(pos);
+                ranged.append((const char*)d, n);
+                pos += n;
+                last_seen = is_last;
+            }, nullptr, range);
+        auto past_end = ft.download_file(chunked_path, [](const uint8_t*, size_t, bool) {},
+                                         nullptr, interfaces::ByteRange{full.size() + 1, 0});
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        const uint64_t chunk = interfaces::FILE_TRANSFER_CHUNK_SIZE;
+        bool aligned = chunk_starts.size() == 2 && chunk_starts[1] == chunk;
+        bool passed = result.is_ok() && past_end.is_err() && aligned && last_seen &&
+                      ranged == full.substr(range.offset, range.length);
+        log_test("FileTransfer::download_file(range)", passed,
+                 passed ? "100000+180000, split at chunk boundary" : "Range mismatch", ms);
+    }
+
+    // Test 11: Base64 codec (text upload fallback)
+    {
+        bool passed = true;
+        std::string bytes;
+        for (int len = 0; len < 64 && passed; ++len) {
+            auto enc = common::base64::encode((const uint8_t*)bytes.data(), bytes.size());
+            auto dec = common::base64::decode(enc);
+            passed = enc.size() == common::base64::encoded_size(bytes.size()) &&
+                     std::string(dec.begin(), dec.end()) == bytes;
+            bytes.push_back(static_cast<char>(len * 37 + 11));
+        }
+        auto known = common::base64::encode((const uint8_t*)"Hello World", 11);
+        auto stop = common::base64::decode(std::string("SGVsbG8=junk"));
+        passed = passed && known == "SGVsbG8gV29ybGQ=" && std::string(stop.begin(), stop.end()) == "Hello";
+
+        log_test("Base64::round_trip", passed, "lengths 0-63, stops at padding");
+    }
+
+    // Test 12: Concurrent uploads each take their own lock; preallocated
+    // files, write-behind past WRITE_BEHIND_BYTES, contents intact
+    {
+        const size_t uploads = 8;
+        const size_t per_upload = 16 * 1024 * 1024;
+        const size_t chunk = 64 * 1024;
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < uploads; ++i) paths.push_back(test_dir + "/concurrent_" + std::to_string(i) + ".bin");
+
+        std::atomic<size_t> failures{0};
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> writers;
+        for (size_t i = 0; i < uploads; ++i) {
+            writers.emplace_back([&, i]() {
+                std::vector<uint8_t> block(chunk, static_cast<uint8_t>('a' + i));
+                if (ft.upload_start(paths[i], per_upload).is_err()) { failures++; return; }
+                for (size_t off = 0; off < per_upload; off += chunk) {
+                    if (ft.upload_chunk(paths[i], block.data(), block.size()).is_err()) { failures++; return; }
+                }
+                if (ft.upload_finish(paths[i]).is_err()) failures++;
+            });
+        }
+        for (auto& w : writers) w.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        bool intact = failures == 0;
+        for (size_t i = 0; i < uploads && intact; ++i) {
+            uint64_t size = 0;
+            bool same = true;
+            ft.download_file(paths[i], [&](const uint8_t* d, size_t n, bool) {
+                size += n;
+                same = same && std::all_of(d, d + n, [&](uint8_t b) { return b == 'a' + i; });
+            });
+            intact = size == per_upload && same;
+        }
+        for (const auto& path : paths) ft.delete_path(path);
+
+        std::ostringstream details;
+        details << uploads << " x " << (per_upload >> 20) << " MB, "
+                << std::fixed << std::setprecision(1) << (uploads * per_upload / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s";
+        log_test("FileTransfer::concurrent_uploads", intact, details.str(), ms);
+    }
+
+    // Test 13: KeyedStrands keep each key's tasks in order, run different
+    // keys side by side and drop a key once its tasks are done
+    {
+        core::ThreadPool pool(4);
+        auto strands = std::make_shared<core::KeyedStrands>(pool);
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool b_ran = false;
+        bool a_saw_b = false;
+        std::vector<int> order;
+
+        // "a" waits on a task of "b": one shared strand would time it out
+        strands->post("a", [&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            a_saw_b = cv.wait_for(lock, 2s, [&]() { return b_ran; });
+        });
+        strands->post("b", [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            b_ran = true;
+            cv.notify_all();
+        });
+        const int TASKS = 1000;
+        for (int i = 0; i < TASKS; ++i) {
+            strands->post("c", [&, i]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+            });
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (strands->active() > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        bool in_order = order.size() == static_cast<size_t>(TASKS) && std::is_sorted(order.begin(), order.end());
+        bool passed = a_saw_b && in_order && strands->active() == 0;
+        log_test("KeyedStrands::per_key", passed,
+                 std::string(a_saw_b ? "keys in parallel" : "keys serialized") + ", " +
+                 std::to_string(order.size()) + " tasks in order: " + (in_order ? "yes" : "no"));
+    }
+
+    // Test 14: Uploads through a gateway session: 8 uploads started at once,
+    // their checksummed binary chunks interleaved on the control socket and
+    // ended in reverse order, each on its own strand; then a delta and a
+    // deduplicated upload left open when the gateway disconnects
+    {
+        const size_t uploads = 8;
+        const size_t per_upload = 4 * 1024 * 1024;
+        const size_t chunk = 64 * 1024;
+        const uint16_t port = 19480;
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < uploads; ++i) paths.push_back(test_dir + "/session_" + std::to_string(i) + ".bin");
+
+        auto session_ft = std::make_shared<LinuxFileTransfer>();
+        core::BackendServer server(port, std::make_shared<core::BroadcastBus>(), std::make_shared<core::BroadcastBus>(),
+                                   nullptr, nullptr, nullptr, nullptr, nullptr, session_ft);
+        std::thread server_thread([&]() { server.run(); });
+
+        auto connect_to = [](uint16_t p) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(p);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            for (int attempt = 0; attempt < 50; ++attempt) {
+                int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+                close(fd);
+                std::this_thread::sleep_for(20ms);
+            }
+            return -1;
+        };
+        // [4B length][4B cid][4B bid][payload], as the gateway frames it
+        auto send_frame = [](int fd, const std::string& payload) {
+            uint32_t head[3] = {htonl(static_cast<uint32_t>(payload.size())), htonl(5), htonl(1)};
+            std::string frame(reinterpret_cast<const char*>(head), sizeof(head));
+            frame += payload;
+            for (size_t sent = 0; sent < frame.size();) {
+                ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) return false;
+                sent += n;
+            }
+            return true;
+        };
+        // [0x04][4B upload id][8B offset][4B CRC32C][data]
+        auto send_chunk = [&](int fd, uint32_t id, uint64_t offset, const std::vector<uint8_t>& data) {
+            uint32_t fields[4] = {htonl(id), htonl(static_cast<uint32_t>(offset >> 32)),
+                                  htonl(static_cast<uint32_t>(offset)),
+                                  htonl(common::checksum::crc32c(data.data(), data.size()))};
+            std::string payload(1, '\x04');
+            payload.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+            payload.append(reinterpret_cast<const char*>(data.data()), data.size());
+            return send_frame(fd, payload);
+        };
+
+        // Replies arrive on either socket: [12B header][1B traffic class][text]
+        int sockets[2] = {connect_to(port), connect_to(port + 1)};
+        std::vector<uint8_t> inbuf[2];
+        auto next_reply = [&](std::chrono::steady_clock::time_point deadline) {
+            while (std::chrono::steady_clock::now() < deadline) {
+                for (int k = 0; k < 2; ++k) {
+                    if (inbuf[k].size() < 12) continue;
+                    uint32_t len;
+                    memcpy(&len, inbuf[k].data(), 4);
+                    len = ntohl(len);
+                    if (inbuf[k].size() < 12 + len) continue;
+                    std::string text(inbuf[k].begin() + 13, inbuf[k].begin() + 12 + len);
+                    inbuf[k].erase(inbuf[k].begin(), inbuf[k].begin() + 12 + len);
+                    return text;
+                }
+                pollfd fds[2] = {{sockets[0], POLLIN, 0}, {sockets[1], POLLIN, 0}};
+                if (poll(fds, 2, 100) <= 0) continue;
+                for (int k = 0; k < 2; ++k) {
+                    if (!(fds[k].revents & POLLIN)) continue;
+                    uint8_t buf[4096];
+                    ssize_t n = recv(fds[k].fd, buf, sizeof(buf), 0);
+                    if (n <= 0) return std::string();
+                    inbuf[k].insert(inbuf[k].end(), buf, buf + n);
+                }
+            }
+            return std::string();
+        };
+
+        // Paired once the session answers a ping: unpaired sockets may not buffer much
+        int control = sockets[0];
+        bool sent = sockets[0] >= 0 && sockets[1] >= 0 && send_frame(control, "HELLO session-uploads") &&
+                    send_frame(sockets[1], "HELLO session-uploads") && send_frame(control, "ping") &&
+                    next_reply(std::chrono::steady_clock::now() + 5s).rfind("INFO:", 0) == 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < uploads && sent; ++i) {
+            sent = send_frame(control, "file_upload_start " + paths[i] + " " + std::to_string(per_upload) + " " +
+                                       std::to_string(i + 1) + " 1");
+        }
+        for (size_t off = 0; off < per_upload && sent; off += chunk) {
+            for (size_t i = 0; i < uploads && sent; ++i) {
+                std::vector<uint8_t> block(chunk, static_cast<uint8_t>('a' + i));
+                sent = send_chunk(control, static_cast<uint32_t>(i + 1), off, block);
+            }
+        }
+        for (size_t i = uploads; i-- > 0 && sent;) sent = send_frame(control, "file_upload_end " + paths[i]);
+
+        size_t completed = 0;
+        std::string errors;
+        auto deadline = std::chrono::steady_clock::now() + 10s;
+        while (sent && completed < uploads) {
+            std::string text = next_reply(deadline);
+            if (text.empty()) break;
+            if (text.rfind("STATUS:FILE_UPLOAD_COMPLETE:", 0) == 0) completed++;
+            else if (text.rfind("ERROR:", 0) == 0 && errors.empty()) errors = text;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        // Then a delta upload of the first file and a deduplicated upload,
+        // both left open: the session's disconnect has to cancel them, which
+        // removes the delta's temporary file and the partial CAS file
+        auto delta_temps = [&]() {
+            size_t count = 0;
+            if (DIR* dir = opendir(test_dir.c_str())) {
+                while (dirent* entry = readdir(dir)) count += strstr(entry->d_name, ".delta.") != nullptr;
+                closedir(dir);
+            }
+            return count;
+        };
+        bool delta_open = false;
+        auto basis = session_ft->get_file_info(paths[0]);
+        if (sent && completed == uploads && basis.is_ok()) {
+            sent = send_frame(control, "file_delta_start " + std::to_string(per_upload) + " 100 " +
+                                       std::to_string(basis.unwrap().size) + " " +
+                                       std::to_string(basis.unwrap().modified_time) + " " + paths[0]) &&
+                   send_chunk(control, 100, 0, std::vector<uint8_t>(chunk, 'z'));
+            delta_open = sent && next_reply(std::chrono::steady_clock::now() + 5s).rfind("STATUS:FILE_UPLOAD_READY:", 0) == 0 &&
+                         delta_temps() == 1;
+        }
+        const std::string cas_path = test_dir + "/session_cas.bin";
+        bool cas_open = false;
+        if (delta_open) {
+            std::vector<uint8_t> block(chunk, 'y');
+            sent = send_frame(control, "file_cas_start " + std::to_string(2 * chunk) + " 101 " + cas_path) &&
+                   send_frame(control, "file_cas_have 0 " + common::checksum::sha256_hex(block.data(), block.size()) +
+                                       ":" + std::to_string(chunk) + " " + cas_path) &&
+                   send_chunk(control, 101, chunk, block);
+            auto reply_deadline = std::chrono::steady_clock::now() + 5s;
+            cas_open = sent && next_reply(reply_deadline).rfind("STATUS:FILE_UPLOAD_READY:", 0) == 0 &&
+                       next_reply(reply_deadline).rfind("DATA:FILE_CAS_NEED:", 0) == 0;
+        }
+
+        for (int fd : sockets) if (fd >= 0) close(fd);
+        server.stop();
+        server_thread.join();
+
+        // The cancel runs on the upload's strand, after its queued chunk
+        auto cancel_deadline = std::chrono::steady_clock::now() + 5s;
+        struct stat cas_st{};
+        auto cas_left = [&]() { return stat(cas_path.c_str(), &cas_st) == 0; };
+        while ((delta_temps() > 0 || cas_left()) && std::chrono::steady_clock::now() < cancel_deadline) {
+            std::this_thread::sleep_for(10ms);
+        }
+        bool delta_cancelled = delta_open && delta_temps() == 0;
+        bool cas_cancelled = cas_open && !cas_left();
+
+        bool intact = sent && completed == uploads;
+        for (size_t i = 0; i < uploads && intact; ++i) {
+            uint64_t size = 0;
+            bool same = true;
+            session_ft->download_file(paths[i], [&](const uint8_t* d, size_t n, bool) {
+                size += n;
+                same = same && std::all_of(d, d + n, [&](uint8_t b) { return b == 'a' + i; });
+            });
+            intact = size == per_upload && same;
+        }
+        for (const auto& path : paths) ft.delete_path(path);
+
+        std::ostringstream details;
+        details << completed << "/" << uploads << " x " << (per_upload >> 20) << " MB completed, "
+                << std::fixed << std::setprecision(1) << (uploads * per_upload / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s";
+        if (!errors.empty()) details << ", " << errors;
+        log_test("FileTransfer::session_uploads", intact, details.str(), ms);
+        std::string left_open = !delta_open ? "delta upload did not start"
+                              : !cas_open ? "CAS upload did not start"
+                              : !delta_cancelled ? "delta temp file left behind"
+                              : !cas_cancelled ? "partial CAS file left behind"
+                              : "open delta and CAS uploads cancelled, their files removed";
+        log_test("FileTransfer::session_disconnect", intact && delta_cancelled && cas_cancelled, left_open);
+    }
+
     // Cleanup
+    ft.delete_path(chunked_path);
     ft.delete_path(new_path);
     ft.delete_path(test_dir);
 }
 
+// ============================================================================
+// ParallelTransfer Tests
+// ============================================================================
+
+void test_parallel_transfer() {
+    std::cout << "\n=== Testing ParallelTransfer ===" << std::endl;
+
+    LinuxFileTransfer ft;
+    const std::string path = "/tmp/test_parallel_transfer.bin";
+    const size_t FILE_SIZE = 64 * 1024 * 1024;
+
+    std::vector<uint8_t> data(FILE_SIZE);
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < data.size(); i += 4) {
+        uint32_t v = rng();
+        memcpy(&data[i], &v, 4);
+    }
+    ft.upload_start(path, data.size());
+    ft.upload_chunk(path, data.data(), data.size());
+    ft.upload_finish(path);
+
+    core::ParallelTransfer::Config config;
+    config.max_streams = 4;
+    core::ParallelTransfer engine(ft, config);
+    interfaces::ByteRange whole{0, FILE_SIZE};
+
+    // Stand-in gateway: chunks framed as [8B offset][4B size][data] into one
+    // socket (shared like the session's data channel), reassembled by offset
+    // on the other end
+    auto run = [&](size_t streams, double& ms) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return false;
+
+        std::vector<uint8_t> received(FILE_SIZE);
+        size_t last_flags = 0;
+        std::thread gateway([&]() {
+            uint8_t head[12];
+            auto read_full = [&](uint8_t* p, size_t n) {
+                while (n > 0) {
+                    ssize_t r = read(sv[1], p, n);
+                    if (r <= 0) return false;
+                    p += r;
+                    n -= r;
+                }
+                return true;
+            };
+            while (read_full(head, sizeof(head))) {
+                uint64_t offset;
+                uint32_t size;
+                memcpy(&offset, head, 8);
+                memcpy(&size, head + 8, 4);
+                if (offset + size > received.size() || !read_full(&received[offset], size)) break;
+            }
+        });
+
+        std::mutex socket_mutex;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto result = engine.read_with(streams, path, whole,
+            [&](uint64_t offset, const uint8_t* chunk, size_t size, bool is_last) {
+                uint8_t head[12];
+                uint32_t size32 = static_cast<uint32_t>(size);
+                memcpy(head, &offset, 8);
+                memcpy(head + 8, &size32, 4);
+                std::lock_guard<std::mutex> lock(socket_mutex);
+                if (is_last) last_flags++;
+                ::send(sv[0], head, sizeof(head), MSG_NOSIGNAL);
+                for (size_t sent = 0; sent < size; ) {
+                    ssize_t n = ::send(sv[0], chunk + sent, size - sent, MSG_NOSIGNAL);
+                    if (n <= 0) break;
+                    sent += n;
+                }
+            });
+        shutdown(sv[0], SHUT_WR);
+        gateway.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        ms = std::chrono::duration<double, std::milli>(end - start).count();
+        close(sv[0]);
+        close(sv[1]);
+
+        return result.is_ok() && last_flags == 1 && received == data;
+    };
+
+    // Test 1: One stream vs N stripes over the loopback gateway
+    {
+        double mb = FILE_SIZE / (1024.0 * 1024.0);
+        double ms_one = 0, ms_many = 0;
+        bool ok_one = run(1, ms_one);
+        bool ok_many = run(config.max_streams, ms_many);
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(0)
+           << "1 stream " << (mb / (ms_one / 1000.0)) << " MB/s, "
+           << config.max_streams << " streams " << (mb / (ms_many / 1000.0)) << " MB/s";
+        log_test("ParallelTransfer::streams(1 vs N)", ok_one && ok_many, ss.str(), ms_one + ms_many);
+    }
+
+    // Test 2: Tuner measures 1, 2, 4 streams in turn, then settles on a measured count
+    {
+        std::vector<size_t> picks;
+        bool ok = true;
+        for (int i = 0; i < 5 && ok; ++i) {
+            picks.push_back(engine.next_streams());
+            ok = engine.read(path, whole, [](uint64_t, const uint8_t*, size_t, bool) {}).is_ok();
+        }
+        size_t settled = engine.next_streams();
+        ok = ok && picks[0] == 1 && picks[1] == 2 && engine.measured_mbps(1) > 0 &&
+             engine.measured_mbps(settled) > 0;
+
+        std::stringstream ss;
+        ss << "picks";
+        for (size_t p : picks) ss << " " << p;
+        ss << ", settled on " << settled;
+        log_test("ParallelTransfer::auto_tune", ok, ss.str());
+    }
+
+    ft.delete_path(path);
+}
+
+// ============================================================================
+// TransferScheduler Tests
+// ============================================================================
+
+void test_transfer_scheduler() {
+    std::cout << "\n=== Testing TransferScheduler ===" << std::endl;
+    using Scheduler = core::TransferScheduler;
+    using Priority = Scheduler::Priority;
+
+    // Test 1: Interactive bypasses a busy Bulk slot; clients take turns
+    {
+        Scheduler scheduler(2);  // 1 Bulk slot + 1 kept for Interactive
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::string> order;
+        bool gate_open = false;
+        bool gate_running = false;
+
+        auto record = [&](const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+            cv.notify_all();
+        };
+
+        scheduler.submit(1, Priority::Bulk, "gate", [&](Scheduler::Transfer&) {
+            std::unique_lock<std::mutex> lock(mutex);
+            gate_running = true;
+            cv.notify_all();
+            cv.wait(lock, [&]() { return gate_open; });
+        });
+        // The rest queue behind a running gate (queued with it, client 2
+        // would rightly be served before client 1's second job)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::seconds(2), [&]() { return gate_running; });
+        }
+        for (const char* name : {"A2", "A3"}) {
+            scheduler.submit(1, Priority::Bulk, name, [&, name](Scheduler::Transfer&) { record(name); });
+        }
+        scheduler.submit(2, Priority::Bulk, "B1", [&](Scheduler::Transfer&) { record("B1"); });
+        scheduler.submit(2, Priority::Interactive, "list", [&](Scheduler::Transfer&) { record("list"); });
+
+        bool list_first;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            list_first = cv.wait_for(lock, std::chrono::seconds(2), [&]() { return !order.empty(); });
+            gate_open = true;
+            cv.notify_all();
+            cv.wait_for(lock, std::chrono::seconds(2), [&]() { return order.size() == 4; });
+        }
+
+        std::string joined;
+        for (const auto& name : order) joined += name + " ";
+        bool passed = list_first && joined == "list A2 B1 A3 ";
+        log_test("TransferScheduler::priority_and_fairness", passed, joined);
+    }
+
+    // Test 2: Cancel drops queued jobs and wakes a job blocked on its flow window
+    {
+        Scheduler scheduler(1);
+        std::atomic<bool> queued_ran{false};
+        std::atomic<size_t> leased{0};
+        std::atomic<bool> saw_cancel{false};
+        std::vector<std::shared_ptr<const interfaces::TransferLease>> held;  // A writer that never drains
+        std::mutex held_mutex;
+
+        scheduler.submit(7, Priority::Bulk, "/big", [&](Scheduler::Transfer& t) {
+            while (auto lease = t.acquire_lease()) {
+                std::lock_guard<std::mutex> lock(held_mutex);
+                held.push_back(std::move(lease));
+                leased++;
+            }
+            saw_cancel = t.cancelled();
+        });
+        scheduler.submit(7, Priority::Bulk, "/queued", [&](Scheduler::Transfer&) { queued_ran = true; });
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (leased < Scheduler::FLOW_WINDOW && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        bool window_held = leased == Scheduler::FLOW_WINDOW;
+
+        size_t cancelled = scheduler.cancel(7, Priority::Bulk);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto busy = scheduler.stats();  // Still active: the writer holds its leases
+        {
+            std::lock_guard<std::mutex> lock(held_mutex);
+            held.clear();  // Writer discards the packets
+        }
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (scheduler.stats().active > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        auto done = scheduler.stats();
+
+        bool passed = window_held && cancelled == 2 && saw_cancel && !queued_ran &&
+                      busy.active == 1 && done.active == 0 && done.queued == 0 && done.cancelled == 2;
+        std::stringstream ss;
+        ss << leased.load() << " leased, " << cancelled << " cancelled, active " << busy.active
+           << " -> " << done.active;
+        log_test("TransferScheduler::cancel", passed, ss.str());
+    }
+
+    // Test 3: The same cid on two gateway sessions is two clients: cancelling
+    // one session's jobs leaves the other's running and queued
+    {
+        Scheduler scheduler(2);
+        const uint64_t on_a = core::BroadcastBus::make_id(1, 5), on_b = core::BroadcastBus::make_id(2, 5);
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t running = 0;
+        bool release = false;
+        std::atomic<bool> a_cancelled{false}, b_cancelled{false}, a_queued_ran{false}, b_queued_ran{false};
+
+        auto blocker = [&](std::atomic<bool>& cancelled) {
+            return [&](Scheduler::Transfer& t) {
+                std::unique_lock<std::mutex> lock(mutex);
+                running++;
+                cv.notify_all();
+                while (!release && !t.cancelled()) cv.wait_for(lock, std::chrono::milliseconds(5));
+                cancelled = t.cancelled();
+            };
+        };
+        scheduler.submit(on_a, Priority::Interactive, "watch", blocker(a_cancelled));
+        scheduler.submit(on_b, Priority::Interactive, "watch", blocker(b_cancelled));
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::seconds(2), [&]() { return running == 2; });
+        }
+        scheduler.submit(on_a, Priority::Interactive, "watch", [&](Scheduler::Transfer&) { a_queued_ran = true; });
+        scheduler.submit(on_b, Priority::Interactive, "watch", [&](Scheduler::Transfer&) { b_queued_ran = true; });
+
+        size_t cancelled = scheduler.cancel(on_a, Priority::Interactive, "watch");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bool b_untouched = !b_cancelled;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            release = true;
+            cv.notify_all();
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while ((scheduler.stats().active > 0 || scheduler.stats().queued > 0) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        bool passed = cancelled == 2 && a_cancelled && b_untouched && !b_cancelled && !a_queued_ran && b_queued_ran;
+        std::stringstream ss;
+        ss << cancelled << " cancelled on session 1; session 2 " << (b_cancelled ? "cancelled" : "running")
+           << ", its queued job " << (b_queued_ran ? "ran" : "did not run");
+        log_test("TransferScheduler::sessions", passed, ss.str());
+    }
+}
+
+// ============================================================================
+// TrafficShaper Tests
+// ============================================================================
+
+void test_traffic_shaper() {
+    std::cout << "\n=== Testing TrafficShaper ===" << std::endl;
+    using core::network::TrafficClass;
+    using Clock = core::network::TrafficShaper::Clock;
+
+    // Test 1: 1 MB/s file limit over 10 simulated seconds of 250 KB chunks
+    {
+        core::network::TrafficShaper shaper;
+        shaper.set_rate(TrafficClass::File, 1024 * 1024);
+        const size_t CHUNK = 250 * 1024;
+
+        auto t0 = Clock::now();
+        uint64_t sent = 0;
+        for (int ms = 0; ms < 10000; ++ms) {
+            auto now = t0 + std::chrono::milliseconds(ms);
+            while (shaper.admit(TrafficClass::File, CHUNK, now)) sent += CHUNK;
+        }
+        bool unlimited_video = shaper.admit(TrafficClass::Video, 100 * 1024 * 1024, t0);
+
+        // 10 s at 1 MB/s plus the initial burst, give or take one chunk
+        double mb = sent / (1024.0 * 1024.0);
+        bool passed = mb >= 10.0 && mb <= 10.0 + 0.5 && unlimited_video;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << mb << " MB in 10 s, "
+           << shaper.stats().classes[static_cast<size_t>(TrafficClass::File)].throttled << " refusals";
+        log_test("TrafficShaper::file_rate", passed, ss.str());
+    }
+
+    // Test 2: Global cap holds video and file back but not control
+    {
+        core::network::TrafficShaper shaper;
+        shaper.set_global_rate(512 * 1024);
+        auto now = Clock::now();
+
+        bool first = shaper.admit(TrafficClass::Video, 1024 * 1024, now);  // Burst, then debt
+        bool video_held = !shaper.admit(TrafficClass::Video, 1000, now);
+        bool file_held = !shaper.admit(TrafficClass::File, 1000, now);
+        bool control_ok = shaper.admit(TrafficClass::Control, 200, now);
+        auto wait = shaper.wait_time(TrafficClass::File, now);
+        bool later_ok = shaper.admit(TrafficClass::File, 1000, now + wait);
+
+        bool passed = first && video_held && file_held && control_ok && wait.count() > 0 && later_ok;
+        std::stringstream ss;
+        ss << "file waits " << wait.count() / 1000 << " ms behind video burst";
+        log_test("TrafficShaper::global_cap", passed, ss.str());
+    }
+}
+
+// ============================================================================
+// Checksum Tests
+// ============================================================================
+
+void test_checksums() {
+    std::cout << "\n=== Testing Checksums ===" << std::endl;
+    namespace cs = common::checksum;
+
+    std::vector<uint8_t> data(3 * 1024 * 1024 + 12345);
+    std::mt19937 rng(7);
+    for (auto& b : data) b = static_cast<uint8_t>(rng());
+
+    // Test 1: Known vectors, hardware path agrees with the tables at every alignment
+    {
+        const uint8_t* check = reinterpret_cast<const uint8_t*>("123456789");
+        bool passed = cs::crc32c(check, 9) == 0xE3069283u && cs::crc32c_portable(check, 9) == 0xE3069283u;
+        for (size_t skew = 0; skew < 16 && passed; ++skew) {
+            passed = cs::crc32c(data.data() + skew, 1000 + skew) == cs::crc32c_portable(data.data() + skew, 1000 + skew);
+        }
+        uint32_t split = cs::crc32c(data.data() + 777, data.size() - 777, cs::crc32c(data.data(), 777));
+        passed = passed && split == cs::crc32c(data.data(), data.size());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        volatile uint32_t sink = cs::crc32c(data.data(), data.size());
+        (void)sink;
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::stringstream ss;
+        ss << (cs::crc32c_hardware() ? "hardware" : "table") << ", "
+           << std::fixed << std::setprecision(0) << (data.size() / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s";
+        log_test("Checksum::crc32c", passed, ss.str(), ms);
+    }
+
+    // Test 2: XXH64 reference values; streaming in odd pieces matches one shot
+    {
+        bool passed = cs::xxh64(nullptr, 0) == 0xEF46DB3751D8E999ULL &&
+                      cs::xxh64(reinterpret_cast<const uint8_t*>("a"), 1) == 0xD24EC4F1A98C6E5BULL &&
+                      cs::xxh64(reinterpret_cast<const uint8_t*>("abc"), 3) == 0x44BC2CF5AD770999ULL;
+        cs::Xxh64 streamed;
+        for (size_t pos = 0, step = 1; pos < data.size(); pos += step, step = step * 3 % 9973 + 1) {
+            streamed.update(data.data() + pos, (std::min)(step, data.size() - pos));
+        }
+        passed = passed && streamed.digest() == cs::xxh64(data.data(), data.size());
+        log_test("Checksum::xxh64", passed, "reference vectors, split input");
+    }
+
+    // Test 3: Same file digest fed in order, in reverse, and by an upload
+    // whose out-of-order blocks are read back at finish
+    {
+        const uint64_t block = interfaces::FILE_TRANSFER_CHUNK_SIZE;
+        cs::ChunkDigest in_order(block), reversed(block);
+        in_order.update(0, data.data(), data.size());
+        for (uint64_t b = (data.size() - 1) / block + 1; b-- > 0;) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(block, data.size() - b * block));
+            reversed.update(b * block, data.data() + b * block, n);
+        }
+        bool same = in_order.incomplete_blocks(data.size()).empty() &&
+                    reversed.incomplete_blocks(data.size()).empty() &&
+                    in_order.finish(data.size()) == reversed.finish(data.size());
+
+        LinuxFileTransfer ft;
+        std::string path = "/tmp/test_checksum_upload.bin";
+        auto start = std::chrono::high_resolution_clock::now();
+        ft.upload_start(path, data.size());
+        const size_t chunk = 192 * 1024;  // Frontend chunk: not block aligned
+        for (size_t off = (data.size() - 1) / chunk * chunk; ; off -= chunk) {
+            ft.upload_write_at(path, off, data.data() + off, (std::min)(chunk, data.size() - off));
+            if (off == 0) break;
+        }
+        auto uploaded = ft.upload_finish_digest(path);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        auto read_back = ft.file_digest(path);
+        ft.delete_path(path);
+
+        bool passed = same && uploaded.is_ok() && read_back.is_ok() &&
+                      uploaded.unwrap() == in_order.finish(data.size()) &&
+                      read_back.unwrap() == uploaded.unwrap();
+        log_test("Checksum::file_digest", passed,
+                 uploaded.is_ok() ? "digest " + cs::to_hex(uploaded.unwrap()) : uploaded.error().message, ms);
+    }
+
+    // Test 4: SHA-256 reference vectors; the hardware path agrees with the
+    // portable one, whole blocks and split input alike
+    {
+        auto hex = [](const char* text) {
+            return cs::sha256_hex(reinterpret_cast<const uint8_t*>(text), strlen(text));
+        };
+        bool passed = hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" &&
+                      hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" &&
+                      hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+                          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+
+        uint32_t hw[8] = {1, 2, 3, 4, 5, 6, 7, 8}, sw[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        cs::detail::sha256_blocks(hw, data.data(), 1000);
+        cs::detail::sha256_blocks_portable(sw, data.data(), 1000);
+        passed = passed && std::memcmp(hw, sw, sizeof(hw)) == 0;
+
+        cs::Sha256 streamed;
+        for (size_t pos = 0, step = 1; pos < data.size(); pos += step, step = step * 7 % 9973 + 1) {
+            streamed.update(data.data() + pos, (std::min)(step, data.size() - pos));
+        }
+        auto digest = streamed.finish();
+        std::string one_shot = cs::sha256_hex(data.data(), data.size());
+        static const char* HEX = "0123456789abcdef";
+        std::string split;
+        for (uint8_t b : digest) split += {HEX[b >> 4], HEX[b & 0xF]};
+        passed = passed && split == one_shot;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        volatile char sink = cs::sha256_hex(data.data(), data.size())[0];
+        (void)sink;
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::stringstream ss;
+        ss << (cs::detail::sha256_hardware() ? "SHA extensions" : "portable") << ", "
+           << std::fixed << std::setprecision(0) << (data.size() / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s";
+        log_test("Checksum::sha256", passed, ss.str(), ms);
+    }
+}
+
+void test_file_hasher() {
+    std::cout << "\n=== Testing FileHasher ===" << std::endl;
+    namespace cs = common::checksum;
+
+    LinuxFileTransfer ft;
+    core::ParallelTransfer parallel(ft);
+    const std::string path = "/tmp/test_file_hasher.bin";
+    const std::string cache = "/tmp/test_file_hasher.cache";
+    std::remove(cache.c_str());
+
+    std::vector<uint8_t> data(24 * 1024 * 1024 + 4321);
+    std::mt19937 rng(11);
+    for (auto& b : data) b = static_cast<uint8_t>(rng());
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f) {
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    }
+    // Old enough to be cached (files modified just now are not)
+    struct utimbuf times{time(nullptr) - 60, time(nullptr) - 60};
+    utime(path.c_str(), &times);
+
+    // Test 1: Striped tree hashes equal the one-pass digests
+    {
+        core::FileHasher hasher(ft, parallel, cache);
+        uint64_t last_progress = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto tree = hasher.hash(path, core::HashAlgorithm::Xxh64Tree,
+                                [&](uint64_t done, uint64_t) { last_progress = done; });
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        auto crc = hasher.hash(path, core::HashAlgorithm::Crc32c);
+        auto reference = ft.file_digest(path);
+
+        bool passed = tree.is_ok() && crc.is_ok() && reference.is_ok() &&
+                      tree.unwrap().digest == reference.unwrap() && !tree.unwrap().cached &&
+                      crc.unwrap().digest == cs::crc32c(data.data(), data.size()) &&
+                      last_progress == data.size() && hasher.save(true).is_ok();
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(0) << (data.size() / (1024.0 * 1024.0)) / (ms / 1000.0)
+           << " MB/s, " << parallel.next_streams() << " streams";
+        log_test("FileHasher::parallel_digest", passed, ss.str(), ms);
+    }
+
+    // Test 2: A new hasher (restart) answers from the cache file; a changed
+    // file misses
+    {
+        core::FileHasher hasher(ft, parallel, cache);
+        auto start = std::chrono::high_resolution_clock::now();
+        auto again = hasher.hash(path, core::HashAlgorithm::Xxh64Tree);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        data[12345] ^= 0xFF;
+        f = fopen(path.c_str(), "r+b");
+        if (f) {
+            fseek(f, 12345, SEEK_SET);
+            fputc(data[12345], f);
+            fclose(f);
+        }
+        struct utimbuf later{time(nullptr) - 30, time(nullptr) - 30};
+        utime(path.c_str(), &later);
+        auto changed = hasher.hash(path, core::HashAlgorithm::Crc32c);
+
+        auto st = hasher.stats();
+        bool passed = again.is_ok() && again.unwrap().cached && changed.is_ok() && !changed.unwrap().cached &&
+                      changed.unwrap().digest == cs::crc32c(data.data(), data.size()) &&
+                      st.hits == 1 && st.misses == 1;
+        log_test("FileHasher::persistent_cache", passed,
+                 "hits " + std::to_string(st.hits) + ", entries " + std::to_string(st.entries), ms);
+    }
+
+    ft.delete_path(path);
+    std::remove(cache.c_str());
+}
+
+void test_archive_stream() {
+    std::cout << "\n=== Testing ArchiveStream ===" << std::endl;
+
+    LinuxFileTransfer ft;
+    const std::string root = "/tmp/test_archive_dir";
+    const std::string deep = root + "/" + std::string(60, 'd') + "/" + std::string(70, 'e');
+
+    // delete_path is not recursive: children first (the walk lists parents first)
+    auto remove_tree = [&]() {
+        auto tree = core::walk_tree(ft, root);
+        if (tree.is_ok()) {
+            const auto& entries = tree.unwrap().entries;
+            for (auto it = entries.rbegin(); it != entries.rend(); ++it) ft.delete_path(it->path);
+        }
+        ft.delete_path(root);
+    };
+    remove_tree();
+    ft.create_directory(deep);
+    ft.create_directory(root + "/empty");
+
+    // name -> contents, including a name too long for the plain ustar fields
+    std::map<std::string, std::string> expected;
+    std::mt19937 rng(5);
+    auto add_file = [&](const std::string& rel, size_t size) {
+        std::string data(size, '\0');
+        for (auto& c : data) c = static_cast<char>(rng());
+        FILE* f = fopen((root + "/" + rel).c_str(), "wb");
+        if (f) {
+            fwrite(data.data(), 1, data.size(), f);
+            fclose(f);
+        }
+        expected["test_archive_dir/" + rel] = data;
+    };
+    add_file("small.txt", 100);
+    add_file("empty.bin", 0);
+    add_file("big.bin", 5 * 1024 * 1024 + 3);
+    add_file(deep.substr(root.size() + 1) + "/" + std::string(90, 'f') + ".dat", 70000);
+
+    auto listing = core::walk_tree(ft, root);
+    std::vector<core::ArchiveStream::Member> members;
+    members.push_back({common::tar::Entry{"test_archive_dir/", 0, 0, true, false}, ""});
+    if (listing.is_ok()) {
+        for (const auto& f : listing.unwrap().entries) {
+            std::string name = "test_archive_dir/" + core::relative_path(root, f.path) + (f.is_directory ? "/" : "");
+            members.push_back({common::tar::Entry{name, f.size, f.modified_time, f.is_directory, false},
+                               f.is_directory ? "" : f.path});
+        }
+    }
+
+    // Test 1: Stream the archive; every chunk but the last is full size
+    std::string archive;
+    uint64_t announced = 0;
+    bool chunks_ok = true;
+    double ms = 0;
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        core::ArchiveStream stream(ft, std::move(members));
+        announced = stream.size();
+        std::vector<uint8_t> chunk;
+        while (stream.next(chunk)) {
+            if (archive.size() % interfaces::FILE_TRANSFER_CHUNK_SIZE != 0) chunks_ok = false;
+            archive.append(chunk.begin(), chunk.end());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        ms = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Test 2: Read it back: header checksums, pax long names, contents
+    std::map<std::string, std::string> found;
+    std::set<std::string> dirs;
+    bool headers_ok = archive.size() % common::tar::BLOCK_SIZE == 0;
+    size_t pos = 0;
+    std::string long_name;
+    while (headers_ok && pos + common::tar::BLOCK_SIZE <= archive.size()) {
+        const uint8_t* h = reinterpret_cast<const uint8_t*>(archive.data() + pos);
+        if (std::all_of(h, h + common::tar::BLOCK_SIZE, [](uint8_t b) { return b == 0; })) break;  // End blocks
+
+        uint32_t sum = 0;
+        for (size_t i = 0; i < common::tar::BLOCK_SIZE; ++i) sum += (i >= 148 && i < 156) ? ' ' : h[i];
+        headers_ok = sum == std::stoul(std::string(reinterpret_cast<const char*>(h + 148), 6), nullptr, 8) &&
+                     memcmp(h + 257, "ustar", 6) == 0;
+
+        uint64_t size = std::stoull(std::string(reinterpret_cast<const char*>(h + 124), 11), nullptr, 8);
+        std::string name(reinterpret_cast<const char*>(h), strnlen(reinterpret_cast<const char*>(h), 100));
+        std::string prefix(reinterpret_cast<const char*>(h + 345), strnlen(reinterpret_cast<const char*>(h + 345), 155));
+        if (!prefix.empty()) name = prefix + "/" + name;
+        std::string body = archive.substr(pos + common::tar::BLOCK_SIZE, size);
+        pos += common::tar::BLOCK_SIZE + size + common::tar::padding(size);
+
+        if (h[156] == 'x') {
+            size_t key = body.find(" path=");
+            if (key != std::string::npos) long_name = body.substr(key + 6, body.find('\n', key) - key - 6);
+            continue;
+        }
+        if (!long_name.empty()) name = long_name;
+        long_name.clear();
+        if (h[156] == '5') dirs.insert(name);
+        else found[name] = body;
+    }
+
+    bool passed = listing.is_ok() && chunks_ok && announced == archive.size();
+    std::stringstream ss;
+    ss << archive.size() << " bytes, " << std::fixed << std::setprecision(0)
+       << (archive.size() / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s";
+    log_test("ArchiveStream::stream", passed, ss.str(), ms);
+
+    passed = headers_ok && found == expected && dirs.count("test_archive_dir/empty/") == 1 &&
+             dirs.count("test_archive_dir/") == 1;
+    log_test("ArchiveStream::tar_contents", passed,
+             std::to_string(found.size()) + " files, " + std::to_string(dirs.size()) + " directories");
+
+    remove_tree();
+}
+
 // ============================================================================
 // Main Test Runner
 // ============================================================================
 
+// ============================================================================
+// Delta Upload Test
+// ============================================================================
+
+void test_delta_upload() {
+    std::cout << "\n=== Testing Delta Upload ===" << std::endl;
+    namespace cs = common::checksum;
+    namespace delta = common::delta;
+
+    LinuxFileTransfer ft;
+    const std::string dir = "/tmp/test_delta_upload";
+    const std::string path = dir + "/image.bin";
+    ft.create_directory(dir);
+
+    // A large binary and a new version of it: a few patched bytes, an
+    // insertion and a deletion (everything after them shifts) and an
+    // appended tail
+    std::vector<uint8_t> basis(64 * 1024 * 1024 + 777);
+    std::mt19937 rng(21);
+    for (auto& b : basis) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> target(basis.begin(), basis.begin() + 20 * 1024 * 1024);
+    for (int i = 0; i < 1000; ++i) target.push_back(static_cast<uint8_t>(rng()));
+    target.insert(target.end(), basis.begin() + 20 * 1024 * 1024, basis.begin() + 40 * 1024 * 1024);
+    target.insert(target.end(), basis.begin() + 40 * 1024 * 1024 + 5000, basis.end());
+    for (int i = 0; i < 100 * 1024; ++i) target.push_back(static_cast<uint8_t>(rng()));
+    for (size_t at : {size_t(4096), size_t(9 * 1024 * 1024 + 3), size_t(50 * 1024 * 1024)}) target[at] ^= 0x5A;
+
+    auto write_basis = [&]() {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = fwrite(basis.data(), 1, basis.size(), f) == basis.size();
+        return fclose(f) == 0 && ok;
+    };
+    auto read_file = [&]() {
+        std::vector<uint8_t> out;
+        ft.download_file(path, [&](const uint8_t* data, size_t n, bool) { out.insert(out.end(), data, data + n); });
+        return out;
+    };
+    auto temp_files = [&]() {
+        size_t count = 0;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* e = readdir(d)) count += strstr(e->d_name, ".delta.") != nullptr;
+            closedir(d);
+        }
+        return count;
+    };
+
+    // Sender side: literals as upload chunks, copies as basis ranges
+    auto apply = [&](const std::vector<delta::Op>& ops) {
+        auto result = ft.delta_start(path, target.size());
+        for (const auto& op : ops) {
+            if (result.is_err()) break;
+            if (op.copy) {
+                result = ft.delta_copy(path, op.dst, op.src, op.length);
+                continue;
+            }
+            for (uint64_t pos = 0; pos < op.length && result.is_ok(); pos += interfaces::FILE_TRANSFER_CHUNK_SIZE) {
+                size_t n = static_cast<size_t>((std::min)(op.length - pos, uint64_t(interfaces::FILE_TRANSFER_CHUNK_SIZE)));
+                result = ft.upload_write_at(path, op.dst + pos, target.data() + op.dst + pos, n);
+            }
+        }
+        return result;
+    };
+
+    // Test 1: Signatures, delta, reconstruction; bytes saved and CPU cost
+    {
+        write_basis();
+        auto t0 = std::chrono::high_resolution_clock::now();
+        delta::SignatureBuilder builder(delta::block_size_for(basis.size()));
+        for (size_t pos = 0; pos < basis.size(); pos += interfaces::FILE_TRANSFER_CHUNK_SIZE) {
+            builder.update(basis.data() + pos, (std::min)(basis.size() - pos, size_t(interfaces::FILE_TRANSFER_CHUNK_SIZE)));
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto ops = delta::compute_delta(builder.blocks(), builder.block_size(), target.data(), target.size());
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        uint64_t literal = 0, covered = 0;
+        for (const auto& op : ops) {
+            if (!op.copy) literal += op.length;
+            covered += op.length;
+        }
+
+        auto started = apply(ops);
+        bool old_visible = read_file() == basis;  // Until the rename
+        auto t3 = std::chrono::high_resolution_clock::now();
+        auto finished = ft.delta_finish(path, cs::crc32c(target.data(), target.size()));
+        auto t4 = std::chrono::high_resolution_clock::now();
+        auto digest = ft.file_digest(path);
+
+        double sig_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double delta_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        double finish_ms = std::chrono::duration<double, std::milli>(t4 - t3).count();
+        double mb = basis.size() / (1024.0 * 1024.0);
+
+        bool passed = started.is_ok() && finished.is_ok() && old_visible && covered == target.size() &&
+                      read_file() == target && digest.is_ok() && finished.unwrap() == digest.unwrap() &&
+                      literal < 1024 * 1024 && temp_files() == 0;
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << literal / 1024.0 << " KB literal of "
+           << target.size() / (1024.0 * 1024.0) << " MB (" << std::setprecision(2)
+           << 100.0 * (1.0 - double(literal + builder.blocks().size() * delta::SIGNATURE_BYTES) / target.size())
+           << "% saved incl. " << builder.blocks().size() * delta::SIGNATURE_BYTES / 1024 << " KB signatures), "
+           << ops.size() << " ops; signatures " << std::setprecision(0) << mb / (sig_ms / 1000.0)
+           << " MB/s, delta " << mb / (delta_ms / 1000.0) << " MB/s, verify+rename "
+           << std::setprecision(1) << finish_ms << " ms";
+        log_test("DeltaUpload::reconstruct", passed, ss.str(), sig_ms + delta_ms);
+    }
+
+    // Test 2: A wrong reconstruction (bad checksum) and a cancel both leave
+    // the current file untouched and no temporary file behind
+    {
+        write_basis();
+        std::vector<delta::Op> ops = {{false, 0, 0, target.size()}};
+        auto started = apply(ops);
+        auto rejected = ft.delta_finish(path, cs::crc32c(target.data(), target.size()) ^ 1);
+        bool kept = read_file() == basis && temp_files() == 0;
+
+        auto restarted = apply(ops);
+        bool temp_seen = temp_files() == 1;
+        ft.upload_cancel(path);
+        bool cancelled = read_file() == basis && temp_files() == 0;
+
+        auto missing = ft.delta_copy(path, 0, 0, 1);
+        bool passed = started.is_ok() && rejected.is_err() && kept && restarted.is_ok() && temp_seen &&
+                      cancelled && missing.is_err();
+        log_test("DeltaUpload::rejects_bad_result", passed,
+                 rejected.is_err() ? rejected.error().message : "accepted a wrong checksum");
+    }
+
+    ft.delete_path(path);
+    ft.delete_path(dir);
+}
+
+void test_directory_listing() {
+    std::cout << "\n=== Testing Directory Listing ===" << std::endl;
+
+    LinuxFileTransfer ft;
+    const std::string dir = "/tmp/test_list_dir";
+    const size_t FILES = 90000, DIRS = 5000, LINKS = 4000, BROKEN = 1000;
+
+    auto name_of = [](const char* kind, size_t i) { return std::string(kind) + std::to_string(i); };
+    auto remove_all = [&]() {
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* e = readdir(d)) {
+                if (e->d_name[0] == '.' && (e->d_name[1] == '\0' || e->d_name[1] == '.')) continue;
+                std::string p = dir + "/" + e->d_name;
+                if (unlink(p.c_str()) != 0) rmdir(p.c_str());
+            }
+            closedir(d);
+        }
+        rmdir(dir.c_str());
+    };
+
+    // Files of varied sizes (sparse), directories, symlinks to files and
+    // dangling symlinks; hidden names mixed in
+    remove_all();
+    mkdir(dir.c_str(), 0755);
+    auto gen_start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < FILES; ++i) {
+        std::string p = dir + "/" + (i % 50 == 0 ? "." : "") + name_of("file_", i);
+        int fd = open(p.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, i % 7 == 0 ? 0444 : 0644);
+        if (fd >= 0) {
+            if (ftruncate(fd, static_cast<off_t>(i * 37)) != 0) {}
+            close(fd);
+        }
+    }
+    for (size_t i = 0; i < DIRS; ++i) mkdir((dir + "/" + name_of("dir_", i)).c_str(), 0755);
+    for (size_t i = 0; i < LINKS; ++i) {
+        if (symlink(name_of("file_", i + 1).c_str(), (dir + "/" + name_of("link_", i)).c_str()) != 0) {}
+    }
+    for (size_t i = 0; i < BROKEN; ++i) {
+        if (symlink(name_of("missing_", i).c_str(), (dir + "/" + name_of("broken_", i)).c_str()) != 0) {}
+    }
+    double gen_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - gen_start).count();
+
+    // The previous implementation: readdir, then lstat and (links) stat by full path
+    auto reference = [&]() {
+        std::vector<interfaces::FileInfo> out;
+        DIR* d = opendir(dir.c_str());
+        if (!d) return out;
+        while (dirent* e = readdir(d)) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+            interfaces::FileInfo info{};
+            info.name = e->d_name;
+            info.path = dir + "/" + e->d_name;
+            struct stat st, target;
+            if (lstat(info.path.c_str(), &st) == 0 && S_ISLNK(st.st_mode)) {
+                if (stat(info.path.c_str(), &target) == 0) {
+                    st = target;
+                } else {
+                    info.modified_time = st.st_mtime;
+                    info.is_readonly = true;
+                    info.is_hidden = e->d_name[0] == '.';
+                    out.push_back(std::move(info));
+                    continue;
+                }
+            }
+            info.size = st.st_size;
+            info.modified_time = st.st_mtime;
+            info.is_directory = S_ISDIR(st.st_mode);
+            info.is_readonly = !(st.st_mode & S_IWUSR);
+            info.device = st.st_dev;
+            info.inode = st.st_ino;
+            info.is_hidden = e->d_name[0] == '.';
+            out.push_back(std::move(info));
+        }
+        closedir(d);
+        return out;
+    };
+
+    auto best_of = [](int runs, auto&& fn) {
+        double best = 1e30;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            best = (std::min)(best, std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
+    };
+
+    // Test 1: Same entries and metadata as the readdir + lstat listing; faster
+    {
+        std::vector<interfaces::FileInfo> expected = reference();
+        auto listed = ft.list_directory(dir);
+        double old_ms = best_of(3, [&]() { reference(); });
+        double new_ms = best_of(3, [&]() { ft.list_directory(dir); });
+
+        bool same = listed.is_ok() && listed.unwrap().size() == expected.size();
+        if (same) {
+            auto got = listed.unwrap();
+            auto by_name = [](const interfaces::FileInfo& a, const interfaces::FileInfo& b) { return a.name < b.name; };
+            std::sort(got.begin(), got.end(), by_name);
+            std::sort(expected.begin(), expected.end(), by_name);
+            for (size_t i = 0; i < got.size() && same; ++i) {
+                const auto& a = got[i];
+                const auto& b = expected[i];
+                same = a.name == b.name && a.path == b.path && a.size == b.size &&
+                       a.modified_time == b.modified_time && a.is_directory == b.is_directory &&
+                       a.is_hidden == b.is_hidden && a.is_readonly == b.is_readonly &&
+                       a.device == b.device && a.inode == b.inode;
+            }
+        }
+        const size_t total = FILES + DIRS + LINKS + BROKEN;
+        bool passed = same && expected.size() == total;
+
+        std::stringstream ss;
+        ss << total << " entries (generated in " << std::fixed << std::setprecision(0) << gen_ms
+           << " ms): readdir+lstat " << std::setprecision(1) << old_ms << " ms, getdents64+statx "
+           << new_ms << " ms (" << std::setprecision(2) << old_ms / new_ms << "x, "
+           << total / (new_ms / 1000.0) / 1e6 << "M entries/s)";
+        log_test("DirectoryListing::100k_entries", passed, ss.str(), new_ms);
+    }
+
+    // Test 2: Errors as before: missing directory, a file, and root
+    {
+        auto missing = ft.list_directory(dir + "/no_such_dir");
+        auto file = ft.list_directory(dir + "/file_1");
+        auto root = ft.list_directory("");
+        bool passed = missing.is_err() && missing.error().code == common::ErrorCode::DeviceNotFound &&
+                      file.is_err() && root.is_ok() && !root.unwrap().empty();
+        log_test("DirectoryListing::errors", passed,
+                 missing.is_err() ? missing.error().message : "listed a missing directory");
+    }
+
+    remove_all();
+}
+
+void test_chunk_store() {
+    std::cout << "\n=== Testing ChunkStore ===" << std::endl;
+    namespace cdc = common::cdc;
+
+    LinuxFileTransfer ft;
+    const std::string dir = "/tmp/test_chunk_store";
+    const std::string root = dir + "/chunks";
+
+    auto remove_tree = [&]() {
+        auto tree = core::walk_tree(ft, dir);
+        if (tree.is_ok()) {
+            const auto& entries = tree.unwrap().entries;
+            for (auto it = entries.rbegin(); it != entries.rend(); ++it) ft.delete_path(it->path);
+        }
+        ft.delete_path(dir);
+    };
+    auto read_file = [&](const std::string& path) {
+        std::vector<uint8_t> out;
+        ft.download_file(path, [&](const uint8_t* data, size_t n, bool) { out.insert(out.end(), data, data + n); });
+        return out;
+    };
+    auto stored_files = [&]() {
+        size_t count = 0;
+        auto tree = core::walk_tree(ft, root);
+        if (tree.is_ok()) {
+            for (const auto& e : tree.unwrap().entries) count += !e.is_directory && e.name.size() == 64;
+        }
+        return count;
+    };
+    remove_tree();
+    ft.create_directory(dir);
+
+    // A large binary and a new version: an insertion (everything after it
+    // shifts), a patched byte and an appended tail
+    std::vector<uint8_t> v1(48 * 1024 * 1024 + 333);
+    std::mt19937 rng(22);
+    for (auto& b : v1) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> v2(v1.begin(), v1.begin() + 10 * 1024 * 1024);
+    for (int i = 0; i < 3000; ++i) v2.push_back(static_cast<uint8_t>(rng()));
+    v2.insert(v2.end(), v1.begin() + 10 * 1024 * 1024, v1.end());
+    v2[30 * 1024 * 1024] ^= 0x5A;
+    for (int i = 0; i < 200 * 1024; ++i) v2.push_back(static_cast<uint8_t>(rng()));
+
+    struct Chunk { uint64_t offset; size_t length; std::string key; };
+    auto chunk = [](const std::vector<uint8_t>& data) {
+        std::vector<Chunk> chunks;
+        uint64_t offset = 0;
+        for (size_t n : cdc::chunk_lengths(data.data(), data.size())) {
+            chunks.push_back({offset, n, common::checksum::sha256_hex(data.data() + offset, n)});
+            offset += n;
+        }
+        return chunks;
+    };
+
+    // Client and server of one file_cas upload: only missing chunks are written
+    auto push = [&](core::ChunkStore& store, const std::string& path, const std::vector<uint8_t>& data,
+                    uint64_t& sent) -> common::Result<uint64_t> {
+        sent = 0;
+        auto result = ft.upload_start(path, data.size());
+        for (const auto& c : chunk(data)) {
+            if (result.is_err()) break;
+            if (store.plan(path, c.offset, c.key, c.length)) continue;
+            result = ft.upload_write_at(path, c.offset, data.data() + c.offset, c.length);
+            sent += c.length;
+        }
+        if (result.is_err()) return result.error();
+        auto assembled = store.assemble(path);
+        if (assembled.is_err()) return assembled.error();
+        auto digest = ft.upload_finish_digest(path);
+        store.absorb(path);
+        return digest;
+    };
+
+    auto v1_chunks = chunk(v1);
+    auto v2_chunks = chunk(v2);
+
+    // Test 1: First push sends everything; the edited version only its new chunks
+    {
+        core::ChunkStore store(ft, root);
+        uint64_t sent1 = 0, sent2 = 0;
+        auto first = push(store, dir + "/v1.bin", v1, sent1);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        auto second = push(store, dir + "/v2.bin", v2, sent2);
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        auto t2 = std::chrono::high_resolution_clock::now();
+        auto lengths = cdc::chunk_lengths(v2.data(), v2.size());
+        auto t3 = std::chrono::high_resolution_clock::now();
+        common::checksum::sha256_hex(v2.data(), v2.size());
+        auto t4 = std::chrono::high_resolution_clock::now();
+
+        auto stats = store.stats();
+        auto digest = ft.file_digest(dir + "/v2.bin");
+        bool passed = first.is_ok() && second.is_ok() && sent1 == v1.size() && sent2 < 1024 * 1024 &&
+                      read_file(dir + "/v1.bin") == v1 && read_file(dir + "/v2.bin") == v2 &&
+                      digest.is_ok() && second.unwrap() == digest.unwrap() &&
+                      stats.reused_bytes == v2.size() - sent2 && stats.chunks == stored_files();
+
+        double push_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double cdc_ms = std::chrono::duration<double, std::milli>(t3 - t2).count();
+        double sha_ms = std::chrono::duration<double, std::milli>(t4 - t3).count();
+        double mb = v2.size() / (1024.0 * 1024.0);
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << sent2 / 1024.0 << " KB sent of " << mb << " MB ("
+           << std::setprecision(2) << 100.0 * (1.0 - double(sent2) / v2.size()) << "% saved), "
+           << lengths.size() << " chunks avg " << v2.size() / lengths.size() / 1024 << " KB; FastCDC "
+           << std::setprecision(0) << mb / (cdc_ms / 1000.0) << " MB/s, SHA-256 " << mb / (sha_ms / 1000.0)
+           << " MB/s, server side " << std::setprecision(1) << push_ms << " ms";
+        log_test("ChunkStore::dedup_push", passed, ss.str(), push_ms);
+    }
+
+    // Test 2: A restarted store finds its chunks; a smaller budget evicts
+    // the least recently used (v1's chunks v2 did not reuse) first
+    {
+        bool reloaded;
+        {
+            core::ChunkStore store(ft, root);
+            reloaded = store.contains(v1_chunks.front().key) && store.contains(v2_chunks.back().key) &&
+                       store.stats().chunks == stored_files();
+        }
+
+        const uint64_t budget = 8 * 1024 * 1024;
+        core::ChunkStore store(ft, root, budget);
+        bool newest_kept = store.contains(v2_chunks.back().key);
+        auto stats = store.stats();
+        bool files_match = stats.chunks == stored_files();
+
+        uint64_t sent = 0;
+        auto again = push(store, dir + "/v2b.bin", v2, sent);
+        bool passed = reloaded && newest_kept && stats.bytes <= budget && stats.evicted > 0 &&
+                      files_match && again.is_ok() && read_file(dir + "/v2b.bin") == v2 &&
+                      sent < v2.size();
+
+        std::stringstream ss;
+        ss << stats.evicted << " evicted down to " << stats.chunks << " chunks ("
+           << stats.bytes / 1024 << " KB); re-push sent " << sent / 1024 << " KB";
+        log_test("ChunkStore::reload_and_evict", passed, ss.str());
+    }
+
+    // Test 3: Chunks planned into an upload survive eviction until it is
+    // assembled; content that does not match its name is not stored
+    {
+        const auto& kept = v1_chunks[5];
+        const auto& other = v1_chunks[6];
+        core::ChunkStore store(ft, root, kept.length);  // Room for one chunk
+        auto put_kept = store.put(kept.key, v1.data() + kept.offset, kept.length);
+        const std::string path = dir + "/pinned.bin";
+        auto started = ft.upload_start(path, kept.length);
+        bool planned = store.plan(path, 0, kept.key, kept.length);
+
+        // Over budget: the pinned (least recent) chunk stays, the new one goes
+        auto put = store.put(other.key, v1.data() + other.offset, other.length);
+        auto assembled = store.assemble(path);
+        auto finished = ft.upload_finish(path);
+        auto content = read_file(path);
+
+        auto wrong = store.put(other.key, v1.data() + kept.offset, kept.length);
+        auto stats = store.stats();
+        bool passed = put_kept.is_ok() && started.is_ok() && planned && put.is_ok() && assembled.is_ok() && finished.is_ok() &&
+                      content == std::vector<uint8_t>(v1.begin() + kept.offset, v1.begin() + kept.offset + kept.length) &&
+                      wrong.is_err() && stats.rejected == 1 && stats.chunks == 1 && stored_files() == 1 &&
+                      !store.contains(other.key);
+        log_test("ChunkStore::pins_and_verifies", passed,
+                 wrong.is_err() ? wrong.error().message : "stored a mismatched chunk");
+    }
+
+    // Test 4: Cancelling an upload (as a disconnected session's cleanup does)
+    // drops its plan and unpins its chunks: eviction may take them again
+    {
+        const auto& kept = v1_chunks[5];
+        const auto& other = v1_chunks[6];
+        core::ChunkStore store(ft, root, kept.length);  // Holds `kept` from Test 3
+        const std::string path = dir + "/cancelled.bin";
+        auto started = ft.upload_start(path, kept.length);
+        bool planned = store.plan(path, 0, kept.key, kept.length);
+
+        std::string status;
+        core::command::CommandContext ctx{};
+        ctx.respond = [&](std::vector<uint8_t>&& data, bool, uint8_t) { status.assign(data.begin(), data.end()); };
+        handlers::FileUploadCancelCommand cancel(ft, store, path, ctx);
+        cancel.execute();
+
+        // Over budget: the unpinned older chunk now makes room for the new one
+        auto put = store.put(other.key, v1.data() + other.offset, other.length);
+        auto assembled = store.assemble(path);
+        struct stat st{};
+        bool passed = started.is_ok() && planned && status == "STATUS:FILE_UPLOAD_CANCELLED:" + path &&
+                      put.is_ok() && store.contains(other.key) && !store.contains(kept.key) &&
+                      assembled.is_ok() && assembled.unwrap() == 0 && stat(path.c_str(), &st) != 0;
+        log_test("ChunkStore::release_on_cancel", passed,
+                 passed ? "plan released, pinned chunk evicted, partial file removed" : "reply: " + status);
+    }
+
+    remove_tree();
+}
+
+void test_listing_cache() {
+    std::cout << "\n=== Testing ListingCache ===" << std::endl;
+
+    LinuxFileTransfer ft;
+    const std::string dir = "/tmp/test_listing_cache";
+    const size_t FILES = 20000;
+
+    auto remove_tree = [&]() {
+        auto tree = core::walk_tree(ft, dir);
+        if (tree.is_ok()) {
+            const auto& entries = tree.unwrap().entries;
+            for (auto it = entries.rbegin(); it != entries.rend(); ++it) ft.delete_path(it->path);
+        }
+        ft.delete_path(dir);
+    };
+    auto write_file = [&](const std::string& path, size_t size) {
+        int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+        std::string data(size, 'x');
+        if (write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {}
+        close(fd);
+    };
+    // name -> size|mtime|dir|hidden|readonly, order-free
+    auto summary = [](const std::vector<interfaces::FileInfo>& entries) {
+        std::map<std::string, std::string> out;
+        for (const auto& e : entries) {
+            out[e.name] = std::to_string(e.size) + "|" + std::to_string(e.modified_time) + "|" +
+                          (e.is_directory ? "D" : "F") + (e.is_hidden ? "H" : "-") + (e.is_readonly ? "R" : "-");
+        }
+        return out;
+    };
+    auto matches_disk = [&](const core::ListingCache::Listing& listing, const std::string& path) {
+        auto disk = ft.list_directory(path);
+        return listing && disk.is_ok() && summary(*listing) == summary(disk.unwrap());
+    };
+
+    remove_tree();
+    ft.create_directory(dir + "/big");
+    for (size_t i = 0; i < FILES; ++i) write_file(dir + "/big/file_" + std::to_string(i), i % 100);
+    for (int i = 0; i < 10; ++i) ft.create_directory(dir + "/sub_" + std::to_string(i));
+
+    // Test 1: Repeat listings from memory
+    {
+        core::ListingCache cache(ft);
+        auto start = std::chrono::high_resolution_clock::now();
+        auto first = cache.list(dir + "/big");
+        double miss_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        const int REPEATS = 100;
+        bool same = first.is_ok() && matches_disk(first.unwrap(), dir + "/big");
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < REPEATS; ++i) {
+            auto again = cache.list(dir + "/big");
+            same = same && again.is_ok() && again.unwrap() == first.unwrap();
+        }
+        double hit_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count() / REPEATS;
+
+        auto stats = cache.stats();
+        bool passed = same && stats.misses == 1 && stats.hits == REPEATS && stats.entries == FILES &&
+                      hit_ms * 10 < miss_ms;
+
+        std::stringstream ss;
+        ss << FILES << " entries: read " << std::fixed << std::setprecision(1) << miss_ms
+           << " ms, cached " << std::setprecision(3) << hit_ms << " ms ("
+           << std::setprecision(0) << miss_ms / hit_ms << "x), " << stats.bytes / 1024 << " KB";
+        log_test("ListingCache::repeat_listing", passed, ss.str(), miss_ms);
+    }
+
+    // Test 2: Changes applied from watch events, at once (an operation that
+    // returned is in the next listing); earlier snapshots are not modified
+    {
+        core::ListingCache cache(ft);
+        const std::string sub = dir + "/sub_0";
+        auto before = cache.list(sub);
+        bool ok = before.is_ok() && before.unwrap()->empty();
+
+        write_file(sub + "/a.txt", 10);
+        auto created = cache.list(sub);
+        ok = ok && created.is_ok() && matches_disk(created.unwrap(), sub) && created.unwrap()->size() == 1;
+
+        write_file(sub + "/a.txt", 5000);
+        write_file(sub + "/.hidden", 1);
+        ft.create_directory(sub + "/inner");
+        symlink("nowhere", (sub + "/dangling").c_str());
+        auto modified = cache.list(sub);
+        ok = ok && modified.is_ok() && matches_disk(modified.unwrap(), sub) && modified.unwrap()->size() == 4;
+
+        ft.rename(sub + "/a.txt", sub + "/b.txt");
+        chmod((sub + "/.hidden").c_str(), 0444);
+        ft.delete_path(sub + "/inner");
+        auto renamed = cache.list(sub);
+        ok = ok && renamed.is_ok() && matches_disk(renamed.unwrap(), sub) && renamed.unwrap()->size() == 3;
+        auto patched = cache.stats();
+
+        // More changed entries than MAX_PENDING: read again in full
+        const size_t FLOOD = core::ListingCache::MAX_PENDING + 100;
+        for (size_t i = 0; i < FLOOD; ++i) write_file(sub + "/f_" + std::to_string(i), 0);
+        auto flooded = cache.list(sub);
+        ok = ok && flooded.is_ok() && matches_disk(flooded.unwrap(), sub) && flooded.unwrap()->size() == 3 + FLOOD;
+
+        // Still watched after the re-read: a new file arrives as a delta
+        std::mutex m;
+        std::condition_variable cv;
+        bool arrived = false;
+        cache.subscribe(3, sub, [&](const core::ListingCache::Delta& delta) {
+            std::lock_guard<std::mutex> lock(m);
+            for (const auto& f : delta.changed) arrived = arrived || f.name == "after_relist";
+            cv.notify_all();
+        });
+        write_file(sub + "/after_relist", 1);
+        {
+            std::unique_lock<std::mutex> lock(m);
+            arrived = cv.wait_for(lock, 3s, [&]() { return arrived; });
+        }
+        cache.unsubscribe(3);
+        auto relisted = cache.list(sub);
+        ok = ok && arrived && relisted.is_ok() && relisted.unwrap()->size() == 4 + FLOOD;
+
+        auto stats = cache.stats();
+        bool passed = ok && before.unwrap()->empty() && created.unwrap()->size() == 1 &&
+                      patched.misses == 1 && patched.relisted == 0 && patched.patched >= 8 &&
+                      stats.relisted == 1 && stats.patched == patched.patched + 1;
+        std::stringstream ss;
+        ss << patched.patched << " entries patched, " << patched.misses << " directory read; "
+           << FLOOD << " changes: read again, still watched";
+        log_test("ListingCache::patched_by_events", passed, ss.str());
+    }
+
+    // Test 3: Subscribers get coalesced deltas in version order, and a reset
+    // when the directory goes; none after unsubscribing. The same cid on
+    // another gateway session is another subscriber, left in place
+    {
+        core::ListingCache cache(ft);
+        const uint64_t on_a = core::BroadcastBus::make_id(1, 7), on_b = core::BroadcastBus::make_id(2, 7);
+        const std::string sub = dir + "/sub_1";
+        std::mutex m;
+        std::condition_variable cv;
+        std::set<std::string> present;
+        size_t deltas = 0, resets = 0;
+        uint64_t last_version = 0;
+        bool ordered = true;
+        size_t other_deltas = 0;
+        bool other_saw_after = false;
+        cache.subscribe(on_a, sub, [&](const core::ListingCache::Delta& delta) {
+            std::lock_guard<std::mutex> lock(m);
+            deltas++;
+            ordered = ordered && delta.version > last_version;
+            last_version = delta.version;
+            if (delta.reset) {
+                resets++;
+                present.clear();
+            }
+            for (const auto& f : delta.changed) present.insert(f.name);
+            for (const auto& name : delta.removed) present.erase(name);
+            cv.notify_all();
+        });
+        cache.subscribe(on_b, sub, [&](const core::ListingCache::Delta& delta) {
+            std::lock_guard<std::mutex> lock(m);
+            other_deltas++;
+            for (const auto& f : delta.changed) other_saw_after = other_saw_after || f.name == "after";
+            cv.notify_all();
+        });
+        uint64_t initial_version = 0;
+        auto initial = cache.list(sub, &initial_version);
+
+        auto wait_for = [&](size_t count) {
+            std::unique_lock<std::mutex> lock(m);
+            return cv.wait_for(lock, 3s, [&]() { return present.size() == count; });
+        };
+
+        const size_t BURST = 300;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < BURST; ++i) write_file(sub + "/n_" + std::to_string(i), i);
+        bool added = wait_for(BURST);
+        double push_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        size_t burst_deltas = deltas;
+
+        for (size_t i = 0; i < BURST; i += 2) ft.delete_path(sub + "/n_" + std::to_string(i));
+        bool removed = wait_for(BURST / 2);
+
+        // The directory itself deleted: sent as a reset
+        for (size_t i = 1; i < BURST; i += 2) ft.delete_path(sub + "/n_" + std::to_string(i));
+        ft.delete_path(sub);
+        bool gone = wait_for(0);
+        {
+            std::unique_lock<std::mutex> lock(m);
+            gone = gone && cv.wait_for(lock, 3s, [&]() { return resets == 1; });
+        }
+
+        ft.create_directory(sub);
+        cache.list(sub);
+        cache.unsubscribe(on_a);
+        size_t before_unsubscribed = deltas;
+        write_file(sub + "/after", 1);
+        std::this_thread::sleep_for(core::ListingCache::PUSH_DELAY * 3);
+        bool other_kept;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            other_kept = cv.wait_for(lock, 3s, [&]() { return other_saw_after; });
+        }
+        cache.unsubscribe(on_b);
+
+        auto stats = cache.stats();
+        std::lock_guard<std::mutex> lock(m);
+        bool passed = initial.is_ok() && initial_version > 0 && ordered && added && removed && gone &&
+                      resets == 1 && burst_deltas < BURST / 10 && deltas == before_unsubscribed &&
+                      other_kept && stats.pushed == deltas + other_deltas;
+        std::stringstream ss;
+        ss << BURST << " creations in " << burst_deltas << " delta(s), " << std::fixed << std::setprecision(0)
+           << push_ms << " ms to the last" << (other_kept ? ", other session kept" : ", other session dropped");
+        log_test("ListingCache::push_deltas", passed, ss.str());
+    }
+
+    // Test 4: Limits: directories (watches) and memory
+    {
+        core::ListingCache few(ft, core::ListingCache::DEFAULT_MAX_BYTES, 4);
+        bool listed = true;
+        for (int i = 2; i < 10; ++i) listed = listed && few.list(dir + "/sub_" + std::to_string(i)).is_ok();
+        auto few_stats = few.stats();
+
+        core::ListingCache small(ft, 64 * 1024);
+        auto big = small.list(dir + "/big");
+        auto big_again = small.list(dir + "/big");
+        auto tiny = small.list(dir + "/sub_9");
+        auto small_stats = small.stats();
+
+        auto missing = small.list(dir + "/no_such_dir");
+
+        bool passed = listed && few_stats.directories == 4 && few_stats.evicted == 4 &&
+                      big.is_ok() && big_again.is_ok() && big.unwrap()->size() == FILES &&
+                      small_stats.uncached == 2 && small_stats.hits == 0 && tiny.is_ok() &&
+                      small_stats.directories == 1 && small_stats.bytes <= 64 * 1024 &&
+                      missing.is_err() && missing.error().code == common::ErrorCode::DeviceNotFound;
+        std::stringstream ss;
+        ss << "4 of 8 directories kept, " << FILES << "-entry listing over a 64 KB cap not kept";
+        log_test("ListingCache::limits", passed, ss.str());
+    }
+
+    remove_tree();
+}
+
+void test_listing_pages() {
+    std::cout << "\n=== Testing ListingOrder ===" << std::endl;
+
+    auto entry = [](const std::string& name, uint64_t size, uint64_t mtime, bool dir) {
+        interfaces::FileInfo info{};
+        info.name = name;
+        info.path = "/data/" + name;
+        info.size = size;
+        info.modified_time = mtime;
+        info.is_directory = dir;
+        return info;
+    };
+    auto names = [](const std::vector<const interfaces::FileInfo*>& sorted) {
+        std::string out;
+        for (const auto* f : sorted) out += f->name + ",";
+        return out;
+    };
+    // name|path|size|time|dir|hidden, as in FILES_PAGE
+    auto compact = [](const std::vector<const interfaces::FileInfo*>& sorted, size_t first, size_t count) {
+        std::string out;
+        for (size_t i = first; i < first + count && i < sorted.size(); ++i) {
+            const auto& f = *sorted[i];
+            out += f.name + "|" + f.path + "|" + std::to_string(f.size) + "|" + std::to_string(f.modified_time) +
+                   (f.is_directory ? "|1|" : "|0|") + (f.is_hidden ? "1\n" : "0\n");
+        }
+        return out;
+    };
+
+    // Test 1: Directories first; keys, direction, case-insensitive names
+    {
+        std::vector<interfaces::FileInfo> entries = {
+            entry("c.txt", 1, 2, false), entry("b", 0, 9, true), entry("B.txt", 5, 1, false),
+            entry("A", 0, 1, true), entry("a.txt", 5, 3, false)};
+        std::map<std::string, std::string> expected = {
+            {"name", "A,b,a.txt,B.txt,c.txt,"},
+            {"-name", "b,A,c.txt,B.txt,a.txt,"},
+            {"size", "A,b,c.txt,a.txt,B.txt,"},
+            {"-size", "A,b,a.txt,B.txt,c.txt,"},
+            {"mtime", "A,b,B.txt,c.txt,a.txt,"},
+            {"-mtime", "A,b,a.txt,c.txt,B.txt,"}};
+
+        bool passed = true;
+        std::string failed;
+        for (const auto& [text, order_names] : expected) {
+            core::ListingOrder order;
+            bool ok = core::ListingOrder::parse(text, order) && order.to_string() == text &&
+                      names(order.sort(entries)) == order_names;
+            if (!ok) failed += " " + text;
+            passed = passed && ok;
+        }
+        core::ListingOrder unused;
+        passed = passed && !core::ListingOrder::parse("", unused) && !core::ListingOrder::parse("-", unused) &&
+                 !core::ListingOrder::parse("Name", unused) && !core::ListingOrder::parse("--size", unused);
+        log_test("ListingOrder::sort_keys", passed, failed.empty() ? "6 orders" : "wrong:" + failed);
+    }
+
+    // Test 2: Paging by cursor while entries come and go: nothing seen twice,
+    // nothing that stayed is skipped, pages continue in order
+    {
+        std::mt19937 rng(7);
+        std::vector<interfaces::FileInfo> entries;
+        for (int i = 0; i < 20000; ++i) {
+            entries.push_back(entry("File_" + std::to_string(i), rng() % 5000, 1700000000 + rng() % 1000,
+                                    i % 50 == 0));
+        }
+        std::set<std::string> removed;
+        core::ListingOrder order;
+        core::ListingOrder::parse("-size", order);
+
+        std::set<std::string> seen;
+        bool unique = true, ordered = true, seeks = true;
+        interfaces::FileInfo previous{};
+        bool have_previous = false;
+        std::string cursor;
+        int pages = 0, added = 0;
+        for (;;) {
+            std::vector<const interfaces::FileInfo*> page;
+            seeks = seeks && order.select(entries, cursor, page);
+            order.arrange(page, 0, 1000);
+            size_t count = (std::min<size_t>)(1000, page.size());
+            for (size_t i = 0; i < count; ++i) {
+                unique = unique && seen.insert(page[i]->name).second;
+                ordered = ordered && (!have_previous || order.before(previous, *page[i]));
+                previous = *page[i];
+                have_previous = true;
+            }
+            pages++;
+            if (count == page.size()) break;
+            cursor = order.cursor(*page[count - 1]);
+
+            // Between requests: 50 removed (the cursor's own entry among
+            // them now and then), 50 added
+            size_t last = static_cast<size_t>(page[count - 1] - &entries[0]);
+            page.clear();  // Points into entries
+            for (int i = 0; i < 50; ++i) {
+                size_t victim = (i == 0 && pages % 3 == 0) ? last : rng() % entries.size();
+                removed.insert(entries[victim].name);
+                entries.erase(entries.begin() + static_cast<long>(victim));
+                entries.push_back(entry("new_" + std::to_string(added++), rng() % 5000, 1700000000, false));
+            }
+        }
+
+        size_t missed = 0;
+        for (int i = 0; i < 20000; ++i) {
+            std::string name = "File_" + std::to_string(i);
+            if (removed.count(name) == 0 && seen.count(name) == 0) missed++;
+        }
+        bool passed = unique && ordered && seeks && missed == 0;
+        std::stringstream ss;
+        ss << pages << " pages over 20000 entries with " << added << " added and " << removed.size()
+           << " removed in between, " << missed << " missed";
+        log_test("ListingOrder::cursor_paging", passed, ss.str());
+    }
+
+    // Test 3: Malformed cursors are refused; cursors select what follows them
+    {
+        std::vector<interfaces::FileInfo> entries = {entry("a", 1, 1, false), entry("b", 2, 2, false)};
+        core::ListingOrder order;
+        core::ListingOrder::parse("size", order);
+        std::vector<const interfaces::FileInfo*> selected;
+        auto token = [](const std::string& text) {
+            return common::base64::encode(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+        };
+        bool passed = order.select(entries, "", selected) && selected.size() == 2;
+        for (const std::string cursor :
+             {"x/0/a", "f/abc/a", "f/1/", "f//a", "d", "f/1a", "f/123456789012345678901/a"}) {
+            passed = passed && !order.select(entries, token(cursor), selected);
+        }
+        passed = passed && !order.select(entries, "f/1/a", selected) &&
+                 !order.select(entries, token("f/1/a") + "!", selected) &&
+                 order.select(entries, order.cursor(entries[0]), selected) && selected.size() == 1 &&
+                 selected[0]->name == "b" &&
+                 order.select(entries, token("f/9999/zzz"), selected) && selected.empty() &&
+                 order.select(entries, token("d/0/zzz"), selected) && selected.size() == 2;
+        log_test("ListingOrder::malformed_cursors", passed, "9 refused");
+    }
+
+    // Test 4: First page of 200k entries vs the whole listing as one reply
+    {
+        const size_t ENTRIES = 200000;
+        std::mt19937 rng(11);
+        std::vector<interfaces::FileInfo> entries;
+        entries.reserve(ENTRIES);
+        for (size_t i = 0; i < ENTRIES; ++i) {
+            std::string name = "photo_" + std::to_string(rng() % 100000) + "_" + std::to_string(i) + ".jpg";
+            entries.push_back(entry(name, rng() % 10000000, 1700000000 + rng() % 100000, false));
+        }
+        core::ListingOrder order;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<const interfaces::FileInfo*> selected;
+        order.select(entries, "", selected);
+        order.arrange(selected, 0, 200);
+        std::string first_page = compact(selected, 0, 200);
+        double first_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        auto sorted = order.sort(entries);
+        std::string all = compact(sorted, 0, ENTRIES);
+        double all_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        // Deep in the listing: the page after the middle entry
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<const interfaces::FileInfo*> rest;
+        bool sought = order.select(entries, order.cursor(*sorted[ENTRIES / 2]), rest);
+        order.arrange(rest, 0, 200);
+        double deep_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        bool passed = all.compare(0, first_page.size(), first_page) == 0 && sought &&
+                      rest.size() == ENTRIES - ENTRIES / 2 - 1 && rest[0] == sorted[ENTRIES / 2 + 1] &&
+                      first_ms < all_ms;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << "first page " << first_page.size() / 1024 << " KB in "
+           << first_ms << " ms, whole listing " << all.size() / 1024 << " KB in " << all_ms
+           << " ms; page after a cursor at 100k in " << deep_ms << " ms";
+        log_test("ListingOrder::first_page", passed, ss.str());
+    }
+}
+
 void print_summary() {
     std::cout << "\n" << std::string(60, '=') << std::endl;
     std::cout << "TEST SUMMARY" << std::endl;
@@ -502,9 +2826,23 @@ int main() {
     // Run all tests
     test_input_injector();
     test_screen_streamer();
+    test_jpeg_splitter();
+    test_frame_buffer_pool();
+    test_input_pipeline();
     test_keylogger();
     test_app_manager();
     test_file_transfer();
+    test_parallel_transfer();
+    test_transfer_scheduler();
+    test_traffic_shaper();
+    test_checksums();
+    test_file_hasher();
+    test_archive_stream();
+    test_delta_upload();
+    test_directory_listing();
+    test_chunk_store();
+    test_listing_cache();
+    test_listing_pages();
 
     // Print summary
     print_summary();
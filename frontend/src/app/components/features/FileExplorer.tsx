@@ -11,17 +11,24 @@ import {
 import { AnimatePresence, motion } from 'motion/react';
 import { useEffect, useRef, useState } from 'react';
 import { useGateway } from '../../services';
+import { buildUploadChunk, chunkLengths, computeDelta, crc32c, type DeltaOp, type DeltaSignature } from '../../services/protocol';
 import type { FileEntry } from '../../services/types';
 import { HelpButton } from '../HelpButton';
 import { Button } from '../ui/button';
 import { Input } from '../ui/input';
 
+// Smaller files are uploaded whole: signatures and a verification pass cost more than they save
+const DELTA_MIN_SIZE = 256 * 1024;
+// Smaller new files are not worth hashing into chunks for the backend's store
+const CAS_MIN_SIZE = 1024 * 1024;
+const CAS_BATCH = 512;  // Chunks per file_cas_have
+
 interface FileExplorerProps {
   backendId: string;
 }
 
 export function FileExplorer({ backendId }: FileExplorerProps) {
-  const { activeClient, sendCommand, wsClient, addFileToCache, removeFileFromCache, renameFileInCache } = useGateway();
+  const { activeClient, sendCommand, wsClient, trackUpload, requestDeltaSignatures, addFileToCache, removeFileFromCache, renameFileInCache } = useGateway();
   const [currentPath, setCurrentPath] = useState('.');
   const [selectedFile, setSelectedFile] = useState<FileEntry | null>(null);
   const [searchQuery, setSearchQuery] = useState('');
@@ -29,18 +36,23 @@ export function FileExplorer({ backendId }: FileExplorerProps) {
   const fileInputRef = useRef<HTMLInputElement>(null);
   const [isLoading, setIsLoading] = useState(false);
 
+  // Cached (prefetched) listings show at once; file_watch replies with the
+  // current listing in pages (served from the backend's cache, the first
+  // page as soon as it is read) and then keeps this directory up to date
+  // with FILES_DELTA
+  const watchedRef = useRef('');
+  const hasCached = !!activeClient?.filesCache?.get(currentPath);
   useEffect(() => {
-    // Check cache first
-    const cached = activeClient?.filesCache?.get(currentPath);
-    if (!cached) {
-      setIsLoading(true);
-      sendCommand(`file_list ${currentPath}`);
-    } else {
-      setIsLoading(false);
-    }
-    // Only re-run if these specific values change.
-    // We check the CACHED entry specifically, not the whole cache object.
-  }, [backendId, currentPath, sendCommand, activeClient?.filesCache?.get(currentPath)]);
+    const key = `${backendId}:${currentPath}`;
+    if (watchedRef.current === key && hasCached) return;  // Following it already
+    watchedRef.current = key;
+    setIsLoading(!hasCached);
+    sendCommand(`file_watch ${currentPath}`);
+    // Deltas replace the cached entry: depend on its presence, not on it
+  }, [backendId, currentPath, sendCommand, hasCached]);
+
+  // Stop following the directory when the explorer closes
+  useEffect(() => () => sendCommand('file_watch'), [backendId, sendCommand]);
 
   // Stop loading when files arrive
   useEffect(() => {
@@ -69,14 +81,24 @@ export function FileExplorer({ backendId }: FileExplorerProps) {
   const handleRefresh = () => {
     if (isTransferring) return;
     console.log('[FileExplorer] Refresh at:', Date.now());
-    // Force refresh: clear cache for current path and show loading
+    // Force refresh: the listing is sent again from its first page
     setIsLoading(true);
-    sendCommand(`file_list ${currentPath}`);
+    sendCommand(`file_watch ${currentPath}`);
   };
 
   const handleDownloadFile = () => {
-    if (isTransferring || !selectedFile || selectedFile.type === 'folder') return;
-    sendCommand(`file_download ${selectedFile.path}`);
+    if (isTransferring || !selectedFile) return;
+    if (selectedFile.type === 'folder') {
+      // Streamed as one tar archive, saved as <folder>.tar
+      sendCommand(`file_download_dir ${selectedFile.path}`);
+      return;
+    }
+    // path|offset|length|mtime|checksums: whole file, CRC32C per chunk
+    sendCommand(`file_download ${selectedFile.path}|0|0|0|1`);
+  };
+
+  const handleCancelDownload = () => {
+    sendCommand('file_download_cancel');
   };
 
   const handleUploadFile = () => {
@@ -95,42 +117,207 @@ export function FileExplorer({ backendId }: FileExplorerProps) {
       const slash = currentPath.includes('/') ? '/' : '\\';
       const targetPath = currentPath === '.' ? file.name : currentPath + (currentPath.endsWith(slash) ? '' : slash) + file.name;
 
-      wsClient.sendText(activeClient.id, `file_upload_start ${targetPath} ${bytes.length}`);
-      setUploadProgress(0);
+      const CHUNK_SIZE = 1024 * 192; // Binary frames: fits gateway tier 3 (256KB)
+
+      const finishUpload = () => {
+        // Optimistic update: add uploaded file to cache
+        const newFile: FileEntry = {
+          name: file.name,
+          type: 'file',
+          path: targetPath,
+          size: bytes.length,
+          extension: file.name.includes('.') ? file.name.split('.').pop() : undefined,
+        };
+        addFileToCache(currentPath, newFile);
+        setUploadProgress(null);
+      };
 
-      const CHUNK_SIZE = 1024 * 30;
-      let offset = 0;
-
-      const sendNextChunk = () => {
-        if (offset >= bytes.length) {
-          wsClient.sendText(activeClient.id, `file_upload_end ${targetPath}`);
-
-          // Optimistic update: add uploaded file to cache
-          const newFile: FileEntry = {
-            name: file.name,
-            type: 'file',
-            path: targetPath,
-            size: bytes.length,
-            extension: file.name.includes('.') ? file.name.split('.').pop() : undefined,
-          };
-          addFileToCache(currentPath, newFile);
-          setUploadProgress(null);
-          return;
+      const sendFull = () => {
+        const uploadId = Math.floor(Math.random() * 0xffffffff) >>> 0;
+        // Checksummed: the backend verifies each chunk and asks again for bad ones
+        trackUpload(targetPath, uploadId, bytes);
+        wsClient.sendText(activeClient.id, `file_upload_start ${targetPath} ${bytes.length} ${uploadId} 1`);
+        setUploadProgress(0);
+
+        let offset = 0;
+
+        const sendNextChunk = () => {
+          if (offset >= bytes.length) {
+            wsClient.sendText(activeClient.id, `file_upload_end ${targetPath}`);
+            finishUpload();
+            return;
+          }
+
+          const chunk = bytes.subarray(offset, offset + CHUNK_SIZE);
+          wsClient.sendBinary(activeClient.id, buildUploadChunk(uploadId, offset, chunk, true));
+          offset += CHUNK_SIZE;
+
+          setUploadProgress(Math.round((offset / bytes.length) * 100));
+          setTimeout(sendNextChunk, 10);
+        };
+
+        sendNextChunk();
+      };
+
+      // Overwriting a file: only the parts it does not already have are sent
+      // (literal runs as upload chunks, the rest as ranges of the old file);
+      // the backend checks the result's CRC32C before replacing the file
+      const sendDelta = (sig: DeltaSignature, ops: DeltaOp[]) => {
+        const uploadId = Math.floor(Math.random() * 0xffffffff) >>> 0;
+        const crc = crc32c(bytes).toString(16).padStart(8, '0');
+        // On FILE_DELTA_ERROR (file changed, bad result): stop and send it whole
+        let failed = false;
+        trackUpload(targetPath, uploadId, bytes, {
+          endCommand: `file_delta_end ${crc} ${targetPath}`,
+          onFallback: () => {
+            failed = true;
+            sendFull();
+          },
+        });
+        wsClient.sendText(activeClient.id,
+          `file_delta_start ${bytes.length} ${uploadId} ${sig.size} ${sig.mtime} ${targetPath}`);
+
+        // One frame per literal chunk, one command per COPY_BATCH copies
+        const COPY_BATCH = 256;
+        const steps: (() => void)[] = [];
+        let copies: string[] = [];
+        const flushCopies = () => {
+          if (copies.length === 0) return;
+          const list = copies.join(',');
+          steps.push(() => wsClient.sendText(activeClient.id, `file_delta_copy ${list} ${targetPath}`));
+          copies = [];
+        };
+        for (const op of ops) {
+          if (op.copy) {
+            copies.push(`${op.dst}:${op.src}:${op.length}`);
+            if (copies.length === COPY_BATCH) flushCopies();
+            continue;
+          }
+          for (let pos = 0; pos < op.length; pos += CHUNK_SIZE) {
+            const offset = op.dst + pos;
+            const chunk = bytes.subarray(offset, offset + Math.min(CHUNK_SIZE, op.length - pos));
+            steps.push(() => wsClient.sendBinary(activeClient.id, buildUploadChunk(uploadId, offset, chunk, true)));
+          }
         }
+        flushCopies();
+
+        let next = 0;
+        const sendNextStep = () => {
+          if (failed) return;
+          if (next >= steps.length) {
+            wsClient.sendText(activeClient.id, `file_delta_end ${crc} ${targetPath}`);
+            finishUpload();
+            return;
+          }
+          steps[next++]();
+          setUploadProgress(Math.round((next / steps.length) * 100));
+          setTimeout(sendNextStep, 10);
+        };
+        sendNextStep();
+      };
 
-        const chunk = bytes.slice(offset, offset + CHUNK_SIZE);
-        let binary = '';
-        for (let i = 0; i < chunk.length; i++) binary += String.fromCharCode(chunk[i]);
-        const base64 = btoa(binary);
+      // A new file: content-defined chunks (SHA-256 named) the backend kept
+      // from earlier uploads, of any file in any session, are copied there
+      // and only the others are sent
+      const sendDeduplicated = async () => {
+        setUploadProgress(0);
+        const lengths = chunkLengths(bytes);
+        const offsets: number[] = [];
+        let end = 0;
+        for (const length of lengths) {
+          offsets.push(end);
+          end += length;
+        }
+        const keys = await Promise.all(lengths.map(async (length, i) => {
+          const digest = await crypto.subtle.digest('SHA-256', bytes.subarray(offsets[i], offsets[i] + length));
+          return Array.from(new Uint8Array(digest), b => b.toString(16).padStart(2, '0')).join('');
+        }));
+
+        const uploadId = Math.floor(Math.random() * 0xffffffff) >>> 0;
+        const batches: { command: string, bytes: number }[] = [];
+        for (let i = 0; i < lengths.length; i += CAS_BATCH) {
+          const slice = lengths.slice(i, i + CAS_BATCH);
+          batches.push({
+            command: `file_cas_have ${offsets[i]} ${slice.map((length, k) => `${keys[i + k]}:${length}`).join(',')} ${targetPath}`,
+            bytes: slice.reduce((sum, length) => sum + length, 0),
+          });
+        }
 
-        wsClient.sendText(activeClient.id, `file_upload_chunk ${targetPath} ${base64}`);
-        offset += CHUNK_SIZE;
+        // Each batch is answered (in order) with the ranges to send; the
+        // upload ends once every batch is answered and its ranges are sent
+        let failed = false;
+        let answered = 0;
+        let covered = 0;  // Bytes the backend has or was sent
+        let sending = false;
+        const queue: [number, number][] = [];
+        const sendNextPiece = () => {
+          if (failed) return;
+          const piece = queue.shift();
+          if (!piece) {
+            sending = false;
+            if (answered === batches.length) {
+              wsClient.sendText(activeClient.id, `file_cas_end ${targetPath}`);
+              finishUpload();
+            }
+            return;
+          }
+          sending = true;
+          const [offset, length] = piece;
+          wsClient.sendBinary(activeClient.id,
+            buildUploadChunk(uploadId, offset, bytes.subarray(offset, offset + length), true));
+          covered += length;
+          setUploadProgress(Math.round((covered / bytes.length) * 100));
+          setTimeout(sendNextPiece, 10);
+        };
+
+        trackUpload(targetPath, uploadId, bytes, {
+          endCommand: `file_cas_end ${targetPath}`,
+          onFallback: () => {
+            failed = true;
+            sendFull();
+          },
+          onNeed: (ranges) => {
+            let needed = 0;
+            for (const [offset, length] of ranges) {
+              for (let pos = 0; pos < length; pos += CHUNK_SIZE) {
+                queue.push([offset + pos, Math.min(CHUNK_SIZE, length - pos)]);
+              }
+              needed += length;
+            }
+            covered += batches[answered++].bytes - needed;
+            setUploadProgress(Math.round((covered / bytes.length) * 100));
+            if (!sending) sendNextPiece();
+          },
+        });
+        wsClient.sendText(activeClient.id, `file_cas_start ${bytes.length} ${uploadId} ${targetPath}`);
+        for (const batch of batches) wsClient.sendText(activeClient.id, batch.command);
+        console.log(`[Upload] ${targetPath}: ${lengths.length} chunks offered to the backend's store`);
+      };
 
-        setUploadProgress(Math.round((offset / bytes.length) * 100));
-        setTimeout(sendNextChunk, 10);
+      // crypto.subtle exists in secure contexts only
+      const sendNew = () => {
+        if (bytes.length >= CAS_MIN_SIZE && globalThis.crypto?.subtle) sendDeduplicated();
+        else sendFull();
       };
 
-      sendNextChunk();
+      const existing = files.find(f => f.path === targetPath && f.type === 'file');
+      if (!existing || (existing.size ?? 0) < DELTA_MIN_SIZE) {
+        sendNew();
+        return;
+      }
+      setUploadProgress(0);
+      requestDeltaSignatures(targetPath).then((sig) => {
+        if (!sig) {
+          sendNew();
+          return;
+        }
+        const ops = computeDelta(sig, bytes);
+        const literal = ops.reduce((sum, op) => sum + (op.copy ? 0 : op.length), 0);
+        console.log(`[Upload] Delta for ${targetPath}: ${literal} of ${bytes.length} bytes literal, ${ops.length} ops`);
+        // Mostly new content: the chunk store may still have it
+        if (literal > bytes.length * 0.9) sendNew();
+        else sendDelta(sig, ops);
+      });
     };
     reader.readAsArrayBuffer(file);
   };
@@ -277,7 +464,13 @@ export function FileExplorer({ backendId }: FileExplorerProps) {
           <div className="w-8 h-8 rounded-full bg-blue-100 flex items-center justify-center text-blue-600 animate-pulse">
             <Download className="w-4 h-4" />
           </div>
-          <div className="text-sm font-medium text-blue-700">Downloading file from remote backend...</div>
+          <div className="flex-1 text-sm font-medium text-blue-700">Downloading file from remote backend...</div>
+          <button
+            onClick={handleCancelDownload}
+            className="px-3 py-1 text-xs font-medium text-blue-700 hover:bg-blue-100 rounded-lg transition-colors"
+          >
+            Cancel
+          </button>
         </div>
       )}
 
@@ -363,16 +556,15 @@ export function FileExplorer({ backendId }: FileExplorerProps) {
                   <Button variant="outline" size="sm" className="text-red-500 border-red-50 bg-white hover:bg-red-50 hover:text-red-600" onClick={handleDelete} disabled={isTransferring}><Trash2 className="w-3 h-3 mr-2" /> Delete</Button>
                 </div>
 
-                {selectedFile.type === 'file' && (
-                  <Button
-                    onClick={handleDownloadFile}
-                    className="w-full bg-blue-600 text-white hover:bg-blue-700 shadow-md shadow-blue-100"
-                    disabled={isTransferring}
-                  >
-                    <Download className={`w-4 h-4 mr-2 ${activeClient?.state.fileTransfer === 'downloading' ? 'animate-bounce' : ''}`} />
-                    {activeClient?.state.fileTransfer === 'downloading' ? 'Downloading...' : 'Download'}
-                  </Button>
-                )}
+                <Button
+                  onClick={handleDownloadFile}
+                  className="w-full bg-blue-600 text-white hover:bg-blue-700 shadow-md shadow-blue-100"
+                  disabled={isTransferring}
+                >
+                  <Download className={`w-4 h-4 mr-2 ${activeClient?.state.fileTransfer === 'downloading' ? 'animate-bounce' : ''}`} />
+                  {activeClient?.state.fileTransfer === 'downloading' ? 'Downloading...' :
+                    selectedFile.type === 'folder' ? 'Download as .tar' : 'Download'}
+                </Button>
               </motion.div>
             ) : (
               <div className="h-full flex items-center justify-center text-center text-gray-400">
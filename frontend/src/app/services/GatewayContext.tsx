@@ -1,7 +1,18 @@
 import { createContext, useCallback, useContext, useEffect, useRef, useState, type ReactNode } from 'react';
 import { GatewayWsClient } from './client';
+import { buildUploadChunk, CHUNK_FLAG_CRC, crc32c, decodeDeltaSignatures, type DeltaSignature } from './protocol';
 import type { AppInfo, BackendFrameEvent, Client, ConnectionStatus, FileEntry, Process } from './types';
 
+export interface UploadOptions {
+  endCommand?: string;          // Default: file_upload_end <path>
+  // The delta or deduplicated upload failed (FILE_DELTA_ERROR, FILE_CAS_ERROR):
+  // the caller sends the file whole instead
+  onFallback?: () => void;
+  // DATA:FILE_CAS_NEED: [offset, length] ranges of one file_cas_have batch
+  // the backend's chunk store lacks (empty: it has them all)
+  onNeed?: (ranges: [number, number][]) => void;
+}
+
 interface GatewayContextValue {
   // Connection
   wsClient: GatewayWsClient | null;
@@ -19,6 +30,15 @@ interface GatewayContextValue {
   sendCommand: (command: string) => void;
   sendCommandTo: (backendId: number, command: string) => void;
 
+  // File transfers: keep an upload's bytes until the backend confirms it
+  // (chunks failing their checksum are asked for again, then endCommand is
+  // sent again). See UploadOptions for delta and deduplicated uploads.
+  trackUpload: (path: string, uploadId: number, bytes: Uint8Array, options?: UploadOptions) => void;
+
+  // Block signatures of an existing backend file for a delta upload over
+  // it; null if the backend cannot provide them
+  requestDeltaSignatures: (path: string) => Promise<DeltaSignature | null>;
+
   // Optimistic Cache Updates
   addFileToCache: (path: string, file: FileEntry) => void;
   removeFileFromCache: (path: string, fileName: string) => void;
@@ -28,6 +48,9 @@ interface GatewayContextValue {
 
 const GatewayContext = createContext<GatewayContextValue | null>(null);
 
+// Re-requests of one corrupted download chunk before the download is abandoned
+const MAX_CHUNK_REPAIRS = 3;
+
 export function useGateway() {
   const context = useContext(GatewayContext);
   if (!context) {
@@ -48,10 +71,34 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
 
   const wsClientRef = useRef<GatewayWsClient | null>(null);
   const pingIntervalRef = useRef<any>(null);
+  // Active download. Chunks are keyed by sequence number (seq * chunkSize is
+  // the file offset) and may arrive in any order; the download is complete
+  // once every chunk of the START range is here intact.
   const currentDownloadRef = useRef<{
     path: string,
     name: string,
-    chunks: { seq: number, data: ArrayBuffer, isLast: boolean }[]
+    mtime: string,
+    rangeStart: number,
+    rangeEnd: number,
+    chunkSize: number,
+    expected: number,
+    chunks: Map<number, ArrayBuffer>,
+    bad: Map<number, { attempts: number, requested: boolean }>,
+    digest?: string,
+  } | null>(null);
+  const uploadsRef = useRef<Map<string, {
+    uploadId: number,
+    bytes: Uint8Array,
+    endCommand: string,
+    onFallback?: () => void,
+    onNeed?: (ranges: [number, number][]) => void,
+  }>>(new Map());
+  // Signature request in flight: batches collect until `received` covers all blocks
+  const deltaSigRef = useRef<{
+    path: string,
+    sig: DeltaSignature | null,
+    received: number,
+    resolve: (sig: DeltaSignature | null) => void,
   } | null>(null);
 
   // Download completion logic
@@ -60,8 +107,9 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
 
     try {
       // Sort chunks by sequence number to ensure order
-      const sortedChunks = [...currentDownloadRef.current.chunks].sort((a, b) => a.seq - b.seq);
-      const allChunks = sortedChunks.map(c => c.data);
+      const allChunks = [...currentDownloadRef.current.chunks.entries()]
+        .sort((a, b) => a[0] - b[0])
+        .map(([, data]) => data);
 
       const blob = new Blob(allChunks, { type: 'application/octet-stream' });
       const url = URL.createObjectURL(blob);
@@ -72,7 +120,9 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
       a.click();
       document.body.removeChild(a);
       URL.revokeObjectURL(url);
-      console.log(`[Download] Finished: ${currentDownloadRef.current.name} (${allChunks.length} chunks)`);
+      const digest = currentDownloadRef.current.digest;
+      console.log(`[Download] Finished: ${currentDownloadRef.current.name} (${allChunks.length} chunks)` +
+                  (digest ? `, digest ${digest}` : ''));
     } catch (err) {
       console.error('Download assembly failed:', err);
     } finally {
@@ -80,6 +130,35 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
     }
   }, []);
 
+  // After each chunk: finish when complete; once every chunk is accounted
+  // for, re-request just the ones that failed their checksum.
+  // Returns true when the download is over (finished or abandoned).
+  const settleDownload = useCallback((backendId: number): boolean => {
+    const dl = currentDownloadRef.current;
+    if (!dl) return false;
+    if (dl.chunks.size >= dl.expected) {
+      finishDownload();
+      return true;
+    }
+    if (dl.chunks.size + dl.bad.size < dl.expected) return false;
+
+    for (const [seq, entry] of dl.bad) {
+      if (entry.requested) continue;
+      if (entry.attempts >= MAX_CHUNK_REPAIRS) {
+        console.error(`[Download] Chunk ${seq} of ${dl.name} failed its checksum ${entry.attempts + 1} times, giving up`);
+        currentDownloadRef.current = null;
+        return true;
+      }
+      entry.attempts++;
+      entry.requested = true;
+      const from = Math.max(seq * dl.chunkSize, dl.rangeStart);
+      const to = Math.min((seq + 1) * dl.chunkSize, dl.rangeEnd);
+      console.warn(`[Download] Chunk ${seq} of ${dl.name} failed its checksum, re-requesting ${from}+${to - from}`);
+      wsClientRef.current?.sendText(backendId, `file_download ${dl.path}|${from}|${to - from}|${dl.mtime}|1`);
+    }
+    return false;
+  }, [finishDownload]);
+
   // Create default client
   const createDefaultClient = useCallback((id: number): Client => ({
     id,
@@ -139,19 +218,24 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
         }
       } else if (ev.kind === 'file') {
         // Binary File Chunk - High Performance
-        // Format: [4B Sequence][1B IsLast][Raw Data]
-        if (ev.payload.byteLength >= 5) {
+        // Format: [4B Sequence][1B Flags][4B CRC32C if CHUNK_FLAG_CRC][Raw Data]
+        const dl = currentDownloadRef.current;
+        if (ev.payload.byteLength >= 5 && dl) {
           const view = new DataView(ev.payload);
           const seq = view.getUint32(0, false);
-          const isLast = view.getUint8(4) === 1;
-          const data = ev.payload.slice(5);
-
-          if (currentDownloadRef.current) {
-            currentDownloadRef.current.chunks.push({ seq, data, isLast });
-            if (isLast) {
-              finishDownload();
-              client = { ...client, state: { ...client.state, fileTransfer: 'idle' } };
-            }
+          const hasCrc = (view.getUint8(4) & CHUNK_FLAG_CRC) !== 0;
+          const data = ev.payload.slice(hasCrc ? 9 : 5);
+
+          if (!hasCrc || (ev.payload.byteLength >= 9 && crc32c(new Uint8Array(data)) === view.getUint32(5, false))) {
+            dl.chunks.set(seq, data);
+            dl.bad.delete(seq);
+          } else if (!dl.chunks.has(seq)) {
+            const entry = dl.bad.get(seq);
+            dl.bad.set(seq, { attempts: entry?.attempts ?? 0, requested: false });
+          }
+
+          if (settleDownload(backendId)) {
+            client = { ...client, state: { ...client.state, fileTransfer: 'idle' } };
           }
         }
       } else if (ev.kind === 'text') {
@@ -161,7 +245,7 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
       newClients.set(backendId, client);
       return newClients;
     });
-  }, [createDefaultClient]);
+  }, [createDefaultClient, settleDownload]);
 
   // Handle text messages from backend
   const handleTextMessage = (client: Client, text: string): Client => {
@@ -202,6 +286,10 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
         newState.fileTransfer = 'uploading';
       } else if (feature === 'FILE_UPLOAD_COMPLETE' || feature === 'FILE_UPLOAD_CANCELLED') {
         newState.fileTransfer = 'idle';
+        // Format: path|digest (COMPLETE); the path itself may contain ':'
+        const [path, digest] = text.substring(text.indexOf(feature) + feature.length + 1).split('|');
+        uploadsRef.current.delete(path);
+        if (digest) console.log(`[Upload] Finished: ${path}, digest ${digest}`);
       }
 
       return { ...client, state: newState };
@@ -302,6 +390,67 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
       return { ...client, filesCache: newCache };
     }
 
+    // Listing in pages (file_watch, file_list_page): path\n,
+    // sort|total|offset|count|last\n, next cursor\n, then entries; the page at
+    // offset 0 starts the listing over, later ones add to it
+    if (text.startsWith('DATA:FILES_PAGE:')) {
+      const lines = text.substring(16).split('\n');
+      if (lines.length < 3) return client;
+
+      const pagePath = lines[0];
+      const offset = parseInt(lines[1].split('|')[2], 10) || 0;
+      const byName = new Map<string, FileEntry>();
+      if (offset > 0) {
+        for (const f of client.filesCache.get(pagePath) || []) byName.set(f.name, f);
+      }
+      for (const line of lines.slice(3)) {
+        if (!line) continue;
+        const [name, path, size, time, isDir, isHidden] = line.split('|');
+        byName.set(name, {
+          name,
+          path,
+          size: parseInt(size, 10) || 0,
+          type: (isDir === '1') ? 'folder' : 'file',
+          extension: name.includes('.') ? name.split('.').pop() : undefined
+        });
+      }
+
+      const files = Array.from(byName.values());
+      const newCache = new Map(client.filesCache);
+      newCache.set(pagePath, files);
+      return { ...client, files: pagePath === client.currentPath ? files : client.files, filesCache: newCache };
+    }
+
+    // Changes of the watched directory (file_watch): path\n, then "+entry"
+    // (added/modified), "-name" (removed)
+    if (text.startsWith('DATA:FILES_DELTA:')) {
+      const lines = text.substring(17).split('\n').filter(Boolean);
+      if (lines.length === 0) return client;
+
+      const deltaPath = lines[0];
+      const byName = new Map<string, FileEntry>();
+      for (const f of client.filesCache.get(deltaPath) || []) byName.set(f.name, f);
+      for (const line of lines.slice(1)) {
+        if (line.startsWith('-')) {
+          byName.delete(line.substring(1));
+          continue;
+        }
+        const [name, path, size, time, isDir, isHidden] = line.substring(1).split('|');
+        byName.set(name, {
+          name,
+          path,
+          size: parseInt(size, 10) || 0,
+          type: (isDir === '1') ? 'folder' : 'file',
+          extension: name.includes('.') ? name.split('.').pop() : undefined
+        });
+      }
+
+      const files = Array.from(byName.values());
+      const newCache = new Map(client.filesCache);
+      newCache.set(deltaPath, files);
+      return { ...client, files: deltaPath === client.currentPath ? files : client.files, filesCache: newCache };
+    }
+
     // File list (Legacy JSON)
     if (text.startsWith('DATA:FILES:')) {
       console.log('[FILES] Received at:', Date.now(), 'length:', text.length);
@@ -366,11 +515,26 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
     }
 
     // File download handling
+    // Format: path|size|mtime|offset|length|chunk_size
     if (text.startsWith('DATA:FILE_DOWNLOAD_START:')) {
       const payload = text.substring(25);
-      const [path] = payload.split('|');
+      const [path, , mtime, offset, length, chunkSize] = payload.split('|');
+
+      // START of a chunk re-request: keep the download it repairs
+      const current = currentDownloadRef.current;
+      if (current && current.path === path && current.bad.size > 0) return client;
+
+      const rangeStart = Number(offset) || 0;
+      const rangeEnd = rangeStart + (Number(length) || 0);
+      const size = Number(chunkSize) || 1;
       const name = path.split(/[\\/]/).pop() || 'download';
-      currentDownloadRef.current = { path, name, chunks: [] };
+      currentDownloadRef.current = {
+        path, name, mtime: mtime ?? '0', rangeStart, rangeEnd, chunkSize: size,
+        expected: rangeEnd > rangeStart ? Math.floor((rangeEnd - 1) / size) - Math.floor(rangeStart / size) + 1 : 0,
+        chunks: new Map(),
+        bad: new Map(),
+      };
+      if (settleDownload(client.id)) return client;  // Empty range
       return { ...client, state: { ...client.state, fileTransfer: 'downloading' } };
     }
 
@@ -379,7 +543,6 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
         const payload = text.substring(16);
         const parts = payload.split('|');
         if (parts.length >= 4) {
-          const isLast = parts[2] === '1';
           const b64 = parts[3];
 
           // Convert b64 to ArrayBuffer for unified handling
@@ -388,10 +551,9 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
           for (let i = 0; i < binaryString.length; i++) {
             bytes[i] = binaryString.charCodeAt(i);
           }
-          currentDownloadRef.current.chunks.push({ seq: parseInt(parts[0], 10), data: bytes.buffer, isLast });
+          currentDownloadRef.current.chunks.set(parseInt(parts[0], 10), bytes.buffer);
 
-          if (isLast) {
-            finishDownload();
+          if (settleDownload(client.id)) {
             return { ...client, state: { ...client.state, fileTransfer: 'idle' } };
           }
         }
@@ -399,9 +561,94 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
       return client;
     }
 
+    // Format: path[|digest]. Chunks travel on the data channel and may still
+    // be in flight: the download finishes when the last one arrives.
     if (text.startsWith('DATA:FILE_DOWNLOAD_END:')) {
-      currentDownloadRef.current = null;
-      return { ...client, state: { ...client.state, fileTransfer: 'idle' } };
+      const [path, digest] = text.substring(23).split('|');
+      const dl = currentDownloadRef.current;
+      if (dl && dl.path === path && digest) dl.digest = digest;
+      return client;
+    }
+
+    // Format: path|offset:length,... chunks that failed their checksum;
+    // resend them, then end the upload again
+    if (text.startsWith('DATA:FILE_UPLOAD_RETRY:')) {
+      const [path, ranges] = text.substring(23).split('|');
+      const upload = uploadsRef.current.get(path);
+      if (upload && wsClientRef.current) {
+        for (const range of (ranges || '').split(',')) {
+          const [offset, length] = range.split(':').map(Number);
+          if (!length) continue;
+          wsClientRef.current.sendBinary(client.id,
+            buildUploadChunk(upload.uploadId, offset, upload.bytes.subarray(offset, offset + length), true));
+        }
+        wsClientRef.current.sendText(client.id, upload.endCommand);
+      }
+      return client;
+    }
+
+    // Format: path|size|mtime|block_size|first|count|total|base64 (one batch)
+    if (text.startsWith('DATA:FILE_DELTA_SIG:')) {
+      const fields = text.substring(20).split('|');
+      const pending = deltaSigRef.current;
+      if (!pending || pending.path !== fields[0]) return client;
+      const total = Number(fields[6]);
+      if (!pending.sig) {
+        pending.sig = {
+          size: Number(fields[1]),
+          mtime: fields[2],
+          blockSize: Number(fields[3]),
+          weak: new Uint32Array(total),
+          strong: new Uint32Array(total),
+        };
+      }
+      decodeDeltaSignatures(pending.sig, Number(fields[4]), fields[7] || '');
+      pending.received += Number(fields[5]);
+      if (pending.received >= total) {
+        deltaSigRef.current = null;
+        pending.resolve(pending.sig);
+      }
+      return client;
+    }
+
+    // Format: path|offset|offset:length,... (one reply per file_cas_have)
+    if (text.startsWith('DATA:FILE_CAS_NEED:')) {
+      const fields = text.substring(19).split('|');
+      const upload = uploadsRef.current.get(fields[0]);
+      const ranges: [number, number][] = [];
+      for (const range of (fields[2] || '').split(',')) {
+        const [offset, length] = range.split(':').map(Number);
+        if (length) ranges.push([offset, length]);
+      }
+      upload?.onNeed?.(ranges);
+      return client;
+    }
+
+    // A delta or deduplicated upload (or delta signatures) failed: the
+    // caller sends the whole file instead
+    if (text.startsWith('ERROR:FILE_DELTA_ERROR:') || text.startsWith('ERROR:FILE_CAS_ERROR:')) {
+      console.warn('[Upload] Upload failed, sending the whole file:', text.substring(text.indexOf(':', 6) + 1));
+      const pending = deltaSigRef.current;
+      if (pending) {
+        deltaSigRef.current = null;
+        pending.resolve(null);
+      }
+      for (const [path, upload] of uploadsRef.current) {
+        if (!upload.onFallback) continue;
+        uploadsRef.current.delete(path);
+        upload.onFallback();
+      }
+      return client;
+    }
+
+    // Format: path|count (empty path: every download of this client)
+    if (text.startsWith('DATA:FILE_DOWNLOAD_CANCELLED:')) {
+      const [path] = text.substring(29).split('|');
+      if (!path || currentDownloadRef.current?.path === path) {
+        currentDownloadRef.current = null;
+        return { ...client, state: { ...client.state, fileTransfer: 'idle' } };
+      }
+      return client;
     }
 
     // Recording ready - auto-trigger download
@@ -443,7 +690,7 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
       newClients.set(backendId, createDefaultClient(backendId));
       return newClients;
     });
-  }, [createDefaultClient]);
+  }, [createDefaultClient, settleDownload]);
 
   // Connect to gateway
   const connect = useCallback((ip: string, port: string) => {
@@ -510,6 +757,28 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
     }
   }, []);
 
+  const trackUpload = useCallback((path: string, uploadId: number, bytes: Uint8Array, options?: UploadOptions) => {
+    uploadsRef.current.set(path, {
+      uploadId,
+      bytes,
+      endCommand: options?.endCommand ?? `file_upload_end ${path}`,
+      onFallback: options?.onFallback,
+      onNeed: options?.onNeed,
+    });
+  }, []);
+
+  const requestDeltaSignatures = useCallback((path: string) => {
+    return new Promise<DeltaSignature | null>((resolve) => {
+      if (!activeClientId || !wsClientRef.current?.isConnected()) {
+        resolve(null);
+        return;
+      }
+      deltaSigRef.current?.resolve(null);
+      deltaSigRef.current = { path, sig: null, received: 0, resolve };
+      wsClientRef.current.sendText(activeClientId, `file_delta_sig ${path}`);
+    });
+  }, [activeClientId]);
+
   // === OPTIMISTIC CACHE UPDATE FUNCTIONS ===
 
   // Add a new file/folder to cache (for upload, mkdir)
@@ -619,6 +888,8 @@ export function GatewayProvider({ children }: GatewayProviderProps) {
     activeClient,
     sendCommand,
     sendCommandTo,
+    trackUpload,
+    requestDeltaSignatures,
     // Optimistic cache functions
     addFileToCache,
     removeFileFromCache,
@@ -1,6 +1,7 @@
 import {
     buildAckPacket,
     buildBackendFrame,
+    encodeInputRecords,
     encodeText,
     getTrafficClass,
     isJpeg,
@@ -10,6 +11,7 @@ import {
     TRAFFIC_VIDEO,
     tryDecodePrintableUtf8,
 } from './protocol';
+import type { InputRecord } from './protocol';
 import type { BackendFrameEvent, ConnectionStatus } from './types';
 
 export interface ClientEvents {
@@ -188,6 +190,16 @@ export class GatewayWsClient {
     return frame.byteLength;
   }
 
+  /**
+   * Send binary input records to a specific backend (TRAFFIC_INPUT)
+   */
+  sendInput(backendId: number, records: InputRecord[]): number {
+    if (!this.ws || this.ws.readyState !== WebSocket.OPEN) return 0;
+    const frame = buildBackendFrame(backendId, this.myClientId, encodeInputRecords(records));
+    this.ws.send(frame);
+    return frame.byteLength;
+  }
+
   /**
    * Send binary data to a specific backend
    */
@@ -1,4 +1,5 @@
 import type { GatewayWsClient } from './client';
+import { INPUT_OP } from './protocol';
 
 /**
  * Handles mouse and keyboard input events on an element and sends them to the backend
@@ -56,9 +57,8 @@ export class InputHandler {
     e.preventDefault();
 
     const dy = e.deltaY;
-    const dx = e.deltaX;
 
-    this.client.sendText(this.backendId, `mouse_scroll ${-dy} ${dx}`);
+    this.client.sendInput(this.backendId, [{ op: INPUT_OP.SCROLL, code: -dy }]);
   };
 
   private onMouseMove = (e: MouseEvent) => {
@@ -67,7 +67,7 @@ export class InputHandler {
     this.lastMoveTime = now;
 
     const { x, y } = this.getNormCoords(e);
-    this.client.sendText(this.backendId, `mouse_move ${x.toFixed(4)} ${y.toFixed(4)}`);
+    this.client.sendInput(this.backendId, [{ op: INPUT_OP.MOVE, x, y }]);
   };
 
   private onMouseDown = (e: MouseEvent) => {
@@ -75,7 +75,7 @@ export class InputHandler {
     if (e.button === 2) btn = 1;
     else if (e.button === 1) btn = 2;
 
-    this.client.sendText(this.backendId, `mouse_down ${btn}`);
+    this.client.sendInput(this.backendId, [{ op: INPUT_OP.BUTTON_DOWN, code: btn }]);
   };
 
   private onMouseUp = (e: MouseEvent) => {
@@ -83,7 +83,7 @@ export class InputHandler {
     if (e.button === 2) btn = 1;
     else if (e.button === 1) btn = 2;
 
-    this.client.sendText(this.backendId, `mouse_up ${btn}`);
+    this.client.sendInput(this.backendId, [{ op: INPUT_OP.BUTTON_UP, code: btn }]);
   };
 
   private onKeyDown = (e: KeyboardEvent) => {
@@ -92,7 +92,7 @@ export class InputHandler {
 
     const code = this.mapKeyCode(e.code);
     if (code !== 0) {
-      this.client.sendText(this.backendId, `key_down ${code}`);
+      this.client.sendInput(this.backendId, [{ op: INPUT_OP.KEY_DOWN, code }]);
     }
 
     if (e.key.length === 1 && !e.ctrlKey && !e.altKey && !e.metaKey) {
@@ -106,7 +106,7 @@ export class InputHandler {
 
     const code = this.mapKeyCode(e.code);
     if (code !== 0) {
-      this.client.sendText(this.backendId, `key_up ${code}`);
+      this.client.sendInput(this.backendId, [{ op: INPUT_OP.KEY_UP, code }]);
     }
   };
 
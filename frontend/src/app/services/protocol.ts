@@ -5,6 +5,7 @@ export const TRAFFIC_CONTROL = 0x01;  // Commands, Status, Info - Never drop
 export const TRAFFIC_VIDEO   = 0x02;  // Video frames - Drop if busy
 export const TRAFFIC_ACK     = 0x03;  // Frontend -> Gateway - Flow control signal
 export const TRAFFIC_FILE    = 0x04;  // File chunks - Raw binary data
+export const TRAFFIC_INPUT   = 0x05;  // Frontend -> Backend - Binary input records
 
 export interface ParsedFrame {
   payloadLen: number;
@@ -104,3 +105,248 @@ export function stripTrafficClass(payload: ArrayBuffer): ArrayBuffer {
   if (payload.byteLength < 1) return payload;
   return payload.slice(1);
 }
+
+// Binary input record ops (backend: core/InputProtocol.hpp)
+export const INPUT_OP = {
+  MOVE: 1,
+  BUTTON_DOWN: 2,
+  BUTTON_UP: 3,
+  CLICK: 4,
+  SCROLL: 5,
+  KEY_DOWN: 6,
+  KEY_UP: 7,
+} as const;
+
+export const INPUT_RECORD_SIZE = 12;
+export const INPUT_COORD_MAX = 32767;
+
+export interface InputRecord {
+  op: number;
+  code?: number;  // Button / key code, or signed wheel delta for SCROLL
+  x?: number;     // Normalized 0..1 (MOVE)
+  y?: number;
+}
+
+/**
+ * Encode input records as a TRAFFIC_INPUT payload
+ * Record format: [1B op][1B flags][2B code][2B x][2B y][4B timestamp], big-endian
+ */
+export function encodeInputRecords(records: InputRecord[]): Uint8Array {
+  const out = new Uint8Array(1 + records.length * INPUT_RECORD_SIZE);
+  const view = new DataView(out.buffer);
+  const now = Date.now() >>> 0;
+  const coord = (v: number | undefined) =>
+    Math.round(Math.min(Math.max(v ?? 0, 0), 1) * INPUT_COORD_MAX);
+
+  out[0] = TRAFFIC_INPUT;
+  records.forEach((r, i) => {
+    const off = 1 + i * INPUT_RECORD_SIZE;
+    view.setUint8(off, r.op);
+    view.setUint8(off + 1, 0);
+    view.setInt16(off + 2, Math.min(Math.max(Math.round(r.code ?? 0), -32768), 32767), false);
+    view.setInt16(off + 4, coord(r.x), false);
+    view.setInt16(off + 6, coord(r.y), false);
+    view.setUint32(off + 8, now, false);
+  });
+  return out;
+}
+
+/**
+ * Build a binary upload chunk (TRAFFIC_FILE, Frontend -> Backend)
+ * Format: [TRAFFIC_FILE][4B uploadId][8B offset][4B CRC32C if checksums][bytes], big-endian
+ * uploadId is the id given to `file_upload_start <path> <size> <uploadId> [checksums]`
+ */
+export function buildUploadChunk(uploadId: number, offset: number, bytes: Uint8Array, checksums = false): ArrayBuffer {
+  const head = checksums ? 17 : 13;
+  const out = new Uint8Array(head + bytes.byteLength);
+  const view = new DataView(out.buffer);
+  out[0] = TRAFFIC_FILE;
+  view.setUint32(1, uploadId >>> 0, false);
+  view.setUint32(5, Math.floor(offset / 0x100000000), false);
+  view.setUint32(9, offset >>> 0, false);
+  if (checksums) view.setUint32(13, crc32c(bytes), false);
+  out.set(bytes, head);
+  return out.buffer;
+}
+
+// Download chunk flags: [4B seq][1B flags][4B CRC32C if CHUNK_FLAG_CRC][bytes]
+export const CHUNK_FLAG_LAST = 0x01;
+export const CHUNK_FLAG_CRC  = 0x02;
+
+const CRC32C_TABLE = (() => {
+  const table = new Uint32Array(256);
+  for (let i = 0; i < 256; i++) {
+    let c = i;
+    for (let k = 0; k < 8; k++) c = (c & 1) ? (c >>> 1) ^ 0x82F63B78 : c >>> 1;
+    table[i] = c >>> 0;
+  }
+  return table;
+})();
+
+/**
+ * CRC32C (Castagnoli), as computed by the backend for chunk checksums
+ */
+export function crc32c(bytes: Uint8Array): number {
+  let crc = 0xFFFFFFFF;
+  for (let i = 0; i < bytes.length; i++) {
+    crc = CRC32C_TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+// === Delta upload (rsync-style, see backend common/Delta.hpp) ===
+
+/**
+ * Block signatures of a file on the backend (DATA:FILE_DELTA_SIG), one per
+ * full block: rolling weak sum and CRC32C
+ */
+export interface DeltaSignature {
+  size: number;
+  mtime: string;
+  blockSize: number;
+  weak: Uint32Array;
+  strong: Uint32Array;
+}
+
+/** One step of the new file: literal bytes, or a run of the existing file */
+export interface DeltaOp {
+  copy: boolean;
+  dst: number;
+  src: number;
+  length: number;
+}
+
+/** Store one FILE_DELTA_SIG batch (8 bytes per block: weak, CRC32C, big-endian) */
+export function decodeDeltaSignatures(sig: DeltaSignature, first: number, b64: string) {
+  const raw = atob(b64);
+  for (let i = 0; i + 8 <= raw.length; i += 8) {
+    const word = (k: number) => ((raw.charCodeAt(k) << 24) | (raw.charCodeAt(k + 1) << 16) |
+                                 (raw.charCodeAt(k + 2) << 8) | raw.charCodeAt(k + 3)) >>> 0;
+    sig.weak[first + i / 8] = word(i);
+    sig.strong[first + i / 8] = word(i + 4);
+  }
+}
+
+/**
+ * Slide a window over `bytes`; where it matches a block of the existing file
+ * (weak sum, then CRC32C) it becomes a copy, everything else is literal.
+ * Same algorithm as the backend's compute_delta.
+ */
+export function computeDelta(sig: DeltaSignature, bytes: Uint8Array): DeltaOp[] {
+  const ops: DeltaOp[] = [];
+  const emit = (copy: boolean, dst: number, src: number, length: number) => {
+    if (length === 0) return;
+    const last = ops[ops.length - 1];
+    if (last && last.copy === copy && last.dst + last.length === dst && (!copy || last.src + last.length === src)) {
+      last.length += length;
+      return;
+    }
+    ops.push({ copy, dst, src, length });
+  };
+
+  const n = sig.blockSize;
+  const byWeak = new Map<number, number[]>();
+  sig.weak.forEach((w, i) => {
+    const list = byWeak.get(w);
+    if (list) list.push(i); else byWeak.set(w, [i]);
+  });
+
+  let literalStart = 0;
+  let pos = 0;
+  let nextBlock = -1;  // Block after the last match: tried first
+  let a = 0, b = 0;
+  let fresh = true;
+
+  while (sig.weak.length > 0 && pos + n <= bytes.length) {
+    if (fresh) {
+      a = 0; b = 0;
+      for (let i = 0; i < n; i++) { a += bytes[pos + i]; b += a; }
+      a >>>= 0; b >>>= 0;
+      fresh = false;
+    }
+    const candidates = byWeak.get(((a & 0xFFFF) | ((b & 0xFFFF) << 16)) >>> 0);
+    if (candidates) {
+      const strong = crc32c(bytes.subarray(pos, pos + n));
+      let match = -1;
+      for (const index of candidates) {
+        if (sig.strong[index] !== strong) continue;
+        if (match < 0 || index === nextBlock) match = index;
+        if (index === nextBlock) break;
+      }
+      if (match >= 0) {
+        emit(false, literalStart, 0, pos - literalStart);
+        emit(true, pos, match * n, n);
+        pos += n;
+        literalStart = pos;
+        nextBlock = match + 1;
+        fresh = true;
+        continue;
+      }
+    }
+    if (pos + n < bytes.length) {
+      const out = bytes[pos];
+      a = (a + bytes[pos + n] - out) >>> 0;
+      b = (b + a - n * out) >>> 0;
+    }
+    pos++;
+  }
+  emit(false, literalStart, 0, bytes.length - literalStart);
+  return ops;
+}
+
+// === Deduplicated upload (content-defined chunks, see backend common/FastCdc.hpp) ===
+
+export const CDC_MIN_SIZE = 16 * 1024;
+export const CDC_AVG_SIZE = 64 * 1024;
+export const CDC_MAX_SIZE = 256 * 1024;
+const CDC_MASK_STRICT = 0xFFFFC000;
+const CDC_MASK_LOOSE = 0xFFFC0000;
+
+// splitmix64 from the backend's fixed seed, high 32 bits of each output
+const CDC_GEAR = (() => {
+  const gear = new Uint32Array(256);
+  const M64 = (1n << 64n) - 1n;
+  let x = 0x43414645434443n;
+  for (let i = 0; i < 256; i++) {
+    x = (x + 0x9E3779B97F4A7C15n) & M64;
+    let z = x;
+    z = ((z ^ (z >> 30n)) * 0xBF58476D1CE4E5B9n) & M64;
+    z = ((z ^ (z >> 27n)) * 0x94D049BB133111EBn) & M64;
+    gear[i] = Number((z ^ (z >> 31n)) >> 32n);
+  }
+  return gear;
+})();
+
+/**
+ * FastCDC chunk lengths of `bytes`: a gear hash cuts where its top bits are
+ * zero, so an edit only moves the boundaries near it. Same cut points as
+ * the backend's common::cdc::chunk_lengths.
+ */
+export function chunkLengths(bytes: Uint8Array): number[] {
+  const lengths: number[] = [];
+  let pos = 0;
+  while (pos < bytes.length) {
+    let size = bytes.length - pos;
+    let cut = size;
+    if (size > CDC_MIN_SIZE) {
+      if (size > CDC_MAX_SIZE) size = CDC_MAX_SIZE;
+      cut = size;
+      const normal = Math.min(size, CDC_AVG_SIZE);
+      let fp = 0;
+      let i = CDC_MIN_SIZE;
+      for (; i < normal; i++) {
+        fp = ((fp << 1) + CDC_GEAR[bytes[pos + i]]) >>> 0;
+        if ((fp & CDC_MASK_STRICT) === 0) { cut = i + 1; break; }
+      }
+      if (cut === size) {
+        for (; i < size; i++) {
+          fp = ((fp << 1) + CDC_GEAR[bytes[pos + i]]) >>> 0;
+          if ((fp & CDC_MASK_LOOSE) === 0) { cut = i + 1; break; }
+        }
+      }
+    }
+    lengths.push(cut);
+    pos += cut;
+  }
+  return lengths;
+}